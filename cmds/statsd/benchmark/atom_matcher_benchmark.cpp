@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::string;
+using std::vector;
+
+// Atom ids of the matchers that never see an event, above the ids of the real atoms.
+static const int kFirstUnusedAtomId = 200000;
+
+// A config with `matcherCount` simple matchers, each counted by a metric, and an OR combination
+// of every pair of them. Only the first matcher cares about the screen state events that are
+// logged; the others are on atoms that are never logged.
+static StatsdConfig CreateManyMatchersConfig(int matcherCount) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");
+
+    vector<AtomMatcher> matchers;
+    matchers.push_back(
+            CreateSimpleAtomMatcher("ScreenStateChanged", android::util::SCREEN_STATE_CHANGED));
+    for (int i = 1; i < matcherCount; i++) {
+        matchers.push_back(CreateSimpleAtomMatcher("Unused" + std::to_string(i),
+                                                   kFirstUnusedAtomId + i / 2));
+    }
+    for (const AtomMatcher& matcher : matchers) {
+        *config.add_atom_matcher() = matcher;
+    }
+    for (int i = 0; i + 1 < matcherCount; i += 2) {
+        AtomMatcher* combination = config.add_atom_matcher();
+        combination->set_id(StringToId("Either" + std::to_string(i)));
+        combination->mutable_combination()->set_operation(LogicalOperation::OR);
+        combination->mutable_combination()->add_matcher(matchers[i].id());
+        combination->mutable_combination()->add_matcher(matchers[i + 1].id());
+    }
+
+    for (int i = 0; i < config.atom_matcher_size(); i++) {
+        CountMetric* metric = config.add_count_metric();
+        metric->set_id(StringToId("Count" + std::to_string(i)));
+        metric->set_what(config.atom_matcher(i).id());
+        metric->set_bucket(FIVE_MINUTES);
+    }
+    return config;
+}
+
+static void BM_OnLogEventManyMatchers(benchmark::State& state) {
+    ConfigKey cfgKey;
+    const int64_t bucketStartTimeNs = 10000000000;
+    auto config = CreateManyMatchersConfig(state.range(0));
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs / NS_PER_SEC, config, cfgKey);
+
+    vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < 100; i++) {
+        events.push_back(CreateScreenStateChangedEvent(
+                bucketStartTimeNs + i, i % 2 ? android::view::DISPLAY_STATE_ON
+                                             : android::view::DISPLAY_STATE_OFF));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+BENCHMARK(BM_OnLogEventManyMatchers)->Arg(10)->Arg(100)->Arg(500);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
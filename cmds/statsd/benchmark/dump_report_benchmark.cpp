@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// Below the dimension guardrail of a metric.
+static const int kUidCount = 500;
+static const int64_t kBucketSizeNs = 5 * 60 * NS_PER_SEC;
+
+// Peak RSS growth of a dump of a config with as many past buckets of kUidCount dimensions as the
+// first argument, built in memory if the second argument is 0, or streamed to /dev/null if it is
+// 1. The data is not erased, so that every dump is as large as the first.
+static void BM_OnDumpReportPeakRss(benchmark::State& state) {
+    const int filledBuckets = state.range(0);
+    const bool streamToFd = state.range(1);
+    const int64_t bucketStartTimeNs = 10000000000;
+
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");
+    auto syncStartMatcher = CreateSyncStartAtomMatcher();
+    *config.add_atom_matcher() = syncStartMatcher;
+    CountMetric* metric = config.add_count_metric();
+    metric->set_id(StringToId("SyncCountPerUid"));
+    metric->set_what(syncStartMatcher.id());
+    *metric->mutable_dimensions_in_what() =
+            CreateAttributionUidDimensions(android::util::SYNC_STATE_CHANGED, {Position::FIRST});
+    metric->set_bucket(FIVE_MINUTES);
+
+    ConfigKey cfgKey;
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs / NS_PER_SEC, config, cfgKey);
+    for (int bucket = 0; bucket < filledBuckets; bucket++) {
+        const int64_t bucketNs = bucketStartTimeNs + bucket * kBucketSizeNs;
+        for (int uid = 0; uid < kUidCount; uid++) {
+            auto event = CreateSyncStartEvent(bucketNs + uid, {10000 + uid}, {"App"}, "sync");
+            processor->OnLogEvent(event.get());
+        }
+    }
+    const int64_t dumpTimeNs = bucketStartTimeNs + filledBuckets * kBucketSizeNs;
+
+    android::base::unique_fd devNull(open("/dev/null", O_WRONLY | O_CLOEXEC));
+    int64_t maxPeakGrowthKb = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        resetPeakRss();
+        const int64_t rssBeforeKb = readProcStatusKb("VmRSS");
+        state.ResumeTiming();
+
+        if (streamToFd) {
+            processor->onDumpReport(cfgKey, dumpTimeNs, false /* include_current_partial_bucket */,
+                                    false /* erase_data */, ADB_DUMP, FAST, devNull.get());
+        } else {
+            vector<uint8_t> output;
+            processor->onDumpReport(cfgKey, dumpTimeNs, false /* include_current_partial_bucket */,
+                                    false /* erase_data */, ADB_DUMP, FAST, &output);
+            benchmark::DoNotOptimize(output.data());
+        }
+
+        state.PauseTiming();
+        maxPeakGrowthKb = std::max(maxPeakGrowthKb, readProcStatusKb("VmHWM") - rssBeforeKb);
+        state.ResumeTiming();
+    }
+    state.counters["peak_rss_growth_kb"] = maxPeakGrowthKb;
+}
+
+BENCHMARK(BM_OnDumpReportPeakRss)
+        ->Args({10, 0})
+        ->Args({10, 1})
+        ->Args({100, 0})
+        ->Args({100, 1});
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
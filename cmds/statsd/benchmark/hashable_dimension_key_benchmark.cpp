@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HashableDimensionKey.h"
+#include "benchmark/benchmark.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+static const int kKeyCount = 1000;
+
+// A key of (uid, package name), like the dimensions of many per app metrics.
+static HashableDimensionKey createKey(int i) {
+    int pos1[] = {1, 0, 0};
+    int pos2[] = {2, 0, 0};
+    HashableDimensionKey key;
+    key.addValue(FieldValue(Field(10 /* atom id */, pos1, 0 /* depth */), Value((int32_t)i)));
+    key.addValue(FieldValue(Field(10 /* atom id */, pos2, 0 /* depth */),
+                            Value("com.example.package" + std::to_string(i))));
+    return key;
+}
+
+// Looks up the keys of new events in a map of kKeyCount dimensions, with the keys of the events
+// and of the map interned or not depending on the argument.
+static void BM_DimensionKeyMapLookup(benchmark::State& state) {
+    const bool intern = state.range(0);
+    std::unordered_map<HashableDimensionKey, int64_t> counts;
+    for (int i = 0; i < kKeyCount; i++) {
+        HashableDimensionKey key = createKey(i);
+        if (intern) {
+            key.intern();
+        }
+        counts[key] = 0;
+    }
+
+    int i = 0;
+    while (state.KeepRunning()) {
+        // Every event has its own key, like the dimension filtered from each event.
+        HashableDimensionKey key = createKey(i);
+        if (intern) {
+            key.intern();
+        }
+        counts[key]++;
+        i = (i + 1) % kKeyCount;
+    }
+}
+BENCHMARK(BM_DimensionKeyMapLookup)->Arg(0)->Arg(1);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -16,6 +16,8 @@
 #include <vector>
 #include "benchmark/benchmark.h"
 #include "logd/LogEvent.h"
+#include "logd/LogEventQueue.h"
+#include "metric_util.h"
 #include "stats_event.h"
 
 namespace android {
@@ -38,13 +40,54 @@ static size_t createAndParseStatsEvent(uint8_t* msg) {
 static void BM_LogEventCreation(benchmark::State& state) {
     uint8_t msg[LOGGER_ENTRY_MAX_PAYLOAD];
     size_t size = createAndParseStatsEvent(msg);
+    startCountingAllocations();
     while (state.KeepRunning()) {
         LogEvent event(/*uid=*/ 1000, /*pid=*/ 1001);
         benchmark::DoNotOptimize(event.parseBuffer(msg, size));
     }
+    state.counters["allocs_per_event"] =
+            (double)stopCountingAllocations() / state.iterations();
 }
 BENCHMARK(BM_LogEventCreation);
 
+// Like the socket listener and the processing thread of statsd: events are obtained from the
+// queue, parsed, pushed, popped in batches and recycled.
+static void BM_LogEventQueueRecycled(benchmark::State& state) {
+    uint8_t msg[LOGGER_ENTRY_MAX_PAYLOAD];
+    size_t size = createAndParseStatsEvent(msg);
+    const size_t batchSize = 64;
+    LogEventQueue queue(2000);
+    std::vector<std::unique_ptr<LogEvent>> events;
+    int64_t oldestTimestampNs;
+    int64_t allocationsBefore = 0;
+    int64_t measuredEvents = 0;
+    bool warm = false;
+    startCountingAllocations();
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < batchSize; i++) {
+            std::unique_ptr<LogEvent> event = queue.obtain(/*uid=*/ 1000, /*pid=*/ 1001);
+            event->parseBuffer(msg, size);
+            queue.push(std::move(event), &oldestTimestampNs);
+        }
+        queue.popBatch(&events, batchSize);
+        queue.recycle(&events);
+        // Leaves out the first batch, which has no event to recycle.
+        if (warm) {
+            measuredEvents += batchSize;
+        } else {
+            allocationsBefore = countedAllocations();
+            warm = true;
+        }
+    }
+    const int64_t allocations = stopCountingAllocations();
+    if (measuredEvents > 0) {
+        state.counters["allocs_per_event"] =
+                (double)(allocations - allocationsBefore) / measuredEvents;
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+BENCHMARK(BM_LogEventQueueRecycled);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
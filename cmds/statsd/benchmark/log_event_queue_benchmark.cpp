@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEventQueue.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// Latency of pushing an event while range(0) - 1 other threads push events as fast as they can,
+// and the consumer pops batches of up to range(1) events.
+static void BM_LogEventQueuePushUnderContention(benchmark::State& state) {
+    const int producerCount = state.range(0);
+    const size_t batchSize = state.range(1);
+    // The size statsd uses.
+    LogEventQueue queue(2000);
+    std::atomic<bool> done(false);
+
+    std::thread consumer([&] {
+        vector<std::unique_ptr<LogEvent>> events;
+        while (!done) {
+            events.clear();
+            queue.popBatch(&events, batchSize);
+        }
+    });
+    vector<std::thread> producers;
+    for (int i = 1; i < producerCount; i++) {
+        producers.emplace_back([&] {
+            int64_t oldestTimestampNs;
+            while (!done) {
+                queue.push(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0), &oldestTimestampNs);
+            }
+        });
+    }
+
+    vector<int64_t> latenciesNs;
+    int64_t oldestTimestampNs;
+    int64_t dropped = 0;
+    while (state.KeepRunning()) {
+        auto event = std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0);
+        const auto start = std::chrono::steady_clock::now();
+        if (!queue.push(std::move(event), &oldestTimestampNs)) {
+            dropped++;
+        }
+        latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count());
+    }
+
+    done = true;
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    // Wakes up the consumer if it is waiting for an event.
+    queue.push(std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0), &oldestTimestampNs);
+    consumer.join();
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    if (!latenciesNs.empty()) {
+        state.counters["p50_ns"] = latenciesNs[latenciesNs.size() / 2];
+        state.counters["p99_ns"] = latenciesNs[latenciesNs.size() * 99 / 100];
+        state.counters["max_ns"] = latenciesNs.back();
+    }
+    state.counters["dropped"] = dropped;
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LogEventQueuePushUnderContention)
+        ->Args({1, 1})
+        ->Args({1, 64})
+        ->Args({4, 1})
+        ->Args({4, 64})
+        ->UseRealTime();
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -14,8 +14,36 @@
 
 #include "metric_util.h"
 
+#include <android-base/file.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 #include "stats_event.h"
 
+static std::atomic<bool> gCountAllocations(false);
+static std::atomic<int64_t> gAllocationCount(0);
+
+void* operator new(size_t size) {
+    if (gCountAllocations.load(std::memory_order_relaxed)) {
+        gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
 namespace android {
 namespace os {
 namespace statsd {
@@ -373,6 +401,35 @@ int64_t StringToId(const string& str) {
     return static_cast<int64_t>(std::hash<std::string>()(str));
 }
 
+int64_t readProcStatusKb(const string& field) {
+    string status;
+    if (!android::base::ReadFileToString("/proc/self/status", &status)) {
+        return -1;
+    }
+    size_t pos = status.find(field + ":");
+    if (pos == string::npos) {
+        return -1;
+    }
+    return strtoll(status.c_str() + pos + field.size() + 1, nullptr, 10);
+}
+
+void resetPeakRss() {
+    android::base::WriteStringToFile("5", "/proc/self/clear_refs");
+}
+
+void startCountingAllocations() {
+    gAllocationCount = 0;
+    gCountAllocations = true;
+}
+
+int64_t countedAllocations() {
+    return gAllocationCount;
+}
+
+int64_t stopCountingAllocations() {
+    gCountAllocations = false;
+    return gAllocationCount;
+}
 
 }  // namespace statsd
 }  // namespace os
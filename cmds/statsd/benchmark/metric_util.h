@@ -135,6 +135,23 @@ void sortLogEventsByTimestamp(std::vector<std::unique_ptr<LogEvent>> *events);
 
 int64_t StringToId(const string& str);
 
+// Reads a field of /proc/self/status, such as VmRSS or VmHWM, in KB. Returns -1 on failure.
+int64_t readProcStatusKb(const string& field);
+
+// Resets VmHWM to the current RSS, so that it tracks the peak of what runs next only.
+void resetPeakRss();
+
+// The benchmark binary replaces operator new to count allocations, of every thread, between
+// startCountingAllocations() and stopCountingAllocations(). The other benchmarks only pay for a
+// relaxed load per allocation.
+void startCountingAllocations();
+
+// Returns the allocations counted since startCountingAllocations().
+int64_t countedAllocations();
+
+// Stops counting, and returns the allocations counted since startCountingAllocations().
+int64_t stopCountingAllocations();
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+static const int kConfigCount = 4;
+// Below the dimension guardrail of a metric.
+static const int kUidCount = 500;
+// Buckets filled before the benchmark, which every dump of a config serializes again.
+static const int kFilledBuckets = 40;
+static const int64_t kBucketSizeNs = 5 * 60 * NS_PER_SEC;
+
+// Counts the syncs of each uid.
+static StatsdConfig CreateSyncCountConfig() {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");
+    auto syncStartMatcher = CreateSyncStartAtomMatcher();
+    *config.add_atom_matcher() = syncStartMatcher;
+    CountMetric* metric = config.add_count_metric();
+    metric->set_id(StringToId("SyncCountPerUid"));
+    metric->set_what(syncStartMatcher.id());
+    *metric->mutable_dimensions_in_what() =
+            CreateAttributionUidDimensions(android::util::SYNC_STATE_CHANGED, {Position::FIRST});
+    metric->set_bucket(FIVE_MINUTES);
+    return config;
+}
+
+static std::unique_ptr<LogEvent> CreateSyncEventForUid(int64_t timestampNs, int uid) {
+    return CreateSyncStartEvent(timestampNs, {10000 + uid}, {"App"}, "sync");
+}
+
+// Latency of logging an event while another thread keeps dumping the first config, with the
+// sharding mode of the argument.
+static void BM_OnLogEventDuringDumps(benchmark::State& state) {
+    const int64_t bucketStartTimeNs = 10000000000;
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+    sp<StatsLogProcessor> processor = new StatsLogProcessor(
+            new UidMap(), new StatsPullerManager(), anomalyAlarmMonitor, periodicAlarmMonitor,
+            bucketStartTimeNs,
+            [](const ConfigKey&) { return true; },
+            [](const int&, const vector<int64_t>&) { return true; },
+            static_cast<StatsLogProcessor::ShardingMode>(state.range(0)));
+    const StatsdConfig config = CreateSyncCountConfig();
+    for (int i = 0; i < kConfigCount; i++) {
+        processor->OnConfigUpdated(bucketStartTimeNs, ConfigKey(1000 + i, i), config);
+    }
+
+    for (int bucket = 0; bucket < kFilledBuckets; bucket++) {
+        const int64_t bucketNs = bucketStartTimeNs + bucket * kBucketSizeNs;
+        for (int uid = 0; uid < kUidCount; uid++) {
+            auto event = CreateSyncEventForUid(bucketNs + uid, uid);
+            processor->OnLogEvent(event.get());
+        }
+    }
+    const int64_t currentBucketStartNs = bucketStartTimeNs + kFilledBuckets * kBucketSizeNs;
+    vector<std::unique_ptr<LogEvent>> events;
+    for (int uid = 0; uid < kUidCount; uid++) {
+        events.push_back(CreateSyncEventForUid(currentBucketStartNs + uid, uid));
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<int> dumps(0);
+    std::thread dumper([&] {
+        vector<uint8_t> output;
+        while (!done) {
+            // Leaves the filled buckets in place, so that every dump is as long as the first.
+            processor->onDumpReport(ConfigKey(1000, 0), currentBucketStartNs,
+                                    false /* include_current_partial_bucket */,
+                                    false /* erase_data */, GET_DATA_CALLED, FAST, &output);
+            dumps++;
+        }
+    });
+
+    vector<int64_t> latenciesNs;
+    size_t next = 0;
+    while (state.KeepRunning()) {
+        const auto start = std::chrono::steady_clock::now();
+        processor->OnLogEvent(events[next].get());
+        latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count());
+        next = (next + 1) % events.size();
+    }
+    done = true;
+    dumper.join();
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    if (!latenciesNs.empty()) {
+        state.counters["p50_ns"] = latenciesNs[latenciesNs.size() / 2];
+        state.counters["p99_ns"] = latenciesNs[latenciesNs.size() * 99 / 100];
+        state.counters["max_ns"] = latenciesNs.back();
+    }
+    state.counters["dumps"] = dumps;
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_OnLogEventDuringDumps)
+        ->Arg(static_cast<int>(StatsLogProcessor::ShardingMode::NONE))
+        ->Arg(static_cast<int>(StatsLogProcessor::ShardingMode::WORKER_PER_CONFIG))
+        ->UseRealTime();
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+
+#include "FieldValue.h"
+#include "HashableDimensionKey.h"
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "src/condition/SimpleConditionTracker.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+static const int kSyncsPerUid = 4;
+
+// Partial link queries by uid of a condition sliced by uid and sync name, with as many uids as
+// the first argument, answered by a scan of the slices if the second argument is 0, or by the
+// index of the link fields if it is 1.
+static void BM_SlicedConditionPartialLinkQuery(benchmark::State& state) {
+    const int uidCount = state.range(0);
+    const bool indexed = state.range(1);
+    const int atomId = android::util::SYNC_STATE_CHANGED;
+    const int64_t conditionId = StringToId("IsSyncingPerUidAndName");
+
+    SimplePredicate simplePredicate;
+    simplePredicate.set_start(StringToId("SyncStart"));
+    simplePredicate.set_stop(StringToId("SyncEnd"));
+    simplePredicate.set_count_nesting(false);
+    simplePredicate.set_initial_value(SimplePredicate_InitialValue_FALSE);
+    *simplePredicate.mutable_dimensions() =
+            CreateAttributionUidDimensions(atomId, {Position::FIRST});
+    simplePredicate.mutable_dimensions()->add_child()->set_field(2);
+
+    unordered_map<int64_t, int> trackerNameIndexMap;
+    trackerNameIndexMap[StringToId("SyncStart")] = 0;
+    trackerNameIndexMap[StringToId("SyncEnd")] = 1;
+    SimpleConditionTracker conditionTracker(ConfigKey(0, 12345), conditionId,
+                                            0 /*condition tracker index*/, simplePredicate,
+                                            trackerNameIndexMap);
+
+    vector<Matcher> linkConditionFields;
+    translateFieldMatcher(CreateAttributionUidDimensions(atomId, {Position::FIRST}),
+                          &linkConditionFields);
+    if (indexed) {
+        conditionTracker.addSlicedConditionIndex(linkConditionFields);
+    }
+
+    vector<sp<ConditionTracker>> allPredicates;
+    vector<MatchingState> matcherState = {MatchingState::kMatched, MatchingState::kNotMatched};
+    vector<ConditionKey> queryKeys;
+    for (int uid = 0; uid < uidCount; uid++) {
+        for (int sync = 0; sync < kSyncsPerUid; sync++) {
+            auto event = CreateSyncStartEvent(uid * kSyncsPerUid + sync, {10000 + uid}, {"App"},
+                                              "sync" + std::to_string(sync));
+            vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+            vector<bool> changedCache(1, false);
+            conditionTracker.evaluateCondition(*event, matcherState, allPredicates,
+                                               conditionCache, changedCache);
+            if (sync == 0) {
+                HashableDimensionKey queryKey;
+                filterValues(linkConditionFields, event->getValues(), &queryKey);
+                queryKeys.push_back({{conditionId, queryKey}});
+            }
+        }
+    }
+
+    size_t query = 0;
+    while (state.KeepRunning()) {
+        vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+        conditionTracker.isConditionMet(queryKeys[query], allPredicates, true /*isPartialLink*/,
+                                        conditionCache);
+        benchmark::DoNotOptimize(conditionCache[0]);
+        query = (query + 1) % queryKeys.size();
+    }
+}
+
+// 150 uids of kSyncsPerUid slices stay below the hard dimension guardrail of a condition.
+BENCHMARK(BM_SlicedConditionPartialLinkQuery)
+        ->Args({10, 0})
+        ->Args({10, 1})
+        ->Args({150, 0})
+        ->Args({150, 1});
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
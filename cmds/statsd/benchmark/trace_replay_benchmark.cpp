@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a recorded trace of the statsd socket against a real config, through the whole
+// StatsLogProcessor: events, pull alarms served from the trace, anomaly and periodic alarms, and
+// the dumps of a client collecting the data.
+//
+// The config and the trace are read from the files named by the STATSD_REPLAY_CONFIG and
+// STATSD_REPLAY_TRACE environment variables. The config is a serialized StatsdConfig, as given
+// to "cmd stats config update". The trace is a sequence of records of
+//
+//     uint32 uid | uint32 pid | uint32 size | size bytes of payload
+//
+// in host byte order, where the payload is what StatsSocketListener gives to
+// LogEvent::parseBuffer, that is the datagram without its android_log_header_t and its tag.
+// Records must be ordered by the elapsed timestamps of their events.
+//
+// Records of pulled atoms are not logged. The rows recorded with the same timestamp form the
+// data of a pull, which the pulls of the replay get from the time it is recorded until the next
+// one. These records carry the uid of the process serving the pull, such as AID_SYSTEM.
+//
+// Packages of the config, such as allowed log sources, are not resolved, as the uid map is empty.
+
+#include <android-base/file.h>
+#include <private/android_filesystem_config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "src/anomaly/AlarmMonitor.h"
+#include "src/external/StatsPuller.h"
+#include "src/external/StatsPullerManager.h"
+#include "src/stats_log_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// Alarms are checked when an event crosses a second, which is the resolution of AlarmMonitor.
+static const int64_t kAlarmCheckIntervalNs = NS_PER_SEC;
+// Same as StatsService.
+static const uint32_t kMinDiffToUpdateRegisteredAlarmSecs = 5;
+
+typedef struct {
+    int32_t uid;
+    int32_t pid;
+    size_t offset;
+    uint32_t size;
+} TraceRecord;
+
+// Splits the trace in records. Returns false if the trace is truncated.
+static bool ReadTraceRecords(const string& trace, vector<TraceRecord>* records) {
+    size_t offset = 0;
+    while (offset < trace.size()) {
+        uint32_t header[3];
+        if (trace.size() - offset < sizeof(header)) {
+            return false;
+        }
+        memcpy(header, trace.data() + offset, sizeof(header));
+        offset += sizeof(header);
+        if (trace.size() - offset < header[2]) {
+            return false;
+        }
+        records->push_back({(int32_t)header[0], (int32_t)header[1], offset, header[2]});
+        offset += header[2];
+    }
+    return true;
+}
+
+// Serves the rows of an atom most recently recorded in the trace.
+class ReplayPuller : public StatsPuller {
+public:
+    // No cooldown, as the replay runs much faster than the trace was recorded.
+    explicit ReplayPuller(int tagId) : StatsPuller(tagId, 0 /* coolDownNs */) {
+    }
+
+    // Rows recorded at another time than the current ones start the data of a new pull.
+    void addRecordedRow(const shared_ptr<LogEvent>& row) {
+        std::lock_guard<std::mutex> lock(mRowsLock);
+        if (!mRows.empty() &&
+            mRows.back()->GetElapsedTimestampNs() != row->GetElapsedTimestampNs()) {
+            mRows.clear();
+        }
+        mRows.push_back(row);
+    }
+
+private:
+    bool PullInternal(vector<shared_ptr<LogEvent>>* data) override {
+        std::lock_guard<std::mutex> lock(mRowsLock);
+        // Copies, as the rows are merged by uid and restamped after the pull.
+        for (const auto& row : mRows) {
+            // The copy constructor of LogEvent is private, so it can't go through make_shared.
+            data->push_back(shared_ptr<LogEvent>(new LogEvent(row->makeCopy())));
+        }
+        return true;
+    }
+
+    std::mutex mRowsLock;
+    vector<shared_ptr<LogEvent>> mRows;
+};
+
+static int64_t ElapsedNsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                start)
+            .count();
+}
+
+// Replays the trace against the config, dumping the data as often as the argument in minutes of
+// the trace.
+static void BM_ReplayTrace(benchmark::State& state) {
+    const int64_t dumpIntervalNs = state.range(0) * 60 * NS_PER_SEC;
+    const char* configPath = getenv("STATSD_REPLAY_CONFIG");
+    const char* tracePath = getenv("STATSD_REPLAY_TRACE");
+    if (configPath == nullptr || tracePath == nullptr) {
+        state.SkipWithError("STATSD_REPLAY_CONFIG and STATSD_REPLAY_TRACE are not set");
+        return;
+    }
+    string configBytes;
+    StatsdConfig config;
+    if (!android::base::ReadFileToString(configPath, &configBytes) ||
+        !config.ParseFromString(configBytes)) {
+        state.SkipWithError("Cannot read the config");
+        return;
+    }
+    string trace;
+    vector<TraceRecord> records;
+    if (!android::base::ReadFileToString(tracePath, &trace) ||
+        !ReadTraceRecords(trace, &records)) {
+        state.SkipWithError("Cannot read the trace");
+        return;
+    }
+    const ConfigKey cfgKey(AID_SYSTEM, config.id());
+
+    int64_t parseNs = 0;
+    int64_t logEventNs = 0;
+    int64_t alarmNs = 0;
+    int64_t dumpNs = 0;
+    int64_t events = 0;
+    int64_t pulledRows = 0;
+    int64_t dumps = 0;
+    int64_t maxPeakGrowthKb = 0;
+    int64_t allocations = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        sp<UidMap> uidMap = new UidMap();
+        StatsPuller::SetUidMap(uidMap);
+        sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+        sp<AlarmMonitor> anomalyAlarmMonitor =
+                new AlarmMonitor(kMinDiffToUpdateRegisteredAlarmSecs,
+                                 [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
+                                 [](const shared_ptr<IStatsCompanionService>&) {});
+        sp<AlarmMonitor> periodicAlarmMonitor =
+                new AlarmMonitor(kMinDiffToUpdateRegisteredAlarmSecs,
+                                 [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
+                                 [](const shared_ptr<IStatsCompanionService>&) {});
+        // The trace is moved to the current time, as pulls are timed with the real clock.
+        const int64_t startTimeNs = getElapsedRealtimeNs();
+        sp<StatsLogProcessor> processor = new StatsLogProcessor(
+                uidMap, pullerManager, anomalyAlarmMonitor, periodicAlarmMonitor, startTimeNs,
+                [](const ConfigKey&) { return true; },
+                [](const int&, const vector<int64_t>&) { return true; });
+        processor->OnConfigUpdated(startTimeNs, cfgKey, config);
+        std::map<PullerKey, sp<ReplayPuller>> pullers;
+        bool hasTraceOffset = false;
+        int64_t traceOffsetNs = 0;
+        int64_t nextAlarmCheckNs = 0;
+        int64_t nextDumpNs = startTimeNs + dumpIntervalNs;
+        int64_t lastEventNs = startTimeNs;
+        vector<uint8_t> output;
+
+        resetPeakRss();
+        const int64_t rssBeforeKb = readProcStatusKb("VmRSS");
+        startCountingAllocations();
+        state.ResumeTiming();
+
+        for (const TraceRecord& record : records) {
+            auto start = std::chrono::steady_clock::now();
+            shared_ptr<LogEvent> event = std::make_shared<LogEvent>(record.uid, record.pid);
+            event->parseBuffer(reinterpret_cast<uint8_t*>(&trace[record.offset]), record.size);
+            parseNs += ElapsedNsSince(start);
+            if (!event->isValid()) {
+                continue;
+            }
+            if (!hasTraceOffset) {
+                traceOffsetNs = startTimeNs - event->GetElapsedTimestampNs();
+                hasTraceOffset = true;
+            }
+            const int64_t eventNs = event->GetElapsedTimestampNs() + traceOffsetNs;
+            event->setElapsedTimestampNs(eventNs);
+            lastEventNs = eventNs;
+
+            // Alarms due before the event fire first, as they would have on the device.
+            if (eventNs >= nextAlarmCheckNs) {
+                start = std::chrono::steady_clock::now();
+                processor->informPullAlarmFired(eventNs);
+                const uint32_t eventSec = eventNs / NS_PER_SEC;
+                auto anomalyAlarms = anomalyAlarmMonitor->popSoonerThan(eventSec);
+                if (!anomalyAlarms.empty()) {
+                    processor->onAnomalyAlarmFired(eventNs, anomalyAlarms);
+                }
+                auto periodicAlarms = periodicAlarmMonitor->popSoonerThan(eventSec);
+                if (!periodicAlarms.empty()) {
+                    processor->onPeriodicAlarmFired(eventNs, periodicAlarms);
+                }
+                nextAlarmCheckNs = eventNs + kAlarmCheckIntervalNs;
+                alarmNs += ElapsedNsSince(start);
+            }
+            if (eventNs >= nextDumpNs) {
+                start = std::chrono::steady_clock::now();
+                processor->onDumpReport(cfgKey, eventNs, false /* include_current_partial_bucket */,
+                                        true /* erase_data */, GET_DATA_CALLED, FAST, &output);
+                nextDumpNs = eventNs + dumpIntervalNs;
+                dumps++;
+                dumpNs += ElapsedNsSince(start);
+            }
+
+            const int tagId = event->GetTagId();
+            if (isPulledAtom(tagId) || isVendorPulledAtom(tagId)) {
+                const PullerKey key = {.atomTag = tagId, .uid = record.uid};
+                auto it = pullers.find(key);
+                if (it == pullers.end()) {
+                    it = pullers.emplace(key, new ReplayPuller(tagId)).first;
+                    pullerManager->kAllPullAtomInfo[key] = it->second;
+                }
+                it->second->addRecordedRow(event);
+                pulledRows++;
+                continue;
+            }
+            start = std::chrono::steady_clock::now();
+            processor->OnLogEvent(event.get());
+            logEventNs += ElapsedNsSince(start);
+            events++;
+        }
+        auto start = std::chrono::steady_clock::now();
+        processor->onDumpReport(cfgKey, lastEventNs, true /* include_current_partial_bucket */,
+                                true /* erase_data */, GET_DATA_CALLED, FAST, &output);
+        dumps++;
+        dumpNs += ElapsedNsSince(start);
+
+        state.PauseTiming();
+        allocations += stopCountingAllocations();
+        maxPeakGrowthKb = std::max(maxPeakGrowthKb, readProcStatusKb("VmHWM") - rssBeforeKb);
+        state.ResumeTiming();
+    }
+
+    const double iterations = state.iterations();
+    state.counters["pulled_rows"] = pulledRows / iterations;
+    state.counters["dumps"] = dumps / iterations;
+    state.counters["parse_ms"] = parseNs / iterations / 1000000;
+    state.counters["log_event_ms"] = logEventNs / iterations / 1000000;
+    state.counters["alarm_ms"] = alarmNs / iterations / 1000000;
+    state.counters["dump_ms"] = dumpNs / iterations / 1000000;
+    state.counters["allocations"] = allocations / iterations;
+    state.counters["peak_rss_growth_kb"] = maxPeakGrowthKb;
+    // Reported as events per second.
+    state.SetItemsProcessed(events);
+}
+
+BENCHMARK(BM_ReplayTrace)->Arg(60)->Unit(benchmark::kMillisecond);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
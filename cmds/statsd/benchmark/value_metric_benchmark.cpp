@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "src/condition/ConditionWizard.h"
+#include "src/external/StatsPullerManager.h"
+#include "src/matchers/EventMatcherWizard.h"
+#include "src/matchers/SimpleLogMatchingTracker.h"
+#include "src/metrics/ValueMetricProducer.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::shared_ptr;
+using std::vector;
+
+static const int kFreqCount = 8;
+static const int64_t kBucketSizeNs = 5 * 60 * NS_PER_SEC;
+
+// A pull of CpuTimePerUidFreq with `rowCount` rows of kFreqCount frequencies per uid, ordered by
+// uid like the kernel reports them unless `shuffled`. Every row grows by its uid at each pull.
+static vector<shared_ptr<LogEvent>> CreateCpuTimePerUidFreqPull(int rowCount, int pull,
+                                                                int64_t timestampNs,
+                                                                bool shuffled) {
+    vector<shared_ptr<LogEvent>> data;
+    for (int row = 0; row < rowCount; row++) {
+        const int uid = 10000 + row / kFreqCount;
+        AStatsEvent* statsEvent = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(statsEvent, android::util::CPU_TIME_PER_UID_FREQ);
+        AStatsEvent_overwriteTimestamp(statsEvent, timestampNs);
+        AStatsEvent_writeInt32(statsEvent, uid);
+        AStatsEvent_writeInt32(statsEvent, row % kFreqCount);
+        AStatsEvent_writeInt64(statsEvent, (int64_t)pull * uid);
+
+        shared_ptr<LogEvent> event = std::make_shared<LogEvent>(/*uid=*/0, /*pid=*/0);
+        parseStatsEventToLogEvent(statsEvent, event.get());
+        data.push_back(event);
+    }
+    if (shuffled) {
+        std::shuffle(data.begin(), data.end(), std::default_random_engine(pull));
+    }
+    return data;
+}
+
+// Diffs of pulls of `rowCount` rows at each bucket boundary, with the sorted diff disabled or
+// enabled by the second argument, and rows pulled in uid order or shuffled by the third.
+static void BM_ValueMetricOnDataPulled(benchmark::State& state) {
+    const int rowCount = state.range(0);
+    const bool sortedDiff = state.range(1);
+    const bool shuffled = state.range(2);
+    const int64_t bucketStartTimeNs = 10000000000;
+    const int atomId = android::util::CPU_TIME_PER_UID_FREQ;
+
+    ValueMetric metric;
+    metric.set_id(StringToId("CpuTimePerUidFreq"));
+    metric.set_bucket(FIVE_MINUTES);
+    metric.mutable_value_field()->set_field(atomId);
+    metric.mutable_value_field()->add_child()->set_field(3);
+    *metric.mutable_dimensions_in_what() = CreateDimensions(atomId, {1, 2});
+    metric.set_max_pull_delay_sec(INT_MAX);
+
+    UidMap uidMap;
+    SimpleAtomMatcher atomMatcher;
+    atomMatcher.set_atom_id(atomId);
+    sp<EventMatcherWizard> eventMatcherWizard = new EventMatcherWizard(
+            {new SimpleLogMatchingTracker(StringToId("CpuTimePerUidFreqMatcher"), 0, atomMatcher,
+                                          uidMap)});
+    sp<ValueMetricProducer> valueProducer = new ValueMetricProducer(
+            ConfigKey(0, 12345), metric, -1 /* no condition */, {}, new ConditionWizard(),
+            0 /* whatMatcherIndex */, eventMatcherWizard, atomId, bucketStartTimeNs,
+            bucketStartTimeNs, new StatsPullerManager());
+
+    ValueMetricProducer::setSortedDiffEnabled(sortedDiff);
+    // Sets the bases.
+    valueProducer->onDataPulled(
+            CreateCpuTimePerUidFreqPull(rowCount, 1, bucketStartTimeNs, shuffled),
+            true /* pullSuccess */, bucketStartTimeNs);
+    int pull = 2;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        const int64_t pullTimeNs = bucketStartTimeNs + (pull - 1) * kBucketSizeNs;
+        auto data = CreateCpuTimePerUidFreqPull(rowCount, pull, pullTimeNs, shuffled);
+        pull++;
+        state.ResumeTiming();
+
+        valueProducer->onDataPulled(data, true /* pullSuccess */, pullTimeNs);
+
+        state.PauseTiming();
+        valueProducer->clearPastBuckets(pullTimeNs);
+        state.ResumeTiming();
+    }
+    ValueMetricProducer::setSortedDiffEnabled(false);
+    state.SetItemsProcessed(state.iterations() * rowCount);
+}
+
+BENCHMARK(BM_ValueMetricOnDataPulled)
+        ->Args({5000, 0, 0})
+        ->Args({5000, 1, 0})
+        ->Args({5000, 0, 1})
+        ->Args({5000, 1, 1})
+        ->Args({9000, 0, 0})
+        ->Args({9000, 1, 0});
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
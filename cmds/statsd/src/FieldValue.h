@@ -304,6 +304,16 @@ struct Value {
         type = STORAGE;
     }
 
+    Value(std::string&& v) {
+        str_value = std::move(v);
+        type = STRING;
+    }
+
+    Value(std::vector<uint8_t>&& v) {
+        storage_value = std::move(v);
+        type = STORAGE;
+    }
+
     void setInt(int32_t v) {
         int_value = v;
         type = INT;
@@ -346,6 +356,7 @@ struct Value {
     double getDouble() const;
 
     Value(const Value& from);
+    Value(Value&& from) noexcept;
 
     bool operator==(const Value& that) const;
     bool operator!=(const Value& that) const;
@@ -356,6 +367,7 @@ struct Value {
     Value operator-(const Value& that) const;
     Value& operator+=(const Value& that);
     Value& operator=(const Value& that);
+    Value& operator=(Value&& that) noexcept;
 };
 
 class Annotations {
@@ -415,6 +427,8 @@ struct FieldValue {
     FieldValue() {}
     FieldValue(const Field& field, const Value& value) : mField(field), mValue(value) {
     }
+    FieldValue(const Field& field, Value&& value) : mField(field), mValue(std::move(value)) {
+    }
     bool operator==(const FieldValue& that) const {
         return mField == that.mField && mValue == that.mValue;
     }
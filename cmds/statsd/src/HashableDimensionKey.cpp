@@ -19,6 +19,10 @@
 #include "HashableDimensionKey.h"
 #include "FieldValue.h"
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 namespace os {
 namespace statsd {
@@ -36,6 +40,46 @@ const static int STATS_DIMENSIONS_VALUE_LONG_TYPE = 4;
 const static int STATS_DIMENSIONS_VALUE_FLOAT_TYPE = 6;
 const static int STATS_DIMENSIONS_VALUE_TUPLE_TYPE = 7;
 
+// The intern table is split in stripes of their own lock, as metrics of different configs can be
+// processed in parallel.
+const static int kInternStripeCount = 16;
+// Stripes remove the entries of values that are no longer used when they reach this many
+// entries, or twice as many as they had after their last sweep.
+const static size_t kMinInternSweepSize = 64;
+
+namespace {
+
+struct InternStripe {
+    std::mutex lock;
+    std::unordered_multimap<android::hash_t, std::weak_ptr<std::vector<FieldValue>>> values;
+    size_t sweepSize = kMinInternSweepSize;
+};
+
+InternStripe* getInternStripes() {
+    static InternStripe* stripes = new InternStripe[kInternStripeCount];
+    return stripes;
+}
+
+std::atomic<bool> gInterningEnabled(false);
+
+// Unlike FieldValue::operator==, also compares the annotations, which are shared with the values.
+bool sameValues(const vector<FieldValue>& a, const vector<FieldValue>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i] || a[i].mAnnotations.isNested() != b[i].mAnnotations.isNested() ||
+            a[i].mAnnotations.isPrimaryField() != b[i].mAnnotations.isPrimaryField() ||
+            a[i].mAnnotations.isExclusiveState() != b[i].mAnnotations.isExclusiveState() ||
+            a[i].mAnnotations.isUidField() != b[i].mAnnotations.isUidField()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 /**
  * Recursive helper function that populates a parent StatsDimensionsValueParcel
  * with children StatsDimensionsValueParcels.
@@ -104,25 +148,26 @@ static void populateStatsDimensionsValueParcelChildren(StatsDimensionsValueParce
 
 StatsDimensionsValueParcel HashableDimensionKey::toStatsDimensionsValueParcel() const {
     StatsDimensionsValueParcel root;
-    if (mValues.size() == 0) {
+    const vector<FieldValue>& values = getValues();
+    if (values.size() == 0) {
         return root;
     }
 
-    root.field = mValues[0].mField.getTag();
+    root.field = values[0].mField.getTag();
     root.valueType = STATS_DIMENSIONS_VALUE_TUPLE_TYPE;
 
     // Children of the root correspond to top-level (depth = 0) FieldValues.
     int childDepth = 0;
     int childPrefix = 0;
     size_t index = 0;
-    populateStatsDimensionsValueParcelChildren(root, childDepth, childPrefix, mValues, index);
+    populateStatsDimensionsValueParcelChildren(root, childDepth, childPrefix, values, index);
 
     return root;
 }
 
-android::hash_t hashDimension(const HashableDimensionKey& value) {
+static android::hash_t computeHash(const vector<FieldValue>& values) {
     android::hash_t hash = 0;
-    for (const auto& fieldValue : value.getValues()) {
+    for (const auto& fieldValue : values) {
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getField()));
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getTag()));
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
@@ -151,6 +196,106 @@ android::hash_t hashDimension(const HashableDimensionKey& value) {
     return JenkinsHashWhiten(hash);
 }
 
+android::hash_t hashDimension(const HashableDimensionKey& value) {
+    return value.getHash();
+}
+
+HashableDimensionKey& HashableDimensionKey::operator=(const HashableDimensionKey& that) {
+    mValues = that.mValues;
+    mHash.store(that.mHash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    mInterned = that.mInterned;
+    return *this;
+}
+
+HashableDimensionKey& HashableDimensionKey::operator=(HashableDimensionKey&& that) noexcept {
+    mValues = std::move(that.mValues);
+    mHash.store(that.mHash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    mInterned = that.mInterned;
+    that.mHash.store(0, std::memory_order_relaxed);
+    that.mInterned = false;
+    return *this;
+}
+
+const vector<FieldValue>& HashableDimensionKey::emptyValues() {
+    static const vector<FieldValue>* empty = new vector<FieldValue>();
+    return *empty;
+}
+
+vector<FieldValue>* HashableDimensionKey::editValues() {
+    if (mValues == nullptr) {
+        mValues = std::make_shared<vector<FieldValue>>();
+    } else if (mInterned || mValues.use_count() > 1) {
+        mValues = std::make_shared<vector<FieldValue>>(*mValues);
+    }
+    mInterned = false;
+    mHash.store(0, std::memory_order_relaxed);
+    return mValues.get();
+}
+
+android::hash_t HashableDimensionKey::getHash() const {
+    android::hash_t hash = mHash.load(std::memory_order_relaxed);
+    if (hash == 0) {
+        // Recomputed every time in the unlikely case that the hash is 0.
+        hash = computeHash(getValues());
+        mHash.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+}
+
+void HashableDimensionKey::intern() {
+    if (mValues == nullptr || mInterned) {
+        return;
+    }
+    const android::hash_t hash = getHash();
+    InternStripe& stripe = getInternStripes()[hash % kInternStripeCount];
+    std::shared_ptr<vector<FieldValue>> previousValues;
+    {
+        std::lock_guard<std::mutex> lock(stripe.lock);
+        auto range = stripe.values.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            std::shared_ptr<vector<FieldValue>> values = it->second.lock();
+            if (values != nullptr && sameValues(*values, *mValues)) {
+                // Released outside of the lock.
+                previousValues = std::move(mValues);
+                mValues = std::move(values);
+                mInterned = true;
+                return;
+            }
+        }
+
+        if (stripe.values.size() >= stripe.sweepSize) {
+            for (auto it = stripe.values.begin(); it != stripe.values.end();) {
+                it = it->second.expired() ? stripe.values.erase(it) : std::next(it);
+            }
+            stripe.sweepSize = std::max(kMinInternSweepSize, stripe.values.size() * 2);
+        }
+        // Copies of this key that are not interned may modify the values they share with it.
+        if (mValues.use_count() > 1) {
+            mValues = std::make_shared<vector<FieldValue>>(*mValues);
+        }
+        stripe.values.emplace(hash, mValues);
+    }
+    mInterned = true;
+}
+
+void HashableDimensionKey::setInterningEnabled(bool enabled) {
+    gInterningEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool HashableDimensionKey::isInterningEnabled() {
+    return gInterningEnabled.load(std::memory_order_relaxed);
+}
+
+size_t HashableDimensionKey::getInternedValuesCount() {
+    size_t count = 0;
+    for (int i = 0; i < kInternStripeCount; i++) {
+        InternStripe& stripe = getInternStripes()[i];
+        std::lock_guard<std::mutex> lock(stripe.lock);
+        count += stripe.values.size();
+    }
+    return count;
+}
+
 bool filterValues(const Matcher& matcherField, const vector<FieldValue>& values,
                   FieldValue* output) {
     for (const auto& value : values) {
@@ -307,12 +452,23 @@ bool HashableDimensionKey::operator!=(const HashableDimensionKey& that) const {
 }
 
 bool HashableDimensionKey::operator==(const HashableDimensionKey& that) const {
-    if (mValues.size() != that.getValues().size()) {
+    // Always the case for equal interned keys.
+    if (mValues == that.mValues) {
+        return true;
+    }
+    const vector<FieldValue>& values = getValues();
+    if (values.size() != that.getValues().size()) {
+        return false;
+    }
+    // Keys that are in the same hash map bucket have both been hashed already.
+    const android::hash_t hash = mHash.load(std::memory_order_relaxed);
+    const android::hash_t thatHash = that.mHash.load(std::memory_order_relaxed);
+    if (hash != 0 && thatHash != 0 && hash != thatHash) {
         return false;
     }
-    size_t count = mValues.size();
+    size_t count = values.size();
     for (size_t i = 0; i < count; i++) {
-        if (mValues[i] != (that.getValues())[i]) {
+        if (values[i] != (that.getValues())[i]) {
             return false;
         }
     }
@@ -324,17 +480,18 @@ bool HashableDimensionKey::operator<(const HashableDimensionKey& that) const {
 };
 
 bool HashableDimensionKey::contains(const HashableDimensionKey& that) const {
-    if (mValues.size() < that.getValues().size()) {
+    const vector<FieldValue>& values = getValues();
+    if (values.size() < that.getValues().size()) {
         return false;
     }
 
-    if (mValues.size() == that.getValues().size()) {
+    if (values.size() == that.getValues().size()) {
         return (*this) == that;
     }
 
     for (const auto& value : that.getValues()) {
         bool found = false;
-        for (const auto& myValue : mValues) {
+        for (const auto& myValue : values) {
             if (value.mField == myValue.mField && value.mValue == myValue.mValue) {
                 found = true;
                 break;
@@ -350,7 +507,7 @@ bool HashableDimensionKey::contains(const HashableDimensionKey& that) const {
 
 string HashableDimensionKey::toString() const {
     std::string output;
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         output += StringPrintf("(%d)%#x->%s ", value.mField.getTag(), value.mField.getField(),
                                value.mValue.toString().c_str());
     }
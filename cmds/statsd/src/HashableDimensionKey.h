@@ -18,6 +18,8 @@
 
 #include <aidl/android/os/StatsDimensionsValueParcel.h>
 #include <utils/JenkinsHash.h>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include "android-base/stringprintf.h"
 #include "FieldValue.h"
@@ -41,35 +43,75 @@ struct Metric2State {
     std::vector<Matcher> stateFields;
 };
 
+/**
+ * The values of a dimension. The values are shared between the copies of a key, and copied when a
+ * copy is modified, as keys are copied into the maps of every bucket that they have data in. The
+ * hash of the values is cached until they are modified.
+ *
+ * intern() makes the key share its values with every interned key that has the same values, in
+ * every metric of every config, and lets equal interned keys be compared by their values pointer.
+ */
 class HashableDimensionKey {
 public:
-    explicit HashableDimensionKey(const std::vector<FieldValue>& values) {
-        mValues = values;
+    explicit HashableDimensionKey(const std::vector<FieldValue>& values)
+        : mValues(std::make_shared<std::vector<FieldValue>>(values)) {
     }
 
     HashableDimensionKey() {};
 
-    HashableDimensionKey(const HashableDimensionKey& that) : mValues(that.getValues()){};
+    HashableDimensionKey(const HashableDimensionKey& that)
+        : mValues(that.mValues),
+          mHash(that.mHash.load(std::memory_order_relaxed)),
+          mInterned(that.mInterned){};
+
+    HashableDimensionKey(HashableDimensionKey&& that) noexcept
+        : mValues(std::move(that.mValues)),
+          mHash(that.mHash.load(std::memory_order_relaxed)),
+          mInterned(that.mInterned) {
+        that.mHash.store(0, std::memory_order_relaxed);
+        that.mInterned = false;
+    }
+
+    HashableDimensionKey& operator=(const HashableDimensionKey& that);
+
+    HashableDimensionKey& operator=(HashableDimensionKey&& that) noexcept;
 
     inline void addValue(const FieldValue& value) {
-        mValues.push_back(value);
+        editValues()->push_back(value);
     }
 
     inline const std::vector<FieldValue>& getValues() const {
-        return mValues;
+        return mValues != nullptr ? *mValues : emptyValues();
     }
 
     inline std::vector<FieldValue>* mutableValues() {
-        return &mValues;
+        return editValues();
     }
 
     inline FieldValue* mutableValue(size_t i) {
-        if (i >= 0 && i < mValues.size()) {
-            return &(mValues[i]);
+        if (i >= 0 && i < getValues().size()) {
+            return &(*editValues())[i];
         }
         return nullptr;
     }
 
+    // Hash of the values, computed once until they are modified.
+    android::hash_t getHash() const;
+
+    /**
+     * Shares the values of an interned key that has the same values, or else adds these values to
+     * the table of interned values.
+     */
+    void intern();
+
+    // Whether MetricProducers intern the dimension keys of their events, set when statsd starts.
+    static void setInterningEnabled(bool enabled);
+    static bool isInterningEnabled();
+
+    // Number of distinct values in the table of interned values, including values that are no
+    // longer used but not yet removed.
+    static size_t getInternedValuesCount();
+
     StatsDimensionsValueParcel toStatsDimensionsValueParcel() const;
 
     std::string toString() const;
@@ -83,7 +125,21 @@ public:
     bool contains(const HashableDimensionKey& that) const;
 
 private:
-    std::vector<FieldValue> mValues;
+    static const std::vector<FieldValue>& emptyValues();
+
+    // Values that only this key holds, so that they can be modified.
+    std::vector<FieldValue>* editValues();
+
+    // Null when the key has no values.
+    std::shared_ptr<std::vector<FieldValue>> mValues;
+
+    // 0 when the hash is not computed yet. Atomic because constant keys are hashed by several
+    // threads.
+    mutable std::atomic<android::hash_t> mHash{0};
+
+    // The values are in the intern table, so they must not be modified even if this key is the
+    // only one that holds them.
+    bool mInterned = false;
 };
 
 class MetricDimensionKey {
@@ -131,6 +187,7 @@ private:
     HashableDimensionKey mStateValuesKey;
 };
 
+// Cached by the key, see HashableDimensionKey::getHash().
 android::hash_t hashDimension(const HashableDimensionKey& key);
 
 /**
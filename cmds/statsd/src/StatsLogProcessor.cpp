@@ -90,8 +90,10 @@ StatsLogProcessor::StatsLogProcessor(const sp<UidMap>& uidMap,
                                      const int64_t timeBaseNs,
                                      const std::function<bool(const ConfigKey&)>& sendBroadcast,
                                      const std::function<bool(
-                                            const int&, const vector<int64_t>&)>& activateBroadcast)
-    : mUidMap(uidMap),
+                                            const int&, const vector<int64_t>&)>& activateBroadcast,
+                                     const ShardingMode shardingMode)
+    : mShardingMode(shardingMode),
+      mUidMap(uidMap),
       mPullerManager(pullerManager),
       mAnomalyAlarmMonitor(anomalyAlarmMonitor),
       mPeriodicAlarmMonitor(periodicAlarmMonitor),
@@ -105,6 +107,9 @@ StatsLogProcessor::StatsLogProcessor(const sp<UidMap>& uidMap,
 }
 
 StatsLogProcessor::~StatsLogProcessor() {
+    for (const auto& pair : mConfigShards) {
+        stopShard(*pair.second);
+    }
 }
 
 static void flushProtoToBuffer(ProtoOutputStream& proto, vector<uint8_t>* outData) {
@@ -124,6 +129,7 @@ void StatsLogProcessor::onAnomalyAlarmFired(
         const int64_t& timestampNs,
         unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> alarmSet) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     for (const auto& itr : mMetricsManagers) {
         itr.second->onAnomalyAlarmFired(timestampNs, alarmSet);
     }
@@ -133,6 +139,7 @@ void StatsLogProcessor::onPeriodicAlarmFired(
         unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> alarmSet) {
 
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     for (const auto& itr : mMetricsManagers) {
         itr.second->onPeriodicAlarmFired(timestampNs, alarmSet);
     }
@@ -370,6 +377,7 @@ vector<int64_t> StatsLogProcessor::processWatchdogRollbackOccurred(const int32_t
 
 void StatsLogProcessor::resetConfigs() {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     resetConfigsLocked(getElapsedRealtimeNs());
 }
 
@@ -425,7 +433,17 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
         mapIsolatedUidToHostUidIfNecessaryLocked(event);
     }
 
-    StateManager::getInstance().onLogEvent(*event);
+    if (mShardingMode == ShardingMode::NONE) {
+        StateManager::getInstance().onLogEvent(*event);
+    } else {
+        // A state change is seen by the metrics of every config, so they first catch up with the
+        // events logged before it.
+        ShardLocks shardLocks;
+        if (StateManager::getInstance().getListenersCount(atomId) > 0) {
+            shardLocks = lockShardsLocked();
+        }
+        StateManager::getInstance().onLogEvent(*event);
+    }
 
     if (mMetricsManagers.empty()) {
         return;
@@ -437,6 +455,12 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
         mLastPullerCacheClearTimeSec = curTimeSec;
     }
 
+    if (mShardingMode != ShardingMode::NONE) {
+        sendPendingBroadcastsLocked(elapsedRealtimeNs);
+        dispatchToShardsLocked(*event);
+        return;
+    }
+
     std::unordered_set<int> uidsWithActiveConfigsChanged;
     std::unordered_map<int, std::vector<int64_t>> activeConfigsPerUid;
     // pass the event to metrics managers.
@@ -466,8 +490,16 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
         flushIfNecessaryLocked(pair.first, *(pair.second));
     }
 
+    sendActivationBroadcastsLocked(uidsWithActiveConfigsChanged, activeConfigsPerUid,
+                                   elapsedRealtimeNs);
+}
+
+void StatsLogProcessor::sendActivationBroadcastsLocked(
+        const std::unordered_set<int>& uids,
+        const std::unordered_map<int, std::vector<int64_t>>& activeConfigsPerUid,
+        const int64_t elapsedRealtimeNs) {
     // Don't use the event timestamp for the guardrail.
-    for (int uid : uidsWithActiveConfigsChanged) {
+    for (int uid : uids) {
         // Send broadcast so that receivers can pull data.
         auto lastBroadcastTime = mLastActivationBroadcastTimes.find(uid);
         if (lastBroadcastTime != mLastActivationBroadcastTimes.end()) {
@@ -496,6 +528,7 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, int64_t elapsedRealtimeNs) {
 
 void StatsLogProcessor::GetActiveConfigs(const int uid, vector<int64_t>& outActiveConfigs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     GetActiveConfigsLocked(uid, outActiveConfigs);
 }
 
@@ -511,6 +544,7 @@ void StatsLogProcessor::GetActiveConfigsLocked(const int uid, vector<int64_t>& o
 void StatsLogProcessor::OnConfigUpdated(const int64_t timestampNs, const ConfigKey& key,
                                         const StatsdConfig& config) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     WriteDataToDiskLocked(key, timestampNs, CONFIG_UPDATED, NO_TIME_CONSTRAINTS);
     OnConfigUpdatedLocked(timestampNs, key, config);
 }
@@ -533,10 +567,16 @@ void StatsLogProcessor::OnConfigUpdatedLocked(
         ALOGE("StatsdConfig NOT valid");
         mMetricsManagers.erase(key);
     }
+    updateShardLocked(key);
 }
 
 size_t StatsLogProcessor::GetMetricsSize(const ConfigKey& key) const {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    auto shard = mConfigShards.find(key);
+    std::unique_lock<std::mutex> shardLock;
+    if (shard != mConfigShards.end()) {
+        shardLock = std::unique_lock<std::mutex>(shard->second->lock);
+    }
     auto it = mMetricsManagers.find(key);
     if (it == mMetricsManagers.end()) {
         ALOGW("Config source %s does not exist", key.ToString().c_str());
@@ -547,6 +587,7 @@ size_t StatsLogProcessor::GetMetricsSize(const ConfigKey& key) const {
 
 void StatsLogProcessor::dumpStates(int out, bool verbose) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     FILE* fout = fdopen(out, "w");
     if (fout == NULL) {
         return;
@@ -559,6 +600,13 @@ void StatsLogProcessor::dumpStates(int out, bool verbose) {
     fclose(fout);
 }
 
+static void writeConfigKeyToProto(const ConfigKey& key, ProtoOutputStream* proto) {
+    uint64_t configKeyToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
+    proto->write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
+    proto->end(configKeyToken);
+}
+
 /*
  * onDumpReport dumps serialized ConfigMetricsReportList into proto.
  */
@@ -568,14 +616,9 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
                                      const DumpReportReason dumpReportReason,
                                      const DumpLatency dumpLatency,
                                      ProtoOutputStream* proto) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    std::unique_lock<std::mutex> lock(mMetricsMutex);
 
-    // Start of ConfigKey.
-    uint64_t configKeyToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
-    proto->write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
-    proto->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
-    proto->end(configKeyToken);
-    // End of ConfigKey.
+    writeConfigKeyToProto(key, proto);
 
     bool keepFile = false;
     auto it = mMetricsManagers.find(key);
@@ -589,20 +632,25 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
             key, proto, erase_data && !keepFile /* should remove file after appending it */,
             dumpReportReason == ADB_DUMP /*if caller is adb*/);
 
-    if (it != mMetricsManagers.end()) {
-        // This allows another broadcast to be sent within the rate-limit period if we get close to
-        // filling the buffer again soon.
-        mLastBroadcastTimes.erase(key);
-
-        vector<uint8_t> buffer;
-        onConfigMetricsReportLocked(key, dumpTimeStampNs, include_current_partial_bucket,
-                                    erase_data, dumpReportReason, dumpLatency,
-                                    false /* is this data going to be saved on disk */, &buffer);
-        proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
-                     reinterpret_cast<char*>(buffer.data()), buffer.size());
-    } else {
+    if (it == mMetricsManagers.end()) {
         ALOGW("Config source %s does not exist", key.ToString().c_str());
+        return;
     }
+    // This allows another broadcast to be sent within the rate-limit period if we get close to
+    // filling the buffer again soon.
+    mLastBroadcastTimes.erase(key);
+
+    ProtoOutputStream report;
+    if (!onCurrentConfigMetricsReportLocked(lock, key, dumpTimeStampNs,
+                                            include_current_partial_bucket, erase_data,
+                                            dumpReportReason, dumpLatency, -1 /* metricsFd */,
+                                            &report)) {
+        return;
+    }
+    vector<uint8_t> buffer;
+    flushProtoToBuffer(report, &buffer);
+    proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                 reinterpret_cast<char*>(buffer.data()), buffer.size());
 }
 
 /*
@@ -627,65 +675,183 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
 }
 
 /*
- * onConfigMetricsReportLocked dumps serialized ConfigMetricsReport into outData.
+ * onDumpReport streams serialized ConfigMetricsReportList to outFd, one report at a time. The
+ * reports saved on disk are copied from their files in chunks. The StatsLogReports of the current
+ * report are spooled to a temporary file one metric at a time, and copied the same way, so that
+ * at most the past buckets of one metric are held in memory.
  */
-void StatsLogProcessor::onConfigMetricsReportLocked(
-        const ConfigKey& key, const int64_t dumpTimeStampNs,
+void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTimeStampNs,
+                                     const bool include_current_partial_bucket,
+                                     const bool erase_data,
+                                     const DumpReportReason dumpReportReason,
+                                     const DumpLatency dumpLatency,
+                                     const int outFd) {
+    std::vector<android::base::unique_fd> savedReports;
+    // The StatsLogReports of the current report, unless it is persisted as local history, which
+    // needs the whole report in memory
+    android::base::unique_fd currentMetrics;
+    // The current report, or the rest of it if its StatsLogReports are in currentMetrics
+    ProtoOutputStream report;
+    bool hasReport = false;
+    {
+        std::unique_lock<std::mutex> lock(mMetricsMutex);
+
+        bool keepFile = false;
+        auto it = mMetricsManagers.find(key);
+        if (it != mMetricsManagers.end() && it->second->shouldPersistLocalHistory()) {
+            keepFile = true;
+        }
+
+        savedReports = StorageManager::openConfigMetricsReports(
+                key, erase_data && !keepFile /* should remove file after appending it */,
+                dumpReportReason == ADB_DUMP /*if caller is adb*/);
+
+        if (it == mMetricsManagers.end()) {
+            ALOGW("Config source %s does not exist", key.ToString().c_str());
+        } else {
+            mLastBroadcastTimes.erase(key);
+
+            if (!(erase_data && keepFile)) {
+                currentMetrics = StorageManager::openTempDataFile();
+            }
+            // The metrics erase their past buckets as they write them into the report, so the
+            // report is the only copy of the data from here on.
+            hasReport = onCurrentConfigMetricsReportLocked(lock, key, dumpTimeStampNs,
+                                                           include_current_partial_bucket,
+                                                           erase_data, dumpReportReason,
+                                                           dumpLatency, currentMetrics.get(),
+                                                           &report);
+        }
+    }
+
+    // Nothing is written to outFd until the locks are released, so that a slow reader does not
+    // hold up the processing of events.
+    ProtoOutputStream configKeyProto;
+    writeConfigKeyToProto(key, &configKeyProto);
+    size_t bytesWritten = configKeyProto.size();
+    configKeyProto.flush(outFd);
+
+    bytesWritten += StorageManager::writeConfigMetricsReports(savedReports, outFd);
+
+    // The file offset of currentMetrics is the size of the StatsLogReports written to it
+    off_t metricsSize = 0;
+    if (hasReport && currentMetrics != -1) {
+        metricsSize = lseek(currentMetrics, 0, SEEK_CUR);
+        if (metricsSize < 0 || lseek(currentMetrics, 0, SEEK_SET) != 0) {
+            ALOGE("Failed to rewind the metrics of %s", key.ToString().c_str());
+            hasReport = false;
+        }
+    }
+    if (hasReport) {
+        const size_t reportSize = metricsSize + report.size();
+        const size_t headerSize =
+                writeLengthDelimitedHeaderToFd(outFd, FIELD_ID_REPORTS, reportSize);
+        if (headerSize > 0 &&
+            (metricsSize == 0 || copyFileToFd(currentMetrics, metricsSize, outFd)) &&
+            report.flush(outFd)) {
+            bytesWritten += headerSize + reportSize;
+        } else {
+            ALOGE("Failed to write the report of %s", key.ToString().c_str());
+        }
+    }
+
+    StatsdStats::getInstance().noteMetricsReportSent(key, bytesWritten);
+}
+
+bool StatsLogProcessor::onCurrentConfigMetricsReportLocked(
+        std::unique_lock<std::mutex>& lock, const ConfigKey& key, const int64_t dumpTimeStampNs,
         const bool include_current_partial_bucket, const bool erase_data,
         const DumpReportReason dumpReportReason, const DumpLatency dumpLatency,
-        const bool dataSavedOnDisk, vector<uint8_t>* buffer) {
-    // We already checked whether key exists in mMetricsManagers in
-    // WriteDataToDisk.
-    auto it = mMetricsManagers.find(key);
-    if (it == mMetricsManagers.end()) {
-        return;
-    }
-    int64_t lastReportTimeNs = it->second->getLastReportTimeNs();
-    int64_t lastReportWallClockNs = it->second->getLastReportWallClockNs();
+        const int metricsFd, ProtoOutputStream* report) {
+    if (mShardingMode == ShardingMode::NONE) {
+        return onConfigMetricsReportLocked(
+                key, *mMetricsManagers.find(key)->second, dumpTimeStampNs,
+                include_current_partial_bucket, erase_data, dumpReportReason, dumpLatency,
+                false /* is this data going to be saved on disk */, metricsFd, report);
+    }
+    // Only this config is locked while its report is built, once the events logged before the
+    // dump are processed.
+    auto shardIt = mConfigShards.find(key);
+    if (shardIt == mConfigShards.end()) {
+        ALOGW("Config source %s has no shard", key.ToString().c_str());
+        return false;
+    }
+    std::shared_ptr<ConfigShard> shard = shardIt->second;
+    lock.unlock();
+    std::unique_lock<std::mutex> shardLock = lockShard(*shard);
+    if (shard->metricsManager == nullptr) {
+        ALOGW("Config source %s was removed during the dump", key.ToString().c_str());
+        return false;
+    }
+    return onConfigMetricsReportLocked(key, *shard->metricsManager, dumpTimeStampNs,
+                                       include_current_partial_bucket, erase_data,
+                                       dumpReportReason, dumpLatency,
+                                       false /* is this data going to be saved on disk */,
+                                       metricsFd, report);
+}
+
+/*
+ * onConfigMetricsReportLocked dumps serialized ConfigMetricsReport into report, or its
+ * StatsLogReports into metricsFd and the rest into report.
+ */
+bool StatsLogProcessor::onConfigMetricsReportLocked(
+        const ConfigKey& key, MetricsManager& metricsManager, const int64_t dumpTimeStampNs,
+        const bool include_current_partial_bucket, const bool erase_data,
+        const DumpReportReason dumpReportReason, const DumpLatency dumpLatency,
+        const bool dataSavedOnDisk, const int metricsFd, ProtoOutputStream* report) {
+    int64_t lastReportTimeNs = metricsManager.getLastReportTimeNs();
+    int64_t lastReportWallClockNs = metricsManager.getLastReportWallClockNs();
 
     std::set<string> str_set;
 
-    ProtoOutputStream tempProto;
     // First, fill in ConfigMetricsReport using current data on memory, which
     // starts from filling in StatsLogReport's.
-    it->second->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
-                             dumpLatency, &str_set, &tempProto);
+    if (metricsFd == -1) {
+        metricsManager.onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
+                                    dumpLatency, &str_set, report);
+    } else if (!metricsManager.onDumpReport(dumpTimeStampNs, include_current_partial_bucket,
+                                            erase_data, dumpLatency, &str_set, metricsFd,
+                                            report)) {
+        ALOGE("Failed to write the metrics of %s", key.ToString().c_str());
+        return false;
+    }
 
     // Fill in UidMap if there is at least one metric to report.
     // This skips the uid map if it's an empty config.
-    if (it->second->getNumMetrics() > 0) {
-        uint64_t uidMapToken = tempProto.start(FIELD_TYPE_MESSAGE | FIELD_ID_UID_MAP);
+    if (metricsManager.getNumMetrics() > 0) {
+        uint64_t uidMapToken = report->start(FIELD_TYPE_MESSAGE | FIELD_ID_UID_MAP);
         mUidMap->appendUidMap(
-                dumpTimeStampNs, key, it->second->hashStringInReport() ? &str_set : nullptr,
-                it->second->versionStringsInReport(), it->second->installerInReport(), &tempProto);
-        tempProto.end(uidMapToken);
+                dumpTimeStampNs, key, metricsManager.hashStringInReport() ? &str_set : nullptr,
+                metricsManager.versionStringsInReport(), metricsManager.installerInReport(),
+                report);
+        report->end(uidMapToken);
     }
 
     // Fill in the timestamps.
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_ELAPSED_NANOS,
-                    (long long)lastReportTimeNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS,
-                    (long long)dumpTimeStampNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_WALL_CLOCK_NANOS,
-                    (long long)lastReportWallClockNs);
-    tempProto.write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_WALL_CLOCK_NANOS,
-                    (long long)getWallClockNs());
+    report->write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_ELAPSED_NANOS,
+                  (long long)lastReportTimeNs);
+    report->write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS,
+                  (long long)dumpTimeStampNs);
+    report->write(FIELD_TYPE_INT64 | FIELD_ID_LAST_REPORT_WALL_CLOCK_NANOS,
+                  (long long)lastReportWallClockNs);
+    report->write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_WALL_CLOCK_NANOS,
+                  (long long)getWallClockNs());
     // Dump report reason
-    tempProto.write(FIELD_TYPE_INT32 | FIELD_ID_DUMP_REPORT_REASON, dumpReportReason);
+    report->write(FIELD_TYPE_INT32 | FIELD_ID_DUMP_REPORT_REASON, dumpReportReason);
 
     for (const auto& str : str_set) {
-        tempProto.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, str);
+        report->write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, str);
     }
 
-    flushProtoToBuffer(tempProto, buffer);
-
-    // save buffer to disk if needed
-    if (erase_data && !dataSavedOnDisk && it->second->shouldPersistLocalHistory()) {
+    // save report to disk if needed
+    if (erase_data && !dataSavedOnDisk && metricsFd == -1 &&
+        metricsManager.shouldPersistLocalHistory()) {
         VLOG("save history to disk");
         string file_name = StorageManager::getDataHistoryFileName((long)getWallClockSec(),
                                                                   key.GetUid(), key.GetId());
-        StorageManager::writeFile(file_name.c_str(), buffer->data(), buffer->size());
+        StorageManager::writeFile(file_name.c_str(), *report);
     }
+    return true;
 }
 
 void StatsLogProcessor::resetConfigsLocked(const int64_t timestampNs,
@@ -713,6 +879,7 @@ void StatsLogProcessor::resetIfConfigTtlExpiredLocked(const int64_t timestampNs)
         }
     }
     if (configKeysTtlExpired.size() > 0) {
+        const ShardLocks shardLocks = lockShardsLocked();
         WriteDataToDiskLocked(CONFIG_RESET, NO_TIME_CONSTRAINTS);
         resetConfigsLocked(timestampNs, configKeysTtlExpired);
     }
@@ -720,11 +887,13 @@ void StatsLogProcessor::resetIfConfigTtlExpiredLocked(const int64_t timestampNs)
 
 void StatsLogProcessor::OnConfigRemoved(const ConfigKey& key) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     auto it = mMetricsManagers.find(key);
     if (it != mMetricsManagers.end()) {
         WriteDataToDiskLocked(key, getElapsedRealtimeNs(), CONFIG_REMOVED,
                               NO_TIME_CONSTRAINTS);
         mMetricsManagers.erase(it);
+        updateShardLocked(key);
         mUidMap->OnConfigRemoved(key);
     }
     StatsdStats::getInstance().noteConfigRemoved(key);
@@ -751,45 +920,209 @@ void StatsLogProcessor::OnConfigRemoved(const ConfigKey& key) {
 void StatsLogProcessor::flushIfNecessaryLocked(const ConfigKey& key,
                                                MetricsManager& metricsManager) {
     int64_t elapsedRealtimeNs = getElapsedRealtimeNs();
-    auto lastCheckTime = mLastByteSizeTimes.find(key);
-    if (lastCheckTime != mLastByteSizeTimes.end()) {
-        if (elapsedRealtimeNs - lastCheckTime->second < StatsdStats::kMinByteSizeCheckPeriodNs) {
-            return;
+    if (shouldRequestDump(key, metricsManager, elapsedRealtimeNs)) {
+        requestDumpLocked(key, elapsedRealtimeNs);
+    }
+}
+
+bool StatsLogProcessor::shouldRequestDump(const ConfigKey& key, MetricsManager& metricsManager,
+                                          const int64_t elapsedRealtimeNs) {
+    {
+        std::lock_guard<std::mutex> lock(mBroadcastMutex);
+        auto lastCheckTime = mLastByteSizeTimes.find(key);
+        if (lastCheckTime != mLastByteSizeTimes.end()) {
+            if (elapsedRealtimeNs - lastCheckTime->second <
+                StatsdStats::kMinByteSizeCheckPeriodNs) {
+                return false;
+            }
         }
+        mLastByteSizeTimes[key] = elapsedRealtimeNs;
     }
 
     // We suspect that the byteSize() computation is expensive, so we set a rate limit.
     size_t totalBytes = metricsManager.byteSize();
-    mLastByteSizeTimes[key] = elapsedRealtimeNs;
-    bool requestDump = false;
     if (totalBytes > StatsdStats::kMaxMetricsBytesPerConfig) {
         // Too late. We need to start clearing data.
         metricsManager.dropData(elapsedRealtimeNs);
         StatsdStats::getInstance().noteDataDropped(key, totalBytes);
         VLOG("StatsD had to toss out metrics for %s", key.ToString().c_str());
-    } else if ((totalBytes > StatsdStats::kBytesPerConfigTriggerGetData) ||
-               (mOnDiskDataConfigs.find(key) != mOnDiskDataConfigs.end())) {
-        // Request to send a broadcast if:
-        // 1. in memory data > threshold   OR
-        // 2. config has old data report on disk.
-        requestDump = true;
+        return false;
+    }
+    // Request to send a broadcast if:
+    // 1. in memory data > threshold   OR
+    // 2. config has old data report on disk.
+    if (totalBytes > StatsdStats::kBytesPerConfigTriggerGetData) {
+        return true;
     }
+    std::lock_guard<std::mutex> lock(mBroadcastMutex);
+    return mOnDiskDataConfigs.find(key) != mOnDiskDataConfigs.end();
+}
 
-    if (requestDump) {
-        // Send broadcast so that receivers can pull data.
-        auto lastBroadcastTime = mLastBroadcastTimes.find(key);
-        if (lastBroadcastTime != mLastBroadcastTimes.end()) {
-            if (elapsedRealtimeNs - lastBroadcastTime->second <
-                    StatsdStats::kMinBroadcastPeriodNs) {
-                VLOG("StatsD would've sent a broadcast but the rate limit stopped us.");
+void StatsLogProcessor::requestDumpLocked(const ConfigKey& key, const int64_t elapsedRealtimeNs) {
+    // Send broadcast so that receivers can pull data.
+    auto lastBroadcastTime = mLastBroadcastTimes.find(key);
+    if (lastBroadcastTime != mLastBroadcastTimes.end()) {
+        if (elapsedRealtimeNs - lastBroadcastTime->second < StatsdStats::kMinBroadcastPeriodNs) {
+            VLOG("StatsD would've sent a broadcast but the rate limit stopped us.");
+            return;
+        }
+    }
+    if (mSendBroadcast(key)) {
+        {
+            std::lock_guard<std::mutex> lock(mBroadcastMutex);
+            mOnDiskDataConfigs.erase(key);
+        }
+        VLOG("StatsD triggered data fetch for %s", key.ToString().c_str());
+        mLastBroadcastTimes[key] = elapsedRealtimeNs;
+        StatsdStats::getInstance().noteBroadcastSent(key);
+    }
+}
+
+void StatsLogProcessor::sendPendingBroadcastsLocked(const int64_t elapsedRealtimeNs) {
+    std::set<ConfigKey> dumpRequests;
+    std::unordered_set<int> activationUids;
+    {
+        std::lock_guard<std::mutex> lock(mBroadcastMutex);
+        dumpRequests.swap(mPendingDumpRequests);
+        activationUids.swap(mPendingActivationUids);
+    }
+    for (const ConfigKey& key : dumpRequests) {
+        if (mMetricsManagers.find(key) != mMetricsManagers.end()) {
+            requestDumpLocked(key, elapsedRealtimeNs);
+        }
+    }
+    if (activationUids.empty()) {
+        return;
+    }
+    std::unordered_map<int, std::vector<int64_t>> activeConfigsPerUid;
+    for (const auto& pair : mConfigShards) {
+        if (pair.second->active) {
+            activeConfigsPerUid[pair.first.GetUid()].push_back(pair.first.GetId());
+        }
+    }
+    sendActivationBroadcastsLocked(activationUids, activeConfigsPerUid, elapsedRealtimeNs);
+}
+
+void StatsLogProcessor::dispatchToShardsLocked(const LogEvent& event) {
+    // The configs share one copy of the event, with its isolated uids already mapped.
+    // The copy constructor of LogEvent is private, so it can't go through make_shared.
+    std::shared_ptr<const LogEvent> sharedEvent(new LogEvent(event.makeCopy()));
+    for (const auto& pair : mConfigShards) {
+        ConfigShard& shard = *pair.second;
+        {
+            std::lock_guard<std::mutex> queueLock(shard.queueMutex);
+            shard.queue.push_back(sharedEvent);
+            shard.queuedEvents++;
+        }
+        shard.queueCondition.notify_all();
+    }
+}
+
+void StatsLogProcessor::onLogEventForShardLocked(ConfigShard& shard, const LogEvent& event) {
+    if (shard.metricsManager == nullptr) {
+        return;
+    }
+    MetricsManager& metricsManager = *shard.metricsManager;
+    bool isPrevActive = metricsManager.isActive();
+    metricsManager.onLogEvent(event);
+    bool isCurActive = metricsManager.isActive();
+    shard.active = isCurActive;
+    if (isPrevActive != isCurActive) {
+        VLOG("Active status changed for uid  %d", shard.key.GetUid());
+        StatsdStats::getInstance().noteActiveStatusChanged(shard.key, isCurActive);
+        std::lock_guard<std::mutex> lock(mBroadcastMutex);
+        mPendingActivationUids.insert(shard.key.GetUid());
+    }
+
+    int64_t elapsedRealtimeNs = getElapsedRealtimeNs();
+    if (shouldRequestDump(shard.key, metricsManager, elapsedRealtimeNs)) {
+        std::lock_guard<std::mutex> lock(mBroadcastMutex);
+        mPendingDumpRequests.insert(shard.key);
+    }
+}
+
+std::unique_lock<std::mutex> StatsLogProcessor::lockShard(ConfigShard& shard) {
+    {
+        std::unique_lock<std::mutex> queueLock(shard.queueMutex);
+        const uint64_t queuedEvents = shard.queuedEvents;
+        shard.queueCondition.wait(queueLock, [&shard, queuedEvents] {
+            return shard.processedEvents >= queuedEvents;
+        });
+    }
+    return std::unique_lock<std::mutex>(shard.lock);
+}
+
+StatsLogProcessor::ShardLocks StatsLogProcessor::lockShardsLocked() {
+    ShardLocks shardLocks;
+    shardLocks.reserve(mConfigShards.size());
+    for (const auto& pair : mConfigShards) {
+        shardLocks.emplace_back(pair.second, lockShard(*pair.second));
+    }
+    return shardLocks;
+}
+
+void StatsLogProcessor::updateShardLocked(const ConfigKey& key) {
+    if (mShardingMode == ShardingMode::NONE) {
+        return;
+    }
+    auto it = mMetricsManagers.find(key);
+    auto shardIt = mConfigShards.find(key);
+    if (it == mMetricsManagers.end()) {
+        if (shardIt != mConfigShards.end()) {
+            // A dump that looked the shard up before the removal finds it empty.
+            shardIt->second->metricsManager = nullptr;
+            stopShard(*shardIt->second);
+            mConfigShards.erase(shardIt);
+        }
+        return;
+    }
+
+    std::shared_ptr<ConfigShard> shard;
+    if (shardIt == mConfigShards.end()) {
+        shard = std::make_shared<ConfigShard>(key);
+        ConfigShard* workerShard = shard.get();
+        shard->worker = std::thread([this, workerShard] { runShardWorker(workerShard); });
+        mConfigShards[key] = shard;
+    } else {
+        shard = shardIt->second;
+    }
+    shard->metricsManager = it->second;
+    shard->active = it->second->isActive();
+}
+
+void StatsLogProcessor::stopShard(ConfigShard& shard) {
+    if (!shard.worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> queueLock(shard.queueMutex);
+        shard.stopping = true;
+    }
+    shard.queueCondition.notify_all();
+    // The worker only needs the lock of its config for events still in its queue, and none are
+    // left once the config is locked with lockShard().
+    shard.worker.join();
+}
+
+void StatsLogProcessor::runShardWorker(ConfigShard* shard) {
+    std::deque<std::shared_ptr<const LogEvent>> events;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> queueLock(shard->queueMutex);
+            shard->processedEvents += events.size();
+            events.clear();
+            shard->queueCondition.notify_all();
+            shard->queueCondition.wait(queueLock, [shard] {
+                return shard->stopping || !shard->queue.empty();
+            });
+            if (shard->queue.empty()) {
                 return;
             }
+            events.swap(shard->queue);
         }
-        if (mSendBroadcast(key)) {
-            mOnDiskDataConfigs.erase(key);
-            VLOG("StatsD triggered data fetch for %s", key.ToString().c_str());
-            mLastBroadcastTimes[key] = elapsedRealtimeNs;
-            StatsdStats::getInstance().noteBroadcastSent(key);
+        std::lock_guard<std::mutex> shardLock(shard->lock);
+        for (const auto& event : events) {
+            onLogEventForShardLocked(*shard, *event);
         }
     }
 }
@@ -798,24 +1131,26 @@ void StatsLogProcessor::WriteDataToDiskLocked(const ConfigKey& key,
                                               const int64_t timestampNs,
                                               const DumpReportReason dumpReportReason,
                                               const DumpLatency dumpLatency) {
-    if (mMetricsManagers.find(key) == mMetricsManagers.end() ||
-        !mMetricsManagers.find(key)->second->shouldWriteToDisk()) {
+    auto it = mMetricsManagers.find(key);
+    if (it == mMetricsManagers.end() || !it->second->shouldWriteToDisk()) {
         return;
     }
-    vector<uint8_t> buffer;
-    onConfigMetricsReportLocked(key, timestampNs, true /* include_current_partial_bucket*/,
-                                true /* erase_data */, dumpReportReason, dumpLatency, true,
-                                &buffer);
+    ProtoOutputStream report;
+    onConfigMetricsReportLocked(key, *it->second, timestampNs,
+                                true /* include_current_partial_bucket*/, true /* erase_data */,
+                                dumpReportReason, dumpLatency, true, -1 /* metricsFd */, &report);
     string file_name =
             StorageManager::getDataFileName((long)getWallClockSec(), key.GetUid(), key.GetId());
-    StorageManager::writeFile(file_name.c_str(), buffer.data(), buffer.size());
+    StorageManager::writeFile(file_name.c_str(), report);
 
     // We were able to write the ConfigMetricsReport to disk, so we should trigger collection ASAP.
+    std::lock_guard<std::mutex> lock(mBroadcastMutex);
     mOnDiskDataConfigs.insert(key);
 }
 
 void StatsLogProcessor::SaveActiveConfigsToDisk(int64_t currentTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     const int64_t timeNs = getElapsedRealtimeNs();
     // Do not write to disk if we already have in the last few seconds.
     if (static_cast<unsigned long long> (timeNs) <
@@ -843,6 +1178,7 @@ void StatsLogProcessor::SaveActiveConfigsToDisk(int64_t currentTimeNs) {
 void StatsLogProcessor::SaveMetadataToDisk(int64_t currentWallClockTimeNs,
                                            int64_t systemElapsedTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     // Do not write to disk if we already have in the last few seconds.
     if (static_cast<unsigned long long> (systemElapsedTimeNs) <
             mLastMetadataWriteNs + WRITE_DATA_COOL_DOWN_SEC * NS_PER_SEC) {
@@ -873,6 +1209,7 @@ void StatsLogProcessor::WriteMetadataToProto(int64_t currentWallClockTimeNs,
                                              int64_t systemElapsedTimeNs,
                                              metadata::StatsMetadataList* metadataList) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     WriteMetadataToProtoLocked(currentWallClockTimeNs, systemElapsedTimeNs, metadataList);
 }
 
@@ -893,6 +1230,7 @@ void StatsLogProcessor::WriteMetadataToProtoLocked(int64_t currentWallClockTimeN
 void StatsLogProcessor::LoadMetadataFromDisk(int64_t currentWallClockTimeNs,
                                              int64_t systemElapsedTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     string file_name = StringPrintf("%s/metadata", STATS_METADATA_DIR);
     int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
     if (-1 == fd) {
@@ -924,6 +1262,7 @@ void StatsLogProcessor::SetMetadataState(const metadata::StatsMetadataList& stat
                                          int64_t currentWallClockTimeNs,
                                          int64_t systemElapsedTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     SetMetadataStateLocked(statsMetadataList, currentWallClockTimeNs, systemElapsedTimeNs);
 }
 
@@ -947,6 +1286,7 @@ void StatsLogProcessor::SetMetadataStateLocked(
 void StatsLogProcessor::WriteActiveConfigsToProtoOutputStream(
         int64_t currentTimeNs, const DumpReportReason reason, ProtoOutputStream* proto) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     WriteActiveConfigsToProtoOutputStreamLocked(currentTimeNs, reason, proto);
 }
 
@@ -962,6 +1302,7 @@ void StatsLogProcessor::WriteActiveConfigsToProtoOutputStreamLocked(
 }
 void StatsLogProcessor::LoadActiveConfigsFromDisk() {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     string file_name = StringPrintf("%s/active_metrics", STATS_ACTIVE_METRIC_DIR);
     int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
     if (-1 == fd) {
@@ -993,6 +1334,7 @@ void StatsLogProcessor::LoadActiveConfigsFromDisk() {
 void StatsLogProcessor::SetConfigsActiveState(const ActiveConfigList& activeConfigList,
                                                     int64_t currentTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     SetConfigsActiveStateLocked(activeConfigList, currentTimeNs);
 }
 
@@ -1033,11 +1375,13 @@ void StatsLogProcessor::WriteDataToDiskLocked(const DumpReportReason dumpReportR
 void StatsLogProcessor::WriteDataToDisk(const DumpReportReason dumpReportReason,
                                         const DumpLatency dumpLatency) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     WriteDataToDiskLocked(dumpReportReason, dumpLatency);
 }
 
 void StatsLogProcessor::informPullAlarmFired(const int64_t timestampNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     mPullerManager->OnAlarmFired(timestampNs);
 }
 
@@ -1053,6 +1397,7 @@ int64_t StatsLogProcessor::getLastReportTimeNs(const ConfigKey& key) {
 void StatsLogProcessor::notifyAppUpgrade(const int64_t& eventTimeNs, const string& apk,
                                          const int uid, const int64_t version) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     VLOG("Received app upgrade");
     StateManager::getInstance().notifyAppChanged(apk, mUidMap);
     for (const auto& it : mMetricsManagers) {
@@ -1063,6 +1408,7 @@ void StatsLogProcessor::notifyAppUpgrade(const int64_t& eventTimeNs, const strin
 void StatsLogProcessor::notifyAppRemoved(const int64_t& eventTimeNs, const string& apk,
                                          const int uid) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     VLOG("Received app removed");
     StateManager::getInstance().notifyAppChanged(apk, mUidMap);
     for (const auto& it : mMetricsManagers) {
@@ -1072,6 +1418,7 @@ void StatsLogProcessor::notifyAppRemoved(const int64_t& eventTimeNs, const strin
 
 void StatsLogProcessor::onUidMapReceived(const int64_t& eventTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     VLOG("Received uid map");
     StateManager::getInstance().updateLogSources(mUidMap);
     for (const auto& it : mMetricsManagers) {
@@ -1081,6 +1428,7 @@ void StatsLogProcessor::onUidMapReceived(const int64_t& eventTimeNs) {
 
 void StatsLogProcessor::onStatsdInitCompleted(const int64_t& elapsedTimeNs) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    const ShardLocks shardLocks = lockShardsLocked();
     VLOG("Received boot completed signal");
     for (const auto& it : mMetricsManagers) {
         it.second->onStatsdInitCompleted(elapsedTimeNs);
@@ -1088,7 +1436,7 @@ void StatsLogProcessor::onStatsdInitCompleted(const int64_t& elapsedTimeNs) {
 }
 
 void StatsLogProcessor::noteOnDiskData(const ConfigKey& key) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    std::lock_guard<std::mutex> lock(mBroadcastMutex);
     mOnDiskDataConfigs.insert(key);
 }
 
@@ -27,7 +27,14 @@
 #include "frameworks/base/cmds/statsd/src/statsd_metadata.pb.h"
 
 #include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace android {
 namespace os {
@@ -36,13 +43,24 @@ namespace statsd {
 
 class StatsLogProcessor : public ConfigListener, public virtual PackageInfoListener {
 public:
+    // How the work on the configs is serialized.
+    enum class ShardingMode {
+        // Events, dumps and every other operation serialize on a single lock.
+        NONE = 0,
+        // Each config has its own lock and a worker thread, fed with the events in the order they
+        // are logged. Dumping a config only delays the processing of its own events, and never
+        // the ingestion.
+        WORKER_PER_CONFIG = 1,
+    };
+
     StatsLogProcessor(const sp<UidMap>& uidMap, const sp<StatsPullerManager>& pullerManager,
                       const sp<AlarmMonitor>& anomalyAlarmMonitor,
                       const sp<AlarmMonitor>& subscriberTriggerAlarmMonitor,
                       const int64_t timeBaseNs,
                       const std::function<bool(const ConfigKey&)>& sendBroadcast,
                       const std::function<bool(const int&,
-                                               const vector<int64_t>&)>& sendActivationBroadcast);
+                                               const vector<int64_t>&)>& sendActivationBroadcast,
+                      const ShardingMode shardingMode = ShardingMode::NONE);
     virtual ~StatsLogProcessor();
 
     void OnLogEvent(LogEvent* event);
@@ -65,6 +83,13 @@ public:
                       const DumpReportReason dumpReportReason,
                       const DumpLatency dumpLatency,
                       ProtoOutputStream* proto);
+    // Streams the ConfigMetricsReportList to outFd once mMetricsMutex is released, holding at most
+    // the past buckets of one metric in memory.
+    void onDumpReport(const ConfigKey& key, const int64_t dumpTimeNs,
+                      const bool include_current_partial_bucket, const bool erase_data,
+                      const DumpReportReason dumpReportReason,
+                      const DumpLatency dumpLatency,
+                      const int outFd);
 
     /* Tells MetricsManager that the alarms in alarmSet have fired. Modifies anomaly alarmSet. */
     void onAnomalyAlarmFired(
@@ -158,21 +183,69 @@ private:
         return mPeriodicAlarmMonitor;
     }
 
+    // The MetricsManager of a config, and what serializes the work on it when the configs are
+    // sharded.
+    struct ConfigShard {
+        explicit ConfigShard(const ConfigKey& configKey) : key(configKey) {
+        }
+
+        const ConfigKey key;
+
+        // Held while the MetricsManager is used. Taken after mMetricsMutex, if at all.
+        std::mutex lock;
+
+        // Same as in mMetricsManagers, or null once the config is removed. Guarded by lock.
+        sp<MetricsManager> metricsManager;
+
+        // Whether the config is active, readable without the lock.
+        std::atomic<bool> active{false};
+
+        // The events waiting for the worker thread.
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        std::deque<std::shared_ptr<const LogEvent>> queue;
+        // Counts of the events queued and processed so far, to wait for the events queued before
+        // a point without waiting for the queue to be empty.
+        uint64_t queuedEvents = 0;
+        uint64_t processedEvents = 0;
+        bool stopping = false;
+        std::thread worker;
+    };
+
+    // The locks of every config, which must be released before their shards.
+    using ShardLocks =
+            std::vector<std::pair<std::shared_ptr<ConfigShard>, std::unique_lock<std::mutex>>>;
+
     mutable mutex mMetricsMutex;
 
     std::unordered_map<ConfigKey, sp<MetricsManager>> mMetricsManagers;
 
+    const ShardingMode mShardingMode;
+
+    // One per entry of mMetricsManagers, unless mShardingMode is NONE. Guarded by mMetricsMutex.
+    std::unordered_map<ConfigKey, std::shared_ptr<ConfigShard>> mConfigShards;
+
     std::unordered_map<ConfigKey, int64_t> mLastBroadcastTimes;
 
     // Last time we sent a broadcast to this uid that the active configs had changed.
     std::unordered_map<int, int64_t> mLastActivationBroadcastTimes;
 
+    // Guards what the configs update while only their own lock is held: the fields below.
+    // Nothing else is locked while it is held.
+    mutable mutex mBroadcastMutex;
+
     // Tracks when we last checked the bytes consumed for each config key.
     std::unordered_map<ConfigKey, int64_t> mLastByteSizeTimes;
 
     // Tracks which config keys has metric reports on disk
     std::set<ConfigKey> mOnDiskDataConfigs;
 
+    // The configs that asked for their data to be fetched, and the uids whose active configs
+    // changed, while their events were processed without mMetricsMutex. The broadcasts are sent
+    // with the next event.
+    std::set<ConfigKey> mPendingDumpRequests;
+    std::unordered_set<int> mPendingActivationUids;
+
     sp<UidMap> mUidMap;  // Reference to the UidMap to lookup app name and version for each uid.
 
     sp<StatsPullerManager> mPullerManager;  // Reference to StatsPullerManager
@@ -211,18 +284,69 @@ private:
                                const DumpReportReason dumpReportReason,
                                const DumpLatency dumpLatency);
 
-    void onConfigMetricsReportLocked(
-            const ConfigKey& key, const int64_t dumpTimeStampNs,
+    // Called with the lock of the config held, which is mMetricsMutex unless the configs are
+    // sharded. Unless metricsFd is -1, the StatsLogReports are written to it one at a time rather
+    // than to report, which then can't be persisted as local history. Returns false if metricsFd
+    // could not be written to.
+    bool onConfigMetricsReportLocked(
+            const ConfigKey& key, MetricsManager& metricsManager, const int64_t dumpTimeStampNs,
             const bool include_current_partial_bucket, const bool erase_data,
             const DumpReportReason dumpReportReason, const DumpLatency dumpLatency,
             /*if dataSavedToDisk is true, it indicates the caller will write the data to disk
              (e.g., before reboot). So no need to further persist local history.*/
-            const bool dataSavedToDisk, vector<uint8_t>* proto);
+            const bool dataSavedToDisk, const int metricsFd, ProtoOutputStream* report);
+
+    // Called with lock holding mMetricsMutex. Writes the ConfigMetricsReport of the existing
+    // config key to report, and metricsFd as above, releasing lock while the report is built if
+    // the configs are sharded. Returns false if the config was removed in the meantime, or if
+    // metricsFd could not be written to.
+    bool onCurrentConfigMetricsReportLocked(
+            std::unique_lock<std::mutex>& lock, const ConfigKey& key,
+            const int64_t dumpTimeStampNs, const bool include_current_partial_bucket,
+            const bool erase_data, const DumpReportReason dumpReportReason,
+            const DumpLatency dumpLatency, const int metricsFd, ProtoOutputStream* report);
 
     /* Check if we should send a broadcast if approaching memory limits and if we're over, we
      * actually delete the data. */
     void flushIfNecessaryLocked(const ConfigKey& key, MetricsManager& metricsManager);
 
+    /* The memory check of flushIfNecessaryLocked, which only needs the lock of the config.
+     * Returns whether a broadcast should be sent. */
+    bool shouldRequestDump(const ConfigKey& key, MetricsManager& metricsManager,
+                           const int64_t elapsedRealtimeNs);
+
+    /* Sends the broadcast for the data of a config, unless one was sent recently. */
+    void requestDumpLocked(const ConfigKey& key, const int64_t elapsedRealtimeNs);
+
+    void sendActivationBroadcastsLocked(
+            const std::unordered_set<int>& uids,
+            const std::unordered_map<int, std::vector<int64_t>>& activeConfigsPerUid,
+            const int64_t elapsedRealtimeNs);
+
+    /* Sends the broadcasts that the configs asked for while processing events on their own. */
+    void sendPendingBroadcastsLocked(const int64_t elapsedRealtimeNs);
+
+    /* Queues the event for the worker of every config when they are sharded. */
+    void dispatchToShardsLocked(const LogEvent& event);
+
+    /* Processes the event for one config, with the lock of the config held. */
+    void onLogEventForShardLocked(ConfigShard& shard, const LogEvent& event);
+
+    /* Locks a config once its worker, if any, has processed the events queued so far. */
+    std::unique_lock<std::mutex> lockShard(ConfigShard& shard);
+
+    /* Locks every config, for the operations that see several of them or state shared between
+     * them. Returns no locks unless the configs are sharded. */
+    ShardLocks lockShardsLocked();
+
+    /* Creates, updates or removes the shard of a config after mMetricsManagers changed. The lock of
+     * the config must be held. */
+    void updateShardLocked(const ConfigKey& key);
+
+    void stopShard(ConfigShard& shard);
+
+    void runShardWorker(ConfigShard* shard);
+
     // Maps the isolated uid in the log event to host uid if the log event contains uid fields.
     void mapIsolatedUidToHostUidIfNecessaryLocked(LogEvent* event) const;
 
@@ -291,6 +415,7 @@ private:
     FRIEND_TEST(StatsLogProcessorTest,
             TestActivationOnBootMultipleActivationsDifferentActivationTypes);
     FRIEND_TEST(StatsLogProcessorTest, TestActivationsPersistAcrossSystemServerRestart);
+    FRIEND_TEST(StatsLogProcessorTest, TestShardedDumpDoesNotBlockOtherConfigs);
 
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensionsForSumDuration1);
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensionsForSumDuration2);
@@ -23,10 +23,12 @@
 #include "config/ConfigKey.h"
 #include "config/ConfigManager.h"
 #include "guardrail/StatsdStats.h"
+#include "metrics/ValueMetricProducer.h"
 #include "storage/StorageManager.h"
 #include "subscriber/SubscriberReporter.h"
 
 #include <android-base/file.h>
+#include <android-base/properties.h>
 #include <android-base/strings.h>
 #include <cutils/multiuser.h>
 #include <frameworks/base/cmds/statsd/src/statsd_config.pb.h>
@@ -55,6 +57,18 @@ constexpr const char* kPermissionDump = "android.permission.DUMP";
 
 constexpr const char* kPermissionRegisterPullAtom = "android.permission.REGISTER_STATS_PULL_ATOM";
 
+// One of the StatsLogProcessor::ShardingMode values, read once when statsd starts.
+constexpr const char* kShardingModeProperty = "persist.statsd.sharding_mode";
+
+// Whether metrics intern their dimension keys, read once when statsd starts.
+constexpr const char* kInternDimensionKeysProperty = "persist.statsd.intern_dimension_keys";
+
+// Whether pulled value metrics diff their pulls with a sorted merge, read once when statsd starts.
+constexpr const char* kValueMetricSortedDiffProperty = "persist.statsd.value_metric_sorted_diff";
+
+// Most events taken from the event queue at once by readLogs().
+constexpr size_t kMaxEventBatchSize = 64;
+
 #define STATS_SERVICE_DIR "/data/misc/stats-service"
 
 // for StatsDataDumpProto
@@ -155,7 +169,17 @@ StatsService::StatsService(const sp<Looper>& handlerLooper, shared_ptr<LogEventQ
                     VLOG("StatsService::active configs broadcast failed for uid %d" , uid);
                     return false;
                 }
-            });
+            },
+            static_cast<StatsLogProcessor::ShardingMode>(android::base::GetIntProperty(
+                    kShardingModeProperty,
+                    static_cast<int>(StatsLogProcessor::ShardingMode::NONE),
+                    static_cast<int>(StatsLogProcessor::ShardingMode::NONE),
+                    static_cast<int>(StatsLogProcessor::ShardingMode::WORKER_PER_CONFIG))));
+
+    HashableDimensionKey::setInterningEnabled(
+            android::base::GetBoolProperty(kInternDimensionKeysProperty, false));
+    ValueMetricProducer::setSortedDiffEnabled(
+            android::base::GetBoolProperty(kValueMetricSortedDiffProperty, false));
 
     mUidMap->setListener(mProcessor);
     mConfigManager->AddListener(mProcessor);
@@ -173,18 +197,23 @@ StatsService::~StatsService() {
 
 /* Runs on a dedicated thread to process pushed events. */
 void StatsService::readLogs() {
+    std::vector<std::unique_ptr<LogEvent>> events;
     // Read forever..... long live statsd
     while (1) {
-        // Block until an event is available.
-        auto event = mEventQueue->waitPop();
-        // Pass it to StatsLogProcess to all configs/metrics
-        // At this point, the LogEventQueue is not blocked, so that the socketListener
-        // can read events from the socket and write to buffer to avoid data drop.
-        mProcessor->OnLogEvent(event.get());
-        // The ShellSubscriber is only used by shell for local debugging.
-        if (mShellSubscriber != nullptr) {
-            mShellSubscriber->onLogEvent(*event);
+        // Block until an event is available, then take every queued event up to the batch size.
+        mEventQueue->popBatch(&events, kMaxEventBatchSize);
+        for (const auto& event : events) {
+            // Pass it to StatsLogProcess to all configs/metrics
+            // At this point, the LogEventQueue is not blocked, so that the socketListener
+            // can read events from the socket and write to buffer to avoid data drop.
+            mProcessor->OnLogEvent(event.get());
+            // The ShellSubscriber is only used by shell for local debugging.
+            if (mShellSubscriber != nullptr) {
+                mShellSubscriber->onLogEvent(*event);
+            }
         }
+        // The socket listener parses the next events into these, without allocating them.
+        mEventQueue->recycle(&events);
     }
 }
 
@@ -682,16 +711,16 @@ status_t StatsService::cmd_dump_report(int out, const Vector<String8>& args) {
             name.assign(args[2].c_str(), args[2].size());
         }
         if (good) {
-            vector<uint8_t> data;
-            mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
-                                     includeCurrentBucket, eraseData, ADB_DUMP,
-                                     NO_TIME_CONSTRAINTS,
-                                     &data);
             if (proto) {
-                for (size_t i = 0; i < data.size(); i ++) {
-                    dprintf(out, "%c", data[i]);
-                }
+                // Streams the reports straight to the shell, so that large reports never have to
+                // fit in memory at once.
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         includeCurrentBucket, eraseData, ADB_DUMP,
+                                         NO_TIME_CONSTRAINTS, out);
             } else {
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         includeCurrentBucket, eraseData, ADB_DUMP,
+                                         NO_TIME_CONSTRAINTS, (vector<uint8_t>*)nullptr);
                 dprintf(out, "Non-proto stats data dump not currently supported.\n");
             }
             return android::OK;
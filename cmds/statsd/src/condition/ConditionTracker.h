@@ -101,6 +101,11 @@ public:
         return mSliced;
     }
 
+    // Indexes the slices of the condition by the condition fields of a MetricConditionLink, so
+    // that partial link queries with these fields do not scan every slice.
+    virtual void addSlicedConditionIndex(const std::vector<Matcher>& linkConditionFields) {
+    }
+
     virtual const std::set<HashableDimensionKey>* getChangedToTrueDimensions(
             const std::vector<sp<ConditionTracker>>& allConditions) const = 0;
     virtual const std::set<HashableDimensionKey>* getChangedToFalseDimensions(
@@ -20,6 +20,8 @@
 #include "SimpleConditionTracker.h"
 #include "guardrail/StatsdStats.h"
 
+#include <algorithm>
+
 namespace android {
 namespace os {
 namespace statsd {
@@ -136,6 +138,9 @@ void SimpleConditionTracker::handleStopAll(std::vector<ConditionState>& conditio
     // After StopAll, we know everything has stopped. From now on, default condition is false.
     mInitialValue = ConditionState::kFalse;
     mSlicedConditionState.clear();
+    for (auto& index : mSlicedConditionIndices) {
+        index.slices.clear();
+    }
     conditionCache[mIndex] = ConditionState::kFalse;
 }
 
@@ -175,12 +180,14 @@ void SimpleConditionTracker::handleConditionEvent(const HashableDimensionKey& ou
         newCondition = matchStart ? ConditionState::kTrue : ConditionState::kFalse;
         if (matchStart && mInitialValue != ConditionState::kTrue) {
             mSlicedConditionState[outputKey] = 1;
+            updateSlicedConditionIndices(outputKey, 1, 1);
             changed = true;
             mLastChangedToTrueDimensions.insert(outputKey);
         } else if (mInitialValue != ConditionState::kFalse) {
             // it's a stop and we don't have history about it.
             // If the default condition is not false, it means this stop is valuable to us.
             mSlicedConditionState[outputKey] = 0;
+            updateSlicedConditionIndices(outputKey, 1, 0);
             mLastChangedToFalseDimensions.insert(outputKey);
             changed = true;
         }
@@ -192,6 +199,7 @@ void SimpleConditionTracker::handleConditionEvent(const HashableDimensionKey& ou
         if (matchStart) {
             if (startedCount == 0) {
                 mLastChangedToTrueDimensions.insert(outputKey);
+                updateSlicedConditionIndices(outputKey, 0, 1);
                 // This condition for this output key will change from false -> true
                 changed = true;
             }
@@ -216,12 +224,14 @@ void SimpleConditionTracker::handleConditionEvent(const HashableDimensionKey& ou
                 // if everything has stopped for this output key, condition true -> false;
                 if (startedCount == 0) {
                     mLastChangedToFalseDimensions.insert(outputKey);
+                    updateSlicedConditionIndices(outputKey, 0, -1);
                     changed = true;
                 }
             }
 
             // if default condition is false, it means we don't need to keep the false values.
             if (mInitialValue == ConditionState::kFalse && startedCount == 0) {
+                updateSlicedConditionIndices(outputKey, -1, 0);
                 mSlicedConditionState.erase(outputIt);
                 VLOG("erase key %s", outputKey.toString().c_str());
             }
@@ -326,6 +336,91 @@ void SimpleConditionTracker::evaluateCondition(
     conditionChangedCache[mIndex] = overallChanged;
 }
 
+// Sets projection to the values of key in the given fields, in their order, so that the key
+// contains a query key iff the projection equals it. Like HashableDimensionKey::contains, a key
+// with as many values as there are fields must have them in the same order. Slices of a condition
+// have a single value per field.
+static bool projectOnFields(const HashableDimensionKey& key, const vector<Field>& fields,
+                            HashableDimensionKey* projection) {
+    const vector<FieldValue>& values = key.getValues();
+    if (values.size() < fields.size()) {
+        return false;
+    }
+    if (values.size() == fields.size()) {
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (values[i].mField != fields[i]) {
+                return false;
+            }
+        }
+        *projection = key;
+        return true;
+    }
+    for (const Field& field : fields) {
+        auto it = std::find_if(values.begin(), values.end(),
+                               [&field](const FieldValue& value) { return value.mField == field; });
+        if (it == values.end()) {
+            return false;
+        }
+        projection->addValue(*it);
+    }
+    return true;
+}
+
+void SimpleConditionTracker::addSlicedConditionIndex(const vector<Matcher>& linkConditionFields) {
+    if (!mSliced || linkConditionFields.empty()) {
+        return;
+    }
+    SlicedConditionIndex index;
+    for (const Matcher& matcher : linkConditionFields) {
+        index.fields.push_back(matcher.mMatcher);
+    }
+    for (const auto& existing : mSlicedConditionIndices) {
+        if (existing.fields == index.fields) {
+            return;
+        }
+    }
+    mSlicedConditionIndices.push_back(std::move(index));
+    // Indexes the slices tracked before the index was added, if any.
+    for (const auto& slice : mSlicedConditionState) {
+        updateSlicedConditionIndices(slice.first, 1, slice.second > 0 ? 1 : 0);
+    }
+}
+
+void SimpleConditionTracker::updateSlicedConditionIndices(const HashableDimensionKey& key,
+                                                          int sliceCountDelta,
+                                                          int trueSliceCountDelta) {
+    for (auto& index : mSlicedConditionIndices) {
+        HashableDimensionKey projection;
+        if (!projectOnFields(key, index.fields, &projection)) {
+            continue;
+        }
+        IndexedSlices& slices = index.slices[projection];
+        slices.sliceCount += sliceCountDelta;
+        slices.trueSliceCount += trueSliceCountDelta;
+        if (slices.sliceCount == 0) {
+            index.slices.erase(projection);
+        }
+    }
+}
+
+const SimpleConditionTracker::SlicedConditionIndex*
+SimpleConditionTracker::findSlicedConditionIndex(const HashableDimensionKey& key) const {
+    const vector<FieldValue>& values = key.getValues();
+    for (const auto& index : mSlicedConditionIndices) {
+        if (index.fields.size() != values.size()) {
+            continue;
+        }
+        bool sameFields = true;
+        for (size_t i = 0; i < values.size() && sameFields; i++) {
+            sameFields = values[i].mField == index.fields[i];
+        }
+        if (sameFields) {
+            return &index;
+        }
+    }
+    return nullptr;
+}
+
 void SimpleConditionTracker::isConditionMet(
         const ConditionKey& conditionParameters, const vector<sp<ConditionTracker>>& allConditions,
         const bool isPartialLink,
@@ -356,7 +451,17 @@ void SimpleConditionTracker::isConditionMet(
 
     ConditionState conditionState = ConditionState::kNotEvaluated;
     const HashableDimensionKey& key = pair->second;
-    if (isPartialLink) {
+    const SlicedConditionIndex* index = isPartialLink ? findSlicedConditionIndex(key) : nullptr;
+    if (index != nullptr) {
+        conditionState = conditionState | mInitialValue;
+        const auto indexIt = index->slices.find(key);
+        if (indexIt != index->slices.end()) {
+            ConditionState sliceState = indexIt->second.trueSliceCount > 0
+                                                ? ConditionState::kTrue
+                                                : ConditionState::kFalse;
+            conditionState = conditionState | sliceState;
+        }
+    } else if (isPartialLink) {
         // For unseen key, check whether the require dimensions are subset of sliced condition
         // output.
         conditionState = conditionState | mInitialValue;
@@ -89,6 +89,8 @@ public:
             return equalDimensions(mOutputDimensions, dimensions);
     }
 
+    void addSlicedConditionIndex(const std::vector<Matcher>& linkConditionFields) override;
+
 private:
     const ConfigKey mConfigKey;
     // The index of the LogEventMatcher which defines the start.
@@ -116,6 +118,28 @@ private:
 
     std::map<HashableDimensionKey, int> mSlicedConditionState;
 
+    typedef struct {
+        // Number of slices with the values of the key in the indexed fields.
+        int sliceCount;
+        // Number of these slices that are true.
+        int trueSliceCount;
+    } IndexedSlices;
+
+    // Slices of mSlicedConditionState grouped by the values of the fields of a link.
+    typedef struct {
+        std::vector<Field> fields;
+        std::unordered_map<HashableDimensionKey, IndexedSlices> slices;
+    } SlicedConditionIndex;
+
+    std::vector<SlicedConditionIndex> mSlicedConditionIndices;
+
+    // Keeps mSlicedConditionIndices up to date with a change of the slice of the given key.
+    void updateSlicedConditionIndices(const HashableDimensionKey& key, int sliceCountDelta,
+                                      int trueSliceCountDelta);
+
+    // Returns the index of the fields of the key, if there is one.
+    const SlicedConditionIndex* findSlicedConditionIndex(const HashableDimensionKey& key) const;
+
     void handleStopAll(std::vector<ConditionState>& conditionCache,
                        std::vector<bool>& changedCache);
 
@@ -126,6 +150,7 @@ private:
 
     void dumpState();
 
+    FRIEND_TEST(SimpleConditionTrackerTest, TestPartialLinkQueryWithIndex);
     FRIEND_TEST(SimpleConditionTrackerTest, TestSlicedCondition);
     FRIEND_TEST(SimpleConditionTrackerTest, TestSlicedWithNoOutputDim);
     FRIEND_TEST(SimpleConditionTrackerTest, TestStopAll);
@@ -43,12 +43,14 @@ StatsPuller::StatsPuller(const int tagId, const int64_t coolDownNs, const int64_
 }
 
 bool StatsPuller::Pull(const int64_t eventTimeNs, std::vector<std::shared_ptr<LogEvent>>* data) {
-    lock_guard<std::mutex> lock(mLock);
-    const int64_t elapsedTimeNs = getElapsedRealtimeNs();
-    const int64_t systemUptimeMillis = getSystemUptimeMillis();
+    // Taken before waiting for a pull in flight, which then started within the cooldown of this
+    // request, so that the request is served by it.
+    const int64_t requestTimeNs = getElapsedRealtimeNs();
+    std::unique_lock<std::mutex> lock(mLock);
+    mPullFinished.wait(lock, [this] { return !mPullInFlight; });
     StatsdStats::getInstance().notePull(mTagId);
     const bool shouldUseCache =
-            (mLastEventTimeNs == eventTimeNs) || (elapsedTimeNs - mLastPullTimeNs < mCoolDownNs);
+            (mLastEventTimeNs == eventTimeNs) || (requestTimeNs - mLastPullTimeNs < mCoolDownNs);
     if (shouldUseCache) {
         if (mHasGoodData) {
             (*data) = mCachedData;
@@ -57,43 +59,67 @@ bool StatsPuller::Pull(const int64_t eventTimeNs, std::vector<std::shared_ptr<Lo
         }
         return mHasGoodData;
     }
+    const int64_t elapsedTimeNs = getElapsedRealtimeNs();
+    const int64_t systemUptimeMillis = getSystemUptimeMillis();
     if (mLastPullTimeNs > 0) {
         StatsdStats::getInstance().updateMinPullIntervalSec(
                 mTagId, (elapsedTimeNs - mLastPullTimeNs) / NS_PER_SEC);
     }
     mCachedData.clear();
+    mHasGoodData = false;
     mLastPullTimeNs = elapsedTimeNs;
     mLastEventTimeNs = eventTimeNs;
-    mHasGoodData = PullInternal(&mCachedData);
-    if (!mHasGoodData) {
-        return mHasGoodData;
+    mPullInFlight = true;
+    lock.unlock();
+
+    std::vector<std::shared_ptr<LogEvent>> pulledData;
+    const bool hasGoodData = PullInternal(&pulledData) &&
+                             processPulledData(elapsedTimeNs, systemUptimeMillis, &pulledData);
+
+    lock.lock();
+    mPullInFlight = false;
+    mPullFinished.notify_all();
+    if (mCacheClearedDuringPull) {
+        mCacheClearedDuringPull = false;
+        if (hasGoodData) {
+            (*data) = pulledData;
+        }
+        return hasGoodData;
+    }
+    mHasGoodData = hasGoodData;
+    if (mHasGoodData) {
+        mCachedData = std::move(pulledData);
+        (*data) = mCachedData;
     }
+    return mHasGoodData;
+}
+
+bool StatsPuller::processPulledData(const int64_t elapsedTimeNs,
+                                    const int64_t systemUptimeMillis,
+                                    std::vector<std::shared_ptr<LogEvent>>* data) {
     const int64_t pullElapsedDurationNs = getElapsedRealtimeNs() - elapsedTimeNs;
     const int64_t pullSystemUptimeDurationMillis = getSystemUptimeMillis() - systemUptimeMillis;
     StatsdStats::getInstance().notePullTime(mTagId, pullElapsedDurationNs);
     const bool pullTimeOut = pullElapsedDurationNs > mPullTimeoutNs;
     if (pullTimeOut) {
         // Something went wrong. Discard the data.
-        mCachedData.clear();
-        mHasGoodData = false;
+        data->clear();
         StatsdStats::getInstance().notePullTimeout(
                 mTagId, pullSystemUptimeDurationMillis, NanoToMillis(pullElapsedDurationNs));
         ALOGW("Pull for atom %d exceeds timeout %lld nano seconds.", mTagId,
               (long long)pullElapsedDurationNs);
-        return mHasGoodData;
+        return false;
     }
 
-    if (mCachedData.size() > 0) {
-        mapAndMergeIsolatedUidsToHostUid(mCachedData, mUidMap, mTagId, mAdditiveFields);
+    if (data->size() > 0) {
+        mapAndMergeIsolatedUidsToHostUid(*data, mUidMap, mTagId, mAdditiveFields);
     }
 
-    if (mCachedData.empty()) {
+    if (data->empty()) {
         VLOG("Data pulled is empty");
         StatsdStats::getInstance().noteEmptyData(mTagId);
     }
-
-    (*data) = mCachedData;
-    return mHasGoodData;
+    return true;
 }
 
 int StatsPuller::ForceClearCache() {
@@ -107,6 +133,9 @@ int StatsPuller::clearCache() {
 
 int StatsPuller::clearCacheLocked() {
     int ret = mCachedData.size();
+    if (mPullInFlight) {
+        mCacheClearedDuringPull = true;
+    }
     mCachedData.clear();
     mLastPullTimeNs = 0;
     mLastEventTimeNs = 0;
@@ -18,6 +18,7 @@
 
 #include <aidl/android/os/IStatsCompanionService.h>
 #include <utils/RefBase.h>
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include "packages/UidMap.h"
@@ -44,7 +45,8 @@ public:
 
     // Pulls the most recent data.
     // The data may be served from cache if consecutive pulls come within
-    // predefined cooldown time.
+    // predefined cooldown time. Requests that come while a pull is in flight
+    // wait for it and share its data instead of pulling again.
     // Returns true if the pull was successful.
     // Returns false when
     //   1) the pull fails
@@ -76,6 +78,17 @@ protected:
 private:
     mutable std::mutex mLock;
 
+    // Signaled when the pull in flight finishes.
+    std::condition_variable mPullFinished;
+
+    // Whether a thread is in PullInternal. mLock is not held during the pull, so that requests
+    // coming meanwhile can wait for its data and clearing the cache does not block on it.
+    bool mPullInFlight = false;
+
+    // Set when the cache is cleared during a pull, so that the data of the pull is only returned
+    // to the thread that made it, and not cached.
+    bool mCacheClearedDuringPull = false;
+
     // Real puller impl.
     virtual bool PullInternal(std::vector<std::shared_ptr<LogEvent>>* data) = 0;
 
@@ -111,6 +124,11 @@ private:
 
     int clearCacheLocked();
 
+    // Checks the timeout and maps isolated uids of the data of a pull that started at
+    // elapsedTimeNs. Returns false if the data must be discarded.
+    bool processPulledData(const int64_t elapsedTimeNs, const int64_t systemUptimeMillis,
+                           std::vector<std::shared_ptr<LogEvent>>* data);
+
     static sp<UidMap> mUidMap;
 };
 
@@ -24,7 +24,10 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <thread>
 
 #include "../StatsService.h"
 #include "../logd/LogEvent.h"
@@ -91,75 +94,86 @@ StatsPullerManager::StatsPullerManager()
       mPullAtomCallbackDeathRecipient(AIBinder_DeathRecipient_new(pullAtomCallbackDied)) {
 }
 
+// Pulls from puller, the one chosen for tagId by the manager, if there is one.
+static bool pullFrom(const sp<StatsPuller>& puller, int tagId, const int64_t eventTimeNs,
+                     vector<shared_ptr<LogEvent>>* data) {
+    if (puller == nullptr) {
+        return false;
+    }
+    bool ret = puller->Pull(eventTimeNs, data);
+    VLOG("pulled %zu items", data->size());
+    if (!ret) {
+        StatsdStats::getInstance().notePullFailed(tagId);
+    }
+    return ret;
+}
+
 bool StatsPullerManager::Pull(int tagId, const ConfigKey& configKey, const int64_t eventTimeNs,
                               vector<shared_ptr<LogEvent>>* data, bool useUids) {
-    std::lock_guard<std::mutex> _l(mLock);
-    return PullLocked(tagId, configKey, eventTimeNs, data, useUids);
+    sp<StatsPuller> puller;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        vector<int32_t> uids;
+        if (useUids && !getPullUidsLocked(tagId, configKey, &uids)) {
+            return false;
+        }
+        puller = getPullerLocked(tagId, uids, useUids);
+    }
+    return pullFrom(puller, tagId, eventTimeNs, data);
 }
 
 bool StatsPullerManager::Pull(int tagId, const vector<int32_t>& uids, const int64_t eventTimeNs,
                               vector<std::shared_ptr<LogEvent>>* data, bool useUids) {
-    std::lock_guard<std::mutex> _l(mLock);
-    return PullLocked(tagId, uids, eventTimeNs, data, useUids);
+    sp<StatsPuller> puller;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        puller = getPullerLocked(tagId, uids, useUids);
+    }
+    return pullFrom(puller, tagId, eventTimeNs, data);
 }
 
-bool StatsPullerManager::PullLocked(int tagId, const ConfigKey& configKey,
-                                    const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data,
-                                    bool useUids) {
-    vector<int32_t> uids;
-    if (useUids) {
-        auto uidProviderIt = mPullUidProviders.find(configKey);
-        if (uidProviderIt == mPullUidProviders.end()) {
-            ALOGE("Error pulling tag %d. No pull uid provider for config key %s", tagId,
-                  configKey.ToString().c_str());
-            StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
-            return false;
-        }
-        sp<PullUidProvider> pullUidProvider = uidProviderIt->second.promote();
-        if (pullUidProvider == nullptr) {
-            ALOGE("Error pulling tag %d, pull uid provider for config %s is gone.", tagId,
-                  configKey.ToString().c_str());
-            StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
-            return false;
-        }
-        uids = pullUidProvider->getPullAtomUids(tagId);
+bool StatsPullerManager::getPullUidsLocked(int tagId, const ConfigKey& configKey,
+                                           vector<int32_t>* uids) {
+    auto uidProviderIt = mPullUidProviders.find(configKey);
+    if (uidProviderIt == mPullUidProviders.end()) {
+        ALOGE("Error pulling tag %d. No pull uid provider for config key %s", tagId,
+              configKey.ToString().c_str());
+        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
+        return false;
     }
-    return PullLocked(tagId, uids, eventTimeNs, data, useUids);
+    sp<PullUidProvider> pullUidProvider = uidProviderIt->second.promote();
+    if (pullUidProvider == nullptr) {
+        ALOGE("Error pulling tag %d, pull uid provider for config %s is gone.", tagId,
+              configKey.ToString().c_str());
+        StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
+        return false;
+    }
+    *uids = pullUidProvider->getPullAtomUids(tagId);
+    return true;
 }
 
-bool StatsPullerManager::PullLocked(int tagId, const vector<int32_t>& uids,
-                                    const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data,
-                                    bool useUids) {
+sp<StatsPuller> StatsPullerManager::getPullerLocked(int tagId, const vector<int32_t>& uids,
+                                                    bool useUids) {
     VLOG("Initiating pulling %d", tagId);
     if (useUids) {
         for (int32_t uid : uids) {
             PullerKey key = {.atomTag = tagId, .uid = uid};
             auto pullerIt = kAllPullAtomInfo.find(key);
             if (pullerIt != kAllPullAtomInfo.end()) {
-                bool ret = pullerIt->second->Pull(eventTimeNs, data);
-                VLOG("pulled %zu items", data->size());
-                if (!ret) {
-                    StatsdStats::getInstance().notePullFailed(tagId);
-                }
-                return ret;
+                return pullerIt->second;
             }
         }
         StatsdStats::getInstance().notePullerNotFound(tagId);
         ALOGW("StatsPullerManager: Unknown tagId %d", tagId);
-        return false;  // Return early since we don't know what to pull.
+        return nullptr;  // Return early since we don't know what to pull.
     } else {
         PullerKey key = {.atomTag = tagId, .uid = -1};
         auto pullerIt = kAllPullAtomInfo.find(key);
         if (pullerIt != kAllPullAtomInfo.end()) {
-            bool ret = pullerIt->second->Pull(eventTimeNs, data);
-            VLOG("pulled %zu items", data->size());
-            if (!ret) {
-                StatsdStats::getInstance().notePullFailed(tagId);
-            }
-            return ret;
+            return pullerIt->second;
         }
         ALOGW("StatsPullerManager: Unknown tagId %d", tagId);
-        return false;  // Return early since we don't know what to pull.
+        return nullptr;  // Return early since we don't know what to pull.
     }
 }
 
@@ -266,35 +280,97 @@ void StatsPullerManager::UnregisterPullUidProvider(const ConfigKey& configKey,
     }
 }
 
+// A pull done for an alarm, and the receivers of its data.
+struct AlarmPull {
+    int tagId;
+    sp<StatsPuller> puller;
+    vector<wp<PullDataReceiver>> receivers;
+    vector<shared_ptr<LogEvent>> data;
+    bool success = false;
+};
+
+// Runs the pulls on up to maxConcurrentPulls threads, including the calling one.
+static void pullConcurrently(vector<AlarmPull>* pulls, const int64_t elapsedTimeNs,
+                             size_t maxConcurrentPulls) {
+    std::atomic<size_t> nextPull(0);
+    auto runPulls = [pulls, elapsedTimeNs, &nextPull] {
+        for (size_t i = nextPull++; i < pulls->size(); i = nextPull++) {
+            AlarmPull& pull = (*pulls)[i];
+            pull.success = pullFrom(pull.puller, pull.tagId, elapsedTimeNs, &pull.data);
+        }
+    };
+    vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(pulls->size(), maxConcurrentPulls); i++) {
+        threads.emplace_back(runPulls);
+    }
+    runPulls();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs) {
-    std::lock_guard<std::mutex> _l(mLock);
     int64_t wallClockNs = getWallClockNs();
 
-    int64_t minNextPullTimeNs = NO_ALARM_UPDATE;
-
-    vector<pair<const ReceiverKey*, vector<ReceiverInfo*>>> needToPull;
-    for (auto& pair : mReceivers) {
-        vector<ReceiverInfo*> receivers;
-        if (pair.second.size() != 0) {
+    vector<AlarmPull> pulls;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        int64_t minNextPullTimeNs = NO_ALARM_UPDATE;
+        // Index in pulls of the pull of each puller, so that the configs that pull an atom from
+        // the same puller share its data.
+        std::map<sp<StatsPuller>, size_t> pullIndices;
+        for (auto& pair : mReceivers) {
+            vector<wp<PullDataReceiver>> receivers;
             for (ReceiverInfo& receiverInfo : pair.second) {
                 if (receiverInfo.nextPullTimeNs <= elapsedTimeNs) {
-                    receivers.push_back(&receiverInfo);
-                } else {
-                    if (receiverInfo.nextPullTimeNs < minNextPullTimeNs) {
-                        minNextPullTimeNs = receiverInfo.nextPullTimeNs;
-                    }
+                    receivers.push_back(receiverInfo.receiver);
+                    // We may have just come out of a coma, compute next pull time.
+                    int numBucketsAhead =
+                            (elapsedTimeNs - receiverInfo.nextPullTimeNs) / receiverInfo.intervalNs;
+                    receiverInfo.nextPullTimeNs += (numBucketsAhead + 1) * receiverInfo.intervalNs;
                 }
+                if (receiverInfo.nextPullTimeNs < minNextPullTimeNs) {
+                    minNextPullTimeNs = receiverInfo.nextPullTimeNs;
+                }
+            }
+            if (receivers.empty()) {
+                continue;
             }
-            if (receivers.size() > 0) {
-                needToPull.push_back(make_pair(&pair.first, receivers));
+
+            const int tagId = pair.first.atomTag;
+            sp<StatsPuller> puller;
+            vector<int32_t> uids;
+            if (getPullUidsLocked(tagId, pair.first.configKey, &uids)) {
+                puller = getPullerLocked(tagId, uids, true /* useUids */);
+            }
+            auto pullIt = puller == nullptr ? pullIndices.end() : pullIndices.find(puller);
+            if (pullIt == pullIndices.end()) {
+                if (puller != nullptr) {
+                    pullIndices[puller] = pulls.size();
+                }
+                AlarmPull pull;
+                pull.tagId = tagId;
+                pull.puller = puller;
+                pull.receivers = std::move(receivers);
+                pulls.push_back(std::move(pull));
+            } else {
+                vector<wp<PullDataReceiver>>& pullReceivers = pulls[pullIt->second].receivers;
+                pullReceivers.insert(pullReceivers.end(), receivers.begin(), receivers.end());
             }
         }
+
+        VLOG("mNextPullTimeNs: %lld updated to %lld", (long long)mNextPullTimeNs,
+             (long long)minNextPullTimeNs);
+        mNextPullTimeNs = minNextPullTimeNs;
+        updateAlarmLocked();
     }
-    for (const auto& pullInfo : needToPull) {
-        vector<shared_ptr<LogEvent>> data;
-        bool pullSuccess = PullLocked(pullInfo.first->atomTag, pullInfo.first->configKey,
-                                      elapsedTimeNs, &data);
-        if (!pullSuccess) {
+
+    // The manager is not locked while pulling, so pulls requested by metrics and subscriptions
+    // meanwhile are not blocked by the alarm.
+    pullConcurrently(&pulls, elapsedTimeNs, kMaxConcurrentAlarmPulls);
+
+    for (AlarmPull& pull : pulls) {
+        if (!pull.success) {
             VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
         }
 
@@ -305,32 +381,24 @@ void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs) {
         // Here the triggering event is alarm fired from AlarmManager.
         // In ValueMetricProducer and GaugeMetricProducer we do same thing
         // when pull on condition change, etc.
-        for (auto& event : data) {
+        // The data may be shared with the cache of the puller, which other threads can be
+        // reading, so the events are copied before they are stamped. The copy constructor of
+        // LogEvent is private, so the copies can't go through make_shared.
+        for (auto& event : pull.data) {
+            event = std::shared_ptr<LogEvent>(new LogEvent(event->makeCopy()));
             event->setElapsedTimestampNs(elapsedTimeNs);
             event->setLogdWallClockTimestampNs(wallClockNs);
         }
 
-        for (const auto& receiverInfo : pullInfo.second) {
-            sp<PullDataReceiver> receiverPtr = receiverInfo->receiver.promote();
+        for (const auto& receiver : pull.receivers) {
+            sp<PullDataReceiver> receiverPtr = receiver.promote();
             if (receiverPtr != nullptr) {
-                receiverPtr->onDataPulled(data, pullSuccess, elapsedTimeNs);
-                // We may have just come out of a coma, compute next pull time.
-                int numBucketsAhead =
-                        (elapsedTimeNs - receiverInfo->nextPullTimeNs) / receiverInfo->intervalNs;
-                receiverInfo->nextPullTimeNs += (numBucketsAhead + 1) * receiverInfo->intervalNs;
-                if (receiverInfo->nextPullTimeNs < minNextPullTimeNs) {
-                    minNextPullTimeNs = receiverInfo->nextPullTimeNs;
-                }
+                receiverPtr->onDataPulled(pull.data, pull.success, elapsedTimeNs);
             } else {
                 VLOG("receiver already gone.");
             }
         }
     }
-
-    VLOG("mNextPullTimeNs: %lld updated to %lld", (long long)mNextPullTimeNs,
-         (long long)minNextPullTimeNs);
-    mNextPullTimeNs = minNextPullTimeNs;
-    updateAlarmLocked();
 }
 
 int StatsPullerManager::ForceClearPullerCache() {
@@ -88,11 +88,14 @@ public:
     // Verify if we know how to pull for this matcher
     bool PullerForMatcherExists(int tagId) const;
 
+    // Pulls the atoms of the receivers that are due, once per puller however many configs
+    // receive its atom, and with up to kMaxConcurrentAlarmPulls pullers running at a time.
     void OnAlarmFired(int64_t elapsedTimeNs);
 
     // Pulls the most recent data.
     // The data may be served from cache if consecutive pulls come within
-    // mCoolDownNs.
+    // mCoolDownNs. The manager is not locked while pulling, so pulls of
+    // different atoms can run at the same time.
     // Returns true if the pull was successful.
     // Returns false when
     //   1) the pull fails
@@ -128,6 +131,9 @@ public:
 private:
     const static int64_t kMinCoolDownNs = NS_PER_SEC;
     const static int64_t kMaxTimeoutNs = 10 * NS_PER_SEC;
+    // Pulls are mostly spent waiting for the process that serves them, so they are overlapped
+    // when an alarm is due for many atoms.
+    const static size_t kMaxConcurrentAlarmPulls = 4;
     shared_ptr<IStatsCompanionService> mStatsCompanionService = nullptr;
 
     // A struct containing an atom id and a Config Key
@@ -152,11 +158,13 @@ private:
     // mapping from Config Key to the PullUidProvider for that config
     std::map<ConfigKey, wp<PullUidProvider>> mPullUidProviders;
 
-    bool PullLocked(int tagId, const ConfigKey& configKey, const int64_t eventTimeNs,
-                    vector<std::shared_ptr<LogEvent>>* data, bool useUids = true);
+    // Gets the uids that configKey allows tagId to be pulled from. Returns false if the config
+    // has no pull uid provider.
+    bool getPullUidsLocked(int tagId, const ConfigKey& configKey, vector<int32_t>* uids);
 
-    bool PullLocked(int tagId, const vector<int32_t>& uids, const int64_t eventTimeNs,
-                    vector<std::shared_ptr<LogEvent>>* data, bool useUids);
+    // Returns the puller of tagId registered by the first of uids that has one, or the one
+    // registered without a uid if useUids is false. Returns nullptr if there is none.
+    sp<StatsPuller> getPullerLocked(int tagId, const vector<int32_t>& uids, bool useUids);
 
     // locks for data receiver and StatsCompanionService changes
     std::mutex mLock;
@@ -19,6 +19,7 @@
 #include "StatsdStats.h"
 
 #include <android/util/ProtoOutputStream.h>
+#include <algorithm>
 #include "../stats_log_util.h"
 #include "statslog_statsd.h"
 #include "storage/StorageManager.h"
@@ -52,6 +53,7 @@ const int FIELD_ID_SYSTEM_SERVER_RESTART = 15;
 const int FIELD_ID_LOGGER_ERROR_STATS = 16;
 const int FIELD_ID_OVERFLOW = 18;
 const int FIELD_ID_ACTIVATION_BROADCAST_GUARDRAIL = 19;
+const int FIELD_ID_EVENT_QUEUE_STATS = 20;
 
 const int FIELD_ID_ATOM_STATS_TAG = 1;
 const int FIELD_ID_ATOM_STATS_COUNT = 2;
@@ -71,6 +73,9 @@ const int FIELD_ID_OVERFLOW_COUNT = 1;
 const int FIELD_ID_OVERFLOW_MAX_HISTORY = 2;
 const int FIELD_ID_OVERFLOW_MIN_HISTORY = 3;
 
+const int FIELD_ID_EVENT_QUEUE_DEPTH_HISTOGRAM = 1;
+const int FIELD_ID_EVENT_QUEUE_LATENCY_MICROS_HISTOGRAM = 2;
+
 const int FIELD_ID_CONFIG_STATS_UID = 1;
 const int FIELD_ID_CONFIG_STATS_ID = 2;
 const int FIELD_ID_CONFIG_STATS_CREATION = 3;
@@ -274,6 +279,26 @@ void StatsdStats::noteEventQueueOverflow(int64_t oldestEventTimestampNs) {
     }
 }
 
+// Index of the bucket of value in a histogram of kEventQueueHistogramBucketCount buckets.
+static int getHistogramBucket(int64_t value) {
+    int bucket = 0;
+    while (value > 0 && bucket < StatsdStats::kEventQueueHistogramBucketCount - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void StatsdStats::noteEventQueueBatch(uint64_t queueDepth,
+                                      const vector<int64_t>& queueLatenciesNs) {
+    lock_guard<std::mutex> lock(mLock);
+
+    mEventQueueDepthHistogram[getHistogramBucket(queueDepth)]++;
+    for (const int64_t latencyNs : queueLatenciesNs) {
+        mEventQueueLatencyMicrosHistogram[getHistogramBucket(latencyNs / 1000)]++;
+    }
+}
+
 void StatsdStats::noteDataDropped(const ConfigKey& key, const size_t totalBytes, int32_t timeSec) {
     lock_guard<std::mutex> lock(mLock);
     auto it = mConfigStats.find(key);
@@ -606,6 +631,8 @@ void StatsdStats::resetInternalLocked() {
     mOverflowCount = 0;
     mMinQueueHistoryNs = kInt64Max;
     mMaxQueueHistoryNs = 0;
+    mEventQueueDepthHistogram.fill(0);
+    mEventQueueLatencyMicrosHistogram.fill(0);
     for (auto& config : mConfigStats) {
         config.second->broadcast_sent_time_sec.clear();
         config.second->activation_time_sec.clear();
@@ -843,6 +870,16 @@ void StatsdStats::dumpStats(int out) const {
     dprintf(out, "Event queue overflow: %d; MaxHistoryNs: %lld; MinHistoryNs: %lld\n",
             mOverflowCount, (long long)mMaxQueueHistoryNs, (long long)mMinQueueHistoryNs);
 
+    dprintf(out, "Event queue depth histogram:");
+    for (const int64_t count : mEventQueueDepthHistogram) {
+        dprintf(out, " %lld", (long long)count);
+    }
+    dprintf(out, "\nEvent queue latency histogram (us):");
+    for (const int64_t count : mEventQueueLatencyMicrosHistogram) {
+        dprintf(out, " %lld", (long long)count);
+    }
+    dprintf(out, "\n");
+
     if (mActivationBroadcastGuardrailStats.size() > 0) {
         dprintf(out, "********mActivationBroadcastGuardrail stats***********\n");
         for (const auto& pair: mActivationBroadcastGuardrailStats) {
@@ -1057,6 +1094,22 @@ void StatsdStats::dumpStats(std::vector<uint8_t>* output, bool reset) {
         proto.end(token);
     }
 
+    if (std::any_of(mEventQueueDepthHistogram.begin(), mEventQueueDepthHistogram.end(),
+                    [](int64_t count) { return count > 0; })) {
+        uint64_t token = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_EVENT_QUEUE_STATS);
+        for (const int64_t count : mEventQueueDepthHistogram) {
+            proto.write(FIELD_TYPE_INT64 | FIELD_ID_EVENT_QUEUE_DEPTH_HISTOGRAM |
+                                FIELD_COUNT_REPEATED,
+                        (long long)count);
+        }
+        for (const int64_t count : mEventQueueLatencyMicrosHistogram) {
+            proto.write(FIELD_TYPE_INT64 | FIELD_ID_EVENT_QUEUE_LATENCY_MICROS_HISTOGRAM |
+                                FIELD_COUNT_REPEATED,
+                        (long long)count);
+        }
+        proto.end(token);
+    }
+
     for (const auto& restart : mSystemServerRestartSec) {
         proto.write(FIELD_TYPE_INT32 | FIELD_ID_SYSTEM_SERVER_RESTART | FIELD_COUNT_REPEATED,
                     restart);
@@ -19,6 +19,7 @@
 
 #include <gtest/gtest_prod.h>
 #include <log/log_time.h>
+#include <array>
 #include <list>
 #include <mutex>
 #include <string>
@@ -191,6 +192,10 @@ public:
 
     static const int32_t kMaxLoggedBucketDropEvents = 10;
 
+    // Buckets of the event queue depth and latency histograms. Bucket 0 counts the values below
+    // 1, bucket i > 0 those in [2^(i-1), 2^i), and the last bucket every larger value.
+    static const int kEventQueueHistogramBucketCount = 24;
+
     /**
      * Report a new config has been received and report the static stats about the config.
      *
@@ -463,6 +468,12 @@ public:
      * the queue */
     void noteEventQueueOverflow(int64_t oldestEventTimestampNs);
 
+    /**
+     * Reports a batch of events popped from the event queue: the number of events that were in
+     * the queue, and how long each event of the batch waited in it.
+     */
+    void noteEventQueueBatch(uint64_t queueDepth, const std::vector<int64_t>& queueLatenciesNs);
+
     /**
      * Reports that the activation broadcast guardrail was hit for this uid. Namely, the broadcast
      * should have been sent, but instead was skipped due to hitting the guardrail.
@@ -618,6 +629,12 @@ private:
     // Total number of events that are lost due to queue overflow.
     int32_t mOverflowCount = 0;
 
+    // Number of events in the queue each time the queue is read.
+    std::array<int64_t, kEventQueueHistogramBucketCount> mEventQueueDepthHistogram = {};
+
+    // Time each event waited in the queue, in microseconds.
+    std::array<int64_t, kEventQueueHistogramBucketCount> mEventQueueLatencyMicrosHistogram = {};
+
     // Timestamps when we detect log loss, and the number of logs lost.
     std::list<LogLossStats> mLogLossStats;
 
@@ -70,6 +70,23 @@ LogEvent::LogEvent(int32_t uid, int32_t pid)
     : mLogdTimestampNs(time(nullptr)), mLogUid(uid), mLogPid(pid) {
 }
 
+void LogEvent::reset(int32_t uid, int32_t pid) {
+    // clear() keeps the capacity of mValues.
+    mValues.clear();
+    mValid = true;
+    mLogdTimestampNs = time(nullptr);
+    mElapsedTimestampNs = 0;
+    mTagId = 0;
+    mLogUid = uid;
+    mLogPid = pid;
+    mTruncateTimestamp = false;
+    mResetState = -1;
+    mUidFieldIndex = -1;
+    mAttributionChainStartIndex = -1;
+    mAttributionChainEndIndex = -1;
+    mExclusiveStateFieldIndex = -1;
+}
+
 LogEvent::LogEvent(const string& trainName, int64_t trainVersionCode, bool requiresStaging,
                    bool rollbackEnabled, bool requiresLowLatencyMonitor, int32_t state,
                    const std::vector<uint8_t>& experimentIds, int32_t userId) {
@@ -127,7 +144,7 @@ void LogEvent::parseString(int32_t* pos, int32_t depth, bool* last, uint8_t numA
     string value = string((char*)mBuf, numBytes);
     mBuf += numBytes;
     mRemainingLen -= numBytes;
-    addToValues(pos, depth, value, last);
+    addToValues(pos, depth, std::move(value), last);
     parseAnnotations(numAnnotations);
 }
 
@@ -154,7 +171,7 @@ void LogEvent::parseByteArray(int32_t* pos, int32_t depth, bool* last, uint8_t n
     vector<uint8_t> value(mBuf, mBuf + numBytes);
     mBuf += numBytes;
     mRemainingLen -= numBytes;
-    addToValues(pos, depth, value, last);
+    addToValues(pos, depth, std::move(value), last);
     parseAnnotations(numAnnotations);
 }
 
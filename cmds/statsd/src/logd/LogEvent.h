@@ -62,6 +62,12 @@ public:
      */
     bool parseBuffer(uint8_t* buf, size_t len);
 
+    /**
+     * Clears the event as if it was just constructed with uid and pid, so that another buffer
+     * can be parsed into it. The memory of the values is kept for the values of that buffer.
+     */
+    void reset(int32_t uid, int32_t pid);
+
     // Constructs a BinaryPushStateChanged LogEvent from API call.
     explicit LogEvent(const std::string& trainName, int64_t trainVersionCode, bool requiresStaging,
                       bool rollbackEnabled, bool requiresLowLatencyMonitor, int32_t state,
@@ -188,7 +194,7 @@ public:
         return mResetState;
     }
 
-    inline LogEvent makeCopy() {
+    inline LogEvent makeCopy() const {
         return LogEvent(*this);
     }
 
@@ -278,15 +284,14 @@ private:
     }
 
     template <class T>
-    void addToValues(int32_t* pos, int32_t depth, T& value, bool* last) {
+    void addToValues(int32_t* pos, int32_t depth, T&& value, bool* last) {
         Field f = Field(mTagId, pos, depth);
         // do not decorate last position at depth 0
         for (int i = 1; i < depth; i++) {
             if (last[i]) f.decorateLastPos(i);
         }
 
-        Value v = Value(value);
-        mValues.push_back(FieldValue(f, v));
+        mValues.emplace_back(f, Value(std::forward<T>(value)));
     }
 
     uint8_t getTypeId(uint8_t typeInfo);
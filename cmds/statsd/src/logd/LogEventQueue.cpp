@@ -19,42 +19,140 @@
 
 #include "LogEventQueue.h"
 
+#include "guardrail/StatsdStats.h"
+#include "stats_log_util.h"
+
 namespace android {
 namespace os {
 namespace statsd {
 
 using std::unique_lock;
 using std::unique_ptr;
+using std::vector;
+
+LogEventQueue::LogEventQueue(size_t maxSize)
+    : mQueueLimit(maxSize),
+      mSlots(new Slot[maxSize]),
+      mTail(0),
+      mHead(0),
+      mConsumerWaiting(false) {
+    for (size_t i = 0; i < mQueueLimit; i++) {
+        mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        mSlots[i].eventTimestampNs.store(0, std::memory_order_relaxed);
+        mSlots[i].pushTimeNs = 0;
+    }
+    mRecycledEvents.reserve(kMaxRecycledEvents);
+}
 
 unique_ptr<LogEvent> LogEventQueue::waitPop() {
-    std::unique_lock<std::mutex> lock(mMutex);
+    vector<unique_ptr<LogEvent>> events;
+    popBatch(&events, 1);
+    return std::move(events.front());
+}
+
+size_t LogEventQueue::popBatch(vector<unique_ptr<LogEvent>>* events, size_t maxEvents) {
+    uint64_t head = mHead.load(std::memory_order_relaxed);
+    // Set when the slot of the position is pushed to.
+    auto isPushed = [this](uint64_t position,
+                           std::memory_order order = std::memory_order_acquire) {
+        return mSlots[position % mQueueLimit].sequence.load(order) == position + 1;
+    };
 
-    if (mQueue.empty()) {
-        mCondition.wait(lock, [this] { return !this->mQueue.empty(); });
+    if (!isPushed(head)) {
+        unique_lock<std::mutex> lock(mMutex);
+        // Sequentially consistent like the publication of an event in push(), so that either the
+        // consumer sees the event or the producer sees that the consumer is waiting.
+        mConsumerWaiting.store(true, std::memory_order_seq_cst);
+        mCondition.wait(lock, [&isPushed, head] {
+            return isPushed(head, std::memory_order_seq_cst);
+        });
+        mConsumerWaiting.store(false, std::memory_order_relaxed);
     }
 
-    unique_ptr<LogEvent> item = std::move(mQueue.front());
-    mQueue.pop();
+    const uint64_t depth = mTail.load(std::memory_order_relaxed) - head;
+    const int64_t nowNs = getElapsedRealtimeNs();
+    size_t popped = 0;
+    while (popped < maxEvents && isPushed(head)) {
+        Slot& slot = mSlots[head % mQueueLimit];
+        mLatenciesNs.push_back(nowNs - slot.pushTimeNs);
+        events->push_back(std::move(slot.event));
+        // Hands the slot back to the producers, for the position one lap later.
+        slot.sequence.store(head + mQueueLimit, std::memory_order_release);
+        head++;
+        popped++;
+    }
+    mHead.store(head, std::memory_order_release);
 
-    return item;
+    StatsdStats::getInstance().noteEventQueueBatch(depth, mLatenciesNs);
+    mLatenciesNs.clear();
+    return popped;
 }
 
 bool LogEventQueue::push(unique_ptr<LogEvent> item, int64_t* oldestTimestampNs) {
-    bool success;
-    {
-        std::unique_lock<std::mutex> lock(mMutex);
-        if (mQueue.size() < mQueueLimit) {
-            mQueue.push(std::move(item));
-            success = true;
+    uint64_t tail = mTail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &mSlots[tail % mQueueLimit];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == tail) {
+            if (mTail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                break;
+            }
+            // tail now holds the position another producer left mTail at.
+        } else if (sequence < tail) {
+            // The slot still holds the event of the previous lap: the queue is full. Events may
+            // be popped concurrently, so the timestamp may be that of a slightly newer event.
+            const uint64_t head = mHead.load(std::memory_order_acquire);
+            *oldestTimestampNs = mSlots[head % mQueueLimit].eventTimestampNs.load(
+                    std::memory_order_relaxed);
+            return false;
         } else {
-            // safe operation as queue must not be empty.
-            *oldestTimestampNs = mQueue.front()->GetElapsedTimestampNs();
-            success = false;
+            tail = mTail.load(std::memory_order_relaxed);
         }
     }
 
-    mCondition.notify_one();
-    return success;
+    slot->eventTimestampNs.store(item->GetElapsedTimestampNs(), std::memory_order_relaxed);
+    slot->pushTimeNs = getElapsedRealtimeNs();
+    slot->event = std::move(item);
+    slot->sequence.store(tail + 1, std::memory_order_seq_cst);
+
+    if (mConsumerWaiting.load(std::memory_order_seq_cst)) {
+        // Taking the lock makes sure the consumer is either before its check of the slot, or
+        // waiting for the notification.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_one();
+    }
+    return true;
+}
+
+unique_ptr<LogEvent> LogEventQueue::obtain(int32_t uid, int32_t pid) {
+    unique_ptr<LogEvent> event;
+    {
+        std::lock_guard<std::mutex> lock(mRecycledMutex);
+        if (!mRecycledEvents.empty()) {
+            event = std::move(mRecycledEvents.back());
+            mRecycledEvents.pop_back();
+        }
+    }
+    if (event == nullptr) {
+        return std::make_unique<LogEvent>(uid, pid);
+    }
+    event->reset(uid, pid);
+    return event;
+}
+
+void LogEventQueue::recycle(vector<unique_ptr<LogEvent>>* events) {
+    {
+        std::lock_guard<std::mutex> lock(mRecycledMutex);
+        for (auto& event : *events) {
+            if (mRecycledEvents.size() >= kMaxRecycledEvents) {
+                break;
+            }
+            mRecycledEvents.push_back(std::move(event));
+        }
+    }
+    // The events that were not kept are freed outside of the lock.
+    events->clear();
 }
 
 }  // namespace statsd
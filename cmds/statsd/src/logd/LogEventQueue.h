@@ -18,9 +18,11 @@
 
 #include "LogEvent.h"
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 namespace android {
 namespace os {
@@ -28,16 +30,27 @@ namespace statsd {
 
 /**
  * A zero copy thread safe queue buffer for producing and consuming LogEvent.
+ *
+ * The queue is a bounded ring that producers claim slots of with a compare-and-swap, so that
+ * pushing an event never blocks on another producer or on the consumer. Only one thread may
+ * consume events. The consumer only sleeps on mMutex when the queue is empty, and producers only
+ * take mMutex to wake it up.
  */
 class LogEventQueue {
 public:
-    explicit LogEventQueue(size_t maxSize) : mQueueLimit(maxSize){};
+    explicit LogEventQueue(size_t maxSize);
 
     /**
      * Blocking read one event from the queue.
      */
     std::unique_ptr<LogEvent> waitPop();
 
+    /**
+     * Blocks until the queue is not empty, then moves up to maxEvents of its oldest events to the
+     * end of events, in the order they were pushed. Returns the number of events that were moved.
+     */
+    size_t popBatch(std::vector<std::unique_ptr<LogEvent>>* events, size_t maxEvents);
+
     /**
      * Puts a LogEvent ptr to the end of the queue.
      * Returns false on failure when the queue is full, and output the oldest event timestamp
@@ -45,11 +58,52 @@ public:
      */
     bool push(std::unique_ptr<LogEvent> event, int64_t* oldestTimestampNs);
 
+    /**
+     * Returns an event to parse a buffer into, as if it was constructed with uid and pid. It is a
+     * recycled event when there is one, whose values reuse the memory of its previous values.
+     */
+    std::unique_ptr<LogEvent> obtain(int32_t uid, int32_t pid);
+
+    /**
+     * Keeps the events for obtain() to return, once they are processed, and clears events.
+     */
+    void recycle(std::vector<std::unique_ptr<LogEvent>>* events);
+
+    // Most events kept for obtain(), a few batches of them.
+    static const size_t kMaxRecycledEvents = 256;
+
 private:
+    struct Slot {
+        // Position of the ring the slot is ready to be pushed to, or that position + 1 once the
+        // event of that position has been pushed to it.
+        std::atomic<uint64_t> sequence;
+        std::unique_ptr<LogEvent> event;
+        // Elapsed timestamp of the event, readable by producers while the consumer pops it.
+        std::atomic<int64_t> eventTimestampNs;
+        // When the event was pushed, for the queue latency stats.
+        int64_t pushTimeNs;
+    };
+
     const size_t mQueueLimit;
+    std::unique_ptr<Slot[]> mSlots;
+
+    // Next position to push to, shared by the producers.
+    alignas(64) std::atomic<uint64_t> mTail;
+    // Next position to pop from, only written by the consumer.
+    alignas(64) std::atomic<uint64_t> mHead;
+
+    // Set by the consumer before it sleeps on mCondition.
+    std::atomic<bool> mConsumerWaiting;
     std::condition_variable mCondition;
     std::mutex mMutex;
-    std::queue<std::unique_ptr<LogEvent>> mQueue;
+
+    // Queue latencies of the batch being popped, kept to not allocate for every batch.
+    std::vector<int64_t> mLatenciesNs;
+
+    // Processed events, for obtain() to return. Separate from mMutex so that the producer does
+    // not wake up the consumer.
+    std::mutex mRecycledMutex;
+    std::vector<std::unique_ptr<LogEvent>> mRecycledEvents;
 };
 
 }  // namespace statsd
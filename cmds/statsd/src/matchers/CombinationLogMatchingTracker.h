@@ -43,8 +43,6 @@ public:
 
 private:
     LogicalOperation mLogicalOperation;
-
-    std::vector<int> mChildren;
 };
 
 }  // namespace statsd
@@ -69,6 +69,12 @@ public:
         return mAtomIds;
     }
 
+    // Get the indices of the matchers whose results this matcher combines. Empty for simple
+    // matchers.
+    const std::vector<int>& getChildren() const {
+        return mChildren;
+    }
+
     const int64_t& getId() const {
         return mId;
     }
@@ -87,6 +93,9 @@ protected:
     // return kNotMatched when we receive an event with an id not in the list. This is especially
     // useful when we have a complex CombinationLogMatcherTracker.
     std::set<int> mAtomIds;
+
+    // The indices of the children LogMatchingTrackers, which are evaluated as part of this one.
+    std::vector<int> mChildren;
 };
 
 }  // namespace statsd
@@ -133,6 +133,10 @@ void MetricProducer::onMatchedLogEventLocked(const size_t matcherIndex, const Lo
 
     HashableDimensionKey dimensionInWhat;
     filterValues(mDimensionsInWhat, event.getValues(), &dimensionInWhat);
+    if (HashableDimensionKey::isInterningEnabled()) {
+        // The maps of this metric then share the values of the key with the other metrics.
+        dimensionInWhat.intern();
+    }
     MetricDimensionKey metricKey(dimensionInWhat, stateValuesKey);
     onMatchedLogEventInternalLocked(matcherIndex, metricKey, conditionKey, condition, event,
                                     statePrimaryKeys);
@@ -20,6 +20,8 @@
 
 #include <private/android_filesystem_config.h>
 
+#include <algorithm>
+
 #include "CountMetricProducer.h"
 #include "condition/CombinationConditionTracker.h"
 #include "condition/SimpleConditionTracker.h"
@@ -83,6 +85,7 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
             mConditionToMetricMap, mTrackerToMetricMap, mTrackerToConditionMap,
             mActivationAtomTrackerToMetricMap, mDeactivationAtomTrackerToMetricMap,
             mAlertTrackerMap, mMetricIndexesWithActivation, mNoReportMetricIds);
+    initAtomMatcherIndex();
 
     mHashStringsInReport = config.hash_strings_in_metric_report();
     mVersionStringsInReport = config.version_strings_in_metric_report();
@@ -351,6 +354,41 @@ void MetricsManager::onDumpReport(const int64_t dumpTimeStampNs,
             producer->clearPastBuckets(dumpTimeStampNs);
         }
     }
+    finishDumpReport(dumpTimeStampNs, erase_data, protoOutput);
+}
+
+bool MetricsManager::onDumpReport(const int64_t dumpTimeStampNs,
+                                  const bool include_current_partial_bucket,
+                                  const bool erase_data,
+                                  const DumpLatency dumpLatency,
+                                  std::set<string>* str_set,
+                                  const int metricsFd,
+                                  ProtoOutputStream* protoOutput) {
+    VLOG("=========================Metric Reports Start==========================");
+    bool success = true;
+    for (const auto& producer : mAllMetricProducers) {
+        if (mNoReportMetricIds.find(producer->getMetricId()) == mNoReportMetricIds.end()) {
+            // The producer erases the past buckets it writes into the report, so the report of
+            // the metric is the only copy of them until it is written out.
+            ProtoOutputStream metricReport;
+            producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
+                                   dumpLatency, mHashStringsInReport ? str_set : nullptr,
+                                   &metricReport);
+            // The remaining metrics are still dumped on failure, so that they are erased alike.
+            success = success &&
+                      writeLengthDelimitedHeaderToFd(metricsFd, FIELD_ID_METRICS,
+                                                     metricReport.size()) > 0 &&
+                      metricReport.flush(metricsFd);
+        } else {
+            producer->clearPastBuckets(dumpTimeStampNs);
+        }
+    }
+    finishDumpReport(dumpTimeStampNs, erase_data, protoOutput);
+    return success;
+}
+
+void MetricsManager::finishDumpReport(const int64_t dumpTimeStampNs, const bool erase_data,
+                                      ProtoOutputStream* protoOutput) {
     for (const auto& annotation : mAnnotations) {
         uint64_t token = protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED |
                                             FIELD_ID_ANNOTATIONS);
@@ -479,16 +517,18 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
 
     mIsActive = isActive || !activeMetricsIndices.empty();
 
-    if (mTagIds.find(tagId) == mTagIds.end()) {
+    auto matchersForTag = mTagIdToMatcherIndices.find(tagId);
+    if (matchersForTag == mTagIdToMatcherIndices.end()) {
         // Not interesting...
         return;
     }
+    const vector<int>& matcherIndices = matchersForTag->second;
+    vector<MatchingState>& matcherCache = mMatcherCache;
 
-    vector<MatchingState> matcherCache(mAllAtomMatchers.size(), MatchingState::kNotComputed);
-
-    // Evaluate all atom matchers.
-    for (auto& matcher : mAllAtomMatchers) {
-        matcher->onLogEvent(event, mAllAtomMatchers, matcherCache);
+    // Evaluate the atom matchers that may match this tag. The others stay kNotComputed, which
+    // everything below treats as not matched.
+    for (const int matcherIndex : matcherIndices) {
+        mAllAtomMatchers[matcherIndex]->onLogEvent(event, mAllAtomMatchers, matcherCache);
     }
 
     // Set of metrics that received an activation cancellation.
@@ -529,21 +569,27 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     mIsActive = isActive;
 
     // A bitmap to see which ConditionTracker needs to be re-evaluated.
-    vector<bool> conditionToBeEvaluated(mAllConditionTrackers.size(), false);
+    vector<bool>& conditionToBeEvaluated = mConditionToBeEvaluated;
+    std::fill(conditionToBeEvaluated.begin(), conditionToBeEvaluated.end(), false);
 
-    for (const auto& pair : mTrackerToConditionMap) {
-        if (matcherCache[pair.first] == MatchingState::kMatched) {
-            const auto& conditionList = pair.second;
+    for (const int matcherIndex : matcherIndices) {
+        if (matcherCache[matcherIndex] != MatchingState::kMatched) {
+            continue;
+        }
+        auto pair = mTrackerToConditionMap.find(matcherIndex);
+        if (pair != mTrackerToConditionMap.end()) {
+            const auto& conditionList = pair->second;
             for (const int conditionIndex : conditionList) {
                 conditionToBeEvaluated[conditionIndex] = true;
             }
         }
     }
 
-    vector<ConditionState> conditionCache(mAllConditionTrackers.size(),
-                                          ConditionState::kNotEvaluated);
+    vector<ConditionState>& conditionCache = mConditionCache;
     // A bitmap to track if a condition has changed value.
-    vector<bool> changedCache(mAllConditionTrackers.size(), false);
+    vector<bool>& changedCache = mChangedConditionCache;
+    std::fill(conditionCache.begin(), conditionCache.end(), ConditionState::kNotEvaluated);
+    std::fill(changedCache.begin(), changedCache.end(), false);
     for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
         if (conditionToBeEvaluated[i] == false) {
             continue;
@@ -578,7 +624,7 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     }
 
     // For matched AtomMatchers, tell relevant metrics that a matched event has come.
-    for (size_t i = 0; i < mAllAtomMatchers.size(); i++) {
+    for (const int i : matcherIndices) {
         if (matcherCache[i] == MatchingState::kMatched) {
             StatsdStats::getInstance().noteMatcherMatched(mConfigKey,
                                                           mAllAtomMatchers[i]->getId());
@@ -592,6 +638,41 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
             }
         }
     }
+
+    // Leave the matcher cache clean for the next event.
+    for (const int matcherIndex : matcherIndices) {
+        matcherCache[matcherIndex] = MatchingState::kNotComputed;
+    }
+}
+
+void MetricsManager::initAtomMatcherIndex() {
+    for (size_t i = 0; i < mAllAtomMatchers.size(); i++) {
+        // The matcher and the descendants it evaluates, without duplicates.
+        std::set<int> evaluated;
+        vector<int> toVisit = {static_cast<int>(i)};
+        while (!toVisit.empty()) {
+            int index = toVisit.back();
+            toVisit.pop_back();
+            if (evaluated.insert(index).second) {
+                const vector<int>& children = mAllAtomMatchers[index]->getChildren();
+                toVisit.insert(toVisit.end(), children.begin(), children.end());
+            }
+        }
+        for (const int tagId : mAllAtomMatchers[i]->getAtomIds()) {
+            vector<int>& indices = mTagIdToMatcherIndices[tagId];
+            indices.insert(indices.end(), evaluated.begin(), evaluated.end());
+        }
+    }
+    for (auto& tagAndIndices : mTagIdToMatcherIndices) {
+        vector<int>& indices = tagAndIndices.second;
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    }
+
+    mMatcherCache.assign(mAllAtomMatchers.size(), MatchingState::kNotComputed);
+    mConditionToBeEvaluated.assign(mAllConditionTrackers.size(), false);
+    mConditionCache.assign(mAllConditionTrackers.size(), ConditionState::kNotEvaluated);
+    mChangedConditionCache.assign(mAllConditionTrackers.size(), false);
 }
 
 void MetricsManager::onAnomalyAlarmFired(
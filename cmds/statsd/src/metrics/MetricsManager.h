@@ -29,6 +29,7 @@
 #include "metrics/MetricProducer.h"
 #include "packages/UidMap.h"
 
+#include <atomic>
 #include <unordered_map>
 
 namespace android {
@@ -131,6 +132,15 @@ public:
                               std::set<string> *str_set,
                               android::util::ProtoOutputStream* protoOutput);
 
+    // Same as above, but writes each StatsLogReport to metricsFd, size-prefixed as a metrics
+    // field of ConfigMetricsReport, as soon as it is built, so that the past buckets of a single
+    // metric are held in memory at a time. The rest of the report is written to protoOutput.
+    // Returns false if metricsFd could not be written to.
+    bool onDumpReport(const int64_t dumpTimeNs, const bool include_current_partial_bucket,
+                      const bool erase_data, const DumpLatency dumpLatency,
+                      std::set<string>* str_set, const int metricsFd,
+                      android::util::ProtoOutputStream* protoOutput);
+
     // Computes the total byte size of all metrics managed by a single config source.
     // Does not change the state.
     virtual size_t byteSize();
@@ -158,6 +168,11 @@ private:
     // For test only.
     inline int64_t getTtlEndNs() const { return mTtlEndNs; }
 
+    // Writes the annotations of the report and updates the report times, once its metrics are
+    // dumped.
+    void finishDumpReport(const int64_t dumpTimeNs, const bool erase_data,
+                          android::util::ProtoOutputStream* protoOutput);
+
     const ConfigKey mConfigKey;
 
     sp<UidMap> mUidMap;
@@ -171,7 +186,9 @@ private:
     const int64_t mTtlNs;
     int64_t mTtlEndNs;
 
-    int64_t mLastReportTimeNs;
+    // Read by the data broadcasts, which don't hold the lock of this config when the configs are
+    // processed concurrently.
+    std::atomic<int64_t> mLastReportTimeNs;
     int64_t mLastReportWallClockNs;
 
     sp<StatsPullerManager> mPullerManager;
@@ -269,8 +286,22 @@ private:
 
     std::vector<int> mMetricIndexesWithActivation;
 
+    // Maps each interesting tag id to the indices of the LogMatchingTrackers that need to be
+    // evaluated for it: the matchers that care about the tag, and the children they combine. Only
+    // these matchers can have a result other than kNotComputed for an event of that tag.
+    std::unordered_map<int, std::vector<int>> mTagIdToMatcherIndices;
+
+    // Scratch buffers of onLogEvent, reused across events. mMatcherCache is all kNotComputed
+    // between events.
+    std::vector<MatchingState> mMatcherCache;
+    std::vector<bool> mConditionToBeEvaluated;
+    std::vector<ConditionState> mConditionCache;
+    std::vector<bool> mChangedConditionCache;
+
     void initLogSourceWhiteList();
 
+    void initAtomMatcherIndex();
+
     void initPullAtomSources();
 
     // The metrics that don't need to be uploaded or even reported.
@@ -311,6 +342,7 @@ private:
     FRIEND_TEST(MetricActivationE2eTest, TestCountMetricWithTwoMetricsTwoDeactivations);
 
     FRIEND_TEST(MetricsManagerTest, TestLogSources);
+    FRIEND_TEST(MetricsManagerTest, TestAtomMatcherIndex);
 
     FRIEND_TEST(StatsLogProcessorTest, TestActiveConfigMetricDiskWriteRead);
     FRIEND_TEST(StatsLogProcessorTest, TestActivationOnBoot);
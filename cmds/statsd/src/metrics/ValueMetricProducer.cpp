@@ -23,6 +23,8 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
 
 using android::util::FIELD_COUNT_REPEATED;
 using android::util::FIELD_TYPE_BOOL;
@@ -75,6 +77,8 @@ const int FIELD_ID_CONDITION_TRUE_NS = 10;
 const Value ZERO_LONG((int64_t)0);
 const Value ZERO_DOUBLE((int64_t)0);
 
+static std::atomic<bool> gSortedDiffEnabled(false);
+
 // ValueMetric has a minimum bucket size of 10min so that we don't pull too frequently
 ValueMetricProducer::ValueMetricProducer(
         const ConfigKey& key, const ValueMetric& metric, const int conditionIndex,
@@ -603,32 +607,36 @@ void ValueMetricProducer::accumulateEvents(const std::vector<std::shared_ptr<Log
         return;
     }
 
-    mMatchedMetricDimensionKeys.clear();
-    for (const auto& data : allData) {
-        LogEvent localCopy = data->makeCopy();
-        if (mEventMatcherWizard->matchLogEvent(localCopy, mWhatMatcherIndex) ==
-            MatchingState::kMatched) {
-            localCopy.setElapsedTimestampNs(eventElapsedTimeNs);
-            onMatchedLogEventLocked(mWhatMatcherIndex, localCopy);
+    if (canUseSortedDiffLocked(eventElapsedTimeNs)) {
+        accumulateSortedEventsLocked(allData, eventElapsedTimeNs);
+    } else {
+        mMatchedMetricDimensionKeys.clear();
+        for (const auto& data : allData) {
+            LogEvent localCopy = data->makeCopy();
+            if (mEventMatcherWizard->matchLogEvent(localCopy, mWhatMatcherIndex) ==
+                MatchingState::kMatched) {
+                localCopy.setElapsedTimestampNs(eventElapsedTimeNs);
+                onMatchedLogEventLocked(mWhatMatcherIndex, localCopy);
+            }
         }
-    }
-    // If a key that is:
-    // 1. Tracked in mCurrentSlicedBucket and
-    // 2. A superset of the current mStateChangePrimaryKey
-    // was not found in the new pulled data (i.e. not in mMatchedDimensionInWhatKeys)
-    // then we need to reset the base.
-    for (auto& slice : mCurrentSlicedBucket) {
-        const auto& whatKey = slice.first.getDimensionKeyInWhat();
-        bool presentInPulledData =
-                mMatchedMetricDimensionKeys.find(whatKey) != mMatchedMetricDimensionKeys.end();
-        if (!presentInPulledData && whatKey.contains(mStateChangePrimaryKey.second)) {
-            auto it = mCurrentBaseInfo.find(whatKey);
-            for (auto& baseInfo : it->second) {
-                baseInfo.hasBase = false;
+        // If a key that is:
+        // 1. Tracked in mCurrentSlicedBucket and
+        // 2. A superset of the current mStateChangePrimaryKey
+        // was not found in the new pulled data (i.e. not in mMatchedDimensionInWhatKeys)
+        // then we need to reset the base.
+        for (auto& slice : mCurrentSlicedBucket) {
+            const auto& whatKey = slice.first.getDimensionKeyInWhat();
+            bool presentInPulledData =
+                    mMatchedMetricDimensionKeys.find(whatKey) != mMatchedMetricDimensionKeys.end();
+            if (!presentInPulledData && whatKey.contains(mStateChangePrimaryKey.second)) {
+                auto it = mCurrentBaseInfo.find(whatKey);
+                for (auto& baseInfo : it->second) {
+                    baseInfo.hasBase = false;
+                }
             }
         }
+        mMatchedMetricDimensionKeys.clear();
     }
-    mMatchedMetricDimensionKeys.clear();
     mHasGlobalBase = true;
 
     // If we reach the guardrail, we might have dropped some data which means the bucket is
@@ -643,6 +651,100 @@ void ValueMetricProducer::accumulateEvents(const std::vector<std::shared_ptr<Log
     }
 }
 
+void ValueMetricProducer::setSortedDiffEnabled(bool enabled) {
+    gSortedDiffEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool ValueMetricProducer::isSortedDiffEnabled() {
+    return gSortedDiffEnabled.load(std::memory_order_relaxed);
+}
+
+bool ValueMetricProducer::canUseSortedDiffLocked(const int64_t eventElapsedTimeNs) const {
+    // Without sliced states, the events of a pull only depend on their dimensions in what, and
+    // the events that MetricProducer::onMatchedLogEventLocked would drop are dropped together.
+    return isSortedDiffEnabled() && mIsPulled && mUseDiff && mSlicedStateAtoms.empty() &&
+           mIsActive && eventElapsedTimeNs >= mTimeBaseNs &&
+           eventElapsedTimeNs >= mCurrentBucketStartTimeNs;
+}
+
+void ValueMetricProducer::accumulateSortedEventsLocked(
+        const std::vector<std::shared_ptr<LogEvent>>& allData, const int64_t eventElapsedTimeNs) {
+    if (mSortedBaseInfo.size() != mCurrentBaseInfo.size()) {
+        // Bases were added by events diffed one at a time, or this is the first pull.
+        mSortedBaseInfo.clear();
+        for (auto& it : mCurrentBaseInfo) {
+            mSortedBaseInfo.emplace_back(it.first, &it.second);
+        }
+        std::sort(mSortedBaseInfo.begin(), mSortedBaseInfo.end(),
+                  [](const SortedBaseInfo& a, const SortedBaseInfo& b) {
+                      return a.first < b.first;
+                  });
+    }
+
+    mPulledRows.clear();
+    for (const auto& data : allData) {
+        if (mEventMatcherWizard->matchLogEvent(*data, mWhatMatcherIndex) !=
+            MatchingState::kMatched) {
+            continue;
+        }
+        mPulledRows.emplace_back();
+        PulledRow& row = mPulledRows.back();
+        row.event = data.get();
+        filterValues(mDimensionsInWhat, data->getValues(), &row.whatKey);
+    }
+    auto byWhatKey = [](const PulledRow& a, const PulledRow& b) { return a.whatKey < b.whatKey; };
+    // Pullers mostly report their rows in the same order every time.
+    if (!std::is_sorted(mPulledRows.begin(), mPulledRows.end(), byWhatKey)) {
+        // Stable, so that the rows of a key are diffed in the order they were pulled.
+        std::stable_sort(mPulledRows.begin(), mPulledRows.end(), byWhatKey);
+    }
+
+    // Keys tracked in mCurrentSlicedBucket that are not in the pulled data lose their base.
+    auto mergeMissingKey = [this](const SortedBaseInfo& baseInfo) {
+        if (mCurrentSlicedBucket.find(MetricDimensionKey(baseInfo.first, DEFAULT_DIMENSION_KEY)) !=
+            mCurrentSlicedBucket.end()) {
+            for (BaseInfo& info : *baseInfo.second) {
+                info.hasBase = false;
+            }
+        }
+        mMergedBaseInfo.push_back(baseInfo);
+    };
+
+    mMergedBaseInfo.clear();
+    auto baseIt = mSortedBaseInfo.begin();
+    for (const PulledRow& row : mPulledRows) {
+        while (baseIt != mSortedBaseInfo.end() && baseIt->first < row.whatKey) {
+            mergeMissingKey(*baseIt++);
+        }
+        bool passedGuardRail = false;
+        if (baseIt != mSortedBaseInfo.end() && baseIt->first == row.whatKey) {
+            mMergedBaseInfo.push_back(*baseIt++);
+        } else if (mMergedBaseInfo.empty() || mMergedBaseInfo.back().first != row.whatKey) {
+            // A dimension without a base, which the guardrail may keep out before it gets one.
+            HashableDimensionKey whatKey = row.whatKey;
+            if (HashableDimensionKey::isInterningEnabled()) {
+                whatKey.intern();
+            }
+            if (hitGuardRailLocked(MetricDimensionKey(whatKey, DEFAULT_DIMENSION_KEY))) {
+                continue;
+            }
+            mMergedBaseInfo.emplace_back(whatKey, &mCurrentBaseInfo[whatKey]);
+            passedGuardRail = true;
+        }
+        // The key of the base shares its values with the keys of the bucket when interned.
+        const MetricDimensionKey eventKey(mMergedBaseInfo.back().first, DEFAULT_DIMENSION_KEY);
+        if (!passedGuardRail && hitGuardRailLocked(eventKey)) {
+            continue;
+        }
+        aggregateEventLocked(eventKey, *row.event, eventElapsedTimeNs,
+                             *mMergedBaseInfo.back().second);
+    }
+    while (baseIt != mSortedBaseInfo.end()) {
+        mergeMissingKey(*baseIt++);
+    }
+    mSortedBaseInfo.swap(mMergedBaseInfo);
+}
+
 void ValueMetricProducer::dumpStatesLocked(FILE* out, bool verbose) const {
     if (mCurrentSlicedBucket.size() == 0) {
         return;
@@ -783,7 +885,15 @@ void ValueMetricProducer::onMatchedLogEventInternalLocked(
         return;
     }
 
-    vector<BaseInfo>& baseInfos = mCurrentBaseInfo[whatKey];
+    aggregateEventLocked(eventKey, event, eventTimeNs, mCurrentBaseInfo[whatKey]);
+}
+
+void ValueMetricProducer::aggregateEventLocked(const MetricDimensionKey& eventKey,
+                                               const LogEvent& event, const int64_t eventTimeNs,
+                                               vector<BaseInfo>& baseInfos) {
+    const auto& whatKey = eventKey.getDimensionKeyInWhat();
+    const auto& stateKey = eventKey.getStateValuesKey();
+
     if (baseInfos.size() < mFieldMatchers.size()) {
         VLOG("Resizing number of intervals to %d", (int)mFieldMatchers.size());
         baseInfos.resize(mFieldMatchers.size());
@@ -69,6 +69,13 @@ public:
     void onDataPulled(const std::vector<std::shared_ptr<LogEvent>>& data,
                       bool pullSuccess, int64_t originalPullTimeNs) override;
 
+    // When enabled, pulled diffed metrics that are not sliced by state sort the rows of each pull
+    // by dimension and diff them against their bases in a single merge pass, instead of looking up
+    // each row and each tracked dimension in hash maps.
+    static void setSortedDiffEnabled(bool enabled);
+
+    static bool isSortedDiffEnabled();
+
     // ValueMetric needs special logic if it's a pulled atom.
     void notifyAppUpgrade(const int64_t& eventTimeNs) override {
         std::lock_guard<std::mutex> lock(mMutex);
@@ -203,6 +210,21 @@ private:
 
     std::unordered_map<HashableDimensionKey, std::vector<BaseInfo>> mCurrentBaseInfo;
 
+    typedef std::pair<HashableDimensionKey, std::vector<BaseInfo>*> SortedBaseInfo;
+
+    // The entries of mCurrentBaseInfo sorted by dimension, as of the last sorted diff. It is
+    // rebuilt when its size no longer matches, which relies on entries never being erased.
+    std::vector<SortedBaseInfo> mSortedBaseInfo;
+
+    typedef struct {
+        HashableDimensionKey whatKey;
+        const LogEvent* event;
+    } PulledRow;
+
+    // Buffers of accumulateSortedEventsLocked, kept between pulls to reuse their capacity.
+    std::vector<PulledRow> mPulledRows;
+    std::vector<SortedBaseInfo> mMergedBaseInfo;
+
     std::unordered_map<MetricDimensionKey, int64_t> mCurrentFullBucket;
 
     // Save the past buckets and we can clear when the StatsLogReport is dumped.
@@ -222,6 +244,16 @@ private:
     void accumulateEvents(const std::vector<std::shared_ptr<LogEvent>>& allData,
                           int64_t originalPullTimeNs, int64_t eventElapsedTimeNs);
 
+    // Whether a pull at the given time can be diffed with accumulateSortedEventsLocked.
+    bool canUseSortedDiffLocked(const int64_t eventElapsedTimeNs) const;
+
+    void accumulateSortedEventsLocked(const std::vector<std::shared_ptr<LogEvent>>& allData,
+                                      const int64_t eventElapsedTimeNs);
+
+    // Diffs and aggregates the values of an event whose dimension passed the guardrail.
+    void aggregateEventLocked(const MetricDimensionKey& eventKey, const LogEvent& event,
+                              const int64_t eventTimeNs, std::vector<BaseInfo>& baseInfos);
+
     ValueBucket buildPartialBucket(int64_t bucketEndTime,
                                    const std::vector<Interval>& intervals);
 
@@ -314,6 +346,7 @@ private:
     FRIEND_TEST(ValueMetricProducerTest, TestSlicedStateWithMap);
     FRIEND_TEST(ValueMetricProducerTest, TestSlicedStateWithPrimaryField_WithDimensions);
     FRIEND_TEST(ValueMetricProducerTest, TestSlicedStateWithCondition);
+    FRIEND_TEST(ValueMetricProducerTest, TestSortedDiffMatchesHashedDiff);
     FRIEND_TEST(ValueMetricProducerTest, TestTrimUnusedDimensionKey);
     FRIEND_TEST(ValueMetricProducerTest, TestUseZeroDefaultBase);
     FRIEND_TEST(ValueMetricProducerTest, TestUseZeroDefaultBaseWithPullFailures);
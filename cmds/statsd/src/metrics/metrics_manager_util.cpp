@@ -127,6 +127,9 @@ bool handleMetricWithConditions(
         }
         allConditionTrackers[condition_it->second]->setSliced(true);
         allConditionTrackers[it->second]->setSliced(true);
+        vector<Matcher> linkConditionFields;
+        translateFieldMatcher(link.fields_in_condition(), &linkConditionFields);
+        allConditionTrackers[it->second]->addSlicedConditionIndex(linkConditionFields);
     }
     conditionIndex = condition_it->second;
 
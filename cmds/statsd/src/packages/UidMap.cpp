@@ -75,7 +75,7 @@ sp<UidMap> UidMap::getInstance() {
 }
 
 bool UidMap::hasApp(int uid, const string& packageName) const {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
     auto it = mMap.find(std::make_pair(uid, packageName));
     return it != mMap.end() && !it->second.deleted;
@@ -88,7 +88,7 @@ string UidMap::normalizeAppName(const string& appName) const {
 }
 
 std::set<string> UidMap::getAppNamesFromUid(const int32_t& uid, bool returnNormalized) const {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
     return getAppNamesFromUidLocked(uid,returnNormalized);
 }
 
@@ -103,7 +103,7 @@ std::set<string> UidMap::getAppNamesFromUidLocked(const int32_t& uid, bool retur
 }
 
 int64_t UidMap::getAppVersion(int uid, const string& packageName) const {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
     auto it = mMap.find(std::make_pair(uid, packageName));
     if (it == mMap.end() || it->second.deleted) {
@@ -117,7 +117,7 @@ void UidMap::updateMap(const int64_t& timestamp, const vector<int32_t>& uid,
                        const vector<String16>& packageName, const vector<String16>& installer) {
     wp<PackageInfoListener> broadcast = NULL;
     {
-        lock_guard<mutex> lock(mMutex);  // Exclusively lock for updates.
+        lock_guard<shared_mutex> lock(mMutex);  // Exclusively lock for updates.
 
         std::unordered_map<std::pair<int, string>, AppData, PairHash> deletedApps;
 
@@ -164,7 +164,7 @@ void UidMap::updateApp(const int64_t& timestamp, const String16& app_16, const i
     wp<PackageInfoListener> broadcast = NULL;
     string appName = string(String8(app_16).string());
     {
-        lock_guard<mutex> lock(mMutex);
+        lock_guard<shared_mutex> lock(mMutex);
         int32_t prevVersion = 0;
         string prevVersionString = "";
         string newVersionString = string(String8(versionString).string());
@@ -225,7 +225,7 @@ void UidMap::removeApp(const int64_t& timestamp, const String16& app_16, const i
     wp<PackageInfoListener> broadcast = NULL;
     string app = string(String8(app_16).string());
     {
-        lock_guard<mutex> lock(mMutex);
+        lock_guard<shared_mutex> lock(mMutex);
 
         int64_t prevVersion = 0;
         string prevVersionString = "";
@@ -259,18 +259,18 @@ void UidMap::removeApp(const int64_t& timestamp, const String16& app_16, const i
 }
 
 void UidMap::setListener(wp<PackageInfoListener> listener) {
-    lock_guard<mutex> lock(mMutex);  // Lock for updates
+    lock_guard<shared_mutex> lock(mMutex);  // Lock for updates
     mSubscriber = listener;
 }
 
 void UidMap::assignIsolatedUid(int isolatedUid, int parentUid) {
-    lock_guard<mutex> lock(mIsolatedMutex);
+    lock_guard<shared_mutex> lock(mIsolatedMutex);
 
     mIsolatedUidMap[isolatedUid] = parentUid;
 }
 
 void UidMap::removeIsolatedUid(int isolatedUid) {
-    lock_guard<mutex> lock(mIsolatedMutex);
+    lock_guard<shared_mutex> lock(mIsolatedMutex);
 
     auto it = mIsolatedUidMap.find(isolatedUid);
     if (it != mIsolatedUidMap.end()) {
@@ -279,7 +279,7 @@ void UidMap::removeIsolatedUid(int isolatedUid) {
 }
 
 int UidMap::getHostUidOrSelf(int uid) const {
-    lock_guard<mutex> lock(mIsolatedMutex);
+    shared_lock<shared_mutex> lock(mIsolatedMutex);
 
     auto it = mIsolatedUidMap.find(uid);
     if (it != mIsolatedUidMap.end()) {
@@ -315,7 +315,7 @@ size_t UidMap::getBytesUsed() const {
 void UidMap::writeUidMapSnapshot(int64_t timestamp, bool includeVersionStrings,
                                  bool includeInstaller, const std::set<int32_t>& interestingUids,
                                  std::set<string>* str_set, ProtoOutputStream* proto) {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
     writeUidMapSnapshotLocked(timestamp, includeVersionStrings, includeInstaller, interestingUids,
                               str_set, proto);
@@ -370,7 +370,7 @@ void UidMap::writeUidMapSnapshotLocked(int64_t timestamp, bool includeVersionStr
 void UidMap::appendUidMap(const int64_t& timestamp, const ConfigKey& key, std::set<string>* str_set,
                           bool includeVersionStrings, bool includeInstaller,
                           ProtoOutputStream* proto) {
-    lock_guard<mutex> lock(mMutex);  // Lock for updates
+    lock_guard<shared_mutex> lock(mMutex);  // Lock for updates
 
     for (const ChangeRecord& record : mChanges) {
         if (record.timestampNs > mLastUpdatePerConfigKey[key]) {
@@ -438,7 +438,7 @@ void UidMap::appendUidMap(const int64_t& timestamp, const ConfigKey& key, std::s
 }
 
 void UidMap::printUidMap(int out) const {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
     for (const auto& kv : mMap) {
         if (!kv.second.deleted) {
@@ -450,15 +450,17 @@ void UidMap::printUidMap(int out) const {
 }
 
 void UidMap::OnConfigUpdated(const ConfigKey& key) {
+    lock_guard<shared_mutex> lock(mMutex);
     mLastUpdatePerConfigKey[key] = -1;
 }
 
 void UidMap::OnConfigRemoved(const ConfigKey& key) {
+    lock_guard<shared_mutex> lock(mMutex);
     mLastUpdatePerConfigKey.erase(key);
 }
 
 set<int32_t> UidMap::getAppUid(const string& package) const {
-    lock_guard<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
     set<int32_t> results;
     for (const auto& kv : mMap) {
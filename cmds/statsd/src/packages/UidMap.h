@@ -29,6 +29,7 @@
 #include <list>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 
@@ -168,8 +169,10 @@ private:
                                    bool includeInstaller, const std::set<int32_t>& interestingUids,
                                    std::set<string>* str_set, ProtoOutputStream* proto);
 
-    mutable mutex mMutex;
-    mutable mutex mIsolatedMutex;
+    // Both are shared by the readers, which are the metrics of every config when the configs are
+    // processed concurrently, and exclusively locked by the updates.
+    mutable shared_mutex mMutex;
+    mutable shared_mutex mIsolatedMutex;
 
     struct PairHash {
         size_t operator()(std::pair<int, string> p) const noexcept {
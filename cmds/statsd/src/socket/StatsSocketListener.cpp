@@ -126,7 +126,7 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
     uint32_t pid = cred->pid;
 
     int64_t oldestTimestamp;
-    std::unique_ptr<LogEvent> logEvent = std::make_unique<LogEvent>(uid, pid);
+    std::unique_ptr<LogEvent> logEvent = mQueue->obtain(uid, pid);
     logEvent->parseBuffer(msg, len);
 
     if (!mQueue->push(std::move(logEvent), &oldestTimestamp)) {
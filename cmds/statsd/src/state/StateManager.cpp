@@ -37,6 +37,7 @@ StateManager& StateManager::getInstance() {
 }
 
 void StateManager::clear() {
+    std::lock_guard<std::shared_mutex> lock(mMutex);
     mStateTrackers.clear();
 }
 
@@ -44,15 +45,25 @@ void StateManager::onLogEvent(const LogEvent& event) {
     // Only process state events from uids in AID_* and packages that are whitelisted in
     // mAllowedPkg.
     // Whitelisted AIDs are AID_ROOT and all AIDs in [1000, 2000)
-    if (event.GetUid() == AID_ROOT || (event.GetUid() >= 1000 && event.GetUid() < 2000) ||
-        mAllowedLogSources.find(event.GetUid()) != mAllowedLogSources.end()) {
-        if (mStateTrackers.find(event.GetTagId()) != mStateTrackers.end()) {
-            mStateTrackers[event.GetTagId()]->onLogEvent(event);
+    sp<StateTracker> tracker;
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        if (event.GetUid() == AID_ROOT || (event.GetUid() >= 1000 && event.GetUid() < 2000) ||
+            mAllowedLogSources.find(event.GetUid()) != mAllowedLogSources.end()) {
+            auto it = mStateTrackers.find(event.GetTagId());
+            if (it != mStateTrackers.end()) {
+                tracker = it->second;
+            }
         }
     }
+    // The listeners are notified without the lock, as they may query other state values.
+    if (tracker != nullptr) {
+        tracker->onLogEvent(event);
+    }
 }
 
 void StateManager::registerListener(const int32_t atomId, wp<StateListener> listener) {
+    std::lock_guard<std::shared_mutex> lock(mMutex);
     // Check if state tracker already exists.
     if (mStateTrackers.find(atomId) == mStateTrackers.end()) {
         mStateTrackers[atomId] = new StateTracker(atomId);
@@ -61,7 +72,7 @@ void StateManager::registerListener(const int32_t atomId, wp<StateListener> list
 }
 
 void StateManager::unregisterListener(const int32_t atomId, wp<StateListener> listener) {
-    std::unique_lock<std::mutex> lock(mMutex);
+    std::unique_lock<std::shared_mutex> lock(mMutex);
 
     // Hold the sp<> until the lock is released so that ~StateTracker() is
     // not called while the lock is held.
@@ -86,6 +97,7 @@ void StateManager::unregisterListener(const int32_t atomId, wp<StateListener> li
 
 bool StateManager::getStateValue(const int32_t atomId, const HashableDimensionKey& key,
                                  FieldValue* output) const {
+    std::shared_lock<std::shared_mutex> lock(mMutex);
     auto it = mStateTrackers.find(atomId);
     if (it != mStateTrackers.end()) {
         return it->second->getStateValue(key, output);
@@ -94,11 +106,13 @@ bool StateManager::getStateValue(const int32_t atomId, const HashableDimensionKe
 }
 
 void StateManager::updateLogSources(const sp<UidMap>& uidMap) {
-    mAllowedLogSources.clear();
+    std::set<int32_t> allowedLogSources;
     for (const auto& pkg : mAllowedPkg) {
         auto uids = uidMap->getAppUid(pkg);
-        mAllowedLogSources.insert(uids.begin(), uids.end());
+        allowedLogSources.insert(uids.begin(), uids.end());
     }
+    std::lock_guard<std::shared_mutex> lock(mMutex);
+    mAllowedLogSources.swap(allowedLogSources);
 }
 
 void StateManager::notifyAppChanged(const string& apk, const sp<UidMap>& uidMap) {
@@ -19,6 +19,7 @@
 #include <utils/RefBase.h>
 
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 
@@ -32,8 +33,9 @@ namespace os {
 namespace statsd {
 
 /**
- * This class is NOT thread safe.
- * It should only be used while StatsLogProcessor's lock is held.
+ * Listeners are registered and state events are processed while StatsLogProcessor's lock is held.
+ * When the configs are processed concurrently, the metrics of different configs may query state
+ * values at the same time, so the trackers are looked up under a shared lock.
  */
 class StateManager : public virtual RefBase {
 public:
@@ -73,10 +75,12 @@ public:
     void notifyAppChanged(const string& apk, const sp<UidMap>& uidMap);
 
     inline int getStateTrackersCount() const {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
         return mStateTrackers.size();
     }
 
     inline int getListenersCount(const int32_t atomId) const {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
         auto it = mStateTrackers.find(atomId);
         if (it != mStateTrackers.end()) {
             return it->second->getListenersCount();
@@ -85,7 +89,7 @@ public:
     }
 
 private:
-    mutable std::mutex mMutex;
+    mutable std::shared_mutex mMutex;
 
     // Maps state atom ids to StateTrackers
     std::unordered_map<int32_t, sp<StateTracker>> mStateTrackers;
@@ -18,7 +18,9 @@
 #include "stats_log_util.h"
 
 #include <aidl/android/os/IStatsCompanionService.h>
+#include <android-base/file.h>
 #include <private/android_filesystem_config.h>
+#include <algorithm>
 #include <set>
 #include <utils/SystemClock.h>
 
@@ -604,6 +606,43 @@ bool checkPermissionForIds(const char* permission, pid_t pid, uid_t uid) {
     return success;
 }
 
+// The wire type of length-delimited fields, in the low bits of their tag.
+static const uint64_t kWireTypeLengthDelimited = 2;
+
+static size_t encodeVarint(uint64_t value, uint8_t* out) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+size_t writeLengthDelimitedHeaderToFd(int fd, int fieldId, size_t size) {
+    // Two varints of at most 10 bytes each.
+    uint8_t header[20];
+    size_t length = encodeVarint(((uint64_t)fieldId << 3) | kWireTypeLengthDelimited, header);
+    length += encodeVarint(size, header + length);
+    if (!android::base::WriteFully(fd, header, length)) {
+        return 0;
+    }
+    return length;
+}
+
+bool copyFileToFd(int fd, size_t size, int outFd) {
+    char buffer[16 * 1024];
+    while (size > 0) {
+        size_t toRead = std::min(size, sizeof(buffer));
+        if (!android::base::ReadFully(fd, buffer, toRead) ||
+            !android::base::WriteFully(outFd, buffer, toRead)) {
+            return false;
+        }
+        size -= toRead;
+    }
+    return true;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
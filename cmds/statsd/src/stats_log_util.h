@@ -104,6 +104,15 @@ int64_t truncateTimestampIfNecessary(const LogEvent& event);
 // Checks permission for given pid and uid.
 bool checkPermissionForIds(const char* permission, pid_t pid, uid_t uid);
 
+// Writes the tag and the length of a length-delimited field with id fieldId to fd, so that a
+// sub-message of the given size can be streamed to fd right after it. Returns the number of bytes
+// written, or 0 on failure.
+size_t writeLengthDelimitedHeaderToFd(int fd, int fieldId, size_t size);
+
+// Copies size bytes of fd, from its current offset, to outFd in chunks, so that a large file is
+// never held in memory. Returns false on failure.
+bool copyFileToFd(int fd, size_t size, int outFd);
+
 inline bool isVendorPulledAtom(int atomId) {
     return atomId >= StatsdStats::kVendorPulledAtomStartTag && atomId < StatsdStats::kMaxAtomTag;
 }
@@ -24,6 +24,7 @@
 
 #include <android-base/file.h>
 #include <private/android_filesystem_config.h>
+#include <sys/stat.h>
 #include <fstream>
 
 namespace android {
@@ -123,14 +124,32 @@ static void parseFileName(char* name, FileName* output) {
     output->mIsHistory = (substr != nullptr && strcmp("history", substr) == 0);
 }
 
-void StorageManager::writeFile(const char* file, const void* buffer, int numBytes) {
+// Opens file for writing, after making room for it in the stats directories.
+static int openFileForWrite(const char* file) {
     int fd = open(file, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
     if (fd == -1) {
         VLOG("Attempt to access %s but failed", file);
+        return -1;
+    }
+    StorageManager::trimToFit(STATS_SERVICE_DIR);
+    StorageManager::trimToFit(STATS_DATA_DIR);
+    return fd;
+}
+
+static void closeWrittenFile(int fd, const char* file) {
+    int result = fchown(fd, AID_STATSD, AID_STATSD);
+    if (result) {
+        VLOG("Failed to chown %s to statsd", file);
+    }
+
+    close(fd);
+}
+
+void StorageManager::writeFile(const char* file, const void* buffer, int numBytes) {
+    int fd = openFileForWrite(file);
+    if (fd == -1) {
         return;
     }
-    trimToFit(STATS_SERVICE_DIR);
-    trimToFit(STATS_DATA_DIR);
 
     if (android::base::WriteFully(fd, buffer, numBytes)) {
         VLOG("Successfully wrote %s", file);
@@ -138,12 +157,22 @@ void StorageManager::writeFile(const char* file, const void* buffer, int numByte
         ALOGE("Failed to write %s", file);
     }
 
-    int result = fchown(fd, AID_STATSD, AID_STATSD);
-    if (result) {
-        VLOG("Failed to chown %s to statsd", file);
+    closeWrittenFile(fd, file);
+}
+
+void StorageManager::writeFile(const char* file, ProtoOutputStream& proto) {
+    int fd = openFileForWrite(file);
+    if (fd == -1) {
+        return;
     }
 
-    close(fd);
+    if (proto.flush(fd)) {
+        VLOG("Successfully wrote %s", file);
+    } else {
+        ALOGE("Failed to write %s", file);
+    }
+
+    closeWrittenFile(fd, file);
 }
 
 bool StorageManager::writeTrainInfo(const InstallTrainInfo& trainInfo) {
@@ -505,12 +534,13 @@ bool StorageManager::hasConfigMetricsReport(const ConfigKey& key) {
     return false;
 }
 
-void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto,
-                                               bool erase_data, bool isAdb) {
+std::vector<unique_fd> StorageManager::openConfigMetricsReports(const ConfigKey& key,
+                                                                bool erase_data, bool isAdb) {
+    std::vector<unique_fd> reports;
     unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
     if (dir == NULL) {
         VLOG("Path %s does not exist", STATS_DATA_DIR);
-        return;
+        return reports;
     }
 
     dirent* de;
@@ -527,18 +557,14 @@ void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutput
         }
 
         auto fullPathName = StringPrintf("%s/%s", STATS_DATA_DIR, fileName.c_str());
-        int fd = open(fullPathName.c_str(), O_RDONLY | O_CLOEXEC);
+        unique_fd fd(open(fullPathName.c_str(), O_RDONLY | O_CLOEXEC));
         if (fd != -1) {
-            string content;
-            if (android::base::ReadFdToString(fd, &content)) {
-                proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
-                             content.c_str(), content.size());
-            }
-            close(fd);
+            reports.push_back(std::move(fd));
         } else {
             ALOGE("file cannot be opened");
         }
 
+        // The open file can still be read once it is removed or renamed.
         if (erase_data) {
             remove(fullPathName.c_str());
         } else if (!output.mIsHistory && !isAdb) {
@@ -551,6 +577,52 @@ void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutput
             }
         }
     }
+    return reports;
+}
+
+void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto,
+                                               bool erase_data, bool isAdb) {
+    for (const unique_fd& fd : openConfigMetricsReports(key, erase_data, isAdb)) {
+        string content;
+        if (android::base::ReadFdToString(fd, &content)) {
+            proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                         content.c_str(), content.size());
+        }
+    }
+}
+
+size_t StorageManager::writeConfigMetricsReports(const std::vector<unique_fd>& reports,
+                                                 int outFd) {
+    size_t bytesWritten = 0;
+    for (const unique_fd& fd : reports) {
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            ALOGE("Failed to stat report file");
+            continue;
+        }
+        size_t headerSize = writeLengthDelimitedHeaderToFd(outFd, FIELD_ID_REPORTS,
+                                                           fileStat.st_size);
+        if (headerSize == 0) {
+            continue;
+        }
+        bytesWritten += headerSize;
+
+        // The length written above is only valid if the whole file is copied.
+        if (!copyFileToFd(fd, fileStat.st_size, outFd)) {
+            ALOGE("Failed to copy report file");
+            return bytesWritten;
+        }
+        bytesWritten += fileStat.st_size;
+    }
+    return bytesWritten;
+}
+
+unique_fd StorageManager::openTempDataFile() {
+    unique_fd fd(open(STATS_DATA_DIR, O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR));
+    if (fd == -1) {
+        ALOGW("Failed to create a temporary file in %s, errno=%d", STATS_DATA_DIR, errno);
+    }
+    return fd;
 }
 
 bool StorageManager::readFileToString(const char* file, string* content) {
@@ -17,16 +17,20 @@
 #ifndef STORAGE_MANAGER_H
 #define STORAGE_MANAGER_H
 
+#include <android-base/unique_fd.h>
 #include <android/util/ProtoOutputStream.h>
 #include <utils/Log.h>
 #include <utils/RefBase.h>
 
+#include <vector>
+
 #include "packages/UidMap.h"
 
 namespace android {
 namespace os {
 namespace statsd {
 
+using android::base::unique_fd;
 using android::util::ProtoOutputStream;
 
 class StorageManager : public virtual RefBase {
@@ -49,6 +53,12 @@ public:
      */
     static void writeFile(const char* file, const void* buffer, int numBytes);
 
+    /**
+     * Writes the serialized proto as a file to the specified file path, without copying it into
+     * a contiguous buffer first.
+     */
+    static void writeFile(const char* file, ProtoOutputStream& proto);
+
     /**
      * Writes train info.
      */
@@ -117,6 +127,26 @@ public:
     static void appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto,
                                           bool erase_data, bool isAdb);
 
+    /**
+     * Same as above, but opens the report files rather than reading them, so that they can be
+     * written out later without holding any lock. The files are removed or renamed right away.
+     */
+    static std::vector<unique_fd> openConfigMetricsReports(const ConfigKey& key, bool erase_data,
+                                                           bool isAdb);
+
+    /**
+     * Streams the reports opened by openConfigMetricsReports to outFd as size-prefixed
+     * ConfigMetricsReportList reports, a chunk of a file at a time. Returns the number of bytes
+     * written.
+     */
+    static size_t writeConfigMetricsReports(const std::vector<unique_fd>& reports, int outFd);
+
+    /**
+     * Opens a file in the data directory that has no name, so it is never listed with the saved
+     * reports and is deleted once closed. Returns an invalid fd if it can't be created.
+     */
+    static unique_fd openTempDataFile();
+
     /**
      * Call to load the saved configs from disk.
      */
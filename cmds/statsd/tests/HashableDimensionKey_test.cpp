@@ -28,6 +28,53 @@ namespace android {
 namespace os {
 namespace statsd {
 
+TEST(HashableDimensionKeyTest, TestCopiesShareValuesUntilModified) {
+    HashableDimensionKey key1;
+    getUidProcessKey(1000, &key1);
+    const android::hash_t hash1 = hashDimension(key1);
+
+    HashableDimensionKey key2 = key1;
+    EXPECT_EQ(&key1.getValues(), &key2.getValues());
+    EXPECT_EQ(hash1, hashDimension(key2));
+
+    // Modifying the copy leaves the original key and its hash as they were.
+    key2.mutableValue(0)->mValue.setInt(2000);
+    EXPECT_NE(&key1.getValues(), &key2.getValues());
+    EXPECT_EQ(1000, key1.getValues()[0].mValue.int_value);
+    EXPECT_EQ(hash1, hashDimension(key1));
+    EXPECT_NE(key1, key2);
+
+    HashableDimensionKey key3;
+    getUidProcessKey(2000, &key3);
+    EXPECT_EQ(key3, key2);
+    EXPECT_EQ(hashDimension(key3), hashDimension(key2));
+}
+
+TEST(HashableDimensionKeyTest, TestIntern) {
+    HashableDimensionKey key1;
+    getUidProcessKey(1000, &key1);
+    HashableDimensionKey key2;
+    getUidProcessKey(1000, &key2);
+    HashableDimensionKey otherKey;
+    getUidProcessKey(1001, &otherKey);
+    HashableDimensionKey copyOfKey1 = key1;
+
+    key1.intern();
+    key2.intern();
+    otherKey.intern();
+    EXPECT_EQ(&key1.getValues(), &key2.getValues());
+    EXPECT_NE(&key1.getValues(), &otherKey.getValues());
+    // The copy made before interning still has its own values.
+    EXPECT_NE(&key1.getValues(), &copyOfKey1.getValues());
+    EXPECT_EQ(key1, copyOfKey1);
+
+    // Interned values are copied before being modified, even by their last key.
+    copyOfKey1 = HashableDimensionKey();
+    key1.mutableValue(0)->mValue.setInt(1002);
+    EXPECT_EQ(1000, key2.getValues()[0].mValue.int_value);
+    EXPECT_EQ(1002, key1.getValues()[0].mValue.int_value);
+}
+
 /**
  * Test that #containsLinkedStateValues returns false when the whatKey is
  * smaller than the primaryKey.
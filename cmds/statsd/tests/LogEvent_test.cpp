@@ -165,6 +165,41 @@ TEST(LogEventTest, TestStringAndByteArrayParsing) {
     AStatsEvent_release(event);
 }
 
+TEST(LogEventTest, TestResetAndParseAgain) {
+    AStatsEvent* event = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(event, 100);
+    AStatsEvent_writeInt32(event, 10);
+    AStatsEvent_addBoolAnnotation(event, ANNOTATION_ID_IS_UID, true);
+    AStatsEvent_writeString(event, "a string longer than the inline storage of std::string");
+    AStatsEvent_build(event);
+    size_t size;
+    uint8_t* buf = AStatsEvent_getBuffer(event, &size);
+
+    LogEvent logEvent(/*uid=*/1000, /*pid=*/1001);
+    EXPECT_TRUE(logEvent.parseBuffer(buf, size));
+    AStatsEvent_release(event);
+
+    event = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(event, 200);
+    AStatsEvent_writeString(event, "test");
+    AStatsEvent_build(event);
+    buf = AStatsEvent_getBuffer(event, &size);
+
+    logEvent.reset(/*uid=*/2000, /*pid=*/2001);
+    EXPECT_TRUE(logEvent.parseBuffer(buf, size));
+    AStatsEvent_release(event);
+
+    // Nothing is left of the first event.
+    EXPECT_EQ(200, logEvent.GetTagId());
+    EXPECT_EQ(2000, logEvent.GetUid());
+    EXPECT_EQ(2001, logEvent.GetPid());
+    EXPECT_EQ(-1, logEvent.getUidFieldIndex());
+    const vector<FieldValue>& values = logEvent.getValues();
+    ASSERT_EQ(1, values.size());
+    EXPECT_EQ(getField(200, {1, 1, 1}, 0, {false, false, false}), values[0].mField);
+    EXPECT_EQ("test", values[0].mValue.str_value);
+}
+
 TEST(LogEventTest, TestEmptyString) {
     AStatsEvent* event = AStatsEvent_obtain();
     AStatsEvent_setAtomId(event, 100);
@@ -790,6 +790,38 @@ TEST(MetricsManagerTest, TestWhitelistedAtomStateTracker) {
     EXPECT_FALSE(metricsManager.isConfigValid());
 }
 
+TEST(MetricsManagerTest, TestAtomMatcherIndex) {
+    sp<UidMap> uidMap;
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+
+    StatsdConfig config = buildGoodConfig();
+    config.add_allowed_log_source("AID_ROOT");
+    *config.add_atom_matcher() = CreateSimpleAtomMatcher("OTHER_ATOM", 10);
+    AtomMatcher* notOther = config.add_atom_matcher();
+    notOther->set_id(StringToId("NOT_OTHER_ATOM"));
+    notOther->mutable_combination()->set_operation(LogicalOperation::NOT);
+    notOther->mutable_combination()->add_matcher(StringToId("OTHER_ATOM"));
+
+    MetricsManager metricsManager(kConfigKey, config, timeBaseSec, timeBaseSec, uidMap,
+                                  pullerManager, anomalyAlarmMonitor, periodicAlarmMonitor);
+    ASSERT_TRUE(metricsManager.isConfigValid());
+
+    // The screen matchers and their combination, then the other atom and its negation.
+    ASSERT_EQ(2, metricsManager.mTagIdToMatcherIndices.size());
+    EXPECT_EQ(vector<int>({0, 1, 2}), metricsManager.mTagIdToMatcherIndices[2]);
+    EXPECT_EQ(vector<int>({3, 4}), metricsManager.mTagIdToMatcherIndices[10]);
+
+    LogEvent event(0 /* uid */, 0 /* pid */);
+    CreateNoValuesLogEvent(&event, 2 /* atom id */, timeBaseSec * NS_PER_SEC + 1);
+    metricsManager.onLogEvent(event);
+    // The scratch matcher results are reset for the next event.
+    for (MatchingState state : metricsManager.mMatcherCache) {
+        EXPECT_EQ(MatchingState::kNotComputed, state);
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -14,6 +14,7 @@
 
 #include "StatsLogProcessor.h"
 
+#include <android-base/file.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdio.h>
@@ -300,6 +301,63 @@ TEST(StatsLogProcessorTest, TestOnDumpReportEraseData) {
     EXPECT_TRUE(noData);
 }
 
+TEST(StatsLogProcessorTest, TestOnDumpReportToFd) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+    auto wakelockAcquireMatcher = CreateAcquireWakelockAtomMatcher();
+    *config.add_atom_matcher() = wakelockAcquireMatcher;
+
+    auto countMetric = config.add_count_metric();
+    countMetric->set_id(123456);
+    countMetric->set_what(wakelockAcquireMatcher.id());
+    countMetric->set_bucket(FIVE_MINUTES);
+    // Each metric is written out separately
+    auto secondCountMetric = config.add_count_metric();
+    *secondCountMetric = *countMetric;
+    secondCountMetric->set_id(654321);
+
+    ConfigKey cfgKey;
+    sp<StatsLogProcessor> processor = CreateStatsLogProcessor(1, 1, config, cfgKey);
+
+    std::vector<int> attributionUids = {111};
+    std::vector<string> attributionTags = {"App1"};
+    std::unique_ptr<LogEvent> event =
+            CreateAcquireWakelockEvent(2 /*timestamp*/, attributionUids, attributionTags, "wl1");
+    processor->OnLogEvent(event.get());
+
+    // The streamed report is the same as the one built in memory.
+    vector<uint8_t> bytes;
+    processor->onDumpReport(cfgKey, 3, true, false /* Do NOT erase data. */, ADB_DUMP, FAST,
+                            &bytes);
+    TemporaryFile tmpFile;
+    processor->onDumpReport(cfgKey, 3, true, true /* DO erase data. */, ADB_DUMP, FAST,
+                            tmpFile.fd);
+    string streamed;
+    ASSERT_TRUE(android::base::ReadFileToString(tmpFile.path, &streamed));
+
+    ConfigMetricsReportList expected;
+    ASSERT_TRUE(expected.ParseFromArray(bytes.data(), bytes.size()));
+    ConfigMetricsReportList output;
+    ASSERT_TRUE(output.ParseFromString(streamed));
+    EXPECT_EQ(expected.config_key().uid(), output.config_key().uid());
+    EXPECT_EQ(expected.config_key().id(), output.config_key().id());
+    ASSERT_EQ(1, output.reports_size());
+    ASSERT_EQ(2, output.reports(0).metrics_size());
+    for (int i = 0; i < output.reports(0).metrics_size(); i++) {
+        EXPECT_EQ(expected.reports(0).metrics(i).SerializeAsString(),
+                  output.reports(0).metrics(i).SerializeAsString());
+    }
+    EXPECT_EQ(expected.reports(0).current_report_elapsed_nanos(),
+              output.reports(0).current_report_elapsed_nanos());
+
+    // The data was erased by the streamed dump.
+    processor->onDumpReport(cfgKey, 4, true, true /* DO erase data. */, ADB_DUMP, FAST, &bytes);
+    output.ParseFromArray(bytes.data(), bytes.size());
+    bool noData = output.reports_size() == 0 || output.reports(0).metrics_size() == 0 ||
+                  output.reports(0).metrics(0).count_metrics().data_size() == 0;
+    EXPECT_TRUE(noData);
+}
+
 TEST(StatsLogProcessorTest, TestPullUidProviderSetOnConfigUpdate) {
     // Setup simple config key corresponding to empty config.
     sp<UidMap> m = new UidMap();
@@ -1877,6 +1935,66 @@ TEST(StatsLogProcessorTest, TestDumpReportWithoutErasingDataDoesNotUpdateTimesta
 
 }
 
+TEST(StatsLogProcessorTest, TestShardedDumpDoesNotBlockOtherConfigs) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+    auto wakelockAcquireMatcher = CreateAcquireWakelockAtomMatcher();
+    *config.add_atom_matcher() = wakelockAcquireMatcher;
+    auto countMetric = config.add_count_metric();
+    countMetric->set_id(123456);
+    countMetric->set_what(wakelockAcquireMatcher.id());
+    countMetric->set_bucket(FIVE_MINUTES);
+
+    sp<UidMap> m = new UidMap();
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+    sp<StatsLogProcessor> processor = new StatsLogProcessor(
+            m, pullerManager, anomalyAlarmMonitor, periodicAlarmMonitor, 0,
+            [](const ConfigKey&) { return true; },
+            [](const int&, const vector<int64_t>&) { return true; },
+            StatsLogProcessor::ShardingMode::WORKER_PER_CONFIG);
+    ConfigKey busyKey(1, 1);
+    ConfigKey otherKey(2, 2);
+    processor->OnConfigUpdated(1, busyKey, config);
+    processor->OnConfigUpdated(1, otherKey, config);
+    ASSERT_EQ(2u, processor->mConfigShards.size());
+
+    // Holding the lock of a config stands in for a long dump of it.
+    std::unique_lock<std::mutex> busyLock(processor->mConfigShards[busyKey]->lock);
+
+    std::vector<int> attributionUids = {111};
+    std::vector<string> attributionTags = {"App1"};
+    for (int i = 0; i < 3; i++) {
+        std::unique_ptr<LogEvent> event = CreateAcquireWakelockEvent(
+                2 + i /*timestamp*/, attributionUids, attributionTags, "wl1");
+        processor->OnLogEvent(event.get());
+    }
+
+    vector<uint8_t> bytes;
+    ConfigMetricsReportList output;
+    processor->onDumpReport(otherKey, 10, true, true, ADB_DUMP, FAST, &bytes);
+    output.ParseFromArray(bytes.data(), bytes.size());
+    ASSERT_EQ(output.reports_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics(0).count_metrics().data_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics(0).count_metrics().data(0).bucket_info_size(), 1);
+    EXPECT_EQ(output.reports(0).metrics(0).count_metrics().data(0).bucket_info(0).count(), 3);
+
+    // The events queued for the busy config are processed before it is dumped.
+    busyLock.unlock();
+    processor->onDumpReport(busyKey, 10, true, true, ADB_DUMP, FAST, &bytes);
+    output.ParseFromArray(bytes.data(), bytes.size());
+    ASSERT_EQ(output.reports_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics(0).count_metrics().data_size(), 1);
+    ASSERT_EQ(output.reports(0).metrics(0).count_metrics().data(0).bucket_info_size(), 1);
+    EXPECT_EQ(output.reports(0).metrics(0).count_metrics().data(0).bucket_info(0).count(), 3);
+
+    processor->OnConfigRemoved(busyKey);
+    EXPECT_EQ(1u, processor->mConfigShards.size());
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
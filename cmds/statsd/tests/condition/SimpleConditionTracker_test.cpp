@@ -501,6 +501,79 @@ TEST(SimpleConditionTrackerTest, TestSlicedCondition) {
 
 }
 
+TEST(SimpleConditionTrackerTest, TestPartialLinkQueryWithIndex) {
+    // Sliced by the uid and the name of the wake lock, and queried by the uid only.
+    SimplePredicate simplePredicate = getWakeLockHeldCondition(
+            true /*nesting*/, true /*default to false*/, true /*output slice by uid*/,
+            Position::FIRST);
+    simplePredicate.mutable_dimensions()->add_child()->set_field(2);
+    string conditionName = "WL_HELD_BY_UID";
+
+    unordered_map<int64_t, int> trackerNameIndexMap;
+    trackerNameIndexMap[StringToId("WAKE_LOCK_ACQUIRE")] = 0;
+    trackerNameIndexMap[StringToId("WAKE_LOCK_RELEASE")] = 1;
+    trackerNameIndexMap[StringToId("RELEASE_ALL")] = 2;
+
+    SimpleConditionTracker indexedTracker(kConfigKey, StringToId(conditionName),
+                                          0 /*condition tracker index*/, simplePredicate,
+                                          trackerNameIndexMap);
+    SimpleConditionTracker scannedTracker(kConfigKey, StringToId(conditionName),
+                                          0 /*condition tracker index*/, simplePredicate,
+                                          trackerNameIndexMap);
+    FieldMatcher linkFields;
+    linkFields.set_field(TAG_ID);
+    linkFields.add_child()->set_field(ATTRIBUTION_NODE_FIELD_ID);
+    linkFields.mutable_child(0)->set_position(Position::FIRST);
+    linkFields.mutable_child(0)->add_child()->set_field(ATTRIBUTION_UID_FIELD_ID);
+    vector<Matcher> linkConditionFields;
+    translateFieldMatcher(linkFields, &linkConditionFields);
+    indexedTracker.addSlicedConditionIndex(linkConditionFields);
+    ASSERT_EQ(1UL, indexedTracker.mSlicedConditionIndices.size());
+
+    vector<sp<ConditionTracker>> allPredicates;
+    // Feeds an event to both trackers, then checks that both answer the same to queries.
+    auto onEvent = [&](const vector<int>& uids, const string& wl, int matcherIndex,
+                       const vector<ConditionState>& expectedStates) {
+        LogEvent event(/*uid=*/0, /*pid=*/0);
+        makeWakeLockEvent(&event, /*atomId=*/1, /*timestamp=*/0, uids, wl, matcherIndex == 0);
+        vector<MatchingState> matcherState(3, MatchingState::kNotMatched);
+        matcherState[matcherIndex] = MatchingState::kMatched;
+        for (SimpleConditionTracker* tracker : {&indexedTracker, &scannedTracker}) {
+            vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+            vector<bool> changedCache(1, false);
+            tracker->evaluateCondition(event, matcherState, allPredicates, conditionCache,
+                                       changedCache);
+        }
+        const vector<int> queriedUids = {111, 222, 333};
+        for (size_t i = 0; i < queriedUids.size(); i++) {
+            const auto queryKey =
+                    getWakeLockQueryKey(Position::FIRST, {queriedUids[i]}, conditionName);
+            for (SimpleConditionTracker* tracker : {&indexedTracker, &scannedTracker}) {
+                vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+                tracker->isConditionMet(queryKey, allPredicates, true /*isPartialLink*/,
+                                        conditionCache);
+                EXPECT_EQ(expectedStates[i], conditionCache[0]);
+            }
+        }
+    };
+
+    onEvent({111, 1111}, "wl1", 0, {ConditionState::kTrue, ConditionState::kFalse,
+                                    ConditionState::kFalse});
+    onEvent({111}, "wl2", 0, {ConditionState::kTrue, ConditionState::kFalse,
+                              ConditionState::kFalse});
+    onEvent({222}, "wl1", 0, {ConditionState::kTrue, ConditionState::kTrue,
+                              ConditionState::kFalse});
+    EXPECT_EQ(2UL, indexedTracker.mSlicedConditionIndices[0].slices.size());
+    onEvent({111}, "wl1", 1, {ConditionState::kTrue, ConditionState::kTrue,
+                              ConditionState::kFalse});
+    onEvent({111}, "wl2", 1, {ConditionState::kFalse, ConditionState::kTrue,
+                              ConditionState::kFalse});
+    EXPECT_EQ(1UL, indexedTracker.mSlicedConditionIndices[0].slices.size());
+    onEvent({222}, "wl1", 2, {ConditionState::kFalse, ConditionState::kFalse,
+                              ConditionState::kFalse});
+    EXPECT_TRUE(indexedTracker.mSlicedConditionIndices[0].slices.empty());
+}
+
 TEST(SimpleConditionTrackerTest, TestSlicedWithNoOutputDim) {
     std::vector<sp<ConditionTracker>> allConditions;
 
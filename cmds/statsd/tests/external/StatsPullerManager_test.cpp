@@ -19,6 +19,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+
 #include "stats_event.h"
 #include "tests/statsd_test_util.h"
 
@@ -69,9 +71,11 @@ public:
         parcels.push_back(std::move(p));
         AStatsEvent_release(event);
         resultReceiver->pullFinished(atomTag, /*success*/ true, parcels);
+        mPullCount++;
         return Status::ok();
     }
     int32_t mUid;
+    std::atomic<int> mPullCount{0};
 };
 
 class FakePullUidProvider : public PullUidProvider {
@@ -86,6 +90,26 @@ public:
     }
 };
 
+class FakePullDataReceiver : public PullDataReceiver {
+public:
+    void onDataPulled(const vector<shared_ptr<LogEvent>>& data, bool pullSuccess,
+                      int64_t originalPullTimeNs) override {
+        mData = data;
+        mPullSuccess = pullSuccess;
+        mPullTimeNs = originalPullTimeNs;
+    }
+    vector<shared_ptr<LogEvent>> mData;
+    bool mPullSuccess = false;
+    int64_t mPullTimeNs = 0;
+};
+
+class SingleUidPullUidProvider : public PullUidProvider {
+public:
+    vector<int32_t> getPullAtomUids(int atomId) override {
+        return {uid1};
+    }
+};
+
 sp<StatsPullerManager> createPullerManagerAndRegister() {
     sp<StatsPullerManager> pullerManager = new StatsPullerManager();
     shared_ptr<FakePullAtomCallback> cb1 = SharedRefBase::make<FakePullAtomCallback>(uid1);
@@ -145,6 +169,41 @@ TEST(StatsPullerManagerTest, TestPullConfigKeyNoPullerWithUid) {
     EXPECT_FALSE(pullerManager->Pull(pullTagId2, configKey, /*timestamp =*/1, &data, true));
 }
 
+TEST(StatsPullerManagerTest, TestAlarmPullsEachPullerOnce) {
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>(uid1);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId1, coolDownNs, timeoutNs, {}, cb, true);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId2, coolDownNs, timeoutNs, {}, cb, true);
+    sp<SingleUidPullUidProvider> uidProvider = new SingleUidPullUidProvider();
+    pullerManager->RegisterPullUidProvider(configKey, uidProvider);
+    pullerManager->RegisterPullUidProvider(badConfigKey, uidProvider);
+
+    // Two configs receive the first atom, and one config the second atom.
+    sp<FakePullDataReceiver> receiver1 = new FakePullDataReceiver();
+    sp<FakePullDataReceiver> receiver2 = new FakePullDataReceiver();
+    sp<FakePullDataReceiver> receiver3 = new FakePullDataReceiver();
+    const int64_t alarmTimeNs = 100;
+    pullerManager->RegisterReceiver(pullTagId1, configKey, receiver1, alarmTimeNs, 60 * NS_PER_SEC);
+    pullerManager->RegisterReceiver(pullTagId1, badConfigKey, receiver2, alarmTimeNs,
+                                    60 * NS_PER_SEC);
+    pullerManager->RegisterReceiver(pullTagId2, configKey, receiver3, alarmTimeNs,
+                                    60 * NS_PER_SEC);
+
+    pullerManager->OnAlarmFired(alarmTimeNs);
+
+    EXPECT_EQ(2, cb->mPullCount);
+    for (const sp<FakePullDataReceiver>& receiver : {receiver1, receiver2, receiver3}) {
+        EXPECT_TRUE(receiver->mPullSuccess);
+        EXPECT_EQ(alarmTimeNs, receiver->mPullTimeNs);
+        ASSERT_EQ(1, receiver->mData.size());
+        EXPECT_EQ(alarmTimeNs, receiver->mData[0]->GetElapsedTimestampNs());
+    }
+    EXPECT_EQ(pullTagId1, receiver1->mData[0]->GetTagId());
+    // Receivers of the same puller share its data.
+    EXPECT_EQ(receiver1->mData[0], receiver2->mData[0]);
+    EXPECT_EQ(pullTagId2, receiver3->mData[0]->GetTagId());
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
\ No newline at end of file
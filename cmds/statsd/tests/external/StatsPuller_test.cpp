@@ -44,6 +44,7 @@ int pullTagId = 10014;
 bool pullSuccess;
 vector<std::shared_ptr<LogEvent>> pullData;
 long pullDelayNs;
+int pullInternalCalls;
 
 class FakePuller : public StatsPuller {
 public:
@@ -52,6 +53,7 @@ public:
 
 private:
     bool PullInternal(vector<std::shared_ptr<LogEvent>>* data) override {
+        pullInternalCalls++;
         (*data) = pullData;
         sleep_for(std::chrono::nanoseconds(pullDelayNs));
         return pullSuccess;
@@ -80,6 +82,7 @@ public:
         puller.ForceClearCache();
         pullSuccess = false;
         pullDelayNs = 0;
+        pullInternalCalls = 0;
         pullData.clear();
     }
 };
@@ -308,6 +311,27 @@ TEST_F(StatsPullerTest, PullFailsAndPullSameEventTime) {
     ASSERT_EQ(0, dataHolder.size());
 }
 
+TEST_F(StatsPullerTest, PullConcurrentRequestsShareOnePull) {
+    pullData.push_back(createSimpleEvent(1111L, 33));
+    pullSuccess = true;
+    // Shorter than the timeout of 5ms and the cooldown of 10ms.
+    pullDelayNs = MillisToNano(3);
+
+    vector<std::shared_ptr<LogEvent>> dataHolder1;
+    std::thread pullThread(
+            [&] { EXPECT_TRUE(puller.Pull(getElapsedRealtimeNs(), &dataHolder1)); });
+    sleep_for(std::chrono::milliseconds(1));
+    // Comes while the other thread pulls, at another event time.
+    vector<std::shared_ptr<LogEvent>> dataHolder2;
+    EXPECT_TRUE(puller.Pull(getElapsedRealtimeNs(), &dataHolder2));
+    pullThread.join();
+
+    EXPECT_EQ(1, pullInternalCalls);
+    ASSERT_EQ(1, dataHolder1.size());
+    ASSERT_EQ(1, dataHolder2.size());
+    EXPECT_EQ(dataHolder1[0], dataHolder2[0]);
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -501,6 +501,34 @@ TEST(StatsdStatsTest, TestActivationBroadcastGuardrailHit) {
     EXPECT_TRUE(uid2Good);
 }
 
+TEST(StatsdStatsTest, TestEventQueueHistograms) {
+    StatsdStats stats;
+    stats.noteEventQueueBatch(1, {500 /* ns */, 3000 /* ns */});
+    stats.noteEventQueueBatch(6, {5 * 1000 * 1000});
+    // Larger than the last bucket.
+    stats.noteEventQueueBatch(1LL << 40, {});
+
+    vector<uint8_t> output;
+    stats.dumpStats(&output, false);
+    StatsdStatsReport report;
+    EXPECT_TRUE(report.ParseFromArray(&output[0], output.size()));
+
+    ASSERT_TRUE(report.has_event_queue_stats());
+    const int bucketCount = StatsdStats::kEventQueueHistogramBucketCount;
+    const auto& depths = report.event_queue_stats().depth_histogram();
+    ASSERT_EQ(bucketCount, depths.size());
+    EXPECT_EQ(1, depths[1]);
+    EXPECT_EQ(1, depths[3]);
+    EXPECT_EQ(1, depths[bucketCount - 1]);
+
+    // 0us, 3us and 5000us.
+    const auto& latencies = report.event_queue_stats().latency_micros_histogram();
+    ASSERT_EQ(bucketCount, latencies.size());
+    EXPECT_EQ(1, latencies[0]);
+    EXPECT_EQ(1, latencies[2]);
+    EXPECT_EQ(1, latencies[13]);
+}
+
 TEST(StatsdStatsTest, TestAtomErrorStats) {
     StatsdStats stats;
 
@@ -106,6 +106,88 @@ TEST(LogEventQueue_test, TestSlowConsumer) {
     writer.join();
 }
 
+TEST(LogEventQueue_test, TestPopBatch) {
+    LogEventQueue queue(50);
+    int64_t timeBaseNs = 100;
+    int64_t oldestEventNs;
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(queue.push(makeLogEvent(timeBaseNs + i * 1000), &oldestEventNs));
+    }
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    EXPECT_EQ(4u, queue.popBatch(&events, 4));
+    // Only the remaining events are returned when there are fewer than the batch size.
+    EXPECT_EQ(6u, queue.popBatch(&events, 100));
+    ASSERT_EQ(10u, events.size());
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(timeBaseNs + i * 1000, events[i]->GetElapsedTimestampNs());
+    }
+}
+
+TEST(LogEventQueue_test, TestConcurrentProducers) {
+    const int producerCount = 4;
+    const int eventsPerProducer = 1000;
+    LogEventQueue queue(50);
+    std::vector<std::thread> writers;
+    for (int producer = 0; producer < producerCount; producer++) {
+        writers.emplace_back([&queue, producer] {
+            int64_t oldestEventNs;
+            for (int i = 0; i < eventsPerProducer; i++) {
+                // Retries until the reader made room, so that no event is lost.
+                while (!queue.push(makeLogEvent(producer * eventsPerProducer + i),
+                                   &oldestEventNs)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // The events of each producer are popped in the order it pushed them.
+    std::vector<int64_t> lastTimestampNs(producerCount, -1);
+    std::vector<std::unique_ptr<LogEvent>> events;
+    int popped = 0;
+    while (popped < producerCount * eventsPerProducer) {
+        events.clear();
+        popped += queue.popBatch(&events, 16);
+        for (const auto& event : events) {
+            const int64_t timestampNs = event->GetElapsedTimestampNs();
+            const int producer = timestampNs / eventsPerProducer;
+            EXPECT_GT(timestampNs, lastTimestampNs[producer]);
+            lastTimestampNs[producer] = timestampNs;
+        }
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    for (int producer = 0; producer < producerCount; producer++) {
+        EXPECT_EQ((producer + 1) * eventsPerProducer - 1, lastTimestampNs[producer]);
+    }
+}
+
+TEST(LogEventQueue_test, TestObtainRecycledEvent) {
+    LogEventQueue queue(50);
+    int64_t oldestEventNs;
+    EXPECT_TRUE(queue.push(makeLogEvent(100), &oldestEventNs));
+    std::vector<std::unique_ptr<LogEvent>> events;
+    queue.popBatch(&events, 1);
+    const LogEvent* processedEvent = events[0].get();
+
+    queue.recycle(&events);
+    EXPECT_TRUE(events.empty());
+
+    // The processed event is returned again, cleared for the new uid and pid.
+    std::unique_ptr<LogEvent> event = queue.obtain(/*uid=*/1000, /*pid=*/1001);
+    EXPECT_EQ(processedEvent, event.get());
+    EXPECT_EQ(1000, event->GetUid());
+    EXPECT_EQ(1001, event->GetPid());
+    EXPECT_EQ(0, event->size());
+
+    // Until there is no more event to recycle.
+    std::unique_ptr<LogEvent> newEvent = queue.obtain(/*uid=*/1000, /*pid=*/1001);
+    EXPECT_NE(processedEvent, newEvent.get());
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
@@ -19,6 +19,7 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <functional>
 #include <vector>
 
 #include "metrics_test_helper.h"
@@ -1956,6 +1957,79 @@ TEST(ValueMetricProducerTest, TestTrimUnusedDimensionKey) {
     EXPECT_EQ(bucketSizeNs, iterator->second[0].mConditionTrueNs);
 }
 
+/*
+ * Tests that diffing pulls through a sorted merge gives the same bases and buckets as diffing
+ * them one event at a time, with rows pulled out of order and dimensions missing from pulls.
+ */
+TEST(ValueMetricProducerTest, TestSortedDiffMatchesHashedDiff) {
+    ValueMetric metric = ValueMetricProducerTestHelper::createMetric();
+    metric.mutable_dimensions_in_what()->set_field(tagId);
+    metric.mutable_dimensions_in_what()->add_child()->set_field(1);
+
+    auto createProducer = [&metric]() {
+        sp<MockStatsPullerManager> pullerManager = new StrictMock<MockStatsPullerManager>();
+        EXPECT_CALL(*pullerManager, Pull(tagId, kConfigKey, bucketStartTimeNs, _, _))
+                .WillOnce(Invoke([](int tagId, const ConfigKey&, const int64_t,
+                                    vector<std::shared_ptr<LogEvent>>* data, bool) {
+                    data->clear();
+                    data->push_back(CreateTwoValueLogEvent(tagId, bucketStartTimeNs, 3, 30));
+                    data->push_back(CreateTwoValueLogEvent(tagId, bucketStartTimeNs, 1, 10));
+                    data->push_back(CreateTwoValueLogEvent(tagId, bucketStartTimeNs, 2, 20));
+                    return true;
+                }));
+        return ValueMetricProducerTestHelper::createValueProducerNoConditions(pullerManager,
+                                                                              metric);
+    };
+    // The mode is read on every pull, so it is only enabled while the sorted producer pulls.
+    auto pullSorted = [](const std::function<void()>& pull) {
+        ValueMetricProducer::setSortedDiffEnabled(true);
+        pull();
+        ValueMetricProducer::setSortedDiffEnabled(false);
+    };
+    sp<ValueMetricProducer> hashedProducer = createProducer();
+    sp<ValueMetricProducer> sortedProducer;
+    pullSorted([&] { sortedProducer = createProducer(); });
+
+    vector<vector<shared_ptr<LogEvent>>> pulls(2);
+    // Dimension 3 is missing and loses its base, dimension 4 is new.
+    pulls[0].push_back(CreateTwoValueLogEvent(tagId, bucket2StartTimeNs + 1, 2, 25));
+    pulls[0].push_back(CreateTwoValueLogEvent(tagId, bucket2StartTimeNs + 1, 1, 11));
+    pulls[0].push_back(CreateTwoValueLogEvent(tagId, bucket2StartTimeNs + 1, 4, 40));
+    pulls[1].push_back(CreateTwoValueLogEvent(tagId, bucket3StartTimeNs + 1, 1, 15));
+    pulls[1].push_back(CreateTwoValueLogEvent(tagId, bucket3StartTimeNs + 1, 3, 33));
+    pulls[1].push_back(CreateTwoValueLogEvent(tagId, bucket3StartTimeNs + 1, 4, 41));
+    pulls[1].push_back(CreateTwoValueLogEvent(tagId, bucket3StartTimeNs + 1, 2, 27));
+    hashedProducer->onDataPulled(pulls[0], /** succeed */ true, bucket2StartTimeNs);
+    pullSorted([&] {
+        sortedProducer->onDataPulled(pulls[0], /** succeed */ true, bucket2StartTimeNs);
+    });
+    ASSERT_EQ(4UL, sortedProducer->mSortedBaseInfo.size());
+    hashedProducer->onDataPulled(pulls[1], /** succeed */ true, bucket3StartTimeNs);
+    pullSorted([&] {
+        sortedProducer->onDataPulled(pulls[1], /** succeed */ true, bucket3StartTimeNs);
+    });
+
+    ASSERT_EQ(4UL, sortedProducer->mCurrentBaseInfo.size());
+    for (const auto& it : hashedProducer->mCurrentBaseInfo) {
+        auto sortedIt = sortedProducer->mCurrentBaseInfo.find(it.first);
+        ASSERT_NE(sortedProducer->mCurrentBaseInfo.end(), sortedIt);
+        EXPECT_EQ(it.second[0].hasBase, sortedIt->second[0].hasBase);
+        EXPECT_EQ(it.second[0].base.long_value, sortedIt->second[0].base.long_value);
+    }
+
+    // {1: 1, 2: 5} then {1: 4, 2: 2, 4: 1}.
+    ASSERT_EQ(3UL, sortedProducer->mPastBuckets.size());
+    for (const auto& it : hashedProducer->mPastBuckets) {
+        auto sortedIt = sortedProducer->mPastBuckets.find(it.first);
+        ASSERT_NE(sortedProducer->mPastBuckets.end(), sortedIt);
+        ASSERT_EQ(it.second.size(), sortedIt->second.size());
+        for (size_t i = 0; i < it.second.size(); i++) {
+            EXPECT_EQ(it.second[i].mBucketStartNs, sortedIt->second[i].mBucketStartNs);
+            EXPECT_EQ(it.second[i].values[0].long_value, sortedIt->second[i].values[0].long_value);
+        }
+    }
+}
+
 TEST(ValueMetricProducerTest, TestResetBaseOnPullFailAfterConditionChange_EndOfBucket) {
     ValueMetric metric = ValueMetricProducerTestHelper::createMetricWithCondition();
 
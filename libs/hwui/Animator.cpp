@@ -262,6 +262,22 @@ bool BaseRenderNodeAnimator::animate(AnimationContext& context) {
     return finished;
 }
 
+bool BaseRenderNodeAnimator::prepareBatchedAnimate(AnimationContext& context, float* outFraction) {
+    if (!isRunning()) {
+        return false;
+    }
+    nsecs_t playTime = context.frameTimeMs() - mStartTime;
+    if (playTime < 0 || playTime >= mDuration) {
+        return false;
+    }
+    // Same as updatePlayTime(), which the checks above leave with a fraction of mPlayTime over
+    // a positive mDuration
+    mPlayTime = mPlayState == PlayState::Reversing ? mDuration - playTime : playTime;
+    onPlayTimeChanged(mPlayTime);
+    *outFraction = MathUtils::clamp(mPlayTime / (float)mDuration, 0.0f, 1.0f);
+    return true;
+}
+
 bool BaseRenderNodeAnimator::updatePlayTime(nsecs_t playTime) {
     mPlayTime = mPlayState == PlayState::Reversing ? mDuration - playTime : playTime;
     onPlayTimeChanged(mPlayTime);
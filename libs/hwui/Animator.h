@@ -80,6 +80,18 @@ public:
     ANDROID_API void pushStaging(AnimationContext& context);
     ANDROID_API bool animate(AnimationContext& context);
 
+    // Splits animate() in two for AnimatorManager, which interpolates the fractions of its
+    // animators in batches. prepareBatchedAnimate() advances the play time and returns the
+    // fraction to interpolate with interpolator(), unless the animator isn't in the middle of
+    // playing (delayed, finishing this frame, or with a pending end or reset), in which case
+    // it returns false without doing anything and animate() must be called instead.
+    // finishBatchedAnimate() then sets the value for the interpolated fraction.
+    bool prepareBatchedAnimate(AnimationContext& context, float* outFraction);
+    Interpolator* interpolator() { return mInterpolator.get(); }
+    void finishBatchedAnimate(float interpolatedFraction) {
+        setValue(mTarget, mFromValue + (mDeltaValue * interpolatedFraction));
+    }
+
     // Returns the remaining time in ms for the animation. Note this should only be called during
     // an animation on RenderThread.
     ANDROID_API nsecs_t getRemainingPlayTime();
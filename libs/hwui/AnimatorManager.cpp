@@ -20,6 +20,7 @@
 #include "AnimationContext.h"
 #include "Animator.h"
 #include "DamageAccumulator.h"
+#include "Interpolator.h"
 #include "RenderNode.h"
 
 namespace android {
@@ -92,14 +93,93 @@ void AnimatorManager::onAnimatorTargetChanged(BaseRenderNodeAnimator* animator)
     mAnimators.erase(std::remove(mAnimators.begin(), mAnimators.end(), animator), mAnimators.end());
 }
 
+/**
+ * Interpolates the fractions of the animators of a node in batches, one per kind of
+ * interpolator, rather than with a virtual call per animator. Reused across nodes and frames so
+ * that the arrays are only allocated when a node has more animators than ever before.
+ */
+class AnimatorBatches {
+public:
+    static AnimatorBatches& get() {
+        // Animators normally only run on the RenderThread, but tests run them on others too
+        static thread_local AnimatorBatches batches;
+        return batches;
+    }
+
+    // Advances the animators that are in the middle of playing, and interpolates their
+    // fractions
+    void prepare(std::vector<sp<BaseRenderNodeAnimator> >& animators, AnimationContext& context) {
+        for (Batch& batch : mBatches) {
+            batch.fractions.clear();
+            batch.parameters.clear();
+            batch.interpolators.clear();
+        }
+        mSlots.clear();
+        mNextSlot = 0;
+
+        for (auto& animator : animators) {
+            float fraction;
+            if (!animator->prepareBatchedAnimate(context, &fraction)) {
+                mSlots.push_back({-1, 0});
+                continue;
+            }
+            Interpolator* interpolator = animator->interpolator();
+            int kind = static_cast<int>(interpolator->kind());
+            Batch& batch = mBatches[kind];
+            mSlots.push_back({kind, static_cast<uint32_t>(batch.fractions.size())});
+            batch.fractions.push_back(fraction);
+            batch.parameters.push_back(interpolator->parameter());
+            batch.interpolators.push_back(interpolator);
+        }
+
+        for (int kind = 0; kind < Interpolator::kKindCount; kind++) {
+            Batch& batch = mBatches[kind];
+            if (!batch.fractions.empty()) {
+                Interpolator::interpolateBatch(static_cast<Interpolator::Kind>(kind),
+                                               batch.fractions.data(), batch.parameters.data(),
+                                               batch.interpolators.data(), batch.fractions.size());
+            }
+        }
+    }
+
+    // Called for each animator, in the order given to prepare(). Sets the value of a prepared
+    // animator, so that values are still set in the order of the animators, or returns false
+    bool finishNext(BaseRenderNodeAnimator* animator) {
+        const Slot& slot = mSlots[mNextSlot++];
+        if (slot.kind < 0) {
+            return false;
+        }
+        animator->finishBatchedAnimate(mBatches[slot.kind].fractions[slot.index]);
+        return true;
+    }
+
+private:
+    struct Batch {
+        std::vector<float> fractions;
+        std::vector<float> parameters;
+        std::vector<Interpolator*> interpolators;
+    };
+
+    // Where the fraction of an animator is, with a kind of -1 if it wasn't prepared
+    struct Slot {
+        int kind;
+        uint32_t index;
+    };
+
+    Batch mBatches[Interpolator::kKindCount];
+    std::vector<Slot> mSlots;
+    size_t mNextSlot = 0;
+};
+
 class AnimateFunctor {
 public:
-    AnimateFunctor(TreeInfo& info, AnimationContext& context, uint32_t* outDirtyMask)
-            : mInfo(info), mContext(context), mDirtyMask(outDirtyMask) {}
+    AnimateFunctor(TreeInfo& info, AnimationContext& context, AnimatorBatches& batches,
+                   uint32_t* outDirtyMask)
+            : mInfo(info), mContext(context), mBatches(batches), mDirtyMask(outDirtyMask) {}
 
     bool operator()(sp<BaseRenderNodeAnimator>& animator) {
         *mDirtyMask |= animator->dirtyMask();
-        bool remove = animator->animate(mContext);
+        bool remove = !mBatches.finishNext(animator.get()) && animator->animate(mContext);
         if (remove) {
             animator->detach();
         } else {
@@ -116,6 +196,7 @@ public:
 private:
     TreeInfo& mInfo;
     AnimationContext& mContext;
+    AnimatorBatches& mBatches;
     uint32_t* mDirtyMask;
 };
 
@@ -142,7 +223,9 @@ void AnimatorManager::animateNoDamage(TreeInfo& info) {
 
 uint32_t AnimatorManager::animateCommon(TreeInfo& info) {
     uint32_t dirtyMask = 0;
-    AnimateFunctor functor(info, mAnimationHandle->context(), &dirtyMask);
+    AnimatorBatches& batches = AnimatorBatches::get();
+    batches.prepare(mAnimators, mAnimationHandle->context());
+    AnimateFunctor functor(info, mAnimationHandle->context(), batches, &dirtyMask);
     auto newEnd = std::remove_if(mAnimators.begin(), mAnimators.end(), functor);
     mAnimators.erase(newEnd, mAnimators.end());
     mAnimationHandle->notifyAnimationsRan();
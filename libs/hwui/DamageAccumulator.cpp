@@ -18,12 +18,159 @@
 
 #include <log/log.h>
 
+#include <algorithm>
+
+#include "Properties.h"
 #include "RenderNode.h"
 #include "utils/MathUtils.h"
 
 namespace android {
 namespace uirenderer {
 
+// Two rects are merged if the area their union covers that neither of them
+// did is at most this fraction of the union's area
+static constexpr float kMergeWasteRatio = 0.25f;
+
+static inline float rectArea(const SkRect& rect) {
+    return rect.width() * rect.height();
+}
+
+// Area covered by the union of a & b that is covered by neither a nor b
+static float mergeWaste(const SkRect& a, const SkRect& b) {
+    SkRect merged(a);
+    merged.join(b);
+    SkRect overlap;
+    float overlapArea = overlap.intersect(a, b) ? rectArea(overlap) : 0;
+    return rectArea(merged) - (rectArea(a) + rectArea(b) - overlapArea);
+}
+
+static bool shouldMerge(const SkRect& a, const SkRect& b) {
+    if (SkRect::Intersects(a, b)) {
+        // Always merge overlapping rects to keep the region disjoint
+        return true;
+    }
+    SkRect merged(a);
+    merged.join(b);
+    return mergeWaste(a, b) <= kMergeWasteRatio * rectArea(merged);
+}
+
+float DamageRegion::area() const {
+    float total = 0;
+    for (const SkRect& rect : *this) {
+        total += rectArea(rect);
+    }
+    return total;
+}
+
+void DamageRegion::setEmpty() {
+    mCount = 0;
+    mBounds.setEmpty();
+}
+
+void DamageRegion::setRect(const SkRect& rect) {
+    setEmpty();
+    add(rect);
+}
+
+void DamageRegion::removeAt(int index) {
+    mRects[index] = mRects[--mCount];
+}
+
+void DamageRegion::updateBounds() {
+    mBounds.setEmpty();
+    for (const SkRect& rect : *this) {
+        mBounds.join(rect);
+    }
+}
+
+void DamageRegion::add(const SkRect& rect) {
+    if (rect.isEmpty()) return;
+    SkRect pending(rect);
+    // Merging two rects can make the result overlap a third one, so keep
+    // folding until the pending rect is disjoint from everything in the set
+    bool merged;
+    do {
+        merged = false;
+        for (int i = 0; i < mCount; i++) {
+            if (mRects[i].contains(pending)) {
+                return;
+            }
+            if (shouldMerge(mRects[i], pending)) {
+                pending.join(mRects[i]);
+                removeAt(i);
+                merged = true;
+                break;
+            }
+        }
+    } while (merged);
+
+    if (mCount == kMaxRects) {
+        int best = 0;
+        float bestWaste = mergeWaste(mRects[0], pending);
+        for (int i = 1; i < mCount; i++) {
+            float waste = mergeWaste(mRects[i], pending);
+            if (waste < bestWaste) {
+                best = i;
+                bestWaste = waste;
+            }
+        }
+        pending.join(mRects[best]);
+        removeAt(best);
+        add(pending);
+        return;
+    }
+    // Anything removed above is contained in pending, so the bounds only grow
+    mRects[mCount++] = pending;
+    mBounds.join(pending);
+}
+
+void DamageRegion::join(const DamageRegion& other) {
+    for (const SkRect& rect : other) {
+        add(rect);
+    }
+}
+
+void DamageRegion::intersect(const SkRect& clip) {
+    for (int i = mCount - 1; i >= 0; i--) {
+        if (!mRects[i].intersect(clip)) {
+            removeAt(i);
+        }
+    }
+    updateBounds();
+}
+
+void DamageRegion::roundOut() {
+    DamageRegion rounded;
+    for (const SkRect& rect : *this) {
+        rounded.add(SkRect::Make(rect.roundOut()));
+    }
+    *this = rounded;
+}
+
+void DamageRegion::reduceTo(int maxRects) {
+    maxRects = std::max(1, maxRects);
+    while (mCount > maxRects) {
+        int bestA = 0, bestB = 1;
+        float bestWaste = mergeWaste(mRects[0], mRects[1]);
+        for (int a = 0; a < mCount; a++) {
+            for (int b = a + 1; b < mCount; b++) {
+                float waste = mergeWaste(mRects[a], mRects[b]);
+                if (waste < bestWaste) {
+                    bestA = a;
+                    bestB = b;
+                    bestWaste = waste;
+                }
+            }
+        }
+        SkRect merged(mRects[bestA]);
+        merged.join(mRects[bestB]);
+        // bestB > bestA, so removing it first keeps bestA's index valid
+        removeAt(bestB);
+        removeAt(bestA);
+        add(merged);
+    }
+}
+
 enum TransformType {
     TransformInvalid = 0,
     TransformRenderNode,
@@ -37,9 +184,9 @@ struct DirtyStack {
         const RenderNode* renderNode;
         const Matrix4* matrix4;
     };
-    // When this frame is pop'd, this rect is mapped through the above transform
+    // When this frame is pop'd, this region is mapped through the above transform
     // and applied to the previous (aka parent) frame
-    SkRect pendingDirty;
+    DamageRegion pendingDirty;
     DirtyStack* prev;
     DirtyStack* next;
 };
@@ -119,7 +266,7 @@ void DamageAccumulator::popTransform() {
     }
 }
 
-static inline void mapRect(const Matrix4* matrix, const SkRect& in, SkRect* out) {
+static inline void mapRect(const Matrix4* matrix, const SkRect& in, DamageRegion* out) {
     if (in.isEmpty()) return;
     Rect temp(in);
     if (CC_LIKELY(!matrix->isPerspective())) {
@@ -130,11 +277,17 @@ static inline void mapRect(const Matrix4* matrix, const SkRect& in, SkRect* out)
         // calculations. Just give up and expand to DIRTY_MIN/DIRTY_MAX
         temp.set(DIRTY_MIN, DIRTY_MIN, DIRTY_MAX, DIRTY_MAX);
     }
-    out->join({RECT_ARGS(temp)});
+    out->add({RECT_ARGS(temp)});
+}
+
+static inline void mapRegion(const Matrix4* matrix, const DamageRegion& in, DamageRegion* out) {
+    for (const SkRect& rect : in) {
+        mapRect(matrix, rect, out);
+    }
 }
 
 void DamageAccumulator::applyMatrix4Transform(DirtyStack* frame) {
-    mapRect(frame->matrix4, frame->pendingDirty, &mHead->pendingDirty);
+    mapRegion(frame->matrix4, frame->pendingDirty, &mHead->pendingDirty);
 }
 
 static inline void applyMatrix(const SkMatrix* transform, SkRect* rect) {
@@ -150,7 +303,7 @@ static inline void applyMatrix(const SkMatrix* transform, SkRect* rect) {
     }
 }
 
-static inline void mapRect(const RenderProperties& props, const SkRect& in, SkRect* out) {
+static inline void mapRect(const RenderProperties& props, const SkRect& in, DamageRegion* out) {
     if (in.isEmpty()) return;
     SkRect temp(in);
     applyMatrix(props.getTransformMatrix(), &temp);
@@ -160,7 +313,14 @@ static inline void mapRect(const RenderProperties& props, const SkRect& in, SkRe
         applyMatrix(props.getAnimationMatrix(), &temp);
     }
     temp.offset(props.getLeft(), props.getTop());
-    out->join(temp);
+    out->add(temp);
+}
+
+static inline void mapRegion(const RenderProperties& props, const DamageRegion& in,
+                             DamageRegion* out) {
+    for (const SkRect& rect : in) {
+        mapRect(props, rect, out);
+    }
 }
 
 static DirtyStack* findParentRenderNode(DirtyStack* frame) {
@@ -186,13 +346,16 @@ static DirtyStack* findProjectionReceiver(DirtyStack* frame) {
 }
 
 static void applyTransforms(DirtyStack* frame, DirtyStack* end) {
-    SkRect* rect = &frame->pendingDirty;
+    DamageRegion* region = &frame->pendingDirty;
     while (frame != end) {
+        // The mapped damage is joined to the damage before mapping rather than replacing it.
+        DamageRegion mapped = *region;
         if (frame->type == TransformRenderNode) {
-            mapRect(frame->renderNode->properties(), *rect, rect);
+            mapRegion(frame->renderNode->properties(), *region, &mapped);
         } else {
-            mapRect(frame->matrix4, *rect, rect);
+            mapRegion(frame->matrix4, *region, &mapped);
         }
+        *region = mapped;
         frame = frame->prev;
     }
 }
@@ -209,13 +372,11 @@ void DamageAccumulator::applyRenderNodeTransform(DirtyStack* frame) {
 
     // Perform clipping
     if (props.getClipDamageToBounds() && !frame->pendingDirty.isEmpty()) {
-        if (!frame->pendingDirty.intersect(SkRect::MakeIWH(props.getWidth(), props.getHeight()))) {
-            frame->pendingDirty.setEmpty();
-        }
+        frame->pendingDirty.intersect(SkRect::MakeIWH(props.getWidth(), props.getHeight()));
     }
 
     // apply all transforms
-    mapRect(props, frame->pendingDirty, &mHead->pendingDirty);
+    mapRegion(props, frame->pendingDirty, &mHead->pendingDirty);
 
     // project backwards if necessary
     if (props.getProjectBackwards() && !frame->pendingDirty.isEmpty()) {
@@ -233,21 +394,28 @@ void DamageAccumulator::applyRenderNodeTransform(DirtyStack* frame) {
 }
 
 void DamageAccumulator::dirty(float left, float top, float right, float bottom) {
-    mHead->pendingDirty.join({left, top, right, bottom});
+    mHead->pendingDirty.add({left, top, right, bottom});
 }
 
 void DamageAccumulator::peekAtDirty(SkRect* dest) const {
-    *dest = mHead->pendingDirty;
+    *dest = mHead->pendingDirty.getBounds();
 }
 
 void DamageAccumulator::finish(SkRect* totalDirty) {
     LOG_ALWAYS_FATAL_IF(mHead->prev != mHead, "Cannot finish, mismatched push/pop calls! %p vs. %p",
                         mHead->prev, mHead);
     // Root node never has a transform, so this is the fully mapped dirty rect
-    *totalDirty = mHead->pendingDirty;
+    *totalDirty = mHead->pendingDirty.getBounds();
     totalDirty->roundOut(totalDirty);
     mHead->pendingDirty.setEmpty();
 }
 
+void DamageAccumulator::finish(SkRect* totalDirty, DamageRegion* totalDirtyRegion) {
+    *totalDirtyRegion = mHead->pendingDirty;
+    totalDirtyRegion->roundOut();
+    totalDirtyRegion->reduceTo(Properties::maxDamageRects);
+    finish(totalDirty);
+}
+
 } /* namespace uirenderer */
 } /* namespace android */
@@ -36,6 +36,49 @@ struct DirtyStack;
 class RenderNode;
 class Matrix4;
 
+// A small, bounded set of disjoint rectangles describing a damaged area.
+// Rects that overlap are always merged, and rects that are close enough
+// that their union wastes little area are merged as well. Once the set is
+// full, a new rect is merged into whichever existing rect wastes the least
+// area, so the region degrades gracefully to a single bounding rect.
+class DamageRegion {
+public:
+    static constexpr int kMaxRects = 4;
+
+    bool isEmpty() const { return mCount == 0; }
+    int count() const { return mCount; }
+    const SkRect& operator[](int index) const { return mRects[index]; }
+    const SkRect* begin() const { return mRects; }
+    const SkRect* end() const { return mRects + mCount; }
+
+    // The bounding rect of every rect in the region
+    const SkRect& getBounds() const { return mBounds; }
+
+    // Sum of the area of every rect, which (as rects are disjoint) is the
+    // number of pixels covered by the region once rounded out
+    float area() const;
+
+    void setEmpty();
+    void setRect(const SkRect& rect);
+    void add(const SkRect& rect);
+    void join(const DamageRegion& other);
+
+    // Clips every rect to the given bounds, dropping those that become empty
+    void intersect(const SkRect& clip);
+    void roundOut();
+
+    // Merges rects until at most maxRects remain
+    void reduceTo(int maxRects);
+
+private:
+    void removeAt(int index);
+    void updateBounds();
+
+    SkRect mRects[kMaxRects];
+    SkRect mBounds = SkRect::MakeEmpty();
+    int mCount = 0;
+};
+
 class DamageAccumulator {
     PREVENT_COPY_AND_ASSIGN(DamageAccumulator);
 
@@ -55,12 +98,15 @@ public:
 
     void dirty(float left, float top, float right, float bottom);
 
-    // Returns the current dirty area, *NOT* transformed by pushed transforms
+    // Returns the bounds of the current dirty area, *NOT* transformed by pushed transforms
     void peekAtDirty(SkRect* dest) const;
 
     ANDROID_API void computeCurrentTransform(Matrix4* outMatrix) const;
 
     void finish(SkRect* totalDirty);
+    // As above, additionally returning the disjoint rects that make up totalDirty.
+    // The number of rects is limited by Properties::maxDamageRects
+    void finish(SkRect* totalDirty, DamageRegion* totalDirtyRegion);
 
 private:
     void pushCommon();
@@ -18,12 +18,67 @@
 
 #include <utils/RefBase.h>
 
+#include "FrameMetricsRing.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 namespace android {
 namespace uirenderer {
 
 class FrameMetricsObserver : public VirtualLightRefBase {
 public:
-    virtual void notify(const int64_t* buffer) = 0;
+    /**
+     * Called on the RenderThread when a frame was reported after the observer read every
+     * previous frame with readNextFrame(), so at most once per batch of frames that the observer
+     * reads. Implementations should only wake the thread that reads the frames.
+     */
+    virtual void notify() = 0;
+
+    /**
+     * Copies the oldest frame that the observer hasn't read yet into frame, which holds
+     * FrameInfoIndex::NumIndexes values, and sets droppedCount to the number of frames that
+     * were overwritten before the observer could read them since the last frame it read.
+     * Returns false when there is no frame to read, after which notify() is called for the
+     * next one. Called on the observer's own thread, one at a time.
+     */
+    bool readNextFrame(int64_t* frame, uint32_t* droppedCount) {
+        std::lock_guard<std::mutex> lock(mRingLock);
+        *droppedCount = 0;
+        if (mRing && mRing->read(&mCursor, frame, droppedCount)) {
+            return true;
+        }
+        mWaiting.store(true);
+        // A frame may have been reported since, without seeing that the observer was waiting.
+        // Pairs with the fence of FrameMetricsReporter::reportFrameMetrics()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mRing && mRing->hasUnread(mCursor) && mWaiting.exchange(false)) {
+            return mRing->read(&mCursor, frame, droppedCount);
+        }
+        return false;
+    }
+
+private:
+    friend class FrameMetricsReporter;
+
+    void attach(const std::shared_ptr<FrameMetricsRing>& ring) {
+        std::lock_guard<std::mutex> lock(mRingLock);
+        mRing = ring;
+        mCursor = FrameMetricsRing::Cursor(*ring);
+    }
+
+    void detach() {
+        std::lock_guard<std::mutex> lock(mRingLock);
+        mRing.reset();
+    }
+
+    // Only the lock of a single reader, the RenderThread never waits for it
+    std::mutex mRingLock;
+    std::shared_ptr<FrameMetricsRing> mRing;
+    FrameMetricsRing::Cursor mCursor;
+    // Whether notify() should be called on the next frame
+    std::atomic<bool> mWaiting{true};
 };
 
 }  // namespace uirenderer
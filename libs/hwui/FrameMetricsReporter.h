@@ -23,20 +23,36 @@
 #include "FrameMetricsObserver.h"
 
 #include <string.h>
+#include <memory>
 #include <vector>
 
 namespace android {
 namespace uirenderer {
 
+/**
+ * Reports the FrameInfo of each frame to the observers through a FrameMetricsRing, which the
+ * observers read on their own threads, so the RenderThread only copies each frame once however
+ * many observers there are, and never waits for them.
+ */
 class FrameMetricsReporter {
 public:
-    FrameMetricsReporter() {}
+    FrameMetricsReporter() : mRing(std::make_shared<FrameMetricsRing>()) {}
 
-    void addObserver(FrameMetricsObserver* observer) { mObservers.push_back(observer); }
+    ~FrameMetricsReporter() {
+        for (auto& observer : mObservers) {
+            observer->detach();
+        }
+    }
+
+    void addObserver(FrameMetricsObserver* observer) {
+        observer->attach(mRing);
+        mObservers.push_back(observer);
+    }
 
     bool removeObserver(FrameMetricsObserver* observer) {
         for (size_t i = 0; i < mObservers.size(); i++) {
             if (mObservers[i].get() == observer) {
+                observer->detach();
                 mObservers.erase(mObservers.begin() + i);
                 return true;
             }
@@ -47,12 +63,24 @@ public:
     bool hasObservers() { return mObservers.size() > 0; }
 
     void reportFrameMetrics(const int64_t* stats) {
+        mRing->write(stats);
+        // Either the observers see the frame, or this sees that they are waiting for it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         for (size_t i = 0; i < mObservers.size(); i++) {
-            mObservers[i]->notify(stats);
+            FrameMetricsObserver* observer = mObservers[i].get();
+            // Only wake the observers that read every previous frame
+            if (observer->mWaiting.load(std::memory_order_relaxed) &&
+                observer->mWaiting.exchange(false)) {
+                observer->notify();
+            }
         }
     }
 
+    // The frames that observers couldn't read before they were overwritten
+    uint64_t overflowCount() const { return mRing->overflowCount(); }
+
 private:
+    std::shared_ptr<FrameMetricsRing> mRing;
     std::vector<sp<FrameMetricsObserver> > mObservers;
 };
 
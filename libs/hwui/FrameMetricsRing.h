@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * A lock-free ring of the FrameInfo of the last kCapacity frames, written by the RenderThread
+ * and read by any number of readers on their own threads, each with its own Cursor.
+ *
+ * The writer never waits for the readers: a reader that falls more than kCapacity frames behind
+ * skips the frames that were overwritten, and counts them. Each slot is guarded by a sequence
+ * number, odd while the slot is being written, which readers check before and after copying it
+ * to detect the frames that were overwritten while being read.
+ */
+class FrameMetricsRing {
+public:
+    static constexpr uint64_t kCapacity = 64;
+    static constexpr int kFrameSize = static_cast<int>(FrameInfoIndex::NumIndexes);
+
+    // The position of a reader, starting at the frames written after it was created
+    class Cursor {
+    public:
+        Cursor() = default;
+        explicit Cursor(const FrameMetricsRing& ring)
+                : mNext(ring.mWriteIndex.load(std::memory_order_acquire)) {}
+
+    private:
+        friend class FrameMetricsRing;
+        uint64_t mNext = 0;
+    };
+
+    // Only called by the single writer
+    void write(const int64_t* frame) {
+        uint64_t index = mWriteIndex.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[index % kCapacity];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < kFrameSize; i++) {
+            slot.frame[i].store(frame[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        mWriteIndex.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * Copies the next frame of the cursor into frame and advances the cursor, adding the number
+     * of frames that were overwritten before they could be read to droppedCount. Returns false
+     * if the cursor is at the last written frame.
+     */
+    bool read(Cursor* cursor, int64_t* frame, uint32_t* droppedCount) {
+        uint64_t written = mWriteIndex.load(std::memory_order_acquire);
+        while (cursor->mNext < written) {
+            if (written - cursor->mNext > kCapacity) {
+                skip(cursor, written - kCapacity - cursor->mNext, droppedCount);
+            }
+            const Slot& slot = mSlots[cursor->mNext % kCapacity];
+            const uint64_t expected = 2 * cursor->mNext + 2;
+            if (slot.sequence.load(std::memory_order_acquire) == expected) {
+                for (int i = 0; i < kFrameSize; i++) {
+                    frame[i] = slot.frame[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                    cursor->mNext++;
+                    return true;
+                }
+            }
+            // The writer lapped the reader since it loaded written
+            skip(cursor, 1, droppedCount);
+            written = mWriteIndex.load(std::memory_order_acquire);
+        }
+        return false;
+    }
+
+    bool hasUnread(const Cursor& cursor) const {
+        return cursor.mNext < mWriteIndex.load(std::memory_order_acquire);
+    }
+
+    // The frames that were dropped by every reader of the ring so far
+    uint64_t overflowCount() const { return mOverflowCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> frame[kFrameSize];
+    };
+
+    void skip(Cursor* cursor, uint64_t count, uint32_t* droppedCount) {
+        cursor->mNext += count;
+        *droppedCount += count;
+        mOverflowCount.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    Slot mSlots[kCapacity];
+    std::atomic<uint64_t> mWriteIndex{0};
+    std::atomic<uint64_t> mOverflowCount{0};
+};
+
+}  // namespace uirenderer
+}  // namespace android
@@ -29,22 +29,21 @@ Interpolator* Interpolator::createDefaultInterpolator() {
     return new AccelerateDecelerateInterpolator();
 }
 
-float AccelerateDecelerateInterpolator::interpolate(float input) {
+// The formulas of the interpolators, shared by interpolate() and interpolateBatch() so that
+// both compute the exact same values
+
+static inline float accelerateDecelerate(float input) {
     return (float)(cosf((input + 1) * M_PI) / 2.0f) + 0.5f;
 }
 
-float AccelerateInterpolator::interpolate(float input) {
-    if (mFactor == 1.0f) {
+static inline float accelerate(float input, float factor) {
+    if (factor == 1.0f) {
         return input * input;
     } else {
-        return pow(input, mDoubleFactor);
+        return pow(input, factor * 2);
     }
 }
 
-float AnticipateInterpolator::interpolate(float t) {
-    return t * t * ((mTension + 1) * t - mTension);
-}
-
 static float a(float t, float s) {
     return t * t * ((s + 1) * t - s);
 }
@@ -53,18 +52,18 @@ static float o(float t, float s) {
     return t * t * ((s + 1) * t + s);
 }
 
-float AnticipateOvershootInterpolator::interpolate(float t) {
+static inline float anticipateOvershoot(float t, float tension) {
     if (t < 0.5f)
-        return 0.5f * a(t * 2.0f, mTension);
+        return 0.5f * a(t * 2.0f, tension);
     else
-        return 0.5f * (o(t * 2.0f - 2.0f, mTension) + 2.0f);
+        return 0.5f * (o(t * 2.0f - 2.0f, tension) + 2.0f);
 }
 
 static float bounce(float t) {
     return t * t * 8.0f;
 }
 
-float BounceInterpolator::interpolate(float t) {
+static inline float bounceInterpolation(float t) {
     t *= 1.1226f;
     if (t < 0.3535f)
         return bounce(t);
@@ -76,23 +75,55 @@ float BounceInterpolator::interpolate(float t) {
         return bounce(t - 1.0435f) + 0.95f;
 }
 
-float CycleInterpolator::interpolate(float input) {
-    return sinf(2 * mCycles * M_PI * input);
+static inline float cycle(float input, float cycles) {
+    return sinf(2 * cycles * M_PI * input);
 }
 
-float DecelerateInterpolator::interpolate(float input) {
+static inline float decelerate(float input, float factor) {
     float result;
-    if (mFactor == 1.0f) {
+    if (factor == 1.0f) {
         result = 1.0f - (1.0f - input) * (1.0f - input);
     } else {
-        result = 1.0f - pow((1.0f - input), 2 * mFactor);
+        result = 1.0f - pow((1.0f - input), 2 * factor);
     }
     return result;
 }
 
-float OvershootInterpolator::interpolate(float t) {
+static inline float overshoot(float t, float tension) {
     t -= 1.0f;
-    return t * t * ((mTension + 1) * t + mTension) + 1.0f;
+    return t * t * ((tension + 1) * t + tension) + 1.0f;
+}
+
+float AccelerateDecelerateInterpolator::interpolate(float input) {
+    return accelerateDecelerate(input);
+}
+
+float AccelerateInterpolator::interpolate(float input) {
+    return accelerate(input, mFactor);
+}
+
+float AnticipateInterpolator::interpolate(float t) {
+    return a(t, mTension);
+}
+
+float AnticipateOvershootInterpolator::interpolate(float t) {
+    return anticipateOvershoot(t, mTension);
+}
+
+float BounceInterpolator::interpolate(float t) {
+    return bounceInterpolation(t);
+}
+
+float CycleInterpolator::interpolate(float input) {
+    return cycle(input, mCycles);
+}
+
+float DecelerateInterpolator::interpolate(float input) {
+    return decelerate(input, mFactor);
+}
+
+float OvershootInterpolator::interpolate(float t) {
+    return overshoot(t, mTension);
 }
 
 float PathInterpolator::interpolate(float t) {
@@ -127,7 +158,8 @@ float PathInterpolator::interpolate(float t) {
     return startY + (fraction * (endY - startY));
 }
 
-LUTInterpolator::LUTInterpolator(float* values, size_t size) : mValues(values), mSize(size) {}
+LUTInterpolator::LUTInterpolator(float* values, size_t size)
+        : Interpolator(Kind::LUT), mValues(values), mSize(size) {}
 
 LUTInterpolator::~LUTInterpolator() {}
 
@@ -156,5 +188,73 @@ float LUTInterpolator::interpolate(float input) {
     return MathUtils::lerp(v1, v2, weight);
 }
 
+template <typename T>
+static inline void interpolateEach(float* inputs, const float* parameters, size_t count,
+                                   T interpolation) {
+    for (size_t i = 0; i < count; i++) {
+        inputs[i] = interpolation(inputs[i], parameters[i]);
+    }
+}
+
+void Interpolator::interpolateBatch(Kind kind, float* inputs, const float* parameters,
+                                    Interpolator* const* interpolators, size_t count) {
+    switch (kind) {
+        case Kind::AccelerateDecelerate:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float) { return accelerateDecelerate(t); });
+            break;
+        case Kind::Accelerate:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float factor) { return accelerate(t, factor); });
+            break;
+        case Kind::Anticipate:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float tension) { return a(t, tension); });
+            break;
+        case Kind::AnticipateOvershoot:
+            interpolateEach(inputs, parameters, count, [](float t, float tension) {
+                return anticipateOvershoot(t, tension);
+            });
+            break;
+        case Kind::Bounce:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float) { return bounceInterpolation(t); });
+            break;
+        case Kind::Cycle:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float cycles) { return cycle(t, cycles); });
+            break;
+        case Kind::Decelerate:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float factor) { return decelerate(t, factor); });
+            break;
+        case Kind::Linear:
+            break;
+        case Kind::Overshoot:
+            interpolateEach(inputs, parameters, count,
+                            [](float t, float tension) { return overshoot(t, tension); });
+            break;
+        // The path and table lookups can't be vectorized, but qualified calls still avoid the
+        // virtual dispatch
+        case Kind::Path:
+            for (size_t i = 0; i < count; i++) {
+                inputs[i] = static_cast<PathInterpolator*>(interpolators[i])
+                                    ->PathInterpolator::interpolate(inputs[i]);
+            }
+            break;
+        case Kind::LUT:
+            for (size_t i = 0; i < count; i++) {
+                inputs[i] = static_cast<LUTInterpolator*>(interpolators[i])
+                                    ->LUTInterpolator::interpolate(inputs[i]);
+            }
+            break;
+        case Kind::Other:
+            for (size_t i = 0; i < count; i++) {
+                inputs[i] = interpolators[i]->interpolate(inputs[i]);
+            }
+            break;
+    }
+}
+
 } /* namespace uirenderer */
 } /* namespace android */
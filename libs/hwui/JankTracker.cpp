@@ -61,6 +61,26 @@ static const std::array<Comparison, 4> COMPARISONS{
                    FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::FrameCompleted},
 };
 
+struct StageSpan {
+    FrameStage stage;
+    FrameInfoIndex start;
+    FrameInfoIndex end;
+};
+
+static const std::array<StageSpan, 6> STAGE_SPANS{
+        StageSpan{FrameStage::Input, FrameInfoIndex::HandleInputStart,
+                  FrameInfoIndex::AnimationStart},
+        StageSpan{FrameStage::Animation, FrameInfoIndex::AnimationStart,
+                  FrameInfoIndex::PerformTraversalsStart},
+        StageSpan{FrameStage::Traversal, FrameInfoIndex::PerformTraversalsStart,
+                  FrameInfoIndex::SyncStart},
+        StageSpan{FrameStage::Sync, FrameInfoIndex::SyncStart,
+                  FrameInfoIndex::IssueDrawCommandsStart},
+        StageSpan{FrameStage::Draw, FrameInfoIndex::IssueDrawCommandsStart,
+                  FrameInfoIndex::SwapBuffers},
+        StageSpan{FrameStage::Swap, FrameInfoIndex::SwapBuffers, FrameInfoIndex::FrameCompleted},
+};
+
 // If the event exceeds 10 seconds throw it away, this isn't a jank event
 // it's an ANR and will be handled as such
 static const int64_t IGNORE_EXCEEDING = seconds_to_nanoseconds(10);
@@ -129,6 +149,17 @@ void JankTracker::finishFrame(const FrameInfo& frame) {
     mData->reportFrame(totalDuration);
     (*mGlobalData)->reportFrame(totalDuration);
 
+    bool hasUiStages = !(frame[FrameInfoIndex::Flags] & FrameInfoFlags::RTAnimation);
+    for (auto& span : STAGE_SPANS) {
+        // Frames that only ran RenderThread animations didn't go through the UI thread
+        if (span.end <= FrameInfoIndex::SyncStart && !hasUiStages) {
+            continue;
+        }
+        int64_t duration = frame.duration(span.start, span.end);
+        mData->reportStage(span.stage, duration);
+        (*mGlobalData)->reportStage(span.stage, duration);
+    }
+
     // Only things like Surface.lockHardwareCanvas() are exempt from tracking
     if (CC_UNLIKELY(frame[FrameInfoIndex::Flags] & EXEMPT_FRAMES_FLAGS)) {
         return;
@@ -237,6 +268,8 @@ void JankTracker::finishGpuDraw(const FrameInfo& frame) {
     if (totalGPUDrawTime >= 0) {
         mData->reportGPUFrame(totalGPUDrawTime);
         (*mGlobalData)->reportGPUFrame(totalGPUDrawTime);
+        mData->reportStage(FrameStage::Gpu, totalGPUDrawTime);
+        (*mGlobalData)->reportStage(FrameStage::Gpu, totalGPUDrawTime);
     }
 }
 
@@ -19,15 +19,136 @@
 #include "jni.h"
 
 #include <errno.h>
+#include <math.h>
 #include <stdlib.h>
 #include <utils/Log.h>
+#include <list>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
 namespace uirenderer {
 
+// Enough for the paths of a few hundred icons
+static constexpr size_t PATH_CACHE_MAX_BYTES = 512 * 1024;
+// Larger paths are unlikely to be shared, and would evict many smaller ones
+static constexpr size_t PATH_CACHE_MAX_ENTRY_BYTES = PATH_CACHE_MAX_BYTES / 16;
+
+/**
+ * Process wide LRU cache of successfully parsed paths, keyed by their string. The same path data
+ * is parsed each time a VectorDrawable or AnimatedVectorDrawable is inflated from a resource, so
+ * an icon typically only needs to be parsed once.
+ */
+class ParsedPathCache {
+public:
+    static ParsedPathCache& get() {
+        static ParsedPathCache* sInstance = new ParsedPathCache();
+        return *sInstance;
+    }
+
+    // Appends the cached data of pathString to outData. Returns false if it isn't cached.
+    bool findData(std::string_view pathString, PathData* outData) {
+        std::lock_guard lock(mLock);
+        Entry* entry = findLocked(pathString);
+        if (!entry) {
+            return false;
+        }
+        const PathData& data = entry->data;
+        outData->verbs.insert(outData->verbs.end(), data.verbs.begin(), data.verbs.end());
+        outData->verbSizes.insert(outData->verbSizes.end(), data.verbSizes.begin(),
+                                  data.verbSizes.end());
+        outData->points.insert(outData->points.end(), data.points.begin(), data.points.end());
+        return true;
+    }
+
+    bool findPath(std::string_view pathString, SkPath* outPath) {
+        std::lock_guard lock(mLock);
+        Entry* entry = findLocked(pathString);
+        if (!entry || !entry->hasPath) {
+            return false;
+        }
+        *outPath = entry->path;
+        return true;
+    }
+
+    void putData(std::string_view pathString, const PathData& data) {
+        size_t bytes = sizeof(Entry) + pathString.size() + data.verbs.size() +
+                       data.verbSizes.size() * sizeof(size_t) + data.points.size() * sizeof(float);
+        if (bytes > PATH_CACHE_MAX_ENTRY_BYTES) {
+            return;
+        }
+        std::lock_guard lock(mLock);
+        if (mIndex.count(pathString)) {
+            return;
+        }
+        mEntries.push_front({std::string(pathString), data, SkPath(), false, bytes});
+        mIndex[mEntries.front().pathString] = mEntries.begin();
+        mBytes += bytes;
+        trimLocked();
+    }
+
+    // Attaches the SkPath built from an entry's data, if the entry is still cached
+    void putPath(std::string_view pathString, const SkPath& path) {
+        std::lock_guard lock(mLock);
+        auto it = mIndex.find(pathString);
+        if (it == mIndex.end() || it->second->hasPath) {
+            return;
+        }
+        Entry& entry = *it->second;
+        entry.path = path;
+        entry.hasPath = true;
+        size_t pathBytes = path.approximateBytesUsed();
+        entry.bytes += pathBytes;
+        mBytes += pathBytes;
+        trimLocked();
+    }
+
+    void clear() {
+        std::lock_guard lock(mLock);
+        mIndex.clear();
+        mEntries.clear();
+        mBytes = 0;
+    }
+
+private:
+    struct Entry {
+        std::string pathString;
+        PathData data;
+        SkPath path;
+        bool hasPath;
+        size_t bytes;
+    };
+
+    Entry* findLocked(std::string_view pathString) {
+        auto it = mIndex.find(pathString);
+        if (it == mIndex.end()) {
+            return nullptr;
+        }
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return &*it->second;
+    }
+
+    void trimLocked() {
+        while (mBytes > PATH_CACHE_MAX_BYTES) {
+            Entry& oldest = mEntries.back();
+            mBytes -= oldest.bytes;
+            mIndex.erase(oldest.pathString);
+            mEntries.pop_back();
+        }
+    }
+
+    std::mutex mLock;
+    // Most recently used first
+    std::list<Entry> mEntries;
+    // Keys point into the strings owned by mEntries
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> mIndex;
+    size_t mBytes = 0;
+};
+
 static size_t nextStart(const char* s, size_t length, size_t startIndex) {
     size_t index = startIndex;
     while (index < length) {
@@ -99,10 +220,120 @@ static void extract(int* outEndPosition, bool* outEndWithNegOrDot, const char* s
     *outEndPosition = currentIndex;
 }
 
+// Powers of ten that are exactly representable as float and double respectively
+static const float sFloatPowersOf10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                         1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+static const double sDoublePowersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                           1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * Scans a decimal floating point number at the start of [s, end), which is what strtof does for
+ * path data, without depending on the locale. The value is computed exactly whenever the digits
+ * fit the fast paths below, which covers the numbers found in practice. Returns false if the
+ * text can't be handled that way, in which case the caller falls back to strtof.
+ */
+static bool scanFloat(const char* s, const char* end, float* outValue, const char** outEnd) {
+    const char* p = s;
+    while (p < end && isspace(*p)) {
+        p++;
+    }
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p < end && isDigit(*p); p++) {
+        hasDigits = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            // More significant digits than can be represented exactly
+            return false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isDigit(*p); p++) {
+            hasDigits = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            } else {
+                return false;
+            }
+        }
+    }
+    if (!hasDigits || (p < end && (*p == 'x' || *p == 'X'))) {
+        // Not a number, or one of the hexadecimal, infinity or NaN forms strtof also accepts
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        // As with strtof, an 'e' that isn't followed by an exponent is not part of the number
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            q++;
+        }
+        if (q < end && isDigit(*q)) {
+            int explicitExponent = 0;
+            for (; q < end && isDigit(*q); q++) {
+                if (explicitExponent > 1000) {
+                    return false;
+                }
+                explicitExponent = explicitExponent * 10 + (*q - '0');
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = q;
+        }
+    }
+
+    float value;
+    if (mantissa == 0) {
+        value = 0;
+    } else if (mantissa < (1 << 24) && exponent >= -10 && exponent <= 10) {
+        // Both operands are exact, so the result is correctly rounded
+        value = exponent < 0 ? mantissa / sFloatPowersOf10[-exponent]
+                             : mantissa * sFloatPowersOf10[exponent];
+    } else if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double exact = exponent < 0 ? mantissa / sDoublePowersOf10[-exponent]
+                                    : mantissa * sDoublePowersOf10[exponent];
+        value = exact;
+        // The double is correctly rounded, so rounding it again to float can only go wrong if it
+        // landed exactly halfway between two floats
+        float neighbor = nextafterf(value, exact > value ? INFINITY : -INFINITY);
+        if (exact == (static_cast<double>(value) + neighbor) / 2) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    *outValue = negative ? -value : value;
+    *outEnd = p;
+    return true;
+}
+
 static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
                         size_t expectedLength) {
-    char* endPtr = NULL;
-    float currentValue = strtof(startPtr, &endPtr);
+    float currentValue;
+    const char* endPtr;
+    if (!scanFloat(startPtr, startPtr + expectedLength, &currentValue, &endPtr)) {
+        // Rare: too many digits, an extreme exponent or not a decimal number
+        char* strtofEndPtr = NULL;
+        currentValue = strtof(startPtr, &strtofEndPtr);
+        endPtr = strtofEndPtr;
+    }
     if ((currentValue == HUGE_VALF || currentValue == -HUGE_VALF) && errno == ERANGE) {
         result->failureOccurred = true;
         result->failureMessage = "Float out of range:  ";
@@ -125,6 +356,7 @@ static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
  */
 static void getFloats(std::vector<float>* outPoints, PathParser::ParseResult* result,
                       const char* pathStr, int start, int end) {
+    // Points are appended to the output directly, rather than collected per command
     if (pathStr[start] == 'z' || pathStr[start] == 'Z') {
         return;
     }
@@ -222,6 +454,21 @@ void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
         return;
     }
 
+    std::string_view pathString(pathStr, strLen);
+    ParsedPathCache& cache = ParsedPathCache::get();
+    if (cache.findData(pathString, data)) {
+        return;
+    }
+    // Only cache the result if it is all that ends up in data
+    bool cacheable = data->verbs.empty() && data->points.empty();
+    parsePathData(data, result, pathStr, strLen);
+    if (cacheable && !result->failureOccurred) {
+        cache.putData(pathString, *data);
+    }
+}
+
+void PathParser::parsePathData(PathData* data, ParseResult* result, const char* pathStr,
+                               size_t strLen) {
     size_t start = 0;
     // Skip leading spaces.
     while (isspace(pathStr[start]) && start < strLen) {
@@ -236,18 +483,19 @@ void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
 
     while (end < strLen) {
         end = nextStart(pathStr, strLen, end);
-        std::vector<float> points;
-        getFloats(&points, result, pathStr, start, end);
-        validateVerbAndPoints(pathStr[start], points.size(), result);
+        size_t pointsStart = data->points.size();
+        getFloats(&data->points, result, pathStr, start, end);
+        size_t pointCount = data->points.size() - pointsStart;
+        validateVerbAndPoints(pathStr[start], pointCount, result);
         if (result->failureOccurred) {
             // If either verb or points is not valid, return immediately.
+            data->points.resize(pointsStart);
             result->failureMessage += "Failure occurred at position " + std::to_string(start) +
                                       " of path: " + pathStr;
             return;
         }
         data->verbs.push_back(pathStr[start]);
-        data->verbSizes.push_back(points.size());
-        data->points.insert(data->points.end(), points.begin(), points.end());
+        data->verbSizes.push_back(pointCount);
         start = end;
         end++;
     }
@@ -286,8 +534,15 @@ void PathParser::dump(const PathData& data) {
     ALOGD("points are : %s", os.str().c_str());
 }
 
+void PathParser::clearCache() {
+    ParsedPathCache::get().clear();
+}
+
 void PathParser::parseAsciiStringForSkPath(SkPath* skPath, ParseResult* result, const char* pathStr,
                                            size_t strLen) {
+    if (pathStr != NULL && ParsedPathCache::get().findPath({pathStr, strLen}, skPath)) {
+        return;
+    }
     PathData pathData;
     getPathDataFromAsciiString(&pathData, result, pathStr, strLen);
     if (result->failureOccurred) {
@@ -301,7 +556,7 @@ void PathParser::parseAsciiStringForSkPath(SkPath* skPath, ParseResult* result,
         return;
     }
     VectorDrawableUtils::verbsToPath(skPath, pathData);
-    return;
+    ParsedPathCache::get().putPath({pathStr, strLen}, *skPath);
 }
 
 }  // namespace uirenderer
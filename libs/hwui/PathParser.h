@@ -42,8 +42,17 @@ public:
                                                       const char* pathStr, size_t strLength);
     ANDROID_API static void getPathDataFromAsciiString(PathData* outData, ParseResult* result,
                                                        const char* pathStr, size_t strLength);
+    /**
+     * Successfully parsed paths are cached by their string, as the same path strings are parsed
+     * every time a drawable is inflated. This drops all of them.
+     */
+    ANDROID_API static void clearCache();
     static void dump(const PathData& data);
     static void validateVerbAndPoints(char verb, size_t points, ParseResult* result);
+
+private:
+    static void parsePathData(PathData* outData, ParseResult* result, const char* pathStr,
+                              size_t strLength);
 };
 
 }      // namespace uirenderer
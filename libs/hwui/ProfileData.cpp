@@ -17,6 +17,7 @@
 #include "ProfileData.h"
 #include "Properties.h"
 
+#include <algorithm>
 #include <cinttypes>
 
 namespace android {
@@ -26,6 +27,9 @@ static const char* JANK_TYPE_NAMES[] = {
         "Missed Vsync",        "High input latency",       "Slow UI thread",
         "Slow bitmap uploads", "Slow issue draw commands", "Frame deadline missed"};
 
+static const char* FRAME_STAGE_NAMES[] = {"Input", "Animation", "Traversal", "Sync",
+                                          "Draw",  "Swap",      "GPU"};
+
 // The bucketing algorithm controls so to speak
 // If a frame is <= to this it goes in bucket 0
 static const uint32_t kBucketMinThreshold = 5;
@@ -78,6 +82,29 @@ uint32_t ProfileData::frameTimeForSlowFrameCountIndex(uint32_t index) {
     return (index * kSlowFrameBucketIntervalMs) + kSlowFrameBucketStartMs;
 }
 
+// Also called every frame, for each stage. Durations under kStageSubBuckets us each have their
+// own bucket, then each power of two range is split in kStageSubBuckets buckets
+uint32_t ProfileData::stageCountIndexForDuration(int64_t duration) {
+    uint32_t us = static_cast<uint32_t>(std::clamp<int64_t>(ns2us(duration), 0, kStageMaxUs - 1));
+    if (us < kStageSubBuckets) {
+        return us;
+    }
+    // The sub-bucket shift is the number of bits below the kStageSubBuckets most significant ones
+    constexpr uint32_t kSubBucketBits = 3;
+    static_assert(1 << kSubBucketBits == kStageSubBuckets, "kSubBucketBits is wrong");
+    uint32_t shift = 31 - __builtin_clz(us) - kSubBucketBits;
+    return kStageSubBuckets * (shift + 1) + ((us >> shift) - kStageSubBuckets);
+}
+
+uint32_t ProfileData::stageDurationUsForStageCountIndex(uint32_t index) {
+    if (index < kStageSubBuckets) {
+        return index;
+    }
+    uint32_t shift = index / kStageSubBuckets - 1;
+    uint32_t lowerBound = (kStageSubBuckets + index % kStageSubBuckets) << shift;
+    return lowerBound + ((1 << shift) >> 1);
+}
+
 void ProfileData::mergeWith(const ProfileData& other) {
     // Make sure we don't overflow Just In Case
     uint32_t divider = 0;
@@ -103,6 +130,12 @@ void ProfileData::mergeWith(const ProfileData& other) {
         mGPUFrameCounts[i] >>= divider;
         mGPUFrameCounts[i] += other.mGPUFrameCounts[i];
     }
+    for (size_t stage = 0; stage < other.mStageCounts.size(); stage++) {
+        for (size_t i = 0; i < other.mStageCounts[stage].size(); i++) {
+            mStageCounts[stage][i] >>= divider;
+            mStageCounts[stage][i] += other.mStageCounts[stage][i];
+        }
+    }
     mPipelineType = other.mPipelineType;
 }
 
@@ -131,6 +164,16 @@ void ProfileData::dump(int fd) const {
     histogramGPUForEach([fd](HistogramEntry entry) {
         dprintf(fd, " %ums=%u", entry.renderTimeMs, entry.frameCount);
     });
+    dumpStages(fd);
+}
+
+void ProfileData::dumpStages(int fd, const StageHistograms& histograms) {
+    for (size_t i = 0; i < histograms.size(); i++) {
+        const StageCounts& counts = histograms[i];
+        dprintf(fd, "\n%s percentiles: 50th=%.2fms 90th=%.2fms 99th=%.2fms", FRAME_STAGE_NAMES[i],
+                findStagePercentile(counts, 50), findStagePercentile(counts, 90),
+                findStagePercentile(counts, 99));
+    }
 }
 
 uint32_t ProfileData::findPercentile(int percentile) const {
@@ -156,6 +199,9 @@ void ProfileData::reset() {
     mFrameCounts.fill(0);
     mGPUFrameCounts.fill(0);
     mSlowFrameCounts.fill(0);
+    for (auto& counts : mStageCounts) {
+        counts.fill(0);
+    }
     mTotalFrameCount = 0;
     mJankFrameCount = 0;
     mStatStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -218,5 +264,36 @@ void ProfileData::histogramGPUForEach(const std::function<void(HistogramEntry)>&
     }
 }
 
+void ProfileData::reportStage(FrameStage stage, int64_t duration) {
+    mStageCounts[static_cast<int>(stage)][stageCountIndexForDuration(duration)]++;
+}
+
+float ProfileData::findStagePercentile(const StageCounts& counts, int percentile) {
+    uint32_t totalCount = 0;
+    for (uint32_t count : counts) {
+        totalCount += count;
+    }
+    if (totalCount == 0) {
+        return 0;
+    }
+    int pos = percentile * totalCount / 100;
+    int remaining = totalCount - pos;
+    for (int i = counts.size() - 1; i >= 0; i--) {
+        remaining -= counts[i];
+        if (remaining <= 0) {
+            return stageDurationUsForStageCountIndex(i) / 1000.0f;
+        }
+    }
+    return 0;
+}
+
+void ProfileData::stageHistogramForEach(
+        FrameStage stage, const std::function<void(StageHistogramEntry)>& callback) const {
+    const auto& counts = mStageCounts[static_cast<int>(stage)];
+    for (size_t i = 0; i < counts.size(); i++) {
+        callback(StageHistogramEntry{stageDurationUsForStageCountIndex(i), counts[i]});
+    }
+}
+
 } /* namespace uirenderer */
 } /* namespace android */
\ No newline at end of file
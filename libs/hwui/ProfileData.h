@@ -40,9 +40,35 @@ enum JankType {
     NUM_BUCKETS,
 };
 
+// The stages of a frame that ProfileData keeps a histogram of the duration of
+enum class FrameStage {
+    // HandleInputStart to AnimationStart
+    Input = 0,
+    // AnimationStart to PerformTraversalsStart
+    Animation,
+    // PerformTraversalsStart to SyncStart, measuring, laying out and recording the UI
+    Traversal,
+    // SyncStart to IssueDrawCommandsStart
+    Sync,
+    // IssueDrawCommandsStart to SwapBuffers
+    Draw,
+    // SwapBuffers to FrameCompleted
+    Swap,
+    // The GPU draw time, see FrameInfo::gpuDrawTime()
+    Gpu,
+
+    // must be last
+    NumStages,
+};
+
 // For testing
 class MockProfileData;
 
+// A log-linear histogram of the durations of a FrameStage, see
+// ProfileData::stageCountIndexForDuration()
+using StageCounts = std::array<uint32_t, 160>;
+using StageHistograms = std::array<StageCounts, static_cast<int>(FrameStage::NumStages)>;
+
 // Try to keep as small as possible, should match ASHMEM_SIZE in
 // GraphicsStatsService.java
 class ProfileData {
@@ -54,6 +80,9 @@ public:
     void reset();
     void mergeWith(const ProfileData& other);
     void dump(int fd) const;
+    // Dumps the percentiles of each FrameStage, which dump() includes
+    void dumpStages(int fd) const { dumpStages(fd, mStageCounts); }
+    static void dumpStages(int fd, const StageHistograms& histograms);
     uint32_t findPercentile(int percentile) const;
     uint32_t findGPUPercentile(int percentile) const;
 
@@ -61,6 +90,7 @@ public:
     void reportGPUFrame(int64_t duration);
     void reportJank() { mJankFrameCount++; }
     void reportJankType(JankType type) { mJankTypeCounts[static_cast<int>(type)]++; }
+    void reportStage(FrameStage stage, int64_t duration);
 
     uint32_t totalFrameCount() const { return mTotalFrameCount; }
     uint32_t jankFrameCount() const { return mJankFrameCount; }
@@ -75,6 +105,21 @@ public:
     void histogramForEach(const std::function<void(HistogramEntry)>& callback) const;
     void histogramGPUForEach(const std::function<void(HistogramEntry)>& callback) const;
 
+    // Percentile of the duration of a stage, in milliseconds
+    float findStagePercentile(FrameStage stage, int percentile) const {
+        return findStagePercentile(mStageCounts[static_cast<int>(stage)], percentile);
+    }
+    static float findStagePercentile(const StageCounts& counts, int percentile);
+    const StageHistograms& stageHistograms() const { return mStageCounts; }
+
+    struct StageHistogramEntry {
+        // Middle of the range of durations of the bucket
+        uint32_t durationUs;
+        uint32_t frameCount;
+    };
+    void stageHistogramForEach(FrameStage stage,
+                               const std::function<void(StageHistogramEntry)>& callback) const;
+
     constexpr static int HistogramSize() {
         return std::tuple_size<decltype(ProfileData::mFrameCounts)>::value +
                std::tuple_size<decltype(ProfileData::mSlowFrameCounts)>::value;
@@ -84,10 +129,20 @@ public:
         return std::tuple_size<decltype(ProfileData::mGPUFrameCounts)>::value;
     }
 
+    constexpr static int StageHistogramSize() { return std::tuple_size<StageCounts>::value; }
+
     // Visible for testing
     static uint32_t frameTimeForFrameCountIndex(uint32_t index);
     static uint32_t frameTimeForSlowFrameCountIndex(uint32_t index);
     static uint32_t GPUFrameTimeForFrameCountIndex(uint32_t index);
+    static uint32_t stageCountIndexForDuration(int64_t duration);
+    static uint32_t stageDurationUsForStageCountIndex(uint32_t index);
+
+    // Each power of two range of microseconds is split in this many buckets of the stage
+    // histograms, so that their percentiles are within 1/kStageSubBuckets of the actual value
+    static constexpr uint32_t kStageSubBuckets = 8;
+    // Durations of kStageMaxUs or more are counted in the last bucket
+    static constexpr uint32_t kStageMaxUs = 1 << 22;
 
 private:
     // Open our guts up to unit tests
@@ -101,6 +156,8 @@ private:
     // Holds a histogram of GPU draw times in 1ms increments. Frames longer than 25ms are placed in
     // last bucket.
     std::array<uint32_t, 26> mGPUFrameCounts;
+    // Log-linear histograms of the durations of each FrameStage
+    StageHistograms mStageCounts;
 
     uint32_t mTotalFrameCount;
     uint32_t mJankFrameCount;
@@ -116,6 +173,7 @@ public:
     std::array<uint32_t, NUM_BUCKETS>& editJankTypeCounts() { return mJankTypeCounts; }
     std::array<uint32_t, 57>& editFrameCounts() { return mFrameCounts; }
     std::array<uint16_t, 97>& editSlowFrameCounts() { return mSlowFrameCounts; }
+    StageHistograms& editStageCounts() { return mStageCounts; }
     uint32_t& editTotalFrameCount() { return mTotalFrameCount; }
     uint32_t& editJankFrameCount() { return mJankFrameCount; }
     nsecs_t& editStatStartTime() { return mStatStartTime; }
@@ -48,6 +48,13 @@ bool Properties::showDirtyRegions = false;
 bool Properties::skipEmptyFrames = true;
 bool Properties::useBufferAge = true;
 bool Properties::enablePartialUpdates = true;
+int Properties::maxDamageRects = 4;
+bool Properties::prerasterizeVectorDrawables = true;
+int Properties::compressThreads = 3;
+int Properties::regionTileCacheSize = 24;
+int Properties::animatedImageLookahead = 3;
+int Properties::animatedImageCacheSize = 32;
+int Properties::textLayoutCacheSize = 1024;
 
 DebugLevel Properties::debugLevel = kDebugDisabled;
 OverdrawColorSet Properties::overdrawColorSet = OverdrawColorSet::Default;
@@ -116,6 +123,17 @@ bool Properties::load() {
     skipEmptyFrames = base::GetBoolProperty(PROPERTY_SKIP_EMPTY_DAMAGE, true);
     useBufferAge = base::GetBoolProperty(PROPERTY_USE_BUFFER_AGE, true);
     enablePartialUpdates = base::GetBoolProperty(PROPERTY_ENABLE_PARTIAL_UPDATES, true);
+    maxDamageRects = std::max(1, base::GetIntProperty(PROPERTY_MAX_DAMAGE_RECTS, 4));
+    prerasterizeVectorDrawables =
+            base::GetBoolProperty(PROPERTY_PRERASTERIZE_VECTOR_DRAWABLES, true);
+    compressThreads = std::max(1, base::GetIntProperty(PROPERTY_COMPRESS_THREADS, 3));
+    regionTileCacheSize = std::max(0, base::GetIntProperty(PROPERTY_REGION_TILE_CACHE_SIZE, 24));
+    animatedImageLookahead =
+            std::max(1, base::GetIntProperty(PROPERTY_ANIMATED_IMAGE_LOOKAHEAD, 3));
+    animatedImageCacheSize =
+            std::max(0, base::GetIntProperty(PROPERTY_ANIMATED_IMAGE_CACHE_SIZE, 32));
+    textLayoutCacheSize =
+            std::max(0, base::GetIntProperty(PROPERTY_TEXT_LAYOUT_CACHE_SIZE, 1024));
 
     filterOutTestOverhead = base::GetBoolProperty(PROPERTY_FILTER_TEST_OVERHEAD, false);
 
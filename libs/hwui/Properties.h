@@ -123,6 +123,58 @@ enum DebugLevel {
  */
 #define PROPERTY_ENABLE_PARTIAL_UPDATES "debug.hwui.use_partial_updates"
 
+/**
+ * Maximum number of disjoint rects the damage of a frame is tracked as.
+ * Rendering is clipped to those rects rather than to their bounds.
+ * Setting this to "1" restores a single bounding damage rect.
+ * Default is "4"
+ */
+#define PROPERTY_MAX_DAMAGE_RECTS "debug.hwui.max_damage_rects"
+
+/**
+ * Setting this to "false" makes VectorDrawable caches repaint on RenderThread while drawing,
+ * instead of on worker threads while the rest of the frame is being prepared.
+ * Default is "true"
+ */
+#define PROPERTY_PRERASTERIZE_VECTOR_DRAWABLES "debug.hwui.prerasterize_vector_drawables"
+
+/**
+ * Maximum number of threads a single Bitmap.compress() may use to encode a large bitmap as
+ * JPEG or PNG, counting the calling thread and the threads of CommonPool. Setting this to "1"
+ * encodes every bitmap on the calling thread with Skia.
+ * Default is "3"
+ */
+#define PROPERTY_COMPRESS_THREADS "debug.hwui.compress_threads"
+
+/**
+ * Size in MB of the cache of decoded tiles shared by every BitmapRegionDecoder of the process,
+ * split evenly between the live decoders. Setting this to "0" decodes every region directly
+ * from the encoded image, without tiles.
+ * Default is "24"
+ */
+#define PROPERTY_REGION_TILE_CACHE_SIZE "debug.hwui.region_tile_cache_size"
+
+/**
+ * Maximum number of frames an AnimatedImageDrawable decodes ahead of the one on screen. Setting
+ * this to "1" only decodes the next frame, once the current one is shown.
+ * Default is "3"
+ */
+#define PROPERTY_ANIMATED_IMAGE_LOOKAHEAD "debug.hwui.animated_image_lookahead"
+
+/**
+ * Size in MB of the frames all AnimatedImageDrawables may have decoded ahead, past the next frame
+ * of each drawable.
+ * Default is "32"
+ */
+#define PROPERTY_ANIMATED_IMAGE_CACHE_SIZE "debug.hwui.animated_image_cache_size"
+
+/**
+ * Size in KB of the layouts of shaped text runs shared by text measurement and drawing. Setting
+ * this to "0" shapes text again every time it is measured or drawn.
+ * Default is "1024"
+ */
+#define PROPERTY_TEXT_LAYOUT_CACHE_SIZE "debug.hwui.text_layout_cache_size"
+
 #define PROPERTY_FILTER_TEST_OVERHEAD "debug.hwui.filter_test_overhead"
 
 /**
@@ -195,6 +247,13 @@ public:
     static bool skipEmptyFrames;
     static bool useBufferAge;
     static bool enablePartialUpdates;
+    static int maxDamageRects;
+    static bool prerasterizeVectorDrawables;
+    static int compressThreads;
+    static int regionTileCacheSize;
+    static int animatedImageLookahead;
+    static int animatedImageCacheSize;
+    static int textLayoutCacheSize;
 
     // TODO: Move somewhere else?
     static constexpr float textGamma = 1.45f;
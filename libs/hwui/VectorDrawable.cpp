@@ -30,16 +30,92 @@
 #include "renderthread/RenderThread.h"
 #endif
 
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+#include "thread/CommonPool.h"
+#endif
+
+#include "Properties.h"
 #include "utils/Macros.h"
 #include "utils/TraceUtils.h"
 #include "utils/VectorDrawableUtils.h"
 
+#include <condition_variable>
+
 namespace android {
 namespace uirenderer {
 namespace VectorDrawable {
 
 const int Tree::MAX_CACHED_BITMAP_SIZE = 2048;
 
+// Enough for a couple hundred typical icons
+static constexpr size_t SHARED_CACHE_MAX_BYTES = 4 * 1024 * 1024;
+static constexpr size_t SHARED_CACHE_MAX_RECYCLED_BYTES = 1024 * 1024;
+
+// 64 bit FNV-1a, used to identify trees that paint identical caches
+static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+static uint64_t hashValue(uint64_t hash, const T& value) {
+    return hashBytes(hash, &value, sizeof(T));
+}
+
+template <typename T>
+static uint64_t hashVector(uint64_t hash, const std::vector<T>& values) {
+    hash = hashValue(hash, values.size());
+    return hashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+// A repaint started by Tree::prerasterizeAsync. It is run by whichever of the pool and a thread
+// joining it claims it first, so that RT never waits on a repaint still queued behind other work
+// on CommonPool.
+struct Tree::PendingRepaint {
+    enum class State { Queued, Running, Done };
+
+    explicit PendingRepaint(std::function<void()>&& task) : paint(std::move(task)) {}
+
+    // Runs the repaint on the calling thread, unless it has already been claimed
+    void run() {
+        {
+            std::lock_guard lock(mutex);
+            if (state != State::Queued) {
+                return;
+            }
+            state = State::Running;
+        }
+        paint();
+        // Drops the bitmap and the tree the repaint holds
+        paint = nullptr;
+        {
+            std::lock_guard lock(mutex);
+            state = State::Done;
+        }
+        condition.notify_all();
+    }
+
+    void join() {
+        run();
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this] { return state == State::Done; });
+    }
+
+    std::function<void()> paint;
+    std::mutex mutex;
+    std::condition_variable condition;
+    State state = State::Queued;
+};
+
+// Repaints started by Tree::prerasterizeAsync since the last Tree::waitForPrerasterization
+static std::mutex sRepaintLock;
+static std::vector<std::shared_ptr<Tree::PendingRepaint>> sPendingRepaints;
+
 void Path::dump() {
     ALOGD("Path: %s has %zu points", mName.c_str(), mProperties.getData().points.size());
 }
@@ -71,6 +147,13 @@ const SkPath& Path::getUpdatedPath(bool useStagingData, SkPath* tempStagingPath)
     }
 }
 
+uint64_t Path::hashContent(uint64_t seed) const {
+    const Data& data = mProperties.getData();
+    seed = hashVector(seed, data.verbs);
+    seed = hashVector(seed, data.verbSizes);
+    return hashVector(seed, data.points);
+}
+
 void Path::syncProperties() {
     if (mStagingPropertiesDirty) {
         mProperties.syncProperties(mStagingProperties);
@@ -196,6 +279,18 @@ void FullPath::draw(SkCanvas* outCanvas, bool useStagingData) {
     }
 }
 
+uint64_t FullPath::hashContent(uint64_t seed) const {
+    seed = hashValue(seed, 'F');
+    FullPathProperties::PrimitiveFields fields;
+    mProperties.copyProperties(reinterpret_cast<int8_t*>(&fields), sizeof(fields));
+    seed = hashValue(seed, fields);
+    // Gradients can only be matched by identity
+    seed = hashValue(seed, mProperties.getFillGradient());
+    seed = hashValue(seed, mProperties.getStrokeGradient());
+    seed = hashValue(seed, mAntiAlias);
+    return Path::hashContent(seed);
+}
+
 void FullPath::syncProperties() {
     Path::syncProperties();
 
@@ -272,6 +367,10 @@ void ClipPath::draw(SkCanvas* outCanvas, bool useStagingData) {
     outCanvas->clipPath(getUpdatedPath(useStagingData, &tempStagingPath));
 }
 
+uint64_t ClipPath::hashContent(uint64_t seed) const {
+    return Path::hashContent(hashValue(seed, 'C'));
+}
+
 Group::Group(const Group& group) : Node(group) {
     mStagingProperties.syncProperties(group.mStagingProperties);
 }
@@ -291,6 +390,16 @@ void Group::draw(SkCanvas* outCanvas, bool useStagingData) {
     // Restore the previous clip and matrix information.
 }
 
+uint64_t Group::hashContent(uint64_t seed) const {
+    seed = hashValue(seed, 'G');
+    seed = hashValue(seed, mProperties.mPrimitiveFields);
+    seed = hashValue(seed, mChildren.size());
+    for (auto& child : mChildren) {
+        seed = child->hashContent(seed);
+    }
+    return seed;
+}
+
 void Group::dump() {
     ALOGD("Group %s has %zu children: ", mName.c_str(), mChildren.size());
     ALOGD("Group translateX, Y : %f, %f, scaleX, Y: %f, %f", mProperties.getTranslateX(),
@@ -486,15 +595,113 @@ void Tree::getPaintFor(SkPaint* outPaint, const TreeProperties& prop) const {
 }
 
 Bitmap& Tree::getBitmapUpdateIfDirty() {
-    bool redrawNeeded = allocateBitmapIfNeeded(mCache, mProperties.getScaledWidth(),
-                                               mProperties.getScaledHeight());
-    if (redrawNeeded || mCache.dirty) {
+    waitForRepaint();
+    SharedBitmapCache::Key publishKey{};
+    if (prepareCacheForRepaint(&publishKey)) {
         updateBitmapCache(*mCache.bitmap, false);
-        mCache.dirty = false;
+        if (mCache.shared) {
+            SharedBitmapCache::get().put(publishKey, mCache.bitmap);
+        }
     }
     return *mCache.bitmap;
 }
 
+void Tree::prerasterizeAsync() {
+    if (mPendingRepaint || mProperties.getScaledWidth() <= 0 ||
+        mProperties.getScaledHeight() <= 0) {
+        return;
+    }
+    SharedBitmapCache::Key publishKey{};
+    if (!prepareCacheForRepaint(&publishKey)) {
+        return;
+    }
+    // The tree outlives the repaint, as it is joined by the destructor
+    auto repaint = std::make_shared<PendingRepaint>(
+            [this, bitmap = mCache.bitmap, publish = mCache.shared, publishKey]() mutable {
+                updateBitmapCache(*bitmap, false);
+                if (publish) {
+                    SharedBitmapCache::get().put(publishKey, std::move(bitmap));
+                }
+            });
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+    {
+        std::lock_guard lock(sRepaintLock);
+        sPendingRepaints.push_back(repaint);
+    }
+    mPendingRepaint = repaint;
+    CommonPool::post([repaint] { repaint->run(); });
+#else
+    repaint->run();
+#endif
+}
+
+void Tree::waitForPrerasterization() {
+    std::vector<std::shared_ptr<PendingRepaint>> repaints;
+    {
+        std::lock_guard lock(sRepaintLock);
+        repaints.swap(sPendingRepaints);
+    }
+    if (repaints.empty()) {
+        return;
+    }
+    ATRACE_NAME("waitForVectorDrawablePrerasterization");
+    // Repaints that the pool hasn't started yet are run here rather than waited on
+    for (auto& repaint : repaints) {
+        repaint->join();
+    }
+}
+
+void Tree::waitForRepaint() {
+    if (mPendingRepaint) {
+        mPendingRepaint->join();
+        mPendingRepaint = nullptr;
+    }
+}
+
+// Points mCache.bitmap at the bitmap to draw for the current properties. Returns true if it still
+// needs to be painted, in which case outPublishKey is set if the result is to be shared once
+// painted. Only trees that are painted at a new size are shared, as trees that are repainted
+// because their properties changed are likely animating and won't match any other.
+bool Tree::prepareCacheForRepaint(SharedBitmapCache::Key* outPublishKey) {
+    int width = mProperties.getScaledWidth();
+    int height = mProperties.getScaledHeight();
+    bool resized = !canReuseBitmap(mCache.bitmap.get(), width, height);
+    if (!resized && !mCache.dirty) {
+        return false;
+    }
+    mCache.dirty = false;
+
+    SharedBitmapCache& sharedCache = SharedBitmapCache::get();
+    if (!resized) {
+        if (mCache.shared) {
+            // Don't paint over a bitmap other trees may be drawing
+            mCache.bitmap = sharedCache.obtain(mCache.bitmap->width(), mCache.bitmap->height());
+            mCache.shared = false;
+        }
+        return true;
+    }
+
+    if (!mCache.shared && mCache.bitmap) {
+        sharedCache.recycle(std::move(mCache.bitmap));
+    }
+    mCache.shared = false;
+    if (width <= 0 || height <= 0) {
+        allocateBitmapIfNeeded(mCache, width, height);
+        return true;
+    }
+    *outPublishKey = {mRootNode->hashContent(hashValue(hashValue(HASH_SEED,
+                                                                 mProperties.getViewportWidth()),
+                                                       mProperties.getViewportHeight())),
+                      width, height};
+    mCache.bitmap = sharedCache.find(*outPublishKey);
+    mCache.shared = true;
+    if (mCache.bitmap) {
+        return false;
+    }
+    mCache.bitmap = sharedCache.obtain(width, height);
+    return true;
+}
+
 void Tree::draw(SkCanvas* canvas, const SkRect& bounds, const SkPaint& inPaint) {
     if (canvas->quickReject(bounds)) {
         // The RenderNode is on screen, but the AVD is not.
@@ -546,6 +753,99 @@ bool Tree::canReuseBitmap(Bitmap* bitmap, int width, int height) {
     return bitmap && width <= bitmap->width() && height <= bitmap->height();
 }
 
+SharedBitmapCache& SharedBitmapCache::get() {
+    static SharedBitmapCache* sInstance =
+            new SharedBitmapCache(SHARED_CACHE_MAX_BYTES, SHARED_CACHE_MAX_RECYCLED_BYTES);
+    return *sInstance;
+}
+
+size_t SharedBitmapCache::KeyHash::operator()(const Key& key) const {
+    return hashValue(hashValue(key.contentHash, key.width), key.height);
+}
+
+static uint64_t packSize(int width, int height) {
+    return (static_cast<uint64_t>(width) << 32) | static_cast<uint32_t>(height);
+}
+
+sk_sp<Bitmap> SharedBitmapCache::find(const Key& key) {
+    std::lock_guard lock(mLock);
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        mStats.misses++;
+        return nullptr;
+    }
+    mStats.hits++;
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return it->second->second;
+}
+
+void SharedBitmapCache::put(const Key& key, sk_sp<Bitmap> bitmap) {
+    std::lock_guard lock(mLock);
+    size_t size = bitmap->getAllocationByteCount();
+    if (mIndex.count(key) || size > mMaxCachedBytes) {
+        // Painted concurrently by another tree with the same content, or too big to share
+        return;
+    }
+    mEntries.emplace_front(key, std::move(bitmap));
+    mIndex[key] = mEntries.begin();
+    mStats.cachedBytes += size;
+    while (mStats.cachedBytes > mMaxCachedBytes) {
+        Entry& oldest = mEntries.back();
+        mStats.cachedBytes -= oldest.second->getAllocationByteCount();
+        mStats.evictions++;
+        mIndex.erase(oldest.first);
+        recycleLocked(std::move(oldest.second));
+        mEntries.pop_back();
+    }
+}
+
+sk_sp<Bitmap> SharedBitmapCache::obtain(int width, int height) {
+    {
+        std::lock_guard lock(mLock);
+        auto it = mRecycled.find(packSize(width, height));
+        if (it != mRecycled.end() && !it->second.empty()) {
+            sk_sp<Bitmap> bitmap = std::move(it->second.back());
+            it->second.pop_back();
+            mStats.recycledBytes -= bitmap->getAllocationByteCount();
+            mStats.recycled++;
+            return bitmap;
+        }
+    }
+    return Bitmap::allocateHeapBitmap(SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType));
+}
+
+void SharedBitmapCache::recycle(sk_sp<Bitmap>&& bitmap) {
+    std::lock_guard lock(mLock);
+    recycleLocked(std::move(bitmap));
+}
+
+void SharedBitmapCache::recycleLocked(sk_sp<Bitmap>&& bitmap) {
+    // Bitmaps still drawn by a tree or a display list can't be reused
+    if (!bitmap || !bitmap->unique()) {
+        return;
+    }
+    size_t size = bitmap->getAllocationByteCount();
+    if (mStats.recycledBytes + size > mMaxRecycledBytes) {
+        return;
+    }
+    mStats.recycledBytes += size;
+    mRecycled[packSize(bitmap->width(), bitmap->height())].push_back(std::move(bitmap));
+}
+
+void SharedBitmapCache::clear() {
+    std::lock_guard lock(mLock);
+    mIndex.clear();
+    mEntries.clear();
+    mRecycled.clear();
+    mStats.cachedBytes = 0;
+    mStats.recycledBytes = 0;
+}
+
+SharedBitmapCache::Stats SharedBitmapCache::stats() const {
+    std::lock_guard lock(mLock);
+    return mStats;
+}
+
 void Tree::onPropertyChanged(TreeProperties* prop) {
     if (prop == &mStagingProperties) {
         mStagingCache.dirty = true;
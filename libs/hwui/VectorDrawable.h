@@ -36,7 +36,11 @@
 
 #include <cutils/compiler.h>
 #include <stddef.h>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -122,6 +126,10 @@ public:
 
     virtual void forEachFillColor(const std::function<void(SkColor)>& func) const { }
 
+    // Mixes the render thread properties of this node and its children into seed. Trees with
+    // equal hashes paint identical bitmap caches. This should only be called from RT.
+    virtual uint64_t hashContent(uint64_t seed) const = 0;
+
 protected:
     std::string mName;
     PropertyChangedListener* mPropertyChangedListener = nullptr;
@@ -187,6 +195,8 @@ public:
     // This should only be called from animations on RT
     PathProperties* mutateProperties() { return &mProperties; }
 
+    uint64_t hashContent(uint64_t seed) const override;
+
 protected:
     virtual const SkPath& getUpdatedPath(bool useStagingData, SkPath* tempStagingPath);
 
@@ -354,6 +364,7 @@ public:
     void forEachFillColor(const std::function<void(SkColor)>& func) const override {
         func(mStagingProperties.getFillColor());
     }
+    uint64_t hashContent(uint64_t seed) const override;
 
 protected:
     const SkPath& getUpdatedPath(bool useStagingData, SkPath* tempStagingPath) override;
@@ -376,6 +387,7 @@ public:
     ClipPath() : Path() {}
     void draw(SkCanvas* outCanvas, bool useStagingData) override;
     virtual void setAntiAlias(bool aa) {}
+    uint64_t hashContent(uint64_t seed) const override;
 };
 
 class ANDROID_API Group : public Node {
@@ -490,6 +502,7 @@ public:
             child->forEachFillColor(func);
         }
     }
+    uint64_t hashContent(uint64_t seed) const override;
 
 private:
     GroupProperties mProperties = GroupProperties(this);
@@ -498,11 +511,91 @@ private:
     std::vector<std::unique_ptr<Node> > mChildren;
 };
 
+/**
+ * Process wide cache of painted trees. Trees with identical content drawn at the same size, such
+ * as an icon repeated in every row of a list, share a single bitmap instead of each painting their
+ * own. Bitmaps evicted from the cache are kept in buckets of their size so that they can be
+ * recycled by the next tree painted at that size.
+ *
+ * Trees are looked up on RT, and published by whichever thread painted them.
+ */
+class ANDROID_API SharedBitmapCache {
+public:
+    struct Key {
+        uint64_t contentHash;
+        int width;
+        int height;
+
+        bool operator==(const Key& other) const {
+            return contentHash == other.contentHash && width == other.width &&
+                   height == other.height;
+        }
+    };
+
+    struct Stats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t evictions = 0;
+        // Bitmaps handed out by "obtain" that were recycled rather than allocated
+        uint32_t recycled = 0;
+        size_t cachedBytes = 0;
+        size_t recycledBytes = 0;
+    };
+
+    SharedBitmapCache(size_t maxCachedBytes, size_t maxRecycledBytes)
+            : mMaxCachedBytes(maxCachedBytes), mMaxRecycledBytes(maxRecycledBytes) {}
+
+    static SharedBitmapCache& get();
+
+    /**
+     * "find" returns the bitmap published for key, or nullptr. The bitmap must not be modified.
+     */
+    sk_sp<Bitmap> find(const Key& key);
+
+    /**
+     * "put" publishes a painted bitmap, which must not be modified afterwards.
+     */
+    void put(const Key& key, sk_sp<Bitmap> bitmap);
+
+    /**
+     * "obtain" returns a bitmap of the given size, recycled if one is available.
+     */
+    sk_sp<Bitmap> obtain(int width, int height);
+
+    /**
+     * "recycle" hands back a bitmap that is no longer used so that "obtain" can reuse it.
+     */
+    void recycle(sk_sp<Bitmap>&& bitmap);
+
+    void clear();
+    Stats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    using Entry = std::pair<Key, sk_sp<Bitmap>>;
+
+    void recycleLocked(sk_sp<Bitmap>&& bitmap);
+
+    const size_t mMaxCachedBytes;
+    const size_t mMaxRecycledBytes;
+
+    mutable std::mutex mLock;
+    // Most recently used first
+    std::list<Entry> mEntries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mIndex;
+    // Unused bitmaps, bucketed by their packed width and height
+    std::unordered_map<uint64_t, std::vector<sk_sp<Bitmap>>> mRecycled;
+    Stats mStats;
+};
+
 class ANDROID_API Tree : public VirtualLightRefBase {
 public:
     explicit Tree(Group* rootNode) : mRootNode(rootNode) {
         mRootNode->setPropertyChangedListener(&mPropertyChangedListener);
     }
+    ~Tree() { waitForRepaint(); }
 
     // Copy properties from the tree and use the give node as the root node
     Tree(const Tree* copy, Group* rootNode) : Tree(rootNode) {
@@ -516,8 +609,26 @@ public:
     void drawStaging(Canvas* canvas);
 
     Bitmap& getBitmapUpdateIfDirty();
+
+    /**
+     * Starts repainting the bitmap cache on a worker thread if it is dirty, so that it overlaps
+     * with the rest of the frame preparation. The repaint is joined before the cache is drawn or
+     * the properties are synced. This should always be called from RT.
+     */
+    void prerasterizeAsync();
+
+    /**
+     * Completes every repaint started by "prerasterizeAsync", running the ones no worker has
+     * started yet on the calling thread. RT animators modify the properties of the nodes directly,
+     * so this is called before they run.
+     */
+    static void waitForPrerasterization();
+
+    struct PendingRepaint;
+
     void setAllowCaching(bool allowCaching) { mAllowCaching = allowCaching; }
     void syncProperties() {
+        waitForRepaint();
         if (mStagingProperties.mNonAnimatablePropertiesDirty) {
             mCache.dirty |= (mProperties.mNonAnimatableProperties.viewportWidth !=
                              mStagingProperties.mNonAnimatableProperties.viewportWidth) ||
@@ -658,11 +769,15 @@ private:
     public:
         sk_sp<Bitmap> bitmap;  // used by HWUI pipeline and software
         bool dirty = true;
+        // Set when bitmap is also held by the SharedBitmapCache, so it must not be painted into
+        bool shared = false;
     };
 
     bool allocateBitmapIfNeeded(Cache& cache, int width, int height);
     bool canReuseBitmap(Bitmap*, int width, int height);
     void updateBitmapCache(Bitmap& outCache, bool useStagingData);
+    bool prepareCacheForRepaint(SharedBitmapCache::Key* outPublishKey);
+    void waitForRepaint();
 
     // Cap the bitmap size, such that it won't hurt the performance too much
     // and it won't crash due to a very large scale.
@@ -677,6 +792,8 @@ private:
 
     Cache mStagingCache;
     Cache mCache;
+    // Repaint of mCache started by "prerasterizeAsync", if any
+    std::shared_ptr<PendingRepaint> mPendingRepaint;
 
     PropertyChangedListener mPropertyChangedListener =
             PropertyChangedListener(&mCache.dirty, &mStagingCache.dirty);
@@ -19,20 +19,42 @@
 #include "AnimatedImageThread.h"
 #endif
 
+#include "Properties.h"
 #include "utils/TraceUtils.h"
 
 #include <SkPicture.h>
 #include <SkRefCnt.h>
 
+#include <algorithm>
+#include <atomic>
 #include <optional>
 
 namespace android {
 
+// Frames past the next one are only decoded ahead until they cover this much time
+static constexpr int kLookaheadMS = 200;
+
+static std::atomic<size_t> sPendingBytes{0};
+static std::atomic<uint32_t> sLateFrames{0};
+static std::atomic<uint32_t> sDroppedFrames{0};
+
+static size_t computeFrameBytes(const SkAnimatedImage& image) {
+    const SkRect bounds = image.getBounds();
+    return static_cast<size_t>(bounds.width()) * static_cast<size_t>(bounds.height()) * 4;
+}
+
 AnimatedImageDrawable::AnimatedImageDrawable(sk_sp<SkAnimatedImage> animatedImage, size_t bytesUsed)
-        : mSkAnimatedImage(std::move(animatedImage)), mBytesUsed(bytesUsed) {
+        : mSkAnimatedImage(std::move(animatedImage))
+        , mBytesUsed(bytesUsed)
+        , mFrameBytes(computeFrameBytes(*mSkAnimatedImage)) {
     mTimeToShowNextSnapshot = ms2ns(mSkAnimatedImage->currentFrameDuration());
 }
 
+AnimatedImageDrawable::~AnimatedImageDrawable() {
+    // AnimatedImageThread holds a reference while decoding, so mFrames is final by now
+    sPendingBytes -= mFrames.size() * mFrameBytes;
+}
+
 void AnimatedImageDrawable::syncProperties() {
     mProperties = mStagingProperties;
 }
@@ -58,9 +80,67 @@ bool AnimatedImageDrawable::isRunning() {
     return mRunning;
 }
 
-bool AnimatedImageDrawable::nextSnapshotReady() const {
-    return mNextSnapshot.valid() &&
-           mNextSnapshot.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+bool AnimatedImageDrawable::shouldDecodeAheadLocked() const {
+    if (mFinalFrameDecoded) {
+        return false;
+    }
+    // The next frame is always decoded, whatever the budget
+    if (mFrames.empty()) {
+        return true;
+    }
+    if (static_cast<int>(mFrames.size()) >= uirenderer::Properties::animatedImageLookahead) {
+        return false;
+    }
+    int aheadMS = 0;
+    for (const Snapshot& frame : mFrames) {
+        aheadMS += frame.mDurationMS;
+    }
+    const size_t budget =
+            static_cast<size_t>(uirenderer::Properties::animatedImageCacheSize) * 1024 * 1024;
+    return aheadMS < kLookaheadMS && sPendingBytes + mFrameBytes <= budget;
+}
+
+void AnimatedImageDrawable::scheduleDecodeLocked() {
+#ifdef __ANDROID__ // Layoutlib does not support AnimatedImageThread
+    if (!mDecoding && shouldDecodeAheadLocked()) {
+        mDecoding = true;
+        uirenderer::AnimatedImageThread::getInstance().decodeAhead(sk_ref_sp(this));
+    }
+#endif
+}
+
+void AnimatedImageDrawable::discardFramesLocked() {
+    const uint32_t dropped = mFrames.size();
+    sPendingBytes -= dropped * mFrameBytes;
+    mFrames.clear();
+    mDroppedFrames += dropped;
+    sDroppedFrames += dropped;
+    mGeneration++;
+    mFinalFrameDecoded = false;
+}
+
+void AnimatedImageDrawable::restartLocked() {
+    discardFramesLocked();
+    mRestartPending = true;
+    mLate = false;
+}
+
+uint32_t AnimatedImageDrawable::getLateFrameCount() {
+    std::unique_lock lock{mSwapLock};
+    return mLateFrames;
+}
+
+uint32_t AnimatedImageDrawable::getDroppedFrameCount() {
+    std::unique_lock lock{mSwapLock};
+    return mDroppedFrames;
+}
+
+AnimatedImageDrawable::FrameStats AnimatedImageDrawable::getFrameStats() {
+    FrameStats stats;
+    stats.pendingBytes = sPendingBytes;
+    stats.lateFrames = sLateFrames;
+    stats.droppedFrames = sDroppedFrames;
+    return stats;
 }
 
 // Only called on the RenderThread while UI thread is locked.
@@ -77,7 +157,7 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
     std::unique_lock lock{mSwapLock};
     mCurrentTime += currentTime - lastWallTime;
 
-    if (!mNextSnapshot.valid()) {
+    if (mFrames.empty() && !mDecoding) {
         // Need to trigger onDraw in order to start decoding the next frame.
         *outDelay = mTimeToShowNextSnapshot - mCurrentTime;
         return true;
@@ -85,12 +165,10 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
 
     if (mTimeToShowNextSnapshot > mCurrentTime) {
         *outDelay = mTimeToShowNextSnapshot - mCurrentTime;
-    } else if (nextSnapshotReady()) {
-        // We have not yet updated mTimeToShowNextSnapshot. Read frame duration
-        // directly from mSkAnimatedImage.
-        lock.unlock();
-        std::unique_lock imageLock{mImageLock};
-        *outDelay = ms2ns(mSkAnimatedImage->currentFrameDuration());
+    } else if (!mFrames.empty()) {
+        // We have not yet updated mTimeToShowNextSnapshot. The next frame will
+        // be shown for its own duration.
+        *outDelay = ms2ns(std::max(0, mFrames.front().mDurationMS));
         return true;
     } else {
         // The next snapshot has not yet been decoded, but we've already passed
@@ -127,6 +205,40 @@ AnimatedImageDrawable::Snapshot AnimatedImageDrawable::reset() {
     return snap;
 }
 
+// Only called on the AnimatedImageThread.
+bool AnimatedImageDrawable::decodeAhead() {
+    ATRACE_NAME("AnimatedImageDrawable::decodeAhead");
+    int generation;
+    bool restart;
+    {
+        std::unique_lock lock{mSwapLock};
+        generation = mGeneration;
+        restart = mRestartPending;
+    }
+
+    Snapshot snap = restart ? reset() : decodeNextFrame();
+
+    std::unique_lock lock{mSwapLock};
+    if (generation != mGeneration) {
+        // Restarted while decoding, so the next frame to decode is the first one again.
+        mDroppedFrames++;
+        sDroppedFrames++;
+    } else {
+        if (restart) {
+            mRestartPending = false;
+        }
+        mFinalFrameDecoded = snap.mDurationMS == SkAnimatedImage::kFinished;
+        mFrames.push_back(std::move(snap));
+        sPendingBytes += mFrameBytes;
+    }
+
+    if (shouldDecodeAheadLocked()) {
+        return true;
+    }
+    mDecoding = false;
+    return false;
+}
+
 // Only called on the RenderThread.
 void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     std::optional<SkPaint> lazyPaint;
@@ -146,8 +258,7 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     const bool starting = mStarting;
     mStarting = false;
 
-    const bool drawDirectly = !mSnapshot.mPic;
-    if (drawDirectly) {
+    if (!mSnapshot.mPic && !mRunning) {
         // The image is not animating, and never was. Draw directly from
         // mSkAnimatedImage.
         if (lazyPaint) {
@@ -156,23 +267,32 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
 
         std::unique_lock lock{mImageLock};
         mSkAnimatedImage->draw(canvas);
-        if (!mRunning) {
-            return;
-        }
+        return;
+    }
+
+    if (!mSnapshot.mPic) {
+        // The image is animating for the first time. Decoding ahead advances
+        // mSkAnimatedImage past the frame on screen, so the current frame is
+        // drawn from a snapshot taken before any frame is decoded ahead.
+        std::unique_lock lock{mImageLock};
+        mSnapshot.mPic.reset(mSkAnimatedImage->newPictureSnapshot());
+        mSnapshot.mDurationMS = mSkAnimatedImage->currentFrameDuration();
     } else if (starting) {
-        // The image has animated, and now is being reset. Queue up the first
-        // frame, but keep showing the current frame until the first is ready.
-#ifdef __ANDROID__ // Layoutlib does not support AnimatedImageThread
-        auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.reset(sk_ref_sp(this));
-#endif
+        // The image has animated, and now is being reset. Drop the frames
+        // decoded ahead and queue up the first frame, but keep showing the
+        // current frame until the first is ready.
+        std::unique_lock lock{mSwapLock};
+        restartLocked();
     }
 
     bool finalFrame = false;
-    if (mRunning && nextSnapshotReady()) {
+    if (mRunning) {
         std::unique_lock lock{mSwapLock};
-        if (mCurrentTime >= mTimeToShowNextSnapshot) {
-            mSnapshot = mNextSnapshot.get();
+        if (mCurrentTime >= mTimeToShowNextSnapshot && !mFrames.empty()) {
+            mSnapshot = std::move(mFrames.front());
+            mFrames.pop_front();
+            sPendingBytes -= mFrameBytes;
+            mLate = false;
             const nsecs_t timeToShowCurrentSnap = mTimeToShowNextSnapshot;
             if (mSnapshot.mDurationMS == SkAnimatedImage::kFinished) {
                 finalFrame = true;
@@ -187,21 +307,22 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
                     mCurrentTime = timeToShowCurrentSnap;
                 }
             }
+        } else if (mCurrentTime >= mTimeToShowNextSnapshot && !mLate) {
+            // The next frame was not decoded in time, and will be shown late.
+            mLate = true;
+            mLateFrames++;
+            sLateFrames++;
         }
-    }
 
-    if (mRunning && !mNextSnapshot.valid()) {
-#ifdef __ANDROID__ // Layoutlib does not support AnimatedImageThread
-        auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.decodeNextFrame(sk_ref_sp(this));
-#endif
+        if (mRunning) {
+            // Top up the frames decoded ahead.
+            scheduleDecodeLocked();
+        }
     }
 
-    if (!drawDirectly) {
-        // No other thread will modify mCurrentSnap so this should be safe to
-        // use without locking.
-        canvas->drawPicture(mSnapshot.mPic, nullptr, lazyPaint ? &*lazyPaint : nullptr);
-    }
+    // No other thread will modify mSnapshot so this should be safe to use
+    // without locking.
+    canvas->drawPicture(mSnapshot.mPic, nullptr, lazyPaint ? &*lazyPaint : nullptr);
 
     if (finalFrame) {
         if (mEndListener) {
@@ -242,6 +363,7 @@ int AnimatedImageDrawable::drawStaging(SkCanvas* canvas) {
         }
         {
             std::unique_lock lock{mSwapLock};
+            discardFramesLocked();
             mLastWallTime = 0;
             // The current time will be added later, below.
             mTimeToShowNextSnapshot = ms2ns(durationMS);
@@ -278,6 +400,9 @@ int AnimatedImageDrawable::drawStaging(SkCanvas* canvas) {
 
     std::unique_lock lock{mSwapLock};
     if (update) {
+        // The frames decoded ahead for onDraw no longer follow the frame of
+        // mSkAnimatedImage, so decoding ahead resumes from it.
+        discardFramesLocked();
         if (durationMS == SkAnimatedImage::kFinished) {
             mRunning = false;
             return SkAnimatedImage::kFinished;
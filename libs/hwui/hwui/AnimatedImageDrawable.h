@@ -27,7 +27,7 @@
 #include <SkDrawable.h>
 #include <SkPicture.h>
 
-#include <future>
+#include <deque>
 #include <mutex>
 
 namespace android {
@@ -49,6 +49,7 @@ public:
     // bytesUsed includes the approximate sizes of the SkAnimatedImage and the SkPictures in the
     // Snapshots.
     AnimatedImageDrawable(sk_sp<SkAnimatedImage> animatedImage, size_t bytesUsed);
+    ~AnimatedImageDrawable();
 
     /**
      * This updates the internal time and returns true if the image needs
@@ -106,6 +107,31 @@ public:
     Snapshot decodeNextFrame();
     Snapshot reset();
 
+    /**
+     * Decodes the frame after the last one decoded ahead, or the first frame if the animation
+     * was restarted. Returns true if another frame should be decoded ahead.
+     *
+     * Only called on AnimatedImageThread, one call at a time.
+     */
+    bool decodeAhead();
+
+    // Frames shown after their time because they were not decoded yet
+    uint32_t getLateFrameCount();
+    // Frames decoded ahead but never shown, because the animation was restarted
+    uint32_t getDroppedFrameCount();
+
+    struct FrameStats {
+        // Size of the frames decoded ahead by all drawables
+        size_t pendingBytes = 0;
+        uint32_t lateFrames = 0;
+        uint32_t droppedFrames = 0;
+    };
+
+    // Totals of every drawable in the process
+    static FrameStats getFrameStats();
+
+    // Doesn't include the frames decoded ahead, which are charged to a budget shared by all
+    // drawables instead.
     size_t byteSize() const { return sizeof(*this) + mBytesUsed; }
 
 protected:
@@ -121,11 +147,38 @@ private:
     // A snapshot of the current frame to draw.
     Snapshot mSnapshot;
 
-    std::future<Snapshot> mNextSnapshot;
+    // The frames decoded ahead of mSnapshot, in the order they are shown. Their sizes are
+    // charged to the budget of Properties::animatedImageCacheSize.
+    std::deque<Snapshot> mFrames;
+
+    // Approximate size of each of mFrames.
+    const size_t mFrameBytes;
+
+    // Whether decodeAhead is queued or running on AnimatedImageThread.
+    bool mDecoding = false;
+
+    // Whether the next frame to decode is the first one, because the animation was restarted.
+    bool mRestartPending = false;
+
+    // Incremented on restart, so the frame being decoded at the time is dropped.
+    int mGeneration = 0;
+
+    // Whether the last frame of the animation is in mFrames.
+    bool mFinalFrameDecoded = false;
+
+    // Whether the frame due at mTimeToShowNextSnapshot was counted as late already.
+    bool mLate = false;
+
+    uint32_t mLateFrames = 0;
+    uint32_t mDroppedFrames = 0;
 
-    bool nextSnapshotReady() const;
+    bool shouldDecodeAheadLocked() const;
+    void scheduleDecodeLocked();
+    // Drops the frames decoded ahead, and the one being decoded, if any.
+    void discardFramesLocked();
+    void restartLocked();
 
-    // When to switch from mSnapshot to mNextSnapshot.
+    // When to switch from mSnapshot to the first of mFrames.
     nsecs_t mTimeToShowNextSnapshot = 0;
 
     // The current time for the drawable itself.
@@ -134,8 +187,8 @@ private:
     // The wall clock of the last time we called isDirty.
     nsecs_t mLastWallTime = 0;
 
-    // Locked when assigning snapshots and times. Operations while this is held
-    // should be short.
+    // Locked when assigning snapshots, mFrames and times. Operations while this
+    // is held should be short.
     std::mutex mSwapLock;
 
     // Locked when mSkAnimatedImage is being updated or drawn.
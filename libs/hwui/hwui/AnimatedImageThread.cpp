@@ -18,27 +18,49 @@
 
 #include <sys/resource.h>
 
+#include <array>
+
 namespace android {
 namespace uirenderer {
 
+class AnimatedImageThread::DecoderThread : public ThreadBase {
+public:
+    explicit DecoderThread(int index) {
+        std::array<char, 20> name{"AnimatedImageThread"};
+        // The first thread keeps the name it had when there was only one
+        if (index > 0) {
+            snprintf(name.data(), name.size(), "AnimatedImage%d", index);
+        }
+        start(name.data());
+    }
+
+protected:
+    virtual bool threadLoop() override {
+        setpriority(PRIO_PROCESS, 0, PRIORITY_NORMAL + PRIORITY_MORE_FAVORABLE);
+        return ThreadBase::threadLoop();
+    }
+};
+
 AnimatedImageThread& AnimatedImageThread::getInstance() {
     static AnimatedImageThread* sInstance = new AnimatedImageThread();
     return *sInstance;
 }
 
 AnimatedImageThread::AnimatedImageThread() {
-    setpriority(PRIO_PROCESS, 0, PRIORITY_NORMAL + PRIORITY_MORE_FAVORABLE);
-    start("AnimatedImageThread");
-}
-
-std::future<AnimatedImageDrawable::Snapshot> AnimatedImageThread::decodeNextFrame(
-        const sk_sp<AnimatedImageDrawable>& drawable) {
-    return queue().async([drawable]() { return drawable->decodeNextFrame(); });
+    for (int i = 0; i < kThreadCount; i++) {
+        mThreads.push_back(new DecoderThread(i));
+    }
 }
 
-std::future<AnimatedImageDrawable::Snapshot> AnimatedImageThread::reset(
-        const sk_sp<AnimatedImageDrawable>& drawable) {
-    return queue().async([drawable]() { return drawable->reset(); });
+void AnimatedImageThread::decodeAhead(const sk_sp<AnimatedImageDrawable>& drawable) {
+    // A drawable only has one call queued or running at a time, so its frames are decoded in
+    // order whichever threads they end up on
+    DecoderThread* thread = mThreads[mNextThread++ % kThreadCount].get();
+    thread->queue().post([this, drawable]() {
+        if (drawable->decodeAhead()) {
+            decodeAhead(drawable);
+        }
+    });
 }
 
 }  // namespace uirenderer
@@ -22,22 +22,39 @@
 
 #include <SkRefCnt.h>
 
+#include <atomic>
+#include <vector>
+
 namespace android {
 
 namespace uirenderer {
 
-class AnimatedImageThread : private ThreadBase {
+/**
+ * A small pool of threads decoding the frames of all the AnimatedImageDrawables of the process
+ * ahead of time, so that the frames of one drawable don't wait behind the ones of all the
+ * others.
+ */
+class AnimatedImageThread {
     PREVENT_COPY_AND_ASSIGN(AnimatedImageThread);
 
 public:
+    static constexpr int kThreadCount = 3;
+
     static AnimatedImageThread& getInstance();
 
-    std::future<AnimatedImageDrawable::Snapshot> decodeNextFrame(
-            const sk_sp<AnimatedImageDrawable>&);
-    std::future<AnimatedImageDrawable::Snapshot> reset(const sk_sp<AnimatedImageDrawable>&);
+    /**
+     * Calls drawable->decodeAhead() on one of the threads, and again for as long as it returns
+     * true. Each call is queued behind the other drawables' so they take turns.
+     */
+    void decodeAhead(const sk_sp<AnimatedImageDrawable>& drawable);
 
 private:
+    class DecoderThread;
+
     AnimatedImageThread();
+
+    std::vector<sp<DecoderThread>> mThreads;
+    std::atomic<uint32_t> mNextThread{0};
 };
 
 }  // namespace uirenderer
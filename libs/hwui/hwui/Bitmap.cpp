@@ -16,6 +16,7 @@
 #include "Bitmap.h"
 
 #include "HardwareBitmapUploader.h"
+#include "ParallelEncoder.h"
 #include "Properties.h"
 #ifdef __ANDROID__  // Layoutlib does not support render thread
 #include "renderthread/RenderProxy.h"
@@ -509,6 +510,9 @@ bool Bitmap::compress(const SkBitmap& bitmap, JavaCompressFormat format,
         }
     }
 
+    if (ParallelEncoder::canEncode(bitmap.pixmap(), fm)) {
+        return ParallelEncoder::encode(stream, bitmap.pixmap(), fm, quality);
+    }
     return SkEncodeImage(stream, bitmap, fm, quality);
 }
 }  // namespace android
@@ -151,21 +151,29 @@ void Canvas::drawText(const uint16_t* text, int textSize, int start, int count,
         paint.getSkFont().setHinting(SkFontHinting::kNone);
     }
 
-    minikin::Layout layout = MinikinUtils::doLayout(&paint, bidiFlags, typeface, text, textSize,
-                                                    start, count, contextStart, contextCount, mt);
-
-    x += MinikinUtils::xOffsetForTextAlign(&paint, layout);
-
-    minikin::MinikinRect bounds;
-    layout.getBounds(&bounds);
-
-    // Set align to left for drawing, as we don't want individual
-    // glyphs centered or right-aligned; the offset above takes
-    // care of all alignment.
-    paint.setTextAlign(Paint::kLeft_Align);
-
-    DrawTextFunctor f(layout, this, paint, x, y, bounds, layout.getAdvance());
-    MinikinUtils::forFontRun(layout, &paint, f);
+    auto drawLayout = [&](const minikin::Layout& layout) {
+        x += MinikinUtils::xOffsetForTextAlign(&paint, layout);
+
+        minikin::MinikinRect bounds;
+        layout.getBounds(&bounds);
+
+        // Set align to left for drawing, as we don't want individual
+        // glyphs centered or right-aligned; the offset above takes
+        // care of all alignment.
+        paint.setTextAlign(Paint::kLeft_Align);
+
+        DrawTextFunctor f(layout, this, paint, x, y, bounds, layout.getAdvance());
+        MinikinUtils::forFontRun(layout, &paint, f);
+    };
+
+    if (mt == nullptr) {
+        // Usually measured just before, or drawn in the previous frame
+        drawLayout(*MinikinUtils::getCachedLayout(&paint, bidiFlags, typeface, text, textSize,
+                                                  start, count, contextStart, contextCount));
+    } else {
+        drawLayout(MinikinUtils::doLayout(&paint, bidiFlags, typeface, text, textSize, start,
+                                          count, contextStart, contextCount, mt));
+    }
 }
 
 void Canvas::drawDoubleRoundRectXY(float outerLeft, float outerTop, float outerRight,
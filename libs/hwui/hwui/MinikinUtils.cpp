@@ -22,7 +22,9 @@
 
 #include <minikin/MeasuredText.h>
 #include "Paint.h"
+#include "Properties.h"
 #include "SkPathMeasure.h"
+#include "TextLayoutCache.h"
 #include "Typeface.h"
 
 namespace android {
@@ -69,17 +71,44 @@ minikin::Layout MinikinUtils::doLayout(const Paint* paint, minikin::Bidi bidiFla
     }
 }
 
-float MinikinUtils::measureText(const Paint* paint, minikin::Bidi bidiFlags,
-                                const Typeface* typeface, const uint16_t* buf, size_t start,
-                                size_t count, size_t bufSize, float* advances) {
+std::shared_ptr<const minikin::Layout> MinikinUtils::getCachedLayout(
+        const Paint* paint, minikin::Bidi bidiFlags, const Typeface* typeface, const uint16_t* buf,
+        size_t bufSize, size_t start, size_t count, size_t contextStart, size_t contextCount) {
     minikin::MinikinPaint minikinPaint = prepareMinikinPaint(paint, typeface);
+
     const minikin::U16StringPiece textBuf(buf, bufSize);
     const minikin::Range range(start, start + count);
-    const minikin::StartHyphenEdit startHyphen = paint->getStartHyphenEdit();
-    const minikin::EndHyphenEdit endHyphen = paint->getEndHyphenEdit();
+    const minikin::Range contextRange(contextStart, contextStart + contextCount);
+
+    return TextLayoutCache::getInstance().getLayout(
+            textBuf.substr(contextRange), range - contextStart, bidiFlags, minikinPaint,
+            paint->getStartHyphenEdit(), paint->getEndHyphenEdit());
+}
+
+float MinikinUtils::measureText(const Paint* paint, minikin::Bidi bidiFlags,
+                                const Typeface* typeface, const uint16_t* buf, size_t start,
+                                size_t count, size_t bufSize, float* advances) {
+    if (bufSize > TextLayoutCache::kMaxContextLength ||
+        uirenderer::Properties::textLayoutCacheSize == 0) {
+        minikin::MinikinPaint minikinPaint = prepareMinikinPaint(paint, typeface);
+        const minikin::U16StringPiece textBuf(buf, bufSize);
+        const minikin::Range range(start, start + count);
+        const minikin::StartHyphenEdit startHyphen = paint->getStartHyphenEdit();
+        const minikin::EndHyphenEdit endHyphen = paint->getEndHyphenEdit();
+
+        return minikin::Layout::measureText(textBuf, range, bidiFlags, minikinPaint, startHyphen,
+                                            endHyphen, advances);
+    }
 
-    return minikin::Layout::measureText(textBuf, range, bidiFlags, minikinPaint, startHyphen,
-                                        endHyphen, advances);
+    // Shapes the whole run rather than only measuring it, so that drawing it next is a cache hit
+    std::shared_ptr<const minikin::Layout> layout = getCachedLayout(
+            paint, bidiFlags, typeface, buf, bufSize, start, count, 0, bufSize);
+    if (advances) {
+        for (size_t i = 0; i < count; i++) {
+            advances[i] = layout->getCharAdvance(i);
+        }
+    }
+    return layout->getAdvance();
 }
 
 bool MinikinUtils::hasVariationSelector(const Typeface* typeface, uint32_t codepoint, uint32_t vs) {
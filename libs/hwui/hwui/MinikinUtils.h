@@ -31,6 +31,8 @@
 #include "Paint.h"
 #include "Typeface.h"
 
+#include <memory>
+
 namespace minikin {
 class MeasuredText;
 }  // namespace minikin
@@ -48,6 +50,13 @@ public:
                                                 size_t contextStart, size_t contextCount,
                                                 minikin::MeasuredText* mt);
 
+    // Like doLayout without a MeasuredText, but the layout is shared with the other measurements
+    // and draws of the same text through TextLayoutCache
+    ANDROID_API static std::shared_ptr<const minikin::Layout> getCachedLayout(
+            const Paint* paint, minikin::Bidi bidiFlags, const Typeface* typeface,
+            const uint16_t* buf, size_t bufSize, size_t start, size_t count, size_t contextStart,
+            size_t contextCount);
+
     ANDROID_API static float measureText(const Paint* paint, minikin::Bidi bidiFlags,
                                          const Typeface* typeface, const uint16_t* buf,
                                          size_t start, size_t count, size_t bufSize,
@@ -0,0 +1,629 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ParallelEncoder.h"
+
+#include "Properties.h"
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+#include "thread/CommonPool.h"
+#endif
+
+#include <SkColorSpace.h>
+#include <SkData.h>
+#include <SkICC.h>
+#include <SkStream.h>
+#include <SkUnPreMultiply.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C" {
+    #include "jpeglib.h"
+}
+
+namespace android {
+
+// Strips per thread of the budget, so threads that finish early can pick up more work
+static constexpr int kStripsPerThread = 2;
+// Minimum height of a JPEG strip in MCUs, and of a PNG strip in rows
+static constexpr int kMinJpegStripMcuRows = 4;
+static constexpr int kMinPngStripRows = 64;
+// Size of the deflate window, i.e. of the dictionary of a PNG strip
+static constexpr size_t kDeflateWindowSize = 1 << MAX_WBITS;
+// zlib level used by libpng, and therefore by SkPngEncoder, by default
+static constexpr int kPngCompressionLevel = 6;
+
+static int divideRoundingUp(int value, int divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+static void encodeStrips(int stripCount, int threadBudget, const std::function<void(int)>& task) {
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+    uirenderer::CommonPool::parallelFor(stripCount, threadBudget, task);
+#else
+    for (int i = 0; i < stripCount; i++) {
+        task(i);
+    }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// JPEG
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct JpegStrip {
+    std::vector<uint8_t> data;
+    // Offset of the entropy coded data, right after the SOS segment
+    size_t scanOffset = 0;
+    // Offset of the SOF marker
+    size_t frameOffset = 0;
+    int mcuRows = 0;
+    bool encoded = false;
+};
+
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jmp;
+};
+
+struct JpegStripDestination {
+    jpeg_destination_mgr pub;
+    std::vector<uint8_t>* buffer;
+};
+
+}  // namespace
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+    JpegErrorManager* errorManager = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+    (*cinfo->err->output_message)(cinfo);
+    longjmp(errorManager->jmp, 1);
+}
+
+static void jpegOutputMessage(j_common_ptr cinfo) {
+    char buffer[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, buffer);
+    ALOGW("ParallelEncoder: %s", buffer);
+}
+
+static void jpegInitDestination(j_compress_ptr cinfo) {
+    JpegStripDestination* dest = reinterpret_cast<JpegStripDestination*>(cinfo->dest);
+    dest->buffer->resize(64 * 1024);
+    dest->pub.next_output_byte = dest->buffer->data();
+    dest->pub.free_in_buffer = dest->buffer->size();
+}
+
+static boolean jpegEmptyOutputBuffer(j_compress_ptr cinfo) {
+    JpegStripDestination* dest = reinterpret_cast<JpegStripDestination*>(cinfo->dest);
+    // The whole buffer is full when this is called
+    size_t used = dest->buffer->size();
+    dest->buffer->resize(used * 2);
+    dest->pub.next_output_byte = dest->buffer->data() + used;
+    dest->pub.free_in_buffer = dest->buffer->size() - used;
+    return TRUE;
+}
+
+static void jpegTermDestination(j_compress_ptr cinfo) {
+    JpegStripDestination* dest = reinterpret_cast<JpegStripDestination*>(cinfo->dest);
+    dest->buffer->resize(dest->buffer->size() - dest->pub.free_in_buffer);
+}
+
+static bool encodeJpegStrip(JpegStrip* strip, int width, int firstRow, int rowCount,
+                            int mcuHeight, const ParallelEncoder::JpegConfigurator& configure,
+                            const ParallelEncoder::JpegStripWriter& writeStrip) {
+    jpeg_compress_struct cinfo;
+    JpegErrorManager errorManager;
+    cinfo.err = jpeg_std_error(&errorManager.pub);
+    errorManager.pub.error_exit = jpegErrorExit;
+    errorManager.pub.output_message = jpegOutputMessage;
+    if (setjmp(errorManager.jmp)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+
+    JpegStripDestination destination;
+    destination.pub.init_destination = jpegInitDestination;
+    destination.pub.empty_output_buffer = jpegEmptyOutputBuffer;
+    destination.pub.term_destination = jpegTermDestination;
+    destination.buffer = &strip->data;
+    cinfo.dest = &destination.pub;
+
+    configure(&cinfo, rowCount);
+    cinfo.image_width = width;
+    cinfo.image_height = rowCount;
+    cinfo.optimize_coding = FALSE;
+    cinfo.restart_interval = 0;
+    cinfo.restart_in_rows = 1;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    if (cinfo.max_v_samp_factor * DCTSIZE != mcuHeight || cinfo.progressive_mode) {
+        ALOGW("ParallelEncoder: strips of %d rows can't be stitched", mcuHeight);
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    if (!writeStrip(&cinfo, firstRow, rowCount)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    strip->mcuRows = divideRoundingUp(rowCount, mcuHeight);
+    return true;
+}
+
+/**
+ * Finds the frame header and the start of the entropy coded data of a strip, and checks that the
+ * data is followed by nothing but the EOI marker.
+ */
+static bool parseJpegStrip(JpegStrip* strip) {
+    const std::vector<uint8_t>& data = strip->data;
+    const size_t size = data.size();
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8 || data[size - 2] != 0xFF ||
+        data[size - 1] != 0xD9) {
+        return false;
+    }
+    size_t offset = 2;
+    while (offset + 4 <= size && data[offset] == 0xFF) {
+        const uint8_t marker = data[offset + 1];
+        const size_t length = (data[offset + 2] << 8) | data[offset + 3];
+        if (marker == 0xC0 || marker == 0xC1) {
+            strip->frameOffset = offset;
+        } else if (marker == 0xDA) {
+            strip->scanOffset = offset + 2 + length;
+            return strip->frameOffset != 0 && strip->scanOffset <= size - 2;
+        }
+        offset += 2 + length;
+    }
+    return false;
+}
+
+static void writeRestartMarker(SkWStream* stream, int index) {
+    const uint8_t marker[2] = {0xFF, static_cast<uint8_t>(0xD0 | (index & 7))};
+    stream->write(marker, sizeof(marker));
+}
+
+static bool stitchJpegStrips(SkWStream* stream, std::vector<JpegStrip>& strips, int height) {
+    for (JpegStrip& strip : strips) {
+        if (!strip.encoded || !parseJpegStrip(&strip)) {
+            return false;
+        }
+    }
+
+    // The headers of every strip only differ by the image height of their frame header
+    std::vector<uint8_t>& first = strips[0].data;
+    first[strips[0].frameOffset + 5] = static_cast<uint8_t>(height >> 8);
+    first[strips[0].frameOffset + 6] = static_cast<uint8_t>(height & 0xFF);
+    if (!stream->write(first.data(), strips[0].scanOffset)) {
+        return false;
+    }
+
+    int mcuRow = 0;
+    for (size_t i = 0; i < strips.size(); i++) {
+        JpegStrip& strip = strips[i];
+        uint8_t* scan = strip.data.data() + strip.scanOffset;
+        const size_t scanSize = strip.data.size() - 2 - strip.scanOffset;
+
+        // Every strip numbers its restart markers from 0. Since 0xFF bytes of the entropy coded
+        // data are always followed by a stuffed 0x00, any 0xFFD0-0xFFD7 pair is a marker.
+        int restart = mcuRow;
+        for (size_t j = 0; j + 1 < scanSize; j++) {
+            if (scan[j] == 0xFF && (scan[j + 1] & 0xF8) == 0xD0) {
+                scan[j + 1] = static_cast<uint8_t>(0xD0 | (restart++ & 7));
+                j++;
+            }
+        }
+        if (!stream->write(scan, scanSize)) {
+            return false;
+        }
+
+        mcuRow += strip.mcuRows;
+        if (i + 1 < strips.size()) {
+            writeRestartMarker(stream, mcuRow - 1);
+        }
+    }
+
+    const uint8_t eoi[2] = {0xFF, 0xD9};
+    return stream->write(eoi, sizeof(eoi));
+}
+
+bool ParallelEncoder::encodeJpegStrips(SkWStream* stream, int width, int height, int mcuHeight,
+                                       const JpegConfigurator& configure,
+                                       const JpegStripWriter& writeStrip, int threadBudget) {
+    ATRACE_CALL();
+    if (width <= 0 || height <= 0 || width > JPEG_MAX_DIMENSION || height > 0xFFFF ||
+        mcuHeight <= 0) {
+        return false;
+    }
+
+    const int mcuRows = divideRoundingUp(height, mcuHeight);
+    const int stripMcuRows = std::max(kMinJpegStripMcuRows,
+            divideRoundingUp(mcuRows, std::max(1, threadBudget) * kStripsPerThread));
+    const int stripHeight = stripMcuRows * mcuHeight;
+    const int stripCount = divideRoundingUp(height, stripHeight);
+
+    std::vector<JpegStrip> strips(stripCount);
+    encodeStrips(stripCount, threadBudget, [&](int i) {
+        const int firstRow = i * stripHeight;
+        const int rowCount = std::min(stripHeight, height - firstRow);
+        strips[i].encoded = encodeJpegStrip(&strips[i], width, firstRow, rowCount, mcuHeight,
+                                            configure, writeStrip);
+    });
+    return stitchJpegStrips(stream, strips, height);
+}
+
+/**
+ * Returns the APP2 marker data that embeds the ICC profile of colorSpace, built like
+ * SkJpegEncoder does.
+ */
+static sk_sp<SkData> makeJpegIccMarker(const SkColorSpace& colorSpace) {
+    skcms_TransferFunction fn;
+    skcms_Matrix3x3 toXYZD50;
+    colorSpace.transferFn(&fn);
+    colorSpace.toXYZD50(&toXYZD50);
+    sk_sp<SkData> icc = SkWriteICCProfile(fn, toXYZD50);
+    // "ICC_PROFILE" signature, then the sequence number and count of the single marker
+    static constexpr uint8_t kIccHeader[] = {'I', 'C', 'C', '_', 'P', 'R', 'O', 'F',
+                                             'I', 'L', 'E', '\0', 1, 1};
+    if (!icc || sizeof(kIccHeader) + icc->size() > 0xFFFF - 2) {
+        return nullptr;
+    }
+    sk_sp<SkData> marker = SkData::MakeUninitialized(sizeof(kIccHeader) + icc->size());
+    uint8_t* data = static_cast<uint8_t*>(marker->writable_data());
+    memcpy(data, kIccHeader, sizeof(kIccHeader));
+    memcpy(data + sizeof(kIccHeader), icc->data(), icc->size());
+    return marker;
+}
+
+bool ParallelEncoder::encodeJpeg(SkWStream* stream, const SkPixmap& pixmap, int quality,
+                                 int threadBudget) {
+    // Like SkJpegEncoder, alpha is ignored and the color channels are encoded as they are
+    const J_COLOR_SPACE colorSpace =
+            pixmap.colorType() == kRGBA_8888_SkColorType ? JCS_EXT_RGBX : JCS_EXT_BGRX;
+    quality = std::max(0, std::min(100, quality));
+    sk_sp<SkData> iccMarker;
+    if (pixmap.colorSpace()) {
+        iccMarker = makeJpegIccMarker(*pixmap.colorSpace());
+        if (!iccMarker) {
+            return false;
+        }
+    }
+
+    auto configure = [&](jpeg_compress_struct* cinfo, int stripHeight) {
+        cinfo->image_width = pixmap.width();
+        cinfo->image_height = stripHeight;
+        cinfo->input_components = 4;
+        cinfo->in_color_space = colorSpace;
+        jpeg_set_defaults(cinfo);
+        jpeg_set_quality(cinfo, quality, TRUE);
+    };
+    auto writeStrip = [&](jpeg_compress_struct* cinfo, int firstRow, int rowCount) {
+        // Only the headers of the first strip are kept by stitching
+        if (iccMarker && firstRow == 0) {
+            jpeg_write_marker(cinfo, JPEG_APP0 + 2, iccMarker->bytes(), iccMarker->size());
+        }
+        for (int y = firstRow; y < firstRow + rowCount; y++) {
+            JSAMPROW row = static_cast<JSAMPROW>(const_cast<void*>(pixmap.addr(0, y)));
+            jpeg_write_scanlines(cinfo, &row, 1);
+        }
+        return true;
+    };
+    // jpeg_set_defaults subsamples chroma 2x2
+    return encodeJpegStrips(stream, pixmap.width(), pixmap.height(), 2 * DCTSIZE, configure,
+                            writeStrip, threadBudget);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PNG
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct PngStrip {
+    std::vector<uint8_t> deflated;
+    uLong adler = 0;
+    size_t filteredSize = 0;
+    bool encoded = false;
+};
+
+}  // namespace
+
+/**
+ * Converts row y of pixmap to unpremultiplied RGB(A), with the same rounding as SkPngEncoder.
+ */
+static void convertPngRow(const SkPixmap& pixmap, int y, int bytesPerPixel, uint8_t* out) {
+    const uint8_t* src = static_cast<const uint8_t*>(pixmap.addr(0, y));
+    const bool bgra = pixmap.colorType() == kBGRA_8888_SkColorType;
+    const bool premul = pixmap.alphaType() == kPremul_SkAlphaType;
+    for (int x = 0; x < pixmap.width(); x++, src += 4, out += bytesPerPixel) {
+        uint8_t r = src[bgra ? 2 : 0];
+        uint8_t g = src[1];
+        uint8_t b = src[bgra ? 0 : 2];
+        if (bytesPerPixel == 3) {
+            out[0] = r;
+            out[1] = g;
+            out[2] = b;
+            continue;
+        }
+        const uint8_t a = src[3];
+        if (premul && a != 0xFF) {
+            const SkUnPreMultiply::Scale scale = SkUnPreMultiply::GetScale(a);
+            r = SkUnPreMultiply::ApplyScale(scale, r);
+            g = SkUnPreMultiply::ApplyScale(scale, g);
+            b = SkUnPreMultiply::ApplyScale(scale, b);
+        }
+        out[0] = r;
+        out[1] = g;
+        out[2] = b;
+        out[3] = a;
+    }
+}
+
+static int paethPredictor(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+/**
+ * Writes the filter type and filtered bytes of row to out, picking the filter that minimizes
+ * the sum of the absolute values of the filtered bytes like libpng does. prev is the previous
+ * unfiltered row, all zeroes for the first row of the image. scratch holds 5 rows.
+ */
+static void filterPngRow(const uint8_t* row, const uint8_t* prev, size_t size, int bytesPerPixel,
+                         uint8_t* scratch, uint8_t* out) {
+    constexpr int kFilterCount = 5;
+    uint8_t* candidates[kFilterCount];
+    for (int f = 0; f < kFilterCount; f++) {
+        candidates[f] = scratch + f * size;
+    }
+    uint32_t costs[kFilterCount] = {};
+    auto cost = [](uint8_t value) -> uint32_t { return value < 128 ? value : 256 - value; };
+
+    for (size_t i = 0; i < size; i++) {
+        const int x = row[i];
+        const int a = i >= static_cast<size_t>(bytesPerPixel) ? row[i - bytesPerPixel] : 0;
+        const int b = prev[i];
+        const int c = i >= static_cast<size_t>(bytesPerPixel) ? prev[i - bytesPerPixel] : 0;
+        const uint8_t filtered[kFilterCount] = {
+                static_cast<uint8_t>(x),
+                static_cast<uint8_t>(x - a),
+                static_cast<uint8_t>(x - b),
+                static_cast<uint8_t>(x - ((a + b) >> 1)),
+                static_cast<uint8_t>(x - paethPredictor(a, b, c)),
+        };
+        for (int f = 0; f < kFilterCount; f++) {
+            candidates[f][i] = filtered[f];
+            costs[f] += cost(filtered[f]);
+        }
+    }
+
+    int best = 0;
+    for (int f = 1; f < kFilterCount; f++) {
+        if (costs[f] < costs[best]) {
+            best = f;
+        }
+    }
+    out[0] = static_cast<uint8_t>(best);
+    memcpy(out + 1, candidates[best], size);
+}
+
+static bool deflatePngStrip(PngStrip* strip, const SkPixmap& pixmap, int bytesPerPixel,
+                            int firstRow, int rowCount, bool last) {
+    const size_t rowSize = pixmap.width() * bytesPerPixel;
+    const size_t filteredRowSize = rowSize + 1;
+    // The rows above the strip that make up its dictionary are filtered again, which is cheaper
+    // than waiting for the strip above to be done
+    const int dictionaryRows = std::min(
+            firstRow, static_cast<int>((kDeflateWindowSize + rowSize) / filteredRowSize));
+    const int startRow = firstRow - dictionaryRows;
+
+    std::vector<uint8_t> filtered((dictionaryRows + rowCount) * filteredRowSize);
+    std::vector<uint8_t> rows(2 * rowSize, 0);
+    std::vector<uint8_t> scratch(5 * rowSize);
+    uint8_t* prev = rows.data();
+    uint8_t* current = rows.data() + rowSize;
+    if (startRow > 0) {
+        convertPngRow(pixmap, startRow - 1, bytesPerPixel, prev);
+    }
+    for (int y = 0; y < dictionaryRows + rowCount; y++) {
+        convertPngRow(pixmap, startRow + y, bytesPerPixel, current);
+        filterPngRow(current, prev, rowSize, bytesPerPixel, scratch.data(),
+                     filtered.data() + y * filteredRowSize);
+        std::swap(prev, current);
+    }
+
+    uint8_t* input = filtered.data() + dictionaryRows * filteredRowSize;
+    const size_t inputSize = rowCount * filteredRowSize;
+    strip->filteredSize = inputSize;
+    strip->adler = adler32(adler32(0, Z_NULL, 0), input, inputSize);
+
+    z_stream zs = {};
+    if (deflateInit2(&zs, kPngCompressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK) {
+        return false;
+    }
+    if (dictionaryRows > 0) {
+        const size_t dictionarySize =
+                std::min(kDeflateWindowSize, dictionaryRows * filteredRowSize);
+        deflateSetDictionary(&zs, input - dictionarySize, dictionarySize);
+    }
+
+    // Every strip but the last ends with a sync flush rather than a final block, so that the
+    // next strip can carry on the same stream
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    strip->deflated.resize(deflateBound(&zs, inputSize) + 16);
+    zs.next_in = input;
+    zs.avail_in = inputSize;
+    zs.next_out = strip->deflated.data();
+    zs.avail_out = strip->deflated.size();
+    while (true) {
+        const int result = deflate(&zs, flush);
+        if (last ? result == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out != 0)) {
+            break;
+        }
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            deflateEnd(&zs);
+            return false;
+        }
+        const size_t used = zs.total_out;
+        strip->deflated.resize(strip->deflated.size() * 2);
+        zs.next_out = strip->deflated.data() + used;
+        zs.avail_out = strip->deflated.size() - used;
+    }
+    strip->deflated.resize(zs.total_out);
+    deflateEnd(&zs);
+    return true;
+}
+
+static void writeBigEndian32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+static bool writePngChunk(SkWStream* stream, const char* type, const uint8_t* data,
+                          size_t size) {
+    uint8_t header[8];
+    writeBigEndian32(header, size);
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(0, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    crc = crc32(crc, data, size);
+    uint8_t trailer[4];
+    writeBigEndian32(trailer, crc);
+    return stream->write(header, sizeof(header)) && stream->write(data, size) &&
+           stream->write(trailer, sizeof(trailer));
+}
+
+bool ParallelEncoder::encodePng(SkWStream* stream, const SkPixmap& pixmap, int threadBudget) {
+    ATRACE_CALL();
+    const int width = pixmap.width();
+    const int height = pixmap.height();
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    // Like SkPngEncoder, opaque images are encoded without an alpha channel
+    const int bytesPerPixel = pixmap.isOpaque() ? 3 : 4;
+
+    const int stripHeight = std::max(kMinPngStripRows,
+            divideRoundingUp(height, std::max(1, threadBudget) * kStripsPerThread));
+    const int stripCount = divideRoundingUp(height, stripHeight);
+    std::vector<PngStrip> strips(stripCount);
+    encodeStrips(stripCount, threadBudget, [&](int i) {
+        const int firstRow = i * stripHeight;
+        const int rowCount = std::min(stripHeight, height - firstRow);
+        strips[i].encoded = deflatePngStrip(&strips[i], pixmap, bytesPerPixel, firstRow,
+                                            rowCount, i == stripCount - 1);
+    });
+
+    uLong adler = strips[0].adler;
+    for (int i = 0; i < stripCount; i++) {
+        if (!strips[i].encoded) {
+            return false;
+        }
+        if (i > 0) {
+            adler = adler32_combine(adler, strips[i].adler, strips[i].filteredSize);
+        }
+    }
+
+    // The zlib header goes at the start of the first IDAT chunk and the checksum of the whole
+    // stream at the end of the last one
+    static constexpr uint8_t kZlibHeader[] = {0x78, 0x9C};
+    std::vector<uint8_t>& head = strips.front().deflated;
+    head.insert(head.begin(), std::begin(kZlibHeader), std::end(kZlibHeader));
+    std::vector<uint8_t>& tail = strips.back().deflated;
+    tail.resize(tail.size() + 4);
+    writeBigEndian32(tail.data() + tail.size() - 4, adler);
+
+    static constexpr uint8_t kSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (!stream->write(kSignature, sizeof(kSignature))) {
+        return false;
+    }
+
+    uint8_t header[13];
+    writeBigEndian32(header, width);
+    writeBigEndian32(header + 4, height);
+    header[8] = 8;                          // bit depth
+    header[9] = bytesPerPixel == 3 ? 2 : 6; // color type, RGB or RGBA
+    header[10] = 0;                         // compression method
+    header[11] = 0;                         // filter method
+    header[12] = 0;                         // no interlacing
+    if (!writePngChunk(stream, "IHDR", header, sizeof(header))) {
+        return false;
+    }
+    if (pixmap.colorSpace()) {
+        // canEncode only lets sRGB through, which SkPngEncoder tags with a perceptual intent
+        const uint8_t renderingIntent = 0;
+        if (!writePngChunk(stream, "sRGB", &renderingIntent, 1)) {
+            return false;
+        }
+    }
+    for (const PngStrip& strip : strips) {
+        if (!writePngChunk(stream, "IDAT", strip.deflated.data(), strip.deflated.size())) {
+            return false;
+        }
+    }
+    return writePngChunk(stream, "IEND", nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Entry points
+///////////////////////////////////////////////////////////////////////////////
+
+bool ParallelEncoder::canEncode(const SkPixmap& pixmap, SkEncodedImageFormat format) {
+    if (format != SkEncodedImageFormat::kJPEG && format != SkEncodedImageFormat::kPNG) {
+        return false;
+    }
+    if (uirenderer::Properties::compressThreads < 2 || !pixmap.addr() ||
+        static_cast<int64_t>(pixmap.width()) * pixmap.height() < kMinPixels) {
+        return false;
+    }
+    if (pixmap.colorType() != kRGBA_8888_SkColorType &&
+        pixmap.colorType() != kBGRA_8888_SkColorType) {
+        return false;
+    }
+    if (pixmap.alphaType() == kUnknown_SkAlphaType) {
+        return false;
+    }
+    // sRGB is tagged with an ICC profile in JPEG and an sRGB chunk in PNG, like Skia does. Other
+    // color spaces are left to Skia.
+    return !pixmap.colorSpace() || pixmap.colorSpace()->isSRGB();
+}
+
+bool ParallelEncoder::encode(SkWStream* stream, const SkPixmap& pixmap,
+                             SkEncodedImageFormat format, int quality) {
+    const int threadBudget = uirenderer::Properties::compressThreads;
+    if (format == SkEncodedImageFormat::kJPEG) {
+        return encodeJpeg(stream, pixmap, quality, threadBudget);
+    }
+    return encodePng(stream, pixmap, threadBudget);
+}
+
+}  // namespace android
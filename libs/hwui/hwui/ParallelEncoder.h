@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <SkEncodedImageFormat.h>
+#include <SkPixmap.h>
+#include <cutils/compiler.h>
+
+#include <functional>
+
+class SkWStream;
+struct jpeg_compress_struct;
+
+namespace android {
+
+/**
+ * Encodes large images as JPEG or PNG by splitting them into horizontal strips that are
+ * compressed concurrently and stitched back into a single standard file.
+ *
+ * JPEG strips are encoded as independent images with a restart marker after every row of MCUs
+ * and the same quantization and Huffman tables. Since the DC predictors are reset at every
+ * restart marker, the entropy coded data of the strips can be concatenated once their restart
+ * markers are renumbered, under the headers of the first strip.
+ *
+ * PNG strips are filtered and deflated separately, each one primed with the last 32KB of the
+ * strip above as its dictionary. Every strip but the last ends on a byte boundary with a sync
+ * flush, so the raw deflate streams concatenate into the single zlib stream of the IDAT chunks,
+ * whose checksum is combined from the checksums of the strips.
+ *
+ * Work is spread over the calling thread and the threads of CommonPool. The number of
+ * threads an encode may use is set by Properties::compressThreads, and is capped by the size of
+ * CommonPool. Host builds encode the strips on the calling thread.
+ */
+class ParallelEncoder {
+public:
+    // Images with fewer pixels are not worth splitting
+    static constexpr int kMinPixels = 1024 * 1024;
+
+    /**
+     * Called for each JPEG strip to set up cinfo for an image of the full width and stripHeight
+     * rows, before compression is started. Restart intervals and Huffman table optimization are
+     * overridden afterwards, since strips can only be stitched with one restart marker per row
+     * of MCUs and the standard Huffman tables.
+     */
+    using JpegConfigurator = std::function<void(jpeg_compress_struct* cinfo, int stripHeight)>;
+
+    /**
+     * Called for each JPEG strip once compression is started to write rowCount rows of the image
+     * starting at firstRow. Returns false if the strip can't be written.
+     */
+    using JpegStripWriter =
+            std::function<bool(jpeg_compress_struct* cinfo, int firstRow, int rowCount)>;
+
+    /**
+     * "canEncode" returns true if pixmap is large enough to benefit from being encoded in
+     * parallel and in a configuration the parallel encoders support. Everything else should go
+     * through SkEncodeImage.
+     */
+    static bool canEncode(const SkPixmap& pixmap, SkEncodedImageFormat format);
+
+    /**
+     * "encode" writes pixmap to stream, using the thread budget set by the system properties.
+     * Must only be called if "canEncode" returned true.
+     */
+    static bool encode(SkWStream* stream, const SkPixmap& pixmap, SkEncodedImageFormat format,
+                       int quality);
+
+    ANDROID_API static bool encodeJpeg(SkWStream* stream, const SkPixmap& pixmap, int quality,
+                                       int threadBudget);
+    ANDROID_API static bool encodePng(SkWStream* stream, const SkPixmap& pixmap,
+                                      int threadBudget);
+
+    /**
+     * "encodeJpegStrips" encodes a width x height JPEG whose strips are set up by configure and
+     * filled in by writeStrip. mcuHeight is the height in rows of an MCU for the sampling
+     * factors configure picks, i.e. 16 for 4:2:0 and 8 otherwise.
+     */
+    static bool encodeJpegStrips(SkWStream* stream, int width, int height, int mcuHeight,
+                                 const JpegConfigurator& configure,
+                                 const JpegStripWriter& writeStrip, int threadBudget);
+};
+
+}  // namespace android
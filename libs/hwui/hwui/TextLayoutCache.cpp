@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TextLayoutCache.h"
+
+#include "Properties.h"
+
+#include <functional>
+#include <string>
+
+namespace android {
+
+// Rough size of a glyph of a minikin::Layout: its id, position, font and fakery
+static constexpr size_t kBytesPerGlyph = 32;
+
+static inline uint64_t hashMix(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+struct TextLayoutCache::Entry {
+    std::u16string text;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    minikin::Bidi bidiFlags = minikin::Bidi::LTR;
+    // Holding on to the collection keeps its address from being reused by another one
+    std::shared_ptr<minikin::FontCollection> font;
+    float size = 0;
+    float scaleX = 0;
+    float skewX = 0;
+    float letterSpacing = 0;
+    float wordSpacing = 0;
+    uint32_t fontFlags = 0;
+    uint32_t localeListId = 0;
+    minikin::FontStyle fontStyle;
+    minikin::FamilyVariant familyVariant = minikin::FamilyVariant::DEFAULT;
+    std::string fontFeatureSettings;
+    minikin::StartHyphenEdit startHyphen = minikin::StartHyphenEdit::NO_EDIT;
+    minikin::EndHyphenEdit endHyphen = minikin::EndHyphenEdit::NO_EDIT;
+
+    size_t hash = 0;
+    size_t bytes = 0;
+    std::shared_ptr<const minikin::Layout> layout;
+
+    size_t computeHash() const {
+        uint64_t hash = std::hash<std::u16string>()(text);
+        hash = hashMix(hash, (static_cast<uint64_t>(start) << 32) | end);
+        hash = hashMix(hash, static_cast<uint64_t>(bidiFlags));
+        hash = hashMix(hash, reinterpret_cast<uintptr_t>(font.get()));
+        hash = hashMix(hash, std::hash<float>()(size));
+        hash = hashMix(hash, std::hash<float>()(scaleX));
+        hash = hashMix(hash, std::hash<float>()(skewX));
+        hash = hashMix(hash, std::hash<float>()(letterSpacing));
+        hash = hashMix(hash, std::hash<float>()(wordSpacing));
+        hash = hashMix(hash, (static_cast<uint64_t>(fontFlags) << 32) | localeListId);
+        hash = hashMix(hash, (static_cast<uint64_t>(fontStyle.weight()) << 32) |
+                                     static_cast<uint64_t>(fontStyle.slant()));
+        hash = hashMix(hash, static_cast<uint64_t>(familyVariant));
+        hash = hashMix(hash, (static_cast<uint64_t>(startHyphen) << 8) |
+                                     static_cast<uint64_t>(endHyphen));
+        hash = hashMix(hash, std::hash<std::string>()(fontFeatureSettings));
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    bool sameKey(const Entry& other) const {
+        return start == other.start && end == other.end && bidiFlags == other.bidiFlags &&
+               font == other.font && size == other.size && scaleX == other.scaleX &&
+               skewX == other.skewX && letterSpacing == other.letterSpacing &&
+               wordSpacing == other.wordSpacing && fontFlags == other.fontFlags &&
+               localeListId == other.localeListId &&
+               fontStyle.weight() == other.fontStyle.weight() &&
+               fontStyle.slant() == other.fontStyle.slant() &&
+               familyVariant == other.familyVariant && startHyphen == other.startHyphen &&
+               endHyphen == other.endHyphen && fontFeatureSettings == other.fontFeatureSettings &&
+               text == other.text;
+    }
+};
+
+TextLayoutCache::TextLayoutCache() {}
+
+TextLayoutCache& TextLayoutCache::getInstance() {
+    static TextLayoutCache* sInstance = new TextLayoutCache();
+    return *sInstance;
+}
+
+std::shared_ptr<const minikin::Layout> TextLayoutCache::getLayout(
+        const minikin::U16StringPiece& context, const minikin::Range& range,
+        minikin::Bidi bidiFlags, const minikin::MinikinPaint& paint,
+        minikin::StartHyphenEdit startHyphen, minikin::EndHyphenEdit endHyphen) {
+    const size_t budget = static_cast<size_t>(uirenderer::Properties::textLayoutCacheSize) * 1024;
+    if (budget == 0 || context.size() > kMaxContextLength) {
+        return std::make_shared<minikin::Layout>(context, range, bidiFlags, paint, startHyphen,
+                                                 endHyphen);
+    }
+
+    Entry key;
+    key.text.assign(reinterpret_cast<const char16_t*>(context.data()), context.size());
+    key.start = range.getStart();
+    key.end = range.getEnd();
+    key.bidiFlags = bidiFlags;
+    key.font = paint.font;
+    key.size = paint.size;
+    key.scaleX = paint.scaleX;
+    key.skewX = paint.skewX;
+    key.letterSpacing = paint.letterSpacing;
+    key.wordSpacing = paint.wordSpacing;
+    key.fontFlags = paint.fontFlags;
+    key.localeListId = paint.localeListId;
+    key.fontStyle = paint.fontStyle;
+    key.familyVariant = paint.familyVariant;
+    key.fontFeatureSettings = paint.fontFeatureSettings;
+    key.startHyphen = startHyphen;
+    key.endHyphen = endHyphen;
+    key.hash = key.computeHash();
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = findLocked(key.hash, key);
+        if (it != mEntries.end()) {
+            mEntries.splice(mEntries.begin(), mEntries, it);
+            mHits++;
+            return it->layout;
+        }
+        mMisses++;
+    }
+
+    key.layout = std::make_shared<minikin::Layout>(context, range, bidiFlags, paint, startHyphen,
+                                                   endHyphen);
+    key.bytes = sizeof(Entry) + key.text.size() * sizeof(char16_t) +
+                key.fontFeatureSettings.size() + key.layout->nGlyphs() * kBytesPerGlyph +
+                range.getLength() * sizeof(float);
+
+    std::lock_guard<std::mutex> lock(mLock);
+    std::shared_ptr<const minikin::Layout> layout = insertLocked(std::move(key));
+    while (mBytes > budget && mEntries.size() > 1) {
+        evictLocked();
+        mEvictions++;
+    }
+    return layout;
+}
+
+TextLayoutCache::EntryList::iterator TextLayoutCache::findLocked(size_t hash, const Entry& key) {
+    auto range = mIndex.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->sameKey(key)) {
+            return it->second;
+        }
+    }
+    return mEntries.end();
+}
+
+std::shared_ptr<const minikin::Layout> TextLayoutCache::insertLocked(Entry&& entry) {
+    // Another thread may have shaped the same text while this one did
+    auto it = findLocked(entry.hash, entry);
+    if (it != mEntries.end()) {
+        mEntries.splice(mEntries.begin(), mEntries, it);
+        return it->layout;
+    }
+    mBytes += entry.bytes;
+    const size_t hash = entry.hash;
+    mEntries.push_front(std::move(entry));
+    mIndex.emplace(hash, mEntries.begin());
+    return mEntries.front().layout;
+}
+
+void TextLayoutCache::evictLocked() {
+    auto oldest = std::prev(mEntries.end());
+    auto range = mIndex.equal_range(oldest->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == oldest) {
+            mIndex.erase(it);
+            break;
+        }
+    }
+    mBytes -= oldest->bytes;
+    mEntries.erase(oldest);
+}
+
+void TextLayoutCache::clear() {
+    std::lock_guard<std::mutex> lock(mLock);
+    while (!mEntries.empty()) {
+        evictLocked();
+    }
+}
+
+TextLayoutCache::Stats TextLayoutCache::stats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    Stats stats;
+    stats.cachedBytes = mBytes;
+    stats.entries = mEntries.size();
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    return stats;
+}
+
+}  // namespace android
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cutils/compiler.h>
+#include <minikin/Layout.h>
+#include <minikin/MinikinPaint.h>
+#include <minikin/Range.h>
+#include <minikin/U16StringPiece.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace android {
+
+/**
+ * Process-wide LRU cache of the shaped layouts of whole text runs, shared by text measurement
+ * and drawing, so that a string measured by a TextView and then drawn, or drawn again in every
+ * frame of a scrolling list, is only shaped once.
+ *
+ * Layouts are keyed by the context text, the laid out range of it, the bidi flags, and every
+ * field of the MinikinPaint and hyphen edits that shaping depends on. Their estimated sizes are
+ * charged to a budget of Properties::textLayoutCacheSize KB; contexts longer than
+ * kMaxContextLength characters are shaped without the cache, as they are unlikely to repeat.
+ *
+ * Shaping happens outside of the lock, so two threads missing on the same text both shape it and
+ * the second one to finish reuses the layout of the first.
+ */
+class ANDROID_API TextLayoutCache {
+public:
+    static constexpr size_t kMaxContextLength = 512;
+
+    static TextLayoutCache& getInstance();
+
+    // Layout of range within context, like minikin::Layout(context, range, ...)
+    std::shared_ptr<const minikin::Layout> getLayout(const minikin::U16StringPiece& context,
+                                                     const minikin::Range& range,
+                                                     minikin::Bidi bidiFlags,
+                                                     const minikin::MinikinPaint& paint,
+                                                     minikin::StartHyphenEdit startHyphen,
+                                                     minikin::EndHyphenEdit endHyphen);
+
+    void clear();
+
+    struct Stats {
+        size_t cachedBytes = 0;
+        uint32_t entries = 0;
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t evictions = 0;
+    };
+
+    Stats stats();
+
+private:
+    struct Entry;
+    using EntryList = std::list<Entry>;
+
+    TextLayoutCache();
+
+    EntryList::iterator findLocked(size_t hash, const Entry& key);
+    std::shared_ptr<const minikin::Layout> insertLocked(Entry&& entry);
+    void evictLocked();
+
+    std::mutex mLock;
+    // Most recently used first
+    EntryList mEntries;
+    std::unordered_multimap<size_t, EntryList::iterator> mIndex;
+    size_t mBytes = 0;
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+    uint32_t mEvictions = 0;
+};
+
+}  // namespace android
@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TiledRegionDecoder.h"
+
+#include "Bitmap.h"
+#include "Properties.h"
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+#include "thread/CommonPool.h"
+#endif
+
+#include <SkBitmap.h>
+#include <SkStream.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+
+// Upper bound of the decoders of a TiledRegionDecoder, and therefore of its concurrent decodes
+static constexpr int kMaxDecoders = 4;
+// Pixels decoded around every tile and then discarded, so that the upsampled chroma of JPEG
+// tiles is the same along their edges as in the middle of the image. One 4:2:0 MCU is plenty.
+static constexpr int kTileMargin = 16;
+
+static std::atomic<size_t> sCachedBytes{0};
+// Value of sCachedBytes when it was last reported by takeCachedBytesDelta()
+static std::atomic<size_t> sReportedBytes{0};
+// Share of Properties::regionTileCacheSize of each live cache
+static std::atomic<size_t> sCacheBudget{0};
+static std::atomic<uint32_t> sHits{0};
+static std::atomic<uint32_t> sMisses{0};
+static std::atomic<uint32_t> sPrefetched{0};
+static std::atomic<uint32_t> sEvictions{0};
+
+namespace {
+
+struct TileKey {
+    int column;
+    int row;
+    int sampleSize;
+
+    bool operator==(const TileKey& other) const {
+        return column == other.column && row == other.row && sampleSize == other.sampleSize;
+    }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const {
+        return std::hash<uint64_t>()((static_cast<uint64_t>(key.column) << 40) ^
+                                     (static_cast<uint64_t>(key.row) << 16) ^
+                                     static_cast<uint64_t>(key.sampleSize));
+    }
+};
+
+struct Tile {
+    // The tile and its margins
+    SkBitmap bitmap;
+    // Position of the top left pixel of the tile in bitmap
+    int left = 0;
+    int top = 0;
+    // Size of the android::Bitmap backing bitmap
+    size_t bytes = 0;
+};
+
+struct TileConfig {
+    SkColorType colorType = kUnknown_SkColorType;
+    bool requireUnpremul = false;
+    sk_sp<SkColorSpace> colorSpace;
+
+    bool operator==(const TileConfig& other) const {
+        return colorType == other.colorType && requireUnpremul == other.requireUnpremul &&
+               SkColorSpace::Equals(colorSpace.get(), other.colorSpace.get());
+    }
+};
+
+class TileAllocator : public SkBRDAllocator {
+public:
+    bool allocPixelRef(SkBitmap* bitmap) override {
+        mStorage = Bitmap::allocateHeapBitmap(bitmap);
+        return !!mStorage;
+    }
+
+    SkCodec::ZeroInitialized zeroInit() const override { return SkCodec::kYes_ZeroInitialized; }
+
+    size_t getAllocationByteCount() const {
+        return mStorage ? mStorage->getAllocationByteCount() : 0;
+    }
+
+private:
+    sk_sp<Bitmap> mStorage;
+};
+
+// Runs task(0) to task(count - 1) on the calling thread and up to threadBudget - 1 threads
+static void parallelFor(int count, int threadBudget, const std::function<void(int)>& task) {
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+    uirenderer::CommonPool::parallelFor(count, threadBudget, task);
+#else
+    for (int i = 0; i < count; i++) {
+        task(i);
+    }
+#endif
+}
+
+}  // namespace
+
+/**
+ * The state of a TiledRegionDecoder that is shared with its prefetch task: the LRU list of
+ * tiles, the tiles being decoded, and the pool of decoders used to decode them.
+ */
+class TileCache : public std::enable_shared_from_this<TileCache> {
+public:
+    TileCache(std::unique_ptr<SkStreamRewindable> stream, int width, int height);
+    ~TileCache();
+
+    size_t budget() const { return sCacheBudget; }
+
+    // Drops the tiles decoded for a different color type, alpha type or color space
+    void setConfig(const TileConfig& config);
+
+    bool decodeRegion(SkBitmap* bitmap, SkBRDAllocator* allocator, const SkIRect& subset,
+                      int sampleSize);
+
+    // Replaces the tiles to prefetch by the ones around subset
+    void prefetchAround(const SkIRect& subset, int sampleSize);
+
+    void clear();
+
+    // Evicts tiles until the cache fits in its share of the budget
+    void trim();
+
+    // Stops prefetching and drops every tile, once the decoder is deleted
+    void close();
+
+private:
+    bool decodeTile(const TileKey& key, const TileConfig& config, Tile* tile);
+
+    // Decodes a tile claimed in mDecoding, and adds it to the cache unless the configuration
+    // changed in the meantime
+    bool decodeAndInsert(const TileKey& key, const TileConfig& config, int generation,
+                         Tile* tile);
+
+    bool findLocked(const TileKey& key, Tile* tile);
+    void insertLocked(const TileKey& key, const Tile& tile);
+    void evictLocked();
+
+    void postPrefetch();
+    void runPrefetch();
+
+    std::unique_ptr<SkBitmapRegionDecoder> acquireDecoder();
+    void releaseDecoder(std::unique_ptr<SkBitmapRegionDecoder> decoder);
+
+    const int mWidth;
+    const int mHeight;
+
+    std::mutex mLock;
+    std::condition_variable mTileDecoded;
+    std::list<std::pair<TileKey, Tile>> mTiles;
+    std::unordered_map<TileKey, std::list<std::pair<TileKey, Tile>>::iterator, TileKeyHash>
+            mIndex;
+    std::unordered_set<TileKey, TileKeyHash> mDecoding;
+    size_t mBytes = 0;
+    size_t mLastTileBytes = 0;
+    TileConfig mConfig;
+    // Incremented when the configuration changes, to drop the tiles decoded for the old one
+    int mGeneration = 0;
+    std::vector<TileKey> mPrefetchQueue;
+    bool mPrefetching = false;
+    bool mClosed = false;
+
+    std::mutex mDecodersLock;
+    std::condition_variable mDecoderReleased;
+    std::unique_ptr<SkStreamRewindable> mStream;
+    std::vector<std::unique_ptr<SkBitmapRegionDecoder>> mIdleDecoders;
+    int mDecoderCount = 0;
+};
+
+static std::mutex sCachesLock;
+
+static std::unordered_set<TileCache*>& liveCaches() {
+    static std::unordered_set<TileCache*>* caches = new std::unordered_set<TileCache*>();
+    return *caches;
+}
+
+// Splits the budget between the live caches, called with sCachesLock held
+static void updateCacheBudget() {
+    const size_t total = static_cast<size_t>(uirenderer::Properties::regionTileCacheSize) *
+                         1024 * 1024;
+    sCacheBudget = liveCaches().empty() ? total : total / liveCaches().size();
+}
+
+TileCache::TileCache(std::unique_ptr<SkStreamRewindable> stream, int width, int height)
+        : mWidth(width)
+        , mHeight(height)
+        , mStream(std::move(stream)) {
+    std::lock_guard<std::mutex> lock(sCachesLock);
+    liveCaches().insert(this);
+    updateCacheBudget();
+    // The other caches shrink to their new share, so the process stays within the budget
+    for (TileCache* cache : liveCaches()) {
+        if (cache != this) {
+            cache->trim();
+        }
+    }
+}
+
+TileCache::~TileCache() {
+    {
+        std::lock_guard<std::mutex> lock(sCachesLock);
+        liveCaches().erase(this);
+        updateCacheBudget();
+    }
+    clear();
+}
+
+void TileCache::setConfig(const TileConfig& config) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!(config == mConfig)) {
+        mConfig = config;
+        mGeneration++;
+        mPrefetchQueue.clear();
+        while (!mTiles.empty()) {
+            evictLocked();
+        }
+    }
+}
+
+void TileCache::clear() {
+    std::lock_guard<std::mutex> lock(mLock);
+    while (!mTiles.empty()) {
+        evictLocked();
+    }
+}
+
+void TileCache::trim() {
+    std::lock_guard<std::mutex> lock(mLock);
+    while (mBytes > budget() && !mTiles.empty()) {
+        evictLocked();
+        sEvictions++;
+    }
+}
+
+void TileCache::close() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mClosed = true;
+    mPrefetchQueue.clear();
+    while (!mTiles.empty()) {
+        evictLocked();
+    }
+}
+
+bool TileCache::findLocked(const TileKey& key, Tile* tile) {
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        return false;
+    }
+    mTiles.splice(mTiles.begin(), mTiles, it->second);
+    *tile = it->second->second;
+    return true;
+}
+
+void TileCache::insertLocked(const TileKey& key, const Tile& tile) {
+    if (mIndex.count(key)) {
+        return;
+    }
+    mTiles.emplace_front(key, tile);
+    mIndex[key] = mTiles.begin();
+    mBytes += tile.bytes;
+    mLastTileBytes = tile.bytes;
+    sCachedBytes += tile.bytes;
+    while (mBytes > budget() && mTiles.size() > 1) {
+        evictLocked();
+        sEvictions++;
+    }
+}
+
+void TileCache::evictLocked() {
+    const std::pair<TileKey, Tile>& oldest = mTiles.back();
+    mBytes -= oldest.second.bytes;
+    sCachedBytes -= oldest.second.bytes;
+    mIndex.erase(oldest.first);
+    mTiles.pop_back();
+}
+
+std::unique_ptr<SkBitmapRegionDecoder> TileCache::acquireDecoder() {
+    std::unique_lock<std::mutex> lock(mDecodersLock);
+    mDecoderReleased.wait(lock, [this] {
+        return !mIdleDecoders.empty() || mDecoderCount < kMaxDecoders;
+    });
+    if (!mIdleDecoders.empty()) {
+        std::unique_ptr<SkBitmapRegionDecoder> decoder = std::move(mIdleDecoders.back());
+        mIdleDecoders.pop_back();
+        return decoder;
+    }
+
+    // Parsing the headers may take a while, so it's done without holding the lock
+    mDecoderCount++;
+    std::unique_ptr<SkStreamRewindable> stream = mStream->duplicate();
+    lock.unlock();
+    std::unique_ptr<SkBitmapRegionDecoder> decoder;
+    if (stream) {
+        decoder.reset(SkBitmapRegionDecoder::Create(stream.release(),
+                                                    SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+    }
+    if (!decoder) {
+        lock.lock();
+        mDecoderCount--;
+        mDecoderReleased.notify_one();
+    }
+    return decoder;
+}
+
+void TileCache::releaseDecoder(std::unique_ptr<SkBitmapRegionDecoder> decoder) {
+    std::lock_guard<std::mutex> lock(mDecodersLock);
+    mIdleDecoders.push_back(std::move(decoder));
+    mDecoderReleased.notify_one();
+}
+
+bool TileCache::decodeTile(const TileKey& key, const TileConfig& config, Tile* tile) {
+    ATRACE_NAME("decodeTile");
+    const int span = TiledRegionDecoder::kTileSize * key.sampleSize;
+    const int margin = kTileMargin * key.sampleSize;
+    const SkIRect bounds = SkIRect::MakeXYWH(key.column * span, key.row * span, span, span);
+    SkIRect decodeRect = bounds.makeOutset(margin, margin);
+    if (!decodeRect.intersect(SkIRect::MakeWH(mWidth, mHeight))) {
+        return false;
+    }
+
+    std::unique_ptr<SkBitmapRegionDecoder> decoder = acquireDecoder();
+    if (!decoder) {
+        return false;
+    }
+    TileAllocator allocator;
+    const bool decoded = decoder->decodeRegion(&tile->bitmap, &allocator, decodeRect,
+                                               key.sampleSize, config.colorType,
+                                               config.requireUnpremul, config.colorSpace);
+    releaseDecoder(std::move(decoder));
+    if (!decoded) {
+        return false;
+    }
+
+    // Both corners are multiples of the sample size, so the tile starts on a sampled pixel
+    tile->left = (bounds.left() - decodeRect.left()) / key.sampleSize;
+    tile->top = (bounds.top() - decodeRect.top()) / key.sampleSize;
+    tile->bytes = allocator.getAllocationByteCount();
+    return true;
+}
+
+bool TileCache::decodeAndInsert(const TileKey& key, const TileConfig& config, int generation,
+                                Tile* tile) {
+    const bool decoded = decodeTile(key, config, tile);
+    std::lock_guard<std::mutex> lock(mLock);
+    mDecoding.erase(key);
+    if (decoded && generation == mGeneration && !mClosed) {
+        insertLocked(key, *tile);
+    }
+    mTileDecoded.notify_all();
+    return decoded;
+}
+
+bool TileCache::decodeRegion(SkBitmap* bitmap, SkBRDAllocator* allocator,
+                             const SkIRect& subset, int sampleSize) {
+    ATRACE_CALL();
+    const int span = TiledRegionDecoder::kTileSize * sampleSize;
+    const int firstColumn = subset.left() / span;
+    const int firstRow = subset.top() / span;
+    const int columns = (subset.right() - 1) / span - firstColumn + 1;
+    const int rows = (subset.bottom() - 1) / span - firstRow + 1;
+    auto keyAt = [&](int index) {
+        return TileKey{firstColumn + index % columns, firstRow + index / columns, sampleSize};
+    };
+
+    std::vector<Tile> tiles(columns * rows);
+    // Tiles to decode on this thread and the worker threads
+    std::vector<int> missing;
+    // Tiles that the prefetch task is decoding
+    std::vector<int> pending;
+    TileConfig config;
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        config = mConfig;
+        generation = mGeneration;
+        for (int i = 0; i < columns * rows; i++) {
+            const TileKey key = keyAt(i);
+            if (findLocked(key, &tiles[i])) {
+                sHits++;
+            } else if (mDecoding.count(key)) {
+                pending.push_back(i);
+            } else {
+                mDecoding.insert(key);
+                missing.push_back(i);
+            }
+        }
+    }
+
+    std::atomic<bool> failed{false};
+    const int missingCount = static_cast<int>(missing.size());
+    parallelFor(missingCount, kMaxDecoders, [&](int i) {
+        if (!decodeAndInsert(keyAt(missing[i]), config, generation, &tiles[missing[i]])) {
+            failed = true;
+        }
+    });
+    sMisses += missing.size();
+
+    for (int i : pending) {
+        const TileKey key = keyAt(i);
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mTileDecoded.wait(lock, [&] { return !mDecoding.count(key); });
+            if (findLocked(key, &tiles[i])) {
+                sHits++;
+                continue;
+            }
+            mDecoding.insert(key);
+        }
+        // The prefetch failed, or the tile was evicted already
+        sMisses++;
+        if (!decodeAndInsert(key, config, generation, &tiles[i])) {
+            failed = true;
+        }
+    }
+    if (failed) {
+        return false;
+    }
+
+    const SkImageInfo info = tiles[0].bitmap.info().makeWH(subset.width() / sampleSize,
+                                                           subset.height() / sampleSize);
+    if (!bitmap->setInfo(info) || !bitmap->tryAllocPixels(allocator)) {
+        return false;
+    }
+
+    const size_t bytesPerPixel = info.bytesPerPixel();
+    for (int i = 0; i < columns * rows; i++) {
+        const TileKey key = keyAt(i);
+        const Tile& tile = tiles[i];
+        SkIRect bounds = SkIRect::MakeXYWH(key.column * span, key.row * span, span, span);
+        const int boundsLeft = bounds.left();
+        const int boundsTop = bounds.top();
+        bounds.intersect(subset);
+
+        // The subset and the grid line up with the sampled pixels, so all of these are exact
+        const int width = bounds.width() / sampleSize;
+        const int height = bounds.height() / sampleSize;
+        const int srcX = tile.left + (bounds.left() - boundsLeft) / sampleSize;
+        const int srcY = tile.top + (bounds.top() - boundsTop) / sampleSize;
+        const int dstX = (bounds.left() - subset.left()) / sampleSize;
+        const int dstY = (bounds.top() - subset.top()) / sampleSize;
+        if (tile.bitmap.colorType() != info.colorType() ||
+                srcX + width > tile.bitmap.width() || srcY + height > tile.bitmap.height()) {
+            return false;
+        }
+        for (int y = 0; y < height; y++) {
+            memcpy(bitmap->getAddr(dstX, dstY + y), tile.bitmap.getAddr(srcX, srcY + y),
+                   width * bytesPerPixel);
+        }
+    }
+    return true;
+}
+
+void TileCache::prefetchAround(const SkIRect& subset, int sampleSize) {
+    const int span = TiledRegionDecoder::kTileSize * sampleSize;
+    const int firstColumn = subset.left() / span;
+    const int firstRow = subset.top() / span;
+    const int lastColumn = (subset.right() - 1) / span;
+    const int lastRow = (subset.bottom() - 1) / span;
+    const int maxColumn = (mWidth - 1) / span;
+    const int maxRow = (mHeight - 1) / span;
+
+    std::vector<TileKey> ring;
+    for (int row = std::max(0, firstRow - 1); row <= std::min(maxRow, lastRow + 1); row++) {
+        for (int column = std::max(0, firstColumn - 1);
+                column <= std::min(maxColumn, lastColumn + 1); column++) {
+            if (row < firstRow || row > lastRow || column < firstColumn || column > lastColumn) {
+                ring.push_back(TileKey{column, row, sampleSize});
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mClosed) {
+        return;
+    }
+    // Tiles around older regions are no longer interesting
+    mPrefetchQueue = std::move(ring);
+    if (!mPrefetching && !mPrefetchQueue.empty()) {
+        mPrefetching = true;
+        postPrefetch();
+    }
+}
+
+void TileCache::postPrefetch() {
+#ifdef __ANDROID__  // Layoutlib does not support CommonPool
+    // The task keeps the cache alive until it's done, even if the decoder is deleted
+    uirenderer::CommonPool::post([self = shared_from_this()] { self->runPrefetch(); });
+#else
+    mPrefetchQueue.clear();
+    mPrefetching = false;
+#endif
+}
+
+// Decodes a single tile per task, so that prefetching doesn't hold a thread of CommonPool for
+// longer than the other users of the pool are willing to wait
+void TileCache::runPrefetch() {
+    ATRACE_CALL();
+    TileKey key;
+    TileConfig config;
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        // Prefetching never evicts tiles, which may be the ones on screen
+        auto found = mPrefetchQueue.end();
+        if (!mClosed && mBytes + mLastTileBytes <= budget()) {
+            found = std::find_if(mPrefetchQueue.begin(), mPrefetchQueue.end(),
+                                 [this](const TileKey& key) {
+                                     return !mIndex.count(key) && !mDecoding.count(key);
+                                 });
+        }
+        if (found == mPrefetchQueue.end()) {
+            mPrefetchQueue.clear();
+            mPrefetching = false;
+            return;
+        }
+        key = *found;
+        mPrefetchQueue.erase(mPrefetchQueue.begin(), found + 1);
+        mDecoding.insert(key);
+        config = mConfig;
+        generation = mGeneration;
+    }
+    Tile tile;
+    if (decodeAndInsert(key, config, generation, &tile)) {
+        sPrefetched++;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mClosed || mPrefetchQueue.empty()) {
+        mPrefetchQueue.clear();
+        mPrefetching = false;
+    } else {
+        postPrefetch();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<TiledRegionDecoder> TiledRegionDecoder::Make(
+        std::unique_ptr<SkStreamRewindable> stream) {
+    if (!stream) {
+        return nullptr;
+    }
+    std::unique_ptr<SkStreamRewindable> prototype = stream->duplicate();
+    std::unique_ptr<SkBitmapRegionDecoder> decoder(SkBitmapRegionDecoder::Create(
+            stream.release(), SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+    if (!decoder) {
+        return nullptr;
+    }
+
+    std::shared_ptr<TileCache> cache;
+    if (prototype && uirenderer::Properties::regionTileCacheSize > 0) {
+        cache = std::make_shared<TileCache>(std::move(prototype), decoder->width(),
+                                            decoder->height());
+    }
+    return std::unique_ptr<TiledRegionDecoder>(
+            new TiledRegionDecoder(std::move(decoder), std::move(cache)));
+}
+
+TiledRegionDecoder::TiledRegionDecoder(std::unique_ptr<SkBitmapRegionDecoder> decoder,
+                                       std::shared_ptr<TileCache> cache)
+        : mDecoder(std::move(decoder)), mCache(std::move(cache)) {}
+
+TiledRegionDecoder::~TiledRegionDecoder() {
+    if (mCache) {
+        mCache->close();
+    }
+}
+
+bool TiledRegionDecoder::canUseTiles(const SkIRect& subset, int sampleSize,
+                                     SkColorType colorType) const {
+    if (!mCache || sampleSize < 1 || subset.isEmpty() ||
+            !SkIRect::MakeWH(width(), height()).contains(subset)) {
+        return false;
+    }
+    if (subset.left() % sampleSize || subset.top() % sampleSize ||
+            subset.width() % sampleSize || subset.height() % sampleSize) {
+        return false;
+    }
+
+    // Leave room for the tiles around the subset, rather than evicting tiles of the subset
+    // itself while decoding it
+    const int span = kTileSize * sampleSize;
+    const size_t tileCount = ((subset.right() - 1) / span - subset.left() / span + 1) *
+                             ((subset.bottom() - 1) / span - subset.top() / span + 1);
+    const size_t tileBytes = (kTileSize + 2 * kTileMargin) * (kTileSize + 2 * kTileMargin) *
+                             SkColorTypeBytesPerPixel(colorType);
+    return tileCount * tileBytes <= mCache->budget() / 2;
+}
+
+bool TiledRegionDecoder::decodeRegion(SkBitmap* bitmap, SkBRDAllocator* allocator,
+                                      const SkIRect& subset, int sampleSize,
+                                      SkColorType colorType, bool requireUnpremul,
+                                      sk_sp<SkColorSpace> colorSpace) {
+    if (canUseTiles(subset, sampleSize, colorType)) {
+        mCache->setConfig(TileConfig{colorType, requireUnpremul, colorSpace});
+        if (mCache->decodeRegion(bitmap, allocator, subset, sampleSize)) {
+            mCache->prefetchAround(subset, sampleSize);
+            return true;
+        }
+        bitmap->reset();
+    }
+    return mDecoder->decodeRegion(bitmap, allocator, subset, sampleSize, colorType,
+                                  requireUnpremul, std::move(colorSpace));
+}
+
+TiledRegionDecoder::Stats TiledRegionDecoder::stats() {
+    Stats stats;
+    stats.cachedBytes = sCachedBytes;
+    stats.hits = sHits;
+    stats.misses = sMisses;
+    stats.prefetched = sPrefetched;
+    stats.evictions = sEvictions;
+    return stats;
+}
+
+int64_t TiledRegionDecoder::takeCachedBytesDelta() {
+    const size_t cached = sCachedBytes;
+    return static_cast<int64_t>(cached) - static_cast<int64_t>(sReportedBytes.exchange(cached));
+}
+
+void TiledRegionDecoder::trimCaches() {
+    std::lock_guard<std::mutex> lock(sCachesLock);
+    for (TileCache* cache : liveCaches()) {
+        cache->clear();
+    }
+}
+
+}  // namespace android
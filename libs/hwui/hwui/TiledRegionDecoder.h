@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <SkBitmapRegionDecoder.h>
+#include <SkColorSpace.h>
+#include <SkRect.h>
+#include <SkRefCnt.h>
+#include <cutils/compiler.h>
+
+#include <memory>
+
+class SkBitmap;
+class SkStreamRewindable;
+
+namespace android {
+
+class TileCache;
+
+/**
+ * Decodes regions of an image for BitmapRegionDecoder from a cache of decoded tiles, so that
+ * panning and zooming around a large image only decodes the parts that were not seen recently.
+ *
+ * Tiles are kTileSize pixels wide and high once sampled, and are keyed by their position in the
+ * grid of a sample size. Regions that don't line up with the pixels of that grid, or that don't
+ * fit in the cache, are decoded directly like before.
+ *
+ * Missing tiles are decoded concurrently on the calling thread and the threads of CommonPool,
+ * each with its own SkBitmapRegionDecoder on a duplicate of the encoded stream, and the tiles
+ * around the last region are prefetched in the background. Tiles are heap allocated
+ * android::Bitmaps, whose allocation sizes are charged to the cache of their decoder. Every
+ * cache gets an even share of the Properties::regionTileCacheSize MB of the process.
+ */
+class ANDROID_API TiledRegionDecoder {
+public:
+    // Width and height of a tile, in pixels of the sampled image
+    static constexpr int kTileSize = 256;
+
+    static std::unique_ptr<TiledRegionDecoder> Make(std::unique_ptr<SkStreamRewindable> stream);
+
+    ~TiledRegionDecoder();
+
+    int width() const { return mDecoder->width(); }
+    int height() const { return mDecoder->height(); }
+
+    SkEncodedImageFormat getEncodedFormat() { return mDecoder->getEncodedFormat(); }
+
+    SkColorType computeOutputColorType(SkColorType requestedColorType) {
+        return mDecoder->computeOutputColorType(requestedColorType);
+    }
+
+    sk_sp<SkColorSpace> computeOutputColorSpace(SkColorType outputColorType,
+                                                sk_sp<SkColorSpace> prefColorSpace) {
+        return mDecoder->computeOutputColorSpace(outputColorType, std::move(prefColorSpace));
+    }
+
+    /**
+     * "decodeRegion" has the same contract as SkBitmapRegionDecoder::decodeRegion, and must not
+     * be called concurrently on the same decoder.
+     */
+    bool decodeRegion(SkBitmap* bitmap, SkBRDAllocator* allocator, const SkIRect& subset,
+                      int sampleSize, SkColorType colorType, bool requireUnpremul,
+                      sk_sp<SkColorSpace> colorSpace);
+
+    struct Stats {
+        size_t cachedBytes = 0;
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t prefetched = 0;
+        uint32_t evictions = 0;
+    };
+
+    // Totals of the tile caches of every live decoder in the process
+    static Stats stats();
+
+    /**
+     * Returns the change of the bytes of every cached tile since the last call, for the caller
+     * to report to the native allocation accounting of the runtime. Tiles are not owned by any
+     * Java object, so they are not counted otherwise.
+     */
+    static int64_t takeCachedBytesDelta();
+
+    // Drops the cached tiles of every live decoder
+    static void trimCaches();
+
+private:
+    TiledRegionDecoder(std::unique_ptr<SkBitmapRegionDecoder> decoder,
+                       std::shared_ptr<TileCache> cache);
+
+    bool canUseTiles(const SkIRect& subset, int sampleSize, SkColorType colorType) const;
+
+    std::unique_ptr<SkBitmapRegionDecoder> mDecoder;
+    // Shared with the prefetch tasks, which may outlive the decoder. Null if the stream can't be
+    // duplicated, in which case every region is decoded directly
+    std::shared_ptr<TileCache> mCache;
+};
+
+}  // namespace android
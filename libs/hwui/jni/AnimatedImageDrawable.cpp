@@ -76,7 +76,8 @@ static jlong AnimatedImageDrawable_nCreate(JNIEnv* env, jobject /*clazz*/,
     // SkAnimatedImage has one SkBitmap for decoding, plus an extra one if there is a
     // kRestorePrevious frame. AnimatedImageDrawable has two SkPictures storing the current
     // frame and the next frame. (The former assumes that the image is animated, and the
-    // latter assumes that it is drawn to a hardware canvas.)
+    // latter assumes that it is drawn to a hardware canvas.) Frames decoded further ahead
+    // are charged to a budget shared by all drawables instead.
     bytesUsed *= hasRestoreFrame ? 4 : 3;
     sk_sp<SkPicture> picture;
     if (jpostProcess) {
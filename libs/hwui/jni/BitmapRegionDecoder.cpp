@@ -23,13 +23,13 @@
 #include "Utils.h"
 
 #include "SkBitmap.h"
-#include "SkBitmapRegionDecoder.h"
 #include "SkCodec.h"
 #include "SkData.h"
 #include "SkStream.h"
 
 #include <HardwareBitmapUploader.h>
 #include <androidfw/Asset.h>
+#include <hwui/TiledRegionDecoder.h>
 #include <sys/stat.h>
 
 #include <memory>
@@ -37,9 +37,7 @@
 using namespace android;
 
 static jobject createBitmapRegionDecoder(JNIEnv* env, std::unique_ptr<SkStreamRewindable> stream) {
-  std::unique_ptr<SkBitmapRegionDecoder> brd(
-            SkBitmapRegionDecoder::Create(stream.release(),
-                                          SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+    std::unique_ptr<TiledRegionDecoder> brd = TiledRegionDecoder::Make(std::move(stream));
     if (!brd) {
         doThrowIOE(env, "Image format not supported");
         return nullObjectReturn("CreateBitmapRegionDecoder returned null");
@@ -158,7 +156,7 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
         recycledBytes = recycledBitmap->getAllocationByteCount();
     }
 
-    SkBitmapRegionDecoder* brd = reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
+    TiledRegionDecoder* brd = reinterpret_cast<TiledRegionDecoder*>(brdHandle);
     SkColorType decodeColorType = brd->computeOutputColorType(colorType);
     if (decodeColorType == kRGBA_F16_SkColorType && isHardware &&
             !uirenderer::HardwareBitmapUploader::hasFP16Support()) {
@@ -183,8 +181,11 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
     // Decode the region.
     SkIRect subset = SkIRect::MakeXYWH(inputX, inputY, inputWidth, inputHeight);
     SkBitmap bitmap;
-    if (!brd->decodeRegion(&bitmap, allocator, subset, sampleSize,
-            decodeColorType, requireUnpremul, decodeColorSpace)) {
+    const bool decoded = brd->decodeRegion(&bitmap, allocator, subset, sampleSize,
+            decodeColorType, requireUnpremul, decodeColorSpace);
+    // The cached tiles are not part of any bitmap, so they are accounted for separately
+    GraphicsJNI::registerNativeAllocation(env, TiledRegionDecoder::takeCachedBytesDelta());
+    if (!decoded) {
         return nullObjectReturn("Failed to decode region.");
     }
 
@@ -230,21 +231,19 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
 }
 
 static jint nativeGetHeight(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
+    TiledRegionDecoder* brd = reinterpret_cast<TiledRegionDecoder*>(brdHandle);
     return static_cast<jint>(brd->height());
 }
 
 static jint nativeGetWidth(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
+    TiledRegionDecoder* brd = reinterpret_cast<TiledRegionDecoder*>(brdHandle);
     return static_cast<jint>(brd->width());
 }
 
 static void nativeClean(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
+    TiledRegionDecoder* brd = reinterpret_cast<TiledRegionDecoder*>(brdHandle);
     delete brd;
+    GraphicsJNI::registerNativeAllocation(env, TiledRegionDecoder::takeCachedBytesDelta());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -211,6 +211,8 @@ static jobject   gVMRuntime;
 static jclass    gVMRuntime_class;
 static jmethodID gVMRuntime_newNonMovableArray;
 static jmethodID gVMRuntime_addressOf;
+static jmethodID gVMRuntime_registerNativeAllocation;
+static jmethodID gVMRuntime_registerNativeFree;
 
 static jclass gColorSpace_class;
 static jmethodID gColorSpace_getMethodID;
@@ -470,17 +472,28 @@ SkRegion* GraphicsJNI::getNativeRegion(JNIEnv* env, jobject region)
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-jobject GraphicsJNI::createBitmapRegionDecoder(JNIEnv* env, SkBitmapRegionDecoder* bitmap)
+jobject GraphicsJNI::createBitmapRegionDecoder(JNIEnv* env, android::TiledRegionDecoder* decoder)
 {
-    ALOG_ASSERT(bitmap != NULL);
+    ALOG_ASSERT(decoder != NULL);
 
     jobject obj = env->NewObject(gBitmapRegionDecoder_class,
             gBitmapRegionDecoder_constructorMethodID,
-            reinterpret_cast<jlong>(bitmap));
+            reinterpret_cast<jlong>(decoder));
     hasException(env); // For the side effect of logging.
     return obj;
 }
 
+void GraphicsJNI::registerNativeAllocation(JNIEnv* env, int64_t deltaBytes)
+{
+    if (deltaBytes > 0) {
+        env->CallVoidMethod(gVMRuntime, gVMRuntime_registerNativeAllocation,
+                            static_cast<jlong>(deltaBytes));
+    } else if (deltaBytes < 0) {
+        env->CallVoidMethod(gVMRuntime, gVMRuntime_registerNativeFree,
+                            static_cast<jlong>(-deltaBytes));
+    }
+}
+
 jobject GraphicsJNI::createRegion(JNIEnv* env, SkRegion* region)
 {
     ALOG_ASSERT(region != NULL);
@@ -736,6 +749,10 @@ int register_android_graphics_Graphics(JNIEnv* env)
     gVMRuntime_newNonMovableArray = GetMethodIDOrDie(env, gVMRuntime_class, "newNonMovableArray",
                                                      "(Ljava/lang/Class;I)Ljava/lang/Object;");
     gVMRuntime_addressOf = GetMethodIDOrDie(env, gVMRuntime_class, "addressOf", "(Ljava/lang/Object;)J");
+    gVMRuntime_registerNativeAllocation = GetMethodIDOrDie(env, gVMRuntime_class,
+                                                           "registerNativeAllocation", "(J)V");
+    gVMRuntime_registerNativeFree = GetMethodIDOrDie(env, gVMRuntime_class,
+                                                     "registerNativeFree", "(J)V");
 
     gColorSpace_class = MakeGlobalRefOrDie(env, FindClassOrDie(env, "android/graphics/ColorSpace"));
     gColorSpace_getMethodID = GetStaticMethodIDOrDie(env, gColorSpace_class,
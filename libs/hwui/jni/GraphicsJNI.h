@@ -17,11 +17,11 @@
 
 #include "graphics_jni_helpers.h"
 
-class SkBitmapRegionDecoder;
 class SkCanvas;
 
 namespace android {
 class Paint;
+class TiledRegionDecoder;
 struct Typeface;
 }
 
@@ -103,7 +103,14 @@ public:
 
     static jobject createRegion(JNIEnv* env, SkRegion* region);
 
-    static jobject createBitmapRegionDecoder(JNIEnv* env, SkBitmapRegionDecoder* bitmap);
+    static jobject createBitmapRegionDecoder(JNIEnv* env, android::TiledRegionDecoder* decoder);
+
+    /**
+     * Reports native memory that no Java object accounts for to the runtime, so that it is
+     * considered by the garbage collector like the pixels of bitmaps. deltaBytes is the change
+     * since the last report, negative once memory is freed.
+     */
+    static void registerNativeAllocation(JNIEnv* env, int64_t deltaBytes);
 
     /**
      * Given a bitmap we natively allocate a memory block to store the contents
@@ -1,8 +1,11 @@
 #include "CreateJavaOutputStreamAdaptor.h"
 #include "SkJPEGWriteUtility.h"
 #include "YuvToJpegEncoder.h"
+#include "include/private/SkVx.h"
 #include <ui/PixelFormat.h>
 #include <hardware/hardware.h>
+#include <hwui/ParallelEncoder.h>
+#include <Properties.h>
 
 #include "graphics_jni_helpers.h"
 
@@ -34,6 +37,11 @@ void error_exit(j_common_ptr cinfo) {
 
 bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
         int height, int* offsets, int jpegQuality) {
+    const int threadBudget = android::uirenderer::Properties::compressThreads;
+    if (threadBudget > 1 && width * height >= android::ParallelEncoder::kMinPixels) {
+        return encodeStrips(stream, inYuv, width, height, offsets, jpegQuality, threadBudget);
+    }
+
     jpeg_compress_struct    cinfo;
     ErrorMgr                err;
     skjpeg_destination_mgr  sk_wstream(stream);
@@ -53,7 +61,7 @@ bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    compress(&cinfo, (uint8_t*) inYuv, offsets);
+    compress(&cinfo, (uint8_t*) inYuv, offsets, 0);
 
     jpeg_finish_compress(&cinfo);
 
@@ -62,6 +70,20 @@ bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
     return true;
 }
 
+bool YuvToJpegEncoder::encodeStrips(SkWStream* stream, void* inYuv, int width,
+        int height, int* offsets, int jpegQuality, int threadBudget) {
+    auto configure = [&](jpeg_compress_struct* cinfo, int stripHeight) {
+        setJpegCompressStruct(cinfo, width, stripHeight, jpegQuality);
+    };
+    auto writeStrip = [&](jpeg_compress_struct* cinfo, int firstRow, int rowCount) {
+        compress(cinfo, (uint8_t*) inYuv, offsets, firstRow);
+        return true;
+    };
+    // Both formats sample luma 2x2, so MCUs are 16 rows high
+    return android::ParallelEncoder::encodeJpegStrips(stream, width, height, 16, configure,
+            writeStrip, threadBudget);
+}
+
 void YuvToJpegEncoder::setJpegCompressStruct(jpeg_compress_struct* cinfo,
         int width, int height, int quality) {
     cinfo->image_width = width;
@@ -77,6 +99,49 @@ void YuvToJpegEncoder::setJpegCompressStruct(jpeg_compress_struct* cinfo,
     configSamplingFactors(cinfo);
 }
 
+///////////////////////////////////////////////////////////////////
+using ByteLanes = skvx::Vec<32, uint8_t>;
+
+// libjpeg reads rows in whole blocks of DCTSIZE samples, which may extend past
+// the end of the last row of the buffers the planes are deinterleaved into.
+static constexpr int kRowPadding = DCTSIZE;
+
+// Splits count pairs of bytes into the first and the second byte of each pair.
+static void deinterleavePairs(const uint8_t* pairs, uint8_t* first, uint8_t* second,
+        int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        ByteLanes lanes = ByteLanes::Load(pairs + 2 * i);
+        skvx::shuffle<0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30>(lanes)
+                .store(first + i);
+        skvx::shuffle<1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31>(lanes)
+                .store(second + i);
+    }
+    for (; i < count; i++) {
+        first[i] = pairs[2 * i];
+        second[i] = pairs[2 * i + 1];
+    }
+}
+
+// Splits count Y0 U Y1 V quads into 2 * count luma and count samples of each chroma.
+static void deinterleaveYuyv(const uint8_t* yuyv, uint8_t* y, uint8_t* u, uint8_t* v,
+        int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        ByteLanes lanes = ByteLanes::Load(yuyv + 4 * i);
+        skvx::shuffle<0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30>(lanes)
+                .store(y + 2 * i);
+        skvx::shuffle<1, 5, 9, 13, 17, 21, 25, 29>(lanes).store(u + i);
+        skvx::shuffle<3, 7, 11, 15, 19, 23, 27, 31>(lanes).store(v + i);
+    }
+    for (; i < count; i++) {
+        y[2 * i] = yuyv[4 * i];
+        y[2 * i + 1] = yuyv[4 * i + 2];
+        u[i] = yuyv[4 * i + 1];
+        v[i] = yuyv[4 * i + 3];
+    }
+}
+
 ///////////////////////////////////////////////////////////////////
 Yuv420SpToJpegEncoder::Yuv420SpToJpegEncoder(int* strides) :
         YuvToJpegEncoder(strides) {
@@ -84,7 +149,7 @@ Yuv420SpToJpegEncoder::Yuv420SpToJpegEncoder(int* strides) :
 }
 
 void Yuv420SpToJpegEncoder::compress(jpeg_compress_struct* cinfo,
-        uint8_t* yuv, int* offsets) {
+        uint8_t* yuv, int* offsets, int firstRow) {
     SkDebugf("onFlyCompress");
     JSAMPROW y[16];
     JSAMPROW cb[8];
@@ -95,22 +160,23 @@ void Yuv420SpToJpegEncoder::compress(jpeg_compress_struct* cinfo,
     planes[2] = cr;
 
     int width = cinfo->image_width;
-    int height = cinfo->image_height;
+    int height = firstRow + cinfo->image_height;
     uint8_t* yPlanar = yuv + offsets[0];
     uint8_t* vuPlanar = yuv + offsets[1]; //width * height;
-    uint8_t* uRows = new uint8_t [8 * (width >> 1)];
-    uint8_t* vRows = new uint8_t [8 * (width >> 1)];
+    uint8_t* uRows = new uint8_t [8 * (width >> 1) + kRowPadding]();
+    uint8_t* vRows = new uint8_t [8 * (width >> 1) + kRowPadding]();
 
 
     // process 16 lines of Y and 8 lines of U/V each time.
     while (cinfo->next_scanline < cinfo->image_height) {
+        int rowIndex = firstRow + cinfo->next_scanline;
         //deitnerleave u and v
-        deinterleave(vuPlanar, uRows, vRows, cinfo->next_scanline, width, height);
+        deinterleave(vuPlanar, uRows, vRows, rowIndex, width, height);
 
         // Jpeg library ignores the rows whose indices are greater than height.
         for (int i = 0; i < 16; i++) {
             // y row
-            y[i] = yPlanar + (cinfo->next_scanline + i) * fStrides[0];
+            y[i] = yPlanar + (rowIndex + i) * fStrides[0];
 
             // construct u row and v row
             if ((i & 1) == 0) {
@@ -133,13 +199,8 @@ void Yuv420SpToJpegEncoder::deinterleave(uint8_t* vuPlanar, uint8_t* uRows,
     if (numRows > 8) numRows = 8;
     for (int row = 0; row < numRows; ++row) {
         int offset = ((rowIndex >> 1) + row) * fStrides[1];
-        uint8_t* vu = vuPlanar + offset;
-        for (int i = 0; i < (width >> 1); ++i) {
-            int index = row * (width >> 1) + i;
-            uRows[index] = vu[1];
-            vRows[index] = vu[0];
-            vu += 2;
-        }
+        int index = row * (width >> 1);
+        deinterleavePairs(vuPlanar + offset, vRows + index, uRows + index, width >> 1);
     }
 }
 
@@ -160,7 +221,7 @@ Yuv422IToJpegEncoder::Yuv422IToJpegEncoder(int* strides) :
 }
 
 void Yuv422IToJpegEncoder::compress(jpeg_compress_struct* cinfo,
-        uint8_t* yuv, int* offsets) {
+        uint8_t* yuv, int* offsets, int firstRow) {
     SkDebugf("onFlyCompress_422");
     JSAMPROW y[16];
     JSAMPROW cb[16];
@@ -171,16 +232,17 @@ void Yuv422IToJpegEncoder::compress(jpeg_compress_struct* cinfo,
     planes[2] = cr;
 
     int width = cinfo->image_width;
-    int height = cinfo->image_height;
-    uint8_t* yRows = new uint8_t [16 * width];
-    uint8_t* uRows = new uint8_t [16 * (width >> 1)];
-    uint8_t* vRows = new uint8_t [16 * (width >> 1)];
+    int height = firstRow + cinfo->image_height;
+    uint8_t* yRows = new uint8_t [16 * width + kRowPadding]();
+    uint8_t* uRows = new uint8_t [16 * (width >> 1) + kRowPadding]();
+    uint8_t* vRows = new uint8_t [16 * (width >> 1) + kRowPadding]();
 
     uint8_t* yuvOffset = yuv + offsets[0];
 
     // process 16 lines of Y and 16 lines of U/V each time.
     while (cinfo->next_scanline < cinfo->image_height) {
-        deinterleave(yuvOffset, yRows, uRows, vRows, cinfo->next_scanline, width, height);
+        deinterleave(yuvOffset, yRows, uRows, vRows, firstRow + cinfo->next_scanline, width,
+                height);
 
         // Jpeg library ignores the rows whose indices are greater than height.
         for (int i = 0; i < 16; i++) {
@@ -208,15 +270,9 @@ void Yuv422IToJpegEncoder::deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* u
     if (numRows > 16) numRows = 16;
     for (int row = 0; row < numRows; ++row) {
         uint8_t* yuvSeg = yuv + (rowIndex + row) * fStrides[0];
-        for (int i = 0; i < (width >> 1); ++i) {
-            int indexY = row * width + (i << 1);
-            int indexU = row * (width >> 1) + i;
-            yRows[indexY] = yuvSeg[0];
-            yRows[indexY + 1] = yuvSeg[2];
-            uRows[indexU] = yuvSeg[1];
-            vRows[indexU] = yuvSeg[3];
-            yuvSeg += 4;
-        }
+        int indexU = row * (width >> 1);
+        deinterleaveYuyv(yuvSeg, yRows + row * width, uRows + indexU, vRows + indexU,
+                width >> 1);
     }
 }
 
@@ -33,6 +33,16 @@ public:
     bool encode(SkWStream* stream,  void* inYuv, int width,
            int height, int* offsets, int jpegQuality);
 
+    /** Same as encode, but splits the image into strips of whole MCU rows
+     *  that are compressed concurrently and stitched back together.
+     *  Decodes to the same pixels as encode. Large images are encoded this
+     *  way by encode when the compress thread budget allows it.
+     *
+     *  @param threadBudget Maximum number of threads to compress with.
+     */
+    bool encodeStrips(SkWStream* stream, void* inYuv, int width,
+           int height, int* offsets, int jpegQuality, int threadBudget);
+
     virtual ~YuvToJpegEncoder() {}
 
 protected:
@@ -41,8 +51,10 @@ protected:
     void setJpegCompressStruct(jpeg_compress_struct* cinfo, int width,
             int height, int quality);
     virtual void configSamplingFactors(jpeg_compress_struct* cinfo) = 0;
+    // Compresses the rows of the image from firstRow on, as many as cinfo
+    // is set up for. Called concurrently for every strip by encodeStrips.
     virtual void compress(jpeg_compress_struct* cinfo,
-            uint8_t* yuv, int* offsets) = 0;
+            uint8_t* yuv, int* offsets, int firstRow) = 0;
 };
 
 class Yuv420SpToJpegEncoder : public YuvToJpegEncoder {
@@ -56,7 +68,8 @@ private:
             uint8_t*& yPlanar, uint8_t*& uPlanar, uint8_t*& vPlanar);
     void deinterleave(uint8_t* vuPlanar, uint8_t* uRows, uint8_t* vRows,
             int rowIndex, int width, int height);
-    void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
+    void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets,
+            int firstRow);
 };
 
 class Yuv422IToJpegEncoder : public YuvToJpegEncoder {
@@ -66,7 +79,8 @@ public:
 
 private:
     void configSamplingFactors(jpeg_compress_struct* cinfo);
-    void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
+    void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets,
+            int firstRow);
     void deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* uRows,
             uint8_t* vRows, int rowIndex, int width, int height);
 };
@@ -51,37 +51,23 @@ bool HardwareRendererObserver::getNextBuffer(JNIEnv* env, jlongArray metrics, in
     LOG_ALWAYS_FATAL_IF(bufferSize != HardwareRendererObserver::kBufferSize,
                         "Mismatched Java/Native FrameMetrics data format.");
 
-    FrameMetricsNotification& elem = mRingBuffer[mNextInQueue];
-    if (elem.hasData.load()) {
-        env->SetLongArrayRegion(metrics, 0, kBufferSize, elem.buffer);
-        *dropCount = elem.dropCount;
-        mNextInQueue = (mNextInQueue + 1) % kRingSize;
-        elem.hasData = false;
+    int64_t buffer[kBufferSize];
+    uint32_t droppedCount;
+    if (readNextFrame(buffer, &droppedCount)) {
+        env->SetLongArrayRegion(metrics, 0, kBufferSize, buffer);
+        *dropCount = droppedCount;
         return true;
     }
 
     return false;
 }
 
-void HardwareRendererObserver::notify(const int64_t* stats) {
-    FrameMetricsNotification& elem = mRingBuffer[mNextFree];
-
-    if (!elem.hasData.load()) {
-        memcpy(elem.buffer, stats, kBufferSize * sizeof(stats[0]));
-
-        elem.dropCount = mDroppedReports;
-        mDroppedReports = 0;
-        mNextFree = (mNextFree + 1) % kRingSize;
-        elem.hasData = true;
-
-        JNIEnv* env = getenv(mVm);
-        jobject target = env->NewLocalRef(mObserverWeak);
-        if (target != nullptr) {
-            env->CallVoidMethod(target, gHardwareRendererObserverClassInfo.callback);
-            env->DeleteLocalRef(target);
-        }
-    } else {
-        mDroppedReports++;
+void HardwareRendererObserver::notify() {
+    JNIEnv* env = getenv(mVm);
+    jobject target = env->NewLocalRef(mObserverWeak);
+    if (target != nullptr) {
+        env->CallVoidMethod(target, gHardwareRendererObserverClassInfo.callback);
+        env->DeleteLocalRef(target);
     }
 }
 
@@ -31,9 +31,8 @@ public:
 
     /**
      * Retrieves frame metrics for the oldest frame that the renderer has retained. The renderer
-     * will retain a buffer until it has been retrieved, via this method, or its internal storage
-     * is exhausted at which point it informs the caller of how many frames it has failed to store
-     * since the last time this method was invoked.
+     * retains the last FrameMetricsRing::kCapacity frames, and informs the caller of how many
+     * frames it has failed to retain since the last time this method was invoked.
      * @param env java env required to populate the provided buffer array
      * @param metrics output parameter that represents the buffer of metrics that is to be filled
      * @param dropCount output parameter that is updated to reflect the number of buffers that were
@@ -43,33 +42,13 @@ public:
      */
     bool getNextBuffer(JNIEnv* env, jlongArray metrics, int* dropCount);
 
-    void notify(const int64_t* stats) override;
+    void notify() override;
 
 private:
     static constexpr int kBufferSize = static_cast<int>(uirenderer::FrameInfoIndex::NumIndexes);
-    static constexpr int kRingSize = 3;
-
-    class FrameMetricsNotification {
-    public:
-        FrameMetricsNotification() {}
-
-        std::atomic_bool hasData = false;
-        int64_t buffer[kBufferSize];
-        int dropCount = 0;
-    private:
-        // non-copyable
-        FrameMetricsNotification(const FrameMetricsNotification&) = delete;
-        FrameMetricsNotification& operator=(const FrameMetricsNotification& ) = delete;
-    };
 
     JavaVM* const mVm;
     jweak mObserverWeak;
-
-    int mNextFree = 0;
-    int mNextInQueue = 0;
-    FrameMetricsNotification mRingBuffer[kRingSize];
-
-    int mDroppedReports = 0;
 };
 
 } // namespace android
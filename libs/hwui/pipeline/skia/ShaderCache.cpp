@@ -18,11 +18,13 @@
 #include <GrContext.h>
 #include <log/log.h>
 #include <openssl/sha.h>
+#include <utils/String8.h>
 #include <algorithm>
 #include <array>
-#include <thread>
-#include "FileBlobCache.h"
+#include "BlobCache.h"
 #include "Properties.h"
+#include "ShaderCacheJournal.h"
+#include "thread/ThreadBase.h"
 #include "utils/TraceUtils.h"
 
 namespace android {
@@ -35,7 +37,7 @@ static const size_t maxValueSize = 512 * 1024;
 static const size_t maxTotalSize = 1024 * 1024;
 
 ShaderCache::ShaderCache() {
-    // There is an "incomplete FileBlobCache type" compilation error, if ctor is moved to header.
+    // There is an "incomplete BlobCache type" compilation error, if ctor is moved to header.
 }
 
 ShaderCache ShaderCache::sCache;
@@ -52,6 +54,7 @@ bool ShaderCache::validateCache(const void* identity, ssize_t size) {
             ALOGW("ShaderCache::validateCache invalid cache identity");
         }
         mBlobCache->clear();
+        mJournalResetPending = true;
         return false;
     }
 
@@ -72,21 +75,60 @@ bool ShaderCache::validateCache(const void* identity, ssize_t size) {
         ALOGW("ShaderCache::validateCache cache validation fails");
     }
     mBlobCache->clear();
+    mJournalResetPending = true;
     return false;
 }
 
 void ShaderCache::initShaderDiskCache(const void* identity, ssize_t size) {
     ATRACE_NAME("initShaderDiskCache");
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<ShaderCacheJournal> journal;
+    sp<ThreadBase> worker;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Emulators can switch between different renders either as part of config
+        // or snapshot migration. Also, program binaries may not work well on some
+        // desktop / laptop GPUs. Thus, disable the shader disk cache for emulator builds.
+        if (Properties::runningInEmulator || mFilename.length() == 0) {
+            return;
+        }
+        mInitStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        mTimeToFirstHit = -1;
+        mInitialized = false;
+        mJournalResetPending = false;
+        mBlobCache.reset(new BlobCache(maxKeySize, maxValueSize, maxTotalSize));
+        mJournal = std::make_shared<ShaderCacheJournal>(mFilename, maxTotalSize);
+        // Evicting the identity hash would invalidate the whole cache on the next load
+        auto idKey = sIDKey;
+        mJournal->pinKey(&idKey, sizeof(idKey));
+        if (!mWorker) {
+            mWorker = new ThreadBase();
+            mWorker->start("hwuiShaderCache");
+        }
+        journal = mJournal;
+        worker = mWorker;
+    }
 
-    // Emulators can switch between different renders either as part of config
-    // or snapshot migration. Also, program binaries may not work well on some
-    // desktop / laptop GPUs. Thus, disable the shader disk cache for emulator builds.
-    if (!Properties::runningInEmulator && mFilename.length() > 0) {
-        mBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize, maxTotalSize, mFilename));
-        validateCache(identity, size);
-        mInitialized = true;
+    // Replay on the worker so that appends still pending for a previous journal land first.
+    // mMutex must not be held while waiting, as the worker needs it to fill the cache.
+    worker->queue().runSync([&]() {
+        journal->replay([this](const void* key, size_t keySize, const void* value,
+                               size_t valueSize) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mBlobCache) {
+                mBlobCache->set(key, keySize, value, valueSize);
+            }
+        });
+    });
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mJournal != journal) {
+        // Raced with another initialization, which wins
+        return;
     }
+    mReplayDuration = systemTime(SYSTEM_TIME_MONOTONIC) - mInitStartTime;
+    validateCache(identity, size);
+    mInitialized = true;
 }
 
 void ShaderCache::setFilename(const char* filename) {
@@ -128,6 +170,7 @@ sk_sp<SkData> ShaderCache::load(const SkData& key) {
         maxTries--;
     }
     if (!valueSize) {
+        mLoadMisses++;
         free(valueBuffer);
         return nullptr;
     }
@@ -136,17 +179,58 @@ sk_sp<SkData> ShaderCache::load(const SkData& key) {
         free(valueBuffer);
         return nullptr;
     }
+    mLoadHits++;
+    if (mTimeToFirstHit < 0) {
+        mTimeToFirstHit = systemTime(SYSTEM_TIME_MONOTONIC) - mInitStartTime;
+    }
     return SkData::MakeFromMalloc(valueBuffer, valueSize);
 }
 
+static void postAppend(ThreadBase& worker, const std::shared_ptr<ShaderCacheJournal>& journal,
+                       const void* key, size_t keySize, const void* value, size_t valueSize) {
+    // Copy the data, the caller's buffers don't outlive this call
+    auto keyData = SkData::MakeWithCopy(key, keySize);
+    auto valueData = SkData::MakeWithCopy(value, valueSize);
+    worker.queue().post([journal, keyData, valueData]() {
+        journal->append(keyData->data(), keyData->size(), valueData->data(), valueData->size());
+    });
+}
+
+void ShaderCache::resetJournalIfPendingLocked() {
+    if (!mJournalResetPending) return;
+    // The cache was cleared by a failed validation, so is the journal. Start it over
+    // with the new identity hash.
+    mJournalResetPending = false;
+    mWorker->queue().post([journal = mJournal]() { journal->reset(); });
+    if (mIDHash.size()) {
+        auto key = sIDKey;
+        mBlobCache->set(&key, sizeof(key), mIDHash.data(), mIDHash.size());
+        postAppend(*mWorker, mJournal, &key, sizeof(key), mIDHash.data(), mIDHash.size());
+    }
+}
+
+void ShaderCache::appendToJournalLocked(const void* key, size_t keySize, const void* value,
+                                        size_t valueSize) {
+    resetJournalIfPendingLocked();
+    postAppend(*mWorker, mJournal, key, keySize, value, valueSize);
+}
+
 void ShaderCache::saveToDiskLocked() {
     ATRACE_NAME("ShaderCache::saveToDiskLocked");
     if (mInitialized && mBlobCache && mSavePending) {
-        if (mIDHash.size()) {
-            auto key = sIDKey;
-            mBlobCache->set(&key, sizeof(key), mIDHash.data(), mIDHash.size());
+        resetJournalIfPendingLocked();
+        if (mPipelineCacheKey.size()) {
+            size_t valueSize = mBlobCache->get(mPipelineCacheKey.data(), mPipelineCacheKey.size(),
+                                               nullptr, 0);
+            if (valueSize > 0) {
+                std::vector<uint8_t> value(valueSize);
+                mBlobCache->get(mPipelineCacheKey.data(), mPipelineCacheKey.size(), value.data(),
+                                value.size());
+                appendToJournalLocked(mPipelineCacheKey.data(), mPipelineCacheKey.size(),
+                                      value.data(), value.size());
+            }
+            mPipelineCacheKey.clear();
         }
-        mBlobCache->writeToFile();
     }
     mSavePending = false;
 }
@@ -180,6 +264,8 @@ void ShaderCache::store(const SkData& key, const SkData& data) {
             return;
         }
         mNewPipelineCacheSize = valueSize;
+        // The pipeline cache is rewritten on every flush, only persist it on deferred saves
+        mPipelineCacheKey.assign(key.bytes(), key.bytes() + keySize);
     } else {
         mCacheDirty = true;
         // If there are new shaders compiled, we probably have new pipeline state too.
@@ -188,11 +274,13 @@ void ShaderCache::store(const SkData& key, const SkData& data) {
         mTryToStorePipelineCache = true;
     }
     bc->set(key.data(), keySize, value, valueSize);
+    if (!mInStoreVkPipelineInProgress) {
+        appendToJournalLocked(key.data(), keySize, value, valueSize);
+    }
 
     if (!mSavePending && mDeferredSaveDelay > 0) {
         mSavePending = true;
-        std::thread deferredSaveThread([this]() {
-            sleep(mDeferredSaveDelay);
+        mWorker->queue().postDelayed(s2ns(mDeferredSaveDelay), [this]() {
             std::lock_guard<std::mutex> lock(mMutex);
             // Store file on disk if there a new shader or Vulkan pipeline cache size changed.
             if (mCacheDirty || mNewPipelineCacheSize != mOldPipelineCacheSize) {
@@ -200,9 +288,10 @@ void ShaderCache::store(const SkData& key, const SkData& data) {
                 mOldPipelineCacheSize = mNewPipelineCacheSize;
                 mTryToStorePipelineCache = false;
                 mCacheDirty = false;
+            } else {
+                mSavePending = false;
             }
         });
-        deferredSaveThread.detach();
     }
 }
 
@@ -219,6 +308,40 @@ void ShaderCache::onVkFrameFlushed(GrContext* context) {
     mInStoreVkPipelineInProgress = false;
 }
 
+void ShaderCache::dump(String8& log) {
+    std::shared_ptr<ShaderCacheJournal> journal;
+    sp<ThreadBase> worker;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        log.appendFormat("Shader Cache:\n");
+        if (!mInitialized) {
+            log.appendFormat("  Not initialized\n");
+            return;
+        }
+        log.appendFormat("  Journal: %s\n", mFilename.c_str());
+        log.appendFormat("  Loads: %u hits, %u misses\n", mLoadHits, mLoadMisses);
+        log.appendFormat("  Replay time: %.2f ms\n", mReplayDuration / 1000000.0f);
+        if (mTimeToFirstHit >= 0) {
+            log.appendFormat("  Time to first hit: %.2f ms\n", mTimeToFirstHit / 1000000.0f);
+        } else {
+            log.appendFormat("  Time to first hit: none yet\n");
+        }
+        journal = mJournal;
+        worker = mWorker;
+    }
+    // The journal is only ever touched on the worker
+    ShaderCacheJournal::Stats stats = worker->queue().runSync([&]() { return journal->stats(); });
+    log.appendFormat("  Journal size: %.2f kB (%.2f kB live)\n", stats.fileSize / 1024.0f,
+                     stats.liveSize / 1024.0f);
+    log.appendFormat("  Records replayed: %u, dropped: %u\n", stats.recordsReplayed,
+                     stats.recordsDropped);
+    log.appendFormat("  Write amplification: %.2f (%.2f kB written for %.2f kB stored), "
+                     "%u compactions\n",
+                     stats.bytesStored ? (double)stats.bytesWritten / stats.bytesStored : 0.0,
+                     stats.bytesWritten / 1024.0f, stats.bytesStored / 1024.0f,
+                     stats.compactions);
+}
+
 } /* namespace skiapipeline */
 } /* namespace uirenderer */
 } /* namespace android */
@@ -18,6 +18,8 @@
 
 #include <GrContextOptions.h>
 #include <cutils/compiler.h>
+#include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -26,11 +28,16 @@
 namespace android {
 
 class BlobCache;
-class FileBlobCache;
+class String8;
 
 namespace uirenderer {
+
+class ThreadBase;
+
 namespace skiapipeline {
 
+class ShaderCacheJournal;
+
 class ShaderCache : public GrContextOptions::PersistentCache {
 public:
     /**
@@ -82,6 +89,12 @@ public:
      */
     void onVkFrameFlushed(GrContext* context);
 
+    /**
+     * "dump" appends the journal size, write amplification, load hit rate and the time it took
+     * from initialization to the first cache hit to the given log.
+     */
+    void dump(String8& log);
+
 private:
     // Creation and (the lack of) destruction is handled internally.
     ShaderCache();
@@ -105,12 +118,25 @@ private:
     bool validateCache(const void* identity, ssize_t size);
 
     /**
-     * "saveToDiskLocked" attemps to save the current contents of the cache to
-     * disk. If the identity hash exists, we will insert the identity hash into
-     * the cache for next validation.
+     * "saveToDiskLocked" schedules the data that is only persisted periodically (a pending
+     * reset of the journal after a failed validation, the identity hash and the Vulkan pipeline
+     * cache) to be appended to the journal. It never waits for the disk.
      */
     void saveToDiskLocked();
 
+    /**
+     * "resetJournalIfPendingLocked" schedules the journal to be reset if the cache was cleared
+     * since the last time it was persisted, and appends the identity hash to it.
+     */
+    void resetJournalIfPendingLocked();
+
+    /**
+     * "appendToJournalLocked" schedules a key/value blob pair to be appended to the journal
+     * by the worker thread.
+     */
+    void appendToJournalLocked(const void* key, size_t keySize, const void* value,
+                               size_t valueSize);
+
     /**
      * "mInitialized" indicates whether the ShaderCache is in the initialized
      * state.  It is initialized to false at construction time, and gets set to
@@ -122,13 +148,35 @@ private:
     bool mInitialized = false;
 
     /**
-     * "mBlobCache" is the cache in which the key/value blob pairs are stored.  It
-     * is initially NULL, and will be initialized by getBlobCacheLocked the
-     * first time it's needed.
-     * The blob cache contains the Android build number. We treat version mismatches as an empty
-     * cache (logic implemented in BlobCache::unflatten).
+     * "mBlobCache" is the in-memory cache in which the key/value blob pairs are stored. It is
+     * created by initShaderDiskCache and filled by replaying the journal.
      */
-    std::unique_ptr<FileBlobCache> mBlobCache;
+    std::unique_ptr<BlobCache> mBlobCache;
+
+    /**
+     * "mJournal" is the append-only file the cache contents are persisted to. It is only ever
+     * accessed from mWorker. The journal contains the Android build fingerprint. We treat
+     * mismatches as an empty cache.
+     */
+    std::shared_ptr<ShaderCacheJournal> mJournal;
+
+    /**
+     * "mWorker" is the thread all disk operations on the journal are performed on, so that
+     * neither load nor store ever wait for the disk.
+     */
+    sp<ThreadBase> mWorker;
+
+    /**
+     * "mJournalResetPending" is set when the cache was cleared after a failed validation. The
+     * journal is reset the next time data is persisted.
+     */
+    bool mJournalResetPending = false;
+
+    /**
+     * "mPipelineCacheKey" is the key the Vulkan pipeline cache was last stored with. The
+     * pipeline cache changes often, so it is only appended to the journal on deferred saves.
+     */
+    std::vector<uint8_t> mPipelineCacheKey;
 
     /**
      * "mFilename" is the name of the file for storing cache contents in between
@@ -200,6 +248,16 @@ private:
      */
     bool mCacheDirty = false;
 
+    /**
+     * Statistics reported by dump. "mTimeToFirstHit" is the time from the start of
+     * initShaderDiskCache to the first successful load, or -1 if there wasn't any yet.
+     */
+    nsecs_t mInitStartTime = 0;
+    nsecs_t mReplayDuration = 0;
+    nsecs_t mTimeToFirstHit = -1;
+    uint32_t mLoadHits = 0;
+    uint32_t mLoadMisses = 0;
+
     /**
      * "sCache" is the singleton ShaderCache object.
      */
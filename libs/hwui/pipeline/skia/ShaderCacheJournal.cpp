@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ShaderCacheJournal.h"
+
+#include <android-base/properties.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "utils/TraceUtils.h"
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+static constexpr uint32_t kJournalMagic = 0x4a534857;  // 'WHSJ'
+static constexpr uint32_t kJournalVersion = 1;
+
+// Don't bother compacting journals smaller than this
+static constexpr size_t kMinCompactionSize = 256 * 1024;
+
+// Once the live records exceed the maximum size, compaction evicts them down to this ratio of it
+static constexpr float kEvictionLowWaterRatio = 0.75f;
+
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t buildIdSize;
+    // followed by buildIdSize bytes of build fingerprint
+};
+
+struct RecordHeader {
+    uint32_t keySize;
+    uint32_t valueSize;
+    // crc32 of keySize, valueSize, the key and the value
+    uint32_t crc;
+    // followed by keySize bytes of key and valueSize bytes of value
+};
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t size) {
+    static const auto sTable = [] {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = sTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t recordCrc(uint32_t keySize, uint32_t valueSize, const void* key,
+                          const void* value) {
+    uint32_t sizes[2] = {keySize, valueSize};
+    uint32_t crc = crc32(0, sizes, sizeof(sizes));
+    crc = crc32(crc, key, keySize);
+    return crc32(crc, value, valueSize);
+}
+
+static const std::string& buildId() {
+    static const std::string sBuildId = base::GetProperty("ro.build.fingerprint", "");
+    return sBuildId;
+}
+
+static size_t headerSize() {
+    return sizeof(JournalHeader) + buildId().size();
+}
+
+static size_t hashKey(const void* key, size_t keySize) {
+    return std::hash<std::string_view>{}(
+            std::string_view(reinterpret_cast<const char*>(key), keySize));
+}
+
+static bool readFile(const std::string& filename, std::vector<uint8_t>* outData) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ALOGE("ShaderCacheJournal: unable to open %s: %s (%d)", filename.c_str(),
+                  strerror(errno), errno);
+        }
+        return false;
+    }
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        ALOGE("ShaderCacheJournal: unable to stat %s: %s (%d)", filename.c_str(), strerror(errno),
+              errno);
+        close(fd);
+        return false;
+    }
+    outData->resize(statBuf.st_size);
+    size_t done = 0;
+    while (done < outData->size()) {
+        ssize_t ret = TEMP_FAILURE_RETRY(read(fd, outData->data() + done, outData->size() - done));
+        if (ret <= 0) {
+            ALOGE("ShaderCacheJournal: error reading %s: %s (%d)", filename.c_str(),
+                  strerror(errno), errno);
+            close(fd);
+            return false;
+        }
+        done += ret;
+    }
+    close(fd);
+    return true;
+}
+
+static bool isValidHeader(const std::vector<uint8_t>& data) {
+    if (data.size() < sizeof(JournalHeader)) return false;
+    JournalHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    const std::string& id = buildId();
+    return header.magic == kJournalMagic && header.version == kJournalVersion &&
+           header.buildIdSize == id.size() && data.size() >= headerSize() &&
+           memcmp(data.data() + sizeof(JournalHeader), id.data(), id.size()) == 0;
+}
+
+// Calls visitor for each valid record following the header and returns the offset just past
+// the last valid one
+template <typename F>
+static size_t forEachRecord(const std::vector<uint8_t>& data, F&& visitor) {
+    size_t offset = headerSize();
+    while (data.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        memcpy(&header, data.data() + offset, sizeof(header));
+        size_t recordSize = sizeof(RecordHeader) + header.keySize + header.valueSize;
+        if (header.keySize == 0 || header.keySize > data.size() ||
+            header.valueSize > data.size() || recordSize > data.size() - offset) {
+            break;
+        }
+        const uint8_t* key = data.data() + offset + sizeof(RecordHeader);
+        const uint8_t* value = key + header.keySize;
+        if (recordCrc(header.keySize, header.valueSize, key, value) != header.crc) {
+            break;
+        }
+        visitor(offset, key, header.keySize, value, header.valueSize);
+        offset += recordSize;
+    }
+    return offset;
+}
+
+ShaderCacheJournal::ShaderCacheJournal(const std::string& filename, size_t maxTotalSize)
+        : mFilename(filename), mMaxTotalSize(maxTotalSize) {}
+
+ShaderCacheJournal::~ShaderCacheJournal() {
+    closeFd();
+}
+
+void ShaderCacheJournal::pinKey(const void* key, size_t keySize) {
+    mPinnedKeys.emplace(reinterpret_cast<const char*>(key), keySize);
+}
+
+void ShaderCacheJournal::closeFd() {
+    if (mFd != -1) {
+        close(mFd);
+        mFd = -1;
+    }
+}
+
+bool ShaderCacheJournal::writeFully(const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(mFd, bytes, size));
+        if (ret < 0) {
+            ALOGE("ShaderCacheJournal: error writing %s: %s (%d)", mFilename.c_str(),
+                  strerror(errno), errno);
+            return false;
+        }
+        bytes += ret;
+        size -= ret;
+        mStats.bytesWritten += ret;
+    }
+    return true;
+}
+
+bool ShaderCacheJournal::replay(const Visitor& visitor) {
+    ATRACE_NAME("ShaderCacheJournal::replay");
+    closeFd();
+    mLiveRecords.clear();
+    mStats.fileSize = 0;
+    mStats.liveSize = 0;
+
+    std::vector<uint8_t> data;
+    if (!readFile(mFilename, &data) || !isValidHeader(data)) {
+        mNeedsHeader = true;
+        return false;
+    }
+
+    size_t validSize = forEachRecord(data, [&](size_t offset, const uint8_t* key, size_t keySize,
+                                               const uint8_t* value, size_t valueSize) {
+        visitor(key, keySize, value, valueSize);
+        size_t recordSize = sizeof(RecordHeader) + keySize + valueSize;
+        size_t& liveSize = mLiveRecords[hashKey(key, keySize)];
+        mStats.liveSize += recordSize - liveSize;
+        liveSize = recordSize;
+        mStats.recordsReplayed++;
+    });
+
+    mNeedsHeader = false;
+    mStats.fileSize = validSize;
+    if (validSize != data.size()) {
+        // Drop the torn tail so that new records are appended after the last valid one
+        ALOGW("ShaderCacheJournal: dropping %zu corrupt bytes at the end of %s",
+              data.size() - validSize, mFilename.c_str());
+        mStats.recordsDropped++;
+        if (truncate(mFilename.c_str(), validSize) == -1) {
+            ALOGE("ShaderCacheJournal: unable to truncate %s: %s (%d)", mFilename.c_str(),
+                  strerror(errno), errno);
+            mNeedsHeader = true;
+        }
+    }
+    return true;
+}
+
+bool ShaderCacheJournal::openForAppend() {
+    if (mFd != -1) return true;
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (mNeedsHeader) {
+        flags |= O_TRUNC;
+    }
+    mFd = open(mFilename.c_str(), flags, S_IRUSR | S_IWUSR);
+    if (mFd == -1) {
+        ALOGE("ShaderCacheJournal: unable to open %s for writing: %s (%d)", mFilename.c_str(),
+              strerror(errno), errno);
+        return false;
+    }
+    if (mNeedsHeader) {
+        const std::string& id = buildId();
+        JournalHeader header{kJournalMagic, kJournalVersion, static_cast<uint32_t>(id.size())};
+        if (!writeFully(&header, sizeof(header)) || !writeFully(id.data(), id.size())) {
+            closeFd();
+            return false;
+        }
+        mNeedsHeader = false;
+        mLiveRecords.clear();
+        mStats.fileSize = headerSize();
+        mStats.liveSize = 0;
+    }
+    return true;
+}
+
+void ShaderCacheJournal::append(const void* key, size_t keySize, const void* value,
+                                size_t valueSize) {
+    ATRACE_NAME("ShaderCacheJournal::append");
+    if (!openForAppend()) return;
+
+    // Write the record in one go so that a crash can only ever leave a truncated last record
+    size_t recordSize = sizeof(RecordHeader) + keySize + valueSize;
+    std::vector<uint8_t> record(recordSize);
+    RecordHeader header{static_cast<uint32_t>(keySize), static_cast<uint32_t>(valueSize),
+                        recordCrc(keySize, valueSize, key, value)};
+    memcpy(record.data(), &header, sizeof(header));
+    memcpy(record.data() + sizeof(header), key, keySize);
+    memcpy(record.data() + sizeof(header) + keySize, value, valueSize);
+    mStats.bytesStored += keySize + valueSize;
+    if (!writeFully(record.data(), record.size())) {
+        // The file may now end with a partial record, start over on the next append
+        closeFd();
+        mNeedsHeader = true;
+        return;
+    }
+
+    mStats.fileSize += recordSize;
+    size_t& liveSize = mLiveRecords[hashKey(key, keySize)];
+    mStats.liveSize += recordSize - liveSize;
+    liveSize = recordSize;
+
+    compactIfNeeded();
+}
+
+void ShaderCacheJournal::reset() {
+    ATRACE_NAME("ShaderCacheJournal::reset");
+    closeFd();
+    mNeedsHeader = true;
+    openForAppend();
+}
+
+void ShaderCacheJournal::compactIfNeeded() {
+    size_t fileSize = mStats.fileSize;
+    if (mStats.liveSize > mMaxTotalSize) {
+        compact(mMaxTotalSize * kEvictionLowWaterRatio);
+    } else if (fileSize > kMinCompactionSize && fileSize > 2 * mStats.liveSize) {
+        compact(mMaxTotalSize);
+    }
+}
+
+void ShaderCacheJournal::compact(size_t targetSize) {
+    ATRACE_NAME("ShaderCacheJournal::compact");
+    closeFd();
+    std::vector<uint8_t> data;
+    if (!readFile(mFilename, &data) || !isValidHeader(data)) {
+        mNeedsHeader = true;
+        return;
+    }
+
+    struct Record {
+        size_t offset;
+        size_t size;
+        std::string_view key;
+    };
+    std::vector<Record> records;
+    // Size of the latest record of each pinned key, which is kept whatever its age
+    std::unordered_map<std::string_view, size_t> pinnedSizes;
+    forEachRecord(data, [&](size_t offset, const uint8_t* key, size_t keySize,
+                            const uint8_t* value, size_t valueSize) {
+        records.push_back({offset, sizeof(RecordHeader) + keySize + valueSize,
+                           std::string_view(reinterpret_cast<const char*>(key), keySize)});
+        if (mPinnedKeys.count(std::string(records.back().key))) {
+            pinnedSizes[records.back().key] = records.back().size;
+        }
+    });
+    size_t keptSize = 0;
+    for (const auto& pinned : pinnedSizes) {
+        keptSize += pinned.second;
+    }
+
+    // Walk backwards so that only the latest record of each key is kept, preferring the
+    // most recently written ones if they don't all fit
+    std::unordered_set<std::string_view> seen;
+    std::vector<const Record*> kept;
+    for (auto it = records.rbegin(); it != records.rend(); it++) {
+        if (!seen.insert(it->key).second) continue;
+        if (pinnedSizes.count(it->key) == 0) {
+            if (keptSize + it->size > targetSize) continue;
+            keptSize += it->size;
+        }
+        kept.push_back(&*it);
+    }
+
+    std::string tmpFilename = mFilename + ".tmp";
+    mFd = open(tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (mFd == -1) {
+        ALOGE("ShaderCacheJournal: unable to create %s: %s (%d)", tmpFilename.c_str(),
+              strerror(errno), errno);
+        return;
+    }
+    bool success = writeFully(data.data(), headerSize());
+    for (auto it = kept.rbegin(); success && it != kept.rend(); it++) {
+        success = writeFully(data.data() + (*it)->offset, (*it)->size);
+    }
+    // Make sure the new journal is on disk before it replaces the old one
+    success = success && fsync(mFd) == 0;
+    closeFd();
+    if (!success || rename(tmpFilename.c_str(), mFilename.c_str()) == -1) {
+        ALOGE("ShaderCacheJournal: unable to compact %s", mFilename.c_str());
+        unlink(tmpFilename.c_str());
+        return;
+    }
+
+    mLiveRecords.clear();
+    for (const Record* record : kept) {
+        mLiveRecords[hashKey(record->key.data(), record->key.size())] = record->size;
+    }
+    mStats.fileSize = headerSize() + keptSize;
+    mStats.liveSize = keptSize;
+    mStats.compactions++;
+}
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
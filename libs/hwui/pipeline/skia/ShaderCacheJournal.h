@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+/**
+ * An append-only, on-disk log of key/value blob pairs used to persist the ShaderCache.
+ *
+ * The file starts with a header identifying the format and the build that wrote it, followed
+ * by records of the form [keySize][valueSize][crc32][key][value]. New entries are appended with
+ * a single write, so a crash can at most leave a partial record at the end of the file, which is
+ * detected by its size or checksum and dropped on the next replay. A key may appear several
+ * times; the last record wins. Once enough of the file is made of overwritten records it is
+ * compacted by rewriting only the latest record of each key.
+ *
+ * ShaderCacheJournal is not thread safe. ShaderCache only ever calls it from its worker thread.
+ */
+class ShaderCacheJournal {
+public:
+    using Visitor = std::function<void(const void* key, size_t keySize, const void* value,
+                                       size_t valueSize)>;
+
+    struct Stats {
+        // Current size of the journal on disk
+        size_t fileSize = 0;
+        // Size of the latest record of each key, i.e. the size of the file after compaction
+        size_t liveSize = 0;
+        // Key and value bytes handed to append() since the journal was opened
+        uint64_t bytesStored = 0;
+        // Bytes written to disk since the journal was opened, including framing and compaction
+        uint64_t bytesWritten = 0;
+        uint32_t recordsReplayed = 0;
+        // Records discarded on replay because they were truncated or corrupt
+        uint32_t recordsDropped = 0;
+        uint32_t compactions = 0;
+    };
+
+    /**
+     * maxTotalSize bounds the size of the live records. When it is exceeded, a compaction drops
+     * the oldest records until they fit in 3/4 of it, mirroring the eviction of the in-memory
+     * cache, so that the journal isn't compacted again by the next few appends.
+     */
+    ShaderCacheJournal(const std::string& filename, size_t maxTotalSize);
+    ~ShaderCacheJournal();
+
+    /**
+     * "pinKey" makes compactions keep the latest record of key, however old it is.
+     */
+    void pinKey(const void* key, size_t keySize);
+
+    /**
+     * "replay" calls visitor for every valid record in the journal, in the order they were
+     * appended. Reading stops at the first truncated or corrupt record, which is removed from
+     * the file together with anything following it. Returns false if the file doesn't exist or
+     * was written by another build or format version, in which case it will be rewritten from
+     * scratch on the next append.
+     */
+    bool replay(const Visitor& visitor);
+
+    /**
+     * "append" adds a record to the end of the journal, compacting it afterwards if needed.
+     */
+    void append(const void* key, size_t keySize, const void* value, size_t valueSize);
+
+    /**
+     * "reset" discards every record in the journal.
+     */
+    void reset();
+
+    const Stats& stats() const { return mStats; }
+
+private:
+    bool openForAppend();
+    void closeFd();
+    bool writeFully(const void* data, size_t size);
+    void compactIfNeeded();
+    // Rewrites the latest record of each key, dropping the oldest ones past targetSize
+    void compact(size_t targetSize);
+
+    const std::string mFilename;
+    const size_t mMaxTotalSize;
+    int mFd = -1;
+    // Set when the file on disk isn't a valid journal and must be rewritten before appending
+    bool mNeedsHeader = true;
+
+    // Hash of each key to the size of its latest record, used to track mStats.liveSize
+    std::unordered_map<size_t, size_t> mLiveRecords;
+
+    // Keys never dropped by a compaction, see pinKey()
+    std::unordered_set<std::string> mPinnedKeys;
+
+    Stats mStats;
+};
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
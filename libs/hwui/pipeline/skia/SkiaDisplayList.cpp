@@ -151,6 +151,10 @@ bool SkiaDisplayList::prepareListAndChildren(
             if (intersects(info.screenSize, totalMatrix, bounds)) {
                 isDirty = true;
                 vectorDrawable->setPropertyChangeWillBeConsumed(true);
+                if (Properties::prerasterizeVectorDrawables) {
+                    // Repaint the cache on a worker while the rest of the tree is prepared
+                    vectorDrawable->prerasterizeAsync();
+                }
             }
         }
     }
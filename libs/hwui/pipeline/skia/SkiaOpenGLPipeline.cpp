@@ -70,12 +70,12 @@ Frame SkiaOpenGLPipeline::getFrame() {
 }
 
 bool SkiaOpenGLPipeline::draw(const Frame& frame, const SkRect& screenDirty, const SkRect& dirty,
-                              const LightGeometry& lightGeometry,
+                              const DamageRegion& dirtyRegion, const LightGeometry& lightGeometry,
                               LayerUpdateQueue* layerUpdateQueue, const Rect& contentDrawBounds,
                               bool opaque, const LightInfo& lightInfo,
                               const std::vector<sp<RenderNode>>& renderNodes,
                               FrameInfoVisualizer* profiler) {
-    mEglManager.damageFrame(frame, dirty);
+    mEglManager.damageFrame(frame, dirty, dirtyRegion);
 
     SkColorType colorType = getSurfaceColorType();
     // setup surface for fbo0
@@ -102,7 +102,7 @@ bool SkiaOpenGLPipeline::draw(const Frame& frame, const SkRect& screenDirty, con
 
     LightingInfo::updateLighting(lightGeometry, lightInfo);
     renderFrame(*layerUpdateQueue, dirty, renderNodes, opaque, contentDrawBounds, surface,
-                SkMatrix::I());
+                SkMatrix::I(), &dirtyRegion);
     layerUpdateQueue->clear();
 
     // Draw visual debugging features
@@ -24,6 +24,7 @@
 #include <SkOverdrawColorFilter.h>
 #include <SkPicture.h>
 #include <SkPictureRecorder.h>
+#include <SkRegion.h>
 #include <SkSerialProcs.h>
 #include <SkTypeface.h>
 #include <android-base/properties.h>
@@ -428,7 +429,7 @@ void SkiaPipeline::endCapture(SkSurface* surface) {
 void SkiaPipeline::renderFrame(const LayerUpdateQueue& layers, const SkRect& clip,
                                const std::vector<sp<RenderNode>>& nodes, bool opaque,
                                const Rect& contentDrawBounds, sk_sp<SkSurface> surface,
-                               const SkMatrix& preTransform) {
+                               const SkMatrix& preTransform, const DamageRegion* clipRegion) {
     bool previousSkpEnabled = Properties::skpCaptureEnabled;
     if (mPictureCapturedCallback) {
         Properties::skpCaptureEnabled = true;
@@ -441,7 +442,7 @@ void SkiaPipeline::renderFrame(const LayerUpdateQueue& layers, const SkRect& cli
     // draw all layers up front
     renderLayersImpl(layers, opaque);
 
-    renderFrameImpl(clip, nodes, opaque, contentDrawBounds, canvas, preTransform);
+    renderFrameImpl(clip, nodes, opaque, contentDrawBounds, canvas, preTransform, clipRegion);
 
     endCapture(surface.get());
 
@@ -465,7 +466,7 @@ static Rect nodeBounds(RenderNode& node) {
 void SkiaPipeline::renderFrameImpl(const SkRect& clip,
                                    const std::vector<sp<RenderNode>>& nodes, bool opaque,
                                    const Rect& contentDrawBounds, SkCanvas* canvas,
-                                   const SkMatrix& preTransform) {
+                                   const SkMatrix& preTransform, const DamageRegion* clipRegion) {
     SkAutoCanvasRestore saver(canvas, true);
     auto clipRestriction = preTransform.mapRect(clip).roundOut();
     if (CC_UNLIKELY(mCaptureMode == CaptureMode::SingleFrameSKP
@@ -476,6 +477,15 @@ void SkiaPipeline::renderFrameImpl(const SkRect& clip,
         // clip drawing to dirty region only when not recording SKP files (which should contain all
         // draw ops on every frame)
         canvas->androidFramework_setDeviceClipRestriction(clipRestriction);
+        // When the damage is made of several disjoint rects, only repaint those
+        // instead of everything within their bounds
+        if (clipRegion && clipRegion->count() > 1) {
+            SkRegion damage;
+            for (const SkRect& rect : *clipRegion) {
+                damage.op(preTransform.mapRect(rect).roundOut(), SkRegion::kUnion_Op);
+            }
+            canvas->clipRegion(damage);
+        }
     }
     canvas->concat(preTransform);
 
@@ -635,7 +645,7 @@ void SkiaPipeline::renderOverdraw(const SkRect& clip,
     // each time a pixel would have been drawn.
     // Pass true for opaque so we skip the clear - the overdrawCanvas is already zero
     // initialized.
-    renderFrameImpl(clip, nodes, true, contentDrawBounds, &overdrawCanvas, preTransform);
+    renderFrameImpl(clip, nodes, true, contentDrawBounds, &overdrawCanvas, preTransform, nullptr);
     sk_sp<SkImage> counts = offscreen->makeImageSnapshot();
 
     // Draw overdraw colors to the canvas.  The color filter will convert counts to colors.
@@ -57,7 +57,7 @@ public:
     void renderFrame(const LayerUpdateQueue& layers, const SkRect& clip,
                      const std::vector<sp<RenderNode>>& nodes, bool opaque,
                      const Rect& contentDrawBounds, sk_sp<SkSurface> surface,
-                     const SkMatrix& preTransform);
+                     const SkMatrix& preTransform, const DamageRegion* clipRegion = nullptr);
 
     static void prepareToDraw(const renderthread::RenderThread& thread, Bitmap* bitmap);
 
@@ -84,7 +84,7 @@ private:
     void renderFrameImpl(const SkRect& clip,
                          const std::vector<sp<RenderNode>>& nodes, bool opaque,
                          const Rect& contentDrawBounds, SkCanvas* canvas,
-                         const SkMatrix& preTransform);
+                         const SkMatrix& preTransform, const DamageRegion* clipRegion);
 
     /**
      *  Debugging feature.  Draws a semi-transparent overlay on each pixel, indicating
@@ -20,6 +20,10 @@
 #include "Layer.h"
 #include "Properties.h"
 #include "RenderThread.h"
+#include "VectorDrawable.h"
+#include "hwui/AnimatedImageDrawable.h"
+#include "hwui/TextLayoutCache.h"
+#include "hwui/TiledRegionDecoder.h"
 #include "pipeline/skia/ATraceMemoryDump.h"
 #include "pipeline/skia/ShaderCache.h"
 #include "pipeline/skia/SkiaMemoryTracer.h"
@@ -107,6 +111,9 @@ void CacheManager::trimMemory(TrimMemoryMode mode) {
         case TrimMemoryMode::Complete:
             mGrContext->freeGpuResources();
             SkGraphics::PurgeAllCaches();
+            VectorDrawable::SharedBitmapCache::get().clear();
+            TiledRegionDecoder::trimCaches();
+            TextLayoutCache::getInstance().clear();
             break;
         case TrimMemoryMode::UiHidden:
             // Here we purge all the unlocked scratch resources and then toggle the resources cache
@@ -182,8 +189,28 @@ void CacheManager::dumpMemoryUsage(String8& log, const RenderState* renderState)
                          layerMemoryTotal / 1024.0f, renderState->mActiveLayers.size());
     }
 
+    VectorDrawable::SharedBitmapCache::Stats vdStats =
+            VectorDrawable::SharedBitmapCache::get().stats();
+    log.appendFormat("  VectorDrawable Cache %6.2f KB (recycled %.2f KB, hits = %u, misses = %u, "
+                     "evictions = %u, reused = %u)\n",
+                     vdStats.cachedBytes / 1024.0f, vdStats.recycledBytes / 1024.0f, vdStats.hits,
+                     vdStats.misses, vdStats.evictions, vdStats.recycled);
+
+    TiledRegionDecoder::Stats tileStats = TiledRegionDecoder::stats();
+    log.appendFormat("  BitmapRegionDecoder Tiles %6.2f KB (hits = %u, misses = %u, "
+                     "prefetched = %u, evictions = %u)\n",
+                     tileStats.cachedBytes / 1024.0f, tileStats.hits, tileStats.misses,
+                     tileStats.prefetched, tileStats.evictions);
+
+    AnimatedImageDrawable::FrameStats frameStats = AnimatedImageDrawable::getFrameStats();
+    log.appendFormat("  AnimatedImage Frames %6.2f KB (late = %u, dropped = %u)\n",
+                     frameStats.pendingBytes / 1024.0f, frameStats.lateFrames,
+                     frameStats.droppedFrames);
+
     log.appendFormat("Total GPU memory usage:\n");
     gpuTracer.logTotals(log);
+
+    skiapipeline::ShaderCache::get().dump(log);
 }
 
 void CacheManager::onFrameCompleted() {
@@ -32,6 +32,7 @@
 #include "LayerUpdateQueue.h"
 #include "Properties.h"
 #include "RenderThread.h"
+#include "VectorDrawable.h"
 #include "hwui/Canvas.h"
 #include "pipeline/skia/SkiaOpenGLPipeline.h"
 #include "pipeline/skia/SkiaPipeline.h"
@@ -338,6 +339,9 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
         node->prepareTree(info);
         GL_CHECKPOINT(MODERATE);
     }
+    // VectorDrawables prerasterized by the node loop may still be painting, and must be done
+    // before the remaining animators modify their properties
+    VectorDrawableRoot::waitForPrerasterization();
     mAnimationContext->runRemainingAnimations(info);
     GL_CHECKPOINT(MODERATE);
 
@@ -453,7 +457,8 @@ void CanvasContext::setPresentTime() {
 
 void CanvasContext::draw() {
     SkRect dirty;
-    mDamageAccumulator.finish(&dirty);
+    DamageRegion dirtyRegion;
+    mDamageAccumulator.finish(&dirty, &dirtyRegion);
 
     if (dirty.isEmpty() && Properties::skipEmptyFrames && !surfaceRequiresRedraw()) {
         mCurrentFrameInfo->addFlag(FrameInfoFlags::SkippedFrame);
@@ -471,11 +476,19 @@ void CanvasContext::draw() {
     Frame frame = mRenderPipeline->getFrame();
     setPresentTime();
 
-    SkRect windowDirty = computeDirtyRect(frame, &dirty);
+    SkRect windowDirty = computeDirtyRect(frame, &dirty, &dirtyRegion);
+    if (CC_UNLIKELY(ATRACE_ENABLED())) {
+        // Pixels that will be repainted this frame, as the pipeline clips to
+        // dirtyRegion when it is set and to dirty otherwise
+        float damagedPixels = dirtyRegion.isEmpty() ? dirty.width() * dirty.height()
+                                                    : dirtyRegion.area();
+        ATRACE_INT("DamagedPixels", static_cast<int32_t>(std::min(
+                                            damagedPixels, (float)frame.width() * frame.height())));
+    }
 
-    bool drew = mRenderPipeline->draw(frame, windowDirty, dirty, mLightGeometry, &mLayerUpdateQueue,
-                                      mContentDrawBounds, mOpaque, mLightInfo, mRenderNodes,
-                                      &(profiler()));
+    bool drew = mRenderPipeline->draw(frame, windowDirty, dirty, dirtyRegion, mLightGeometry,
+                                      &mLayerUpdateQueue, mContentDrawBounds, mOpaque, mLightInfo,
+                                      mRenderNodes, &(profiler()));
 
     int64_t frameCompleteNr = getFrameNumber();
 
@@ -750,7 +763,8 @@ void CanvasContext::setRenderAheadDepth(int renderAhead) {
     mRenderAheadDepth = static_cast<uint32_t>(renderAhead);
 }
 
-SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty) {
+SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty,
+                                       DamageRegion* dirtyRegion) {
     if (frame.width() != mLastFrameWidth || frame.height() != mLastFrameHeight) {
         // can't rely on prior content of window if viewport size changes
         dirty->setEmpty();
@@ -765,11 +779,20 @@ SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty) {
                   frame.width(), frame.height());
             dirty->setEmpty();
         }
+        SkRect contentDirty(*dirty);
         profiler().unionDirty(dirty);
+        if (*dirty != contentDirty) {
+            // The profiler dirtied area the damage rects don't cover, so
+            // fall back to the single dirty rect while it is visible
+            dirtyRegion->setEmpty();
+        }
     }
 
     if (dirty->isEmpty()) {
         dirty->setIWH(frame.width(), frame.height());
+        dirtyRegion->setEmpty();
+    } else {
+        dirtyRegion->intersect(*dirty);
     }
 
     // At this point dirty is the area of the window to update. However,
@@ -786,6 +809,7 @@ SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty) {
             // We don't have enough history to handle this old of a buffer
             // Just do a full-draw
             dirty->setIWH(frame.width(), frame.height());
+            dirtyRegion->setEmpty();
         } else {
             // At this point we haven't yet added the latest frame
             // to the damage history (happens below)
@@ -793,7 +817,9 @@ SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty) {
             for (int i = mSwapHistory.size() - 1;
                  i > ((int)mSwapHistory.size()) - frame.bufferAge(); i--) {
                 dirty->join(mSwapHistory[i].damage);
+                dirtyRegion->add(mSwapHistory[i].damage);
             }
+            dirtyRegion->reduceTo(Properties::maxDamageRects);
         }
     }
 
@@ -212,7 +212,7 @@ private:
     bool surfaceRequiresRedraw();
     void setPresentTime();
 
-    SkRect computeDirtyRect(const Frame& frame, SkRect* dirty);
+    SkRect computeDirtyRect(const Frame& frame, SkRect* dirty, DamageRegion* dirtyRegion);
 
     // The same type as Frame.mWidth and Frame.mHeight
     int32_t mLastFrameWidth = 0;
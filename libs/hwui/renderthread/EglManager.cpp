@@ -441,12 +441,21 @@ Frame EglManager::beginFrame(EGLSurface surface) {
     return frame;
 }
 
-void EglManager::damageFrame(const Frame& frame, const SkRect& dirty) {
+void EglManager::damageFrame(const Frame& frame, const SkRect& dirty,
+                             const DamageRegion& dirtyRegion) {
 #ifdef EGL_KHR_partial_update
     if (EglExtensions.setDamage && mSwapBehavior == SwapBehavior::BufferAge) {
-        EGLint rects[4];
-        frame.map(dirty, rects);
-        if (!eglSetDamageRegionKHR(mEglDisplay, frame.mSurface, rects, 1)) {
+        EGLint rects[4 * DamageRegion::kMaxRects];
+        EGLint count = 1;
+        if (dirtyRegion.count() > 1) {
+            count = dirtyRegion.count();
+            for (int i = 0; i < count; i++) {
+                frame.map(dirtyRegion[i], rects + 4 * i);
+            }
+        } else {
+            frame.map(dirty, rects);
+        }
+        if (!eglSetDamageRegionKHR(mEglDisplay, frame.mSurface, rects, count)) {
             LOG_ALWAYS_FATAL("Failed to set damage region on surface %p, error=%s",
                              (void*)frame.mSurface, eglErrorString());
         }
@@ -58,7 +58,10 @@ class IRenderPipeline {
 public:
     virtual MakeCurrentResult makeCurrent() = 0;
     virtual Frame getFrame() = 0;
+    // dirtyRegion is the set of disjoint rects within dirty that actually need to be
+    // repainted. It is empty when the whole of dirty must be repainted.
     virtual bool draw(const Frame& frame, const SkRect& screenDirty, const SkRect& dirty,
+                      const DamageRegion& dirtyRegion,
                       const LightGeometry& lightGeometry, LayerUpdateQueue* layerUpdateQueue,
                       const Rect& contentDrawBounds, bool opaque, const LightInfo& lightInfo,
                       const std::vector<sp<RenderNode>>& renderNodes,
@@ -16,6 +16,7 @@
 
 #include "GraphicsStatsService.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
@@ -26,12 +27,19 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
 #include <android/util/ProtoOutputStream.h>
 #include <stats_event.h>
 #include <statslog.h>
 
 #include "JankTracker.h"
 #include "protos/graphicsstats.pb.h"
+#include "thread/CommonPool.h"
 
 namespace android {
 namespace uirenderer {
@@ -39,17 +47,143 @@ namespace uirenderer {
 using namespace google::protobuf;
 using namespace uirenderer::protos;
 
-constexpr int32_t sCurrentFileVersion = 1;
+// Files of this version are the version followed by a serialized GraphicsStatsProto. They are
+// still read, and are rewritten in the current format the next time they are saved to
+constexpr int32_t sProtoFileVersion = 1;
+// Files of this version have the current layout without the stage histograms. They are read and
+// rewritten the same way
+constexpr int32_t sNoStagesFileVersion = 2;
+constexpr int32_t sCurrentFileVersion = 3;
 constexpr int32_t sHeaderSize = 4;
 static_assert(sizeof(sCurrentFileVersion) == sHeaderSize, "Header size is wrong");
 
 constexpr int sHistogramSize = ProfileData::HistogramSize();
 constexpr int sGPUHistogramSize = ProfileData::GPUHistogramSize();
+constexpr int sStageCount = static_cast<int>(FrameStage::NumStages);
+constexpr int sStageHistogramSize = ProfileData::StageHistogramSize();
+// Unlike the other histograms, the size of the stage histograms isn't in the header
+static_assert(sStageCount == 7 && sStageHistogramSize == 160,
+              "Changing the stage histograms needs a new file version");
+
+// Written next to a file being created, then renamed over it
+static const char* const sTempSuffix = ".tmp";
+
+enum SummaryIndex {
+    kTotalFrames = 0,
+    kJankyFrames,
+    kMissedVsyncCount,
+    kHighInputLatencyCount,
+    kSlowUiThreadCount,
+    kSlowBitmapUploadCount,
+    kSlowDrawCount,
+    kMissedDeadlineCount,
+    kSummaryCount,
+};
+
+/*
+ * The current file format, which is this header followed by the sHistogramSize frame counts of
+ * the histogram, the sGPUHistogramSize ones of the GPU histogram, the sStageHistogramSize ones of
+ * each of the sStageCount stage histograms and the package name.
+ *
+ * Saving a buffer maps the file and adds its counts in place with atomic operations, so neither
+ * saving nor dumping parses or serializes a proto, and dumps reading a file while it is saved to
+ * see each count either before or after the buffer was added.
+ */
+struct alignas(8) BinaryStatsHeader {
+    int32_t version;
+    uint32_t histogramSize;
+    uint32_t gpuHistogramSize;
+    uint32_t packageNameSize;
+    int64_t versionCode;
+    std::atomic<int64_t> statsStart;
+    std::atomic<int64_t> statsEnd;
+    std::atomic<int32_t> pipeline;
+    std::atomic<uint32_t> summary[kSummaryCount];
+};
+
+using HistogramCount = std::atomic<uint32_t>;
+static_assert(HistogramCount::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free,
+              "The counts of files mapped in memory must be lock free");
+
+static size_t binaryFileSize(int32_t version, uint32_t packageNameSize) {
+    size_t countCount = sHistogramSize + sGPUHistogramSize;
+    if (version == sCurrentFileVersion) {
+        countCount += sStageCount * sStageHistogramSize;
+    }
+    return sizeof(BinaryStatsHeader) + countCount * sizeof(HistogramCount) + packageNameSize;
+}
+
+static HistogramCount* histogramCounts(BinaryStatsHeader* header) {
+    return reinterpret_cast<HistogramCount*>(header + 1);
+}
+
+static HistogramCount* gpuHistogramCounts(BinaryStatsHeader* header) {
+    return histogramCounts(header) + sHistogramSize;
+}
+
+// Only files of the current version have stage histograms
+static HistogramCount* stageHistogramCounts(BinaryStatsHeader* header, int stage) {
+    return gpuHistogramCounts(header) + sGPUHistogramSize + stage * sStageHistogramSize;
+}
+
+static const char* packageName(BinaryStatsHeader* header) {
+    HistogramCount* end = gpuHistogramCounts(header) + sGPUHistogramSize;
+    if (header->version == sCurrentFileVersion) {
+        end = stageHistogramCounts(header, sStageCount);
+    }
+    return reinterpret_cast<const char*>(end);
+}
+
+// Returns the header of a mapped binary file, of the current version or the one before, or null
+// if it isn't one
+static BinaryStatsHeader* validBinaryHeader(void* addr, size_t size) {
+    if (size < sizeof(BinaryStatsHeader)) {
+        return nullptr;
+    }
+    BinaryStatsHeader* header = reinterpret_cast<BinaryStatsHeader*>(addr);
+    if (header->version != sCurrentFileVersion && header->version != sNoStagesFileVersion) {
+        return nullptr;
+    }
+    if (header->histogramSize != sHistogramSize ||
+        header->gpuHistogramSize != sGPUHistogramSize) {
+        ALOGE("Histogram size mismatch, file is %u/%u expected %d/%d", header->histogramSize,
+              header->gpuHistogramSize, sHistogramSize, sGPUHistogramSize);
+        return nullptr;
+    }
+    if (size != binaryFileSize(header->version, header->packageNameSize)) {
+        ALOGE("File size mismatch, file is %zu expected %zu", size,
+              binaryFileSize(header->version, header->packageNameSize));
+        return nullptr;
+    }
+    return header;
+}
+
+// The render_millis of the buckets of the histograms, which only depend on the bucket index
+struct BucketTimes {
+    std::vector<uint32_t> histogram;
+    std::vector<uint32_t> gpuHistogram;
+};
+
+static const BucketTimes& bucketTimes() {
+    static const BucketTimes* times = [] {
+        BucketTimes* times = new BucketTimes();
+        ProfileData empty;
+        empty.histogramForEach([times](ProfileData::HistogramEntry entry) {
+            times->histogram.push_back(entry.renderTimeMs);
+        });
+        empty.histogramGPUForEach([times](ProfileData::HistogramEntry entry) {
+            times->gpuHistogram.push_back(entry.renderTimeMs);
+        });
+        return times;
+    }();
+    return *times;
+}
 
 static bool mergeProfileDataIntoProto(protos::GraphicsStatsProto* proto, const std::string& package,
                                       int64_t versionCode, int64_t startTime, int64_t endTime,
                                       const ProfileData* data);
-static void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int outFd);
+static void dumpAsTextToFd(protos::GraphicsStatsProto* proto, const StageHistograms* stages,
+                           int outFd);
 
 class FileDescriptor {
 public:
@@ -108,8 +242,59 @@ private:
     io::CopyingOutputStreamAdaptor mImpl;
 };
 
+static void binaryStatsToProto(BinaryStatsHeader* header, protos::GraphicsStatsProto* proto,
+                               StageHistograms* outStages) {
+    proto->set_package_name(std::string(packageName(header), header->packageNameSize));
+    proto->set_version_code(header->versionCode);
+    proto->set_stats_start(header->statsStart.load(std::memory_order_relaxed));
+    proto->set_stats_end(header->statsEnd.load(std::memory_order_relaxed));
+    proto->set_pipeline(static_cast<GraphicsStatsProto_PipelineType>(
+            header->pipeline.load(std::memory_order_relaxed)));
+    auto summary = proto->mutable_summary();
+    auto count = [header](SummaryIndex index) {
+        return header->summary[index].load(std::memory_order_relaxed);
+    };
+    summary->set_total_frames(count(kTotalFrames));
+    summary->set_janky_frames(count(kJankyFrames));
+    summary->set_missed_vsync_count(count(kMissedVsyncCount));
+    summary->set_high_input_latency_count(count(kHighInputLatencyCount));
+    summary->set_slow_ui_thread_count(count(kSlowUiThreadCount));
+    summary->set_slow_bitmap_upload_count(count(kSlowBitmapUploadCount));
+    summary->set_slow_draw_count(count(kSlowDrawCount));
+    summary->set_missed_deadline_count(count(kMissedDeadlineCount));
+
+    const BucketTimes& times = bucketTimes();
+    proto->mutable_histogram()->Reserve(sHistogramSize);
+    HistogramCount* counts = histogramCounts(header);
+    for (int i = 0; i < sHistogramSize; i++) {
+        auto bucket = proto->add_histogram();
+        bucket->set_render_millis(times.histogram[i]);
+        bucket->set_frame_count(counts[i].load(std::memory_order_relaxed));
+    }
+    proto->mutable_gpu_histogram()->Reserve(sGPUHistogramSize);
+    counts = gpuHistogramCounts(header);
+    for (int i = 0; i < sGPUHistogramSize; i++) {
+        auto bucket = proto->add_gpu_histogram();
+        bucket->set_render_millis(times.gpuHistogram[i]);
+        bucket->set_frame_count(counts[i].load(std::memory_order_relaxed));
+    }
+    if (outStages && header->version == sCurrentFileVersion) {
+        for (int stage = 0; stage < sStageCount; stage++) {
+            counts = stageHistogramCounts(header, stage);
+            for (int i = 0; i < sStageHistogramSize; i++) {
+                (*outStages)[stage][i] = counts[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
 bool GraphicsStatsService::parseFromFile(const std::string& path,
-                                         protos::GraphicsStatsProto* output) {
+                                         protos::GraphicsStatsProto* output,
+                                         StageHistograms* outStages) {
+    if (outStages) {
+        // Files saved before the stage histograms were kept have none
+        *outStages = {};
+    }
     FileDescriptor fd{open(path.c_str(), O_RDONLY)};
     if (!fd.valid()) {
         int err = errno;
@@ -142,7 +327,17 @@ bool GraphicsStatsService::parseFromFile(const std::string& path,
         return false;
     }
     uint32_t file_version = *reinterpret_cast<uint32_t*>(addr);
-    if (file_version != sCurrentFileVersion) {
+    if (file_version == sCurrentFileVersion || file_version == sNoStagesFileVersion) {
+        BinaryStatsHeader* header = validBinaryHeader(addr, sb.st_size);
+        if (header) {
+            binaryStatsToProto(header, output, outStages);
+        } else {
+            ALOGW("Invalid stats file '%s'", path.c_str());
+        }
+        munmap(addr, sb.st_size);
+        return header != nullptr;
+    }
+    if (file_version != sProtoFileVersion) {
         ALOGW("file_version mismatch! expected %d got %d", sCurrentFileVersion, file_version);
         munmap(addr, sb.st_size);
         return false;
@@ -280,7 +475,7 @@ static int32_t findGPUPercentile(protos::GraphicsStatsProto* proto, int percenti
     return 0;
 }
 
-void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int fd) {
+void dumpAsTextToFd(protos::GraphicsStatsProto* proto, const StageHistograms* stages, int fd) {
     // This isn't a full validation, just enough that we can deref at will
     if (proto->package_name().empty() || !proto->has_summary()) {
         ALOGW("Skipping dump, invalid package_name() '%s' or summary %d",
@@ -317,56 +512,176 @@ void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int fd) {
     for (const auto& it : proto->gpu_histogram()) {
         dprintf(fd, " %dms=%d", it.render_millis(), it.frame_count());
     }
+    if (stages) {
+        ProfileData::dumpStages(fd, *stages);
+    }
     dprintf(fd, "\n");
 }
 
-void GraphicsStatsService::saveBuffer(const std::string& path, const std::string& package,
-                                      int64_t versionCode, int64_t startTime, int64_t endTime,
-                                      const ProfileData* data) {
-    protos::GraphicsStatsProto statsProto;
-    if (!parseFromFile(path, &statsProto)) {
-        statsProto.Clear();
+static void addProfileDataToBinaryStats(BinaryStatsHeader* header, int64_t startTime,
+                                        int64_t endTime, const ProfileData* data) {
+    int64_t start = header->statsStart.load(std::memory_order_relaxed);
+    while ((start == 0 || start > startTime) &&
+           !header->statsStart.compare_exchange_weak(start, startTime, std::memory_order_relaxed)) {
     }
-    if (!mergeProfileDataIntoProto(&statsProto, package, versionCode, startTime, endTime, data)) {
-        return;
+    int64_t end = header->statsEnd.load(std::memory_order_relaxed);
+    while ((end == 0 || end < endTime) &&
+           !header->statsEnd.compare_exchange_weak(end, endTime, std::memory_order_relaxed)) {
     }
-    // Although we might not have read any data from the file, merging the existing data
-    // should always fully-initialize the proto
-    if (!statsProto.IsInitialized()) {
-        ALOGE("proto initialization error %s", statsProto.InitializationErrorString().c_str());
-        return;
+    header->pipeline.store(data->pipelineType() == RenderPipelineType::SkiaGL
+                                   ? GraphicsStatsProto_PipelineType_GL
+                                   : GraphicsStatsProto_PipelineType_VULKAN,
+                           std::memory_order_relaxed);
+
+    auto add = [header](SummaryIndex index, uint32_t count) {
+        header->summary[index].fetch_add(count, std::memory_order_relaxed);
+    };
+    add(kTotalFrames, data->totalFrameCount());
+    add(kJankyFrames, data->jankFrameCount());
+    add(kMissedVsyncCount, data->jankTypeCount(kMissedVsync));
+    add(kHighInputLatencyCount, data->jankTypeCount(kHighInputLatency));
+    add(kSlowUiThreadCount, data->jankTypeCount(kSlowUI));
+    add(kSlowBitmapUploadCount, data->jankTypeCount(kSlowSync));
+    add(kSlowDrawCount, data->jankTypeCount(kSlowRT));
+    add(kMissedDeadlineCount, data->jankTypeCount(kMissedDeadline));
+
+    HistogramCount* counts = histogramCounts(header);
+    data->histogramForEach([&counts](ProfileData::HistogramEntry entry) {
+        if (entry.frameCount) {
+            counts->fetch_add(entry.frameCount, std::memory_order_relaxed);
+        }
+        counts++;
+    });
+    counts = gpuHistogramCounts(header);
+    data->histogramGPUForEach([&counts](ProfileData::HistogramEntry entry) {
+        if (entry.frameCount) {
+            counts->fetch_add(entry.frameCount, std::memory_order_relaxed);
+        }
+        counts++;
+    });
+    for (int stage = 0; stage < sStageCount; stage++) {
+        counts = stageHistogramCounts(header, stage);
+        const StageCounts& stageCounts = data->stageHistograms()[stage];
+        for (int i = 0; i < sStageHistogramSize; i++) {
+            if (stageCounts[i]) {
+                counts[i].fetch_add(stageCounts[i], std::memory_order_relaxed);
+            }
+        }
     }
-    if (statsProto.package_name().empty() || !statsProto.has_summary()) {
-        ALOGE("missing package_name() '%s' summary %d", statsProto.package_name().c_str(),
-              statsProto.has_summary());
-        return;
+}
+
+// Adds the data to the file in place, and returns false if it isn't a file of the current version.
+// Files of older versions are rewritten by createBinaryFile
+static bool addToBinaryFile(const std::string& path, int64_t startTime, int64_t endTime,
+                            const ProfileData* data) {
+    FileDescriptor fd{open(path.c_str(), O_RDWR | O_CLOEXEC)};
+    if (!fd.valid()) {
+        int err = errno;
+        if (err != ENOENT) {
+            ALOGW("Failed to open '%s', errno=%d (%s)", path.c_str(), err, strerror(err));
+        }
+        return false;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) || sb.st_size < static_cast<off_t>(sizeof(BinaryStatsHeader))) {
+        return false;
     }
-    int outFd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0660);
-    if (outFd <= 0) {
+    void* addr = mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
         int err = errno;
-        ALOGW("Failed to open '%s', error=%d (%s)", path.c_str(), err, strerror(err));
-        return;
+        ALOGW("Failed to mmap '%s', errno=%d (%s)", path.c_str(), err, strerror(err));
+        return false;
+    }
+    BinaryStatsHeader* header = validBinaryHeader(addr, sb.st_size);
+    bool current = header && header->version == sCurrentFileVersion;
+    if (current) {
+        addProfileDataToBinaryStats(header, startTime, endTime, data);
+    }
+    munmap(addr, sb.st_size);
+    return current;
+}
+
+// Creates the file with the data, and the stats of the file it replaces if it is an older one
+static void createBinaryFile(const std::string& path, const std::string& package,
+                             int64_t versionCode, int64_t startTime, int64_t endTime,
+                             const ProfileData* data) {
+    std::vector<uint8_t> buffer(binaryFileSize(sCurrentFileVersion, package.size()));
+    BinaryStatsHeader* header = new (buffer.data()) BinaryStatsHeader();
+    header->version = sCurrentFileVersion;
+    header->histogramSize = sHistogramSize;
+    header->gpuHistogramSize = sGPUHistogramSize;
+    header->packageNameSize = package.size();
+    header->versionCode = versionCode;
+    memcpy(const_cast<char*>(packageName(header)), package.data(), package.size());
+
+    protos::GraphicsStatsProto previous;
+    StageHistograms previousStages;
+    if (GraphicsStatsService::parseFromFile(path, &previous, &previousStages) &&
+        previous.has_summary() &&
+        previous.histogram_size() == sHistogramSize &&
+        previous.gpu_histogram_size() == sGPUHistogramSize) {
+        header->statsStart = previous.stats_start();
+        header->statsEnd = previous.stats_end();
+        const auto& summary = previous.summary();
+        header->summary[kTotalFrames] = summary.total_frames();
+        header->summary[kJankyFrames] = summary.janky_frames();
+        header->summary[kMissedVsyncCount] = summary.missed_vsync_count();
+        header->summary[kHighInputLatencyCount] = summary.high_input_latency_count();
+        header->summary[kSlowUiThreadCount] = summary.slow_ui_thread_count();
+        header->summary[kSlowBitmapUploadCount] = summary.slow_bitmap_upload_count();
+        header->summary[kSlowDrawCount] = summary.slow_draw_count();
+        header->summary[kMissedDeadlineCount] = summary.missed_deadline_count();
+        for (int i = 0; i < sHistogramSize; i++) {
+            histogramCounts(header)[i] = previous.histogram(i).frame_count();
+        }
+        for (int i = 0; i < sGPUHistogramSize; i++) {
+            gpuHistogramCounts(header)[i] = previous.gpu_histogram(i).frame_count();
+        }
+        for (int stage = 0; stage < sStageCount; stage++) {
+            for (int i = 0; i < sStageHistogramSize; i++) {
+                stageHistogramCounts(header, stage)[i] = previousStages[stage][i];
+            }
+        }
     }
-    int wrote = write(outFd, &sCurrentFileVersion, sHeaderSize);
-    if (wrote != sHeaderSize) {
+    addProfileDataToBinaryStats(header, startTime, endTime, data);
+
+    // Readers only ever see a complete file, as it is renamed in place once written
+    std::string tempPath = path + sTempSuffix;
+    int outFd = open(tempPath.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0660);
+    if (outFd < 0) {
         int err = errno;
-        ALOGW("Failed to write header to '%s', returned=%d errno=%d (%s)", path.c_str(), wrote, err,
-              strerror(err));
-        close(outFd);
+        ALOGW("Failed to open '%s', error=%d (%s)", tempPath.c_str(), err, strerror(err));
         return;
     }
-    {
-        FileOutputStreamLite output(outFd);
-        bool success = statsProto.SerializeToZeroCopyStream(&output) && output.Flush();
-        if (output.GetErrno() != 0) {
-            ALOGW("Error writing to fd=%d, path='%s' err=%d (%s)", outFd, path.c_str(),
-                  output.GetErrno(), strerror(output.GetErrno()));
-            success = false;
-        } else if (!success) {
-            ALOGW("Serialize failed on '%s' unknown error", path.c_str());
+    const uint8_t* remaining = buffer.data();
+    size_t size = buffer.size();
+    while (size) {
+        ssize_t wrote = TEMP_FAILURE_RETRY(write(outFd, remaining, size));
+        if (wrote <= 0) {
+            int err = errno;
+            ALOGW("Failed to write to '%s', returned=%zd errno=%d (%s)", tempPath.c_str(), wrote,
+                  err, strerror(err));
+            close(outFd);
+            unlink(tempPath.c_str());
+            return;
         }
+        remaining += wrote;
+        size -= wrote;
     }
     close(outFd);
+    if (rename(tempPath.c_str(), path.c_str())) {
+        int err = errno;
+        ALOGW("Failed to rename '%s', errno=%d (%s)", tempPath.c_str(), err, strerror(err));
+        unlink(tempPath.c_str());
+    }
+}
+
+void GraphicsStatsService::saveBuffer(const std::string& path, const std::string& package,
+                                      int64_t versionCode, int64_t startTime, int64_t endTime,
+                                      const ProfileData* data) {
+    if (!addToBinaryFile(path, startTime, endTime, data)) {
+        createBinaryFile(path, package, versionCode, startTime, endTime, data);
+    }
 }
 
 class GraphicsStatsService::Dump {
@@ -379,6 +694,8 @@ public:
     int fd() { return mFd; }
     DumpType type() { return mType; }
     protos::GraphicsStatsServiceDumpProto& proto() { return mProto; }
+    // Adds the stats of a file, which may be taken. The stage histograms are only dumped as text
+    void addStat(protos::GraphicsStatsProto* stat, const StageHistograms* stages);
     void mergeStat(const protos::GraphicsStatsProto& stat);
     void updateProto();
 
@@ -442,7 +759,8 @@ void GraphicsStatsService::addToDump(Dump* dump, const std::string& path,
                                      const std::string& package, int64_t versionCode,
                                      int64_t startTime, int64_t endTime, const ProfileData* data) {
     protos::GraphicsStatsProto statsProto;
-    if (!path.empty() && !parseFromFile(path, &statsProto)) {
+    StageHistograms stages = {};
+    if (!path.empty() && !parseFromFile(path, &statsProto, &stages)) {
         statsProto.Clear();
     }
     if (data &&
@@ -454,26 +772,84 @@ void GraphicsStatsService::addToDump(Dump* dump, const std::string& path,
               path.empty() ? "<empty>" : path.c_str(), data);
         return;
     }
-    if (dump->type() == DumpType::ProtobufStatsd) {
-        dump->mergeStat(statsProto);
-    } else if (dump->type() == DumpType::Protobuf) {
-        dump->proto().add_stats()->CopyFrom(statsProto);
-    } else {
-        dumpAsTextToFd(&statsProto, dump->fd());
+    if (data) {
+        for (int stage = 0; stage < sStageCount; stage++) {
+            for (int i = 0; i < sStageHistogramSize; i++) {
+                stages[stage][i] += data->stageHistograms()[stage][i];
+            }
+        }
     }
+    dump->addStat(&statsProto, &stages);
 }
 
 void GraphicsStatsService::addToDump(Dump* dump, const std::string& path) {
     protos::GraphicsStatsProto statsProto;
-    if (!parseFromFile(path, &statsProto)) {
+    StageHistograms stages;
+    if (!parseFromFile(path, &statsProto, &stages)) {
         return;
     }
-    if (dump->type() == DumpType::ProtobufStatsd) {
-        dump->mergeStat(statsProto);
-    } else if (dump->type() == DumpType::Protobuf) {
-        dump->proto().add_stats()->CopyFrom(statsProto);
+    dump->addStat(&statsProto, &stages);
+}
+
+void GraphicsStatsService::Dump::addStat(protos::GraphicsStatsProto* stat,
+                                         const StageHistograms* stages) {
+    if (mType == DumpType::ProtobufStatsd) {
+        mergeStat(*stat);
+    } else if (mType == DumpType::Protobuf) {
+        mProto.add_stats()->Swap(stat);
     } else {
-        dumpAsTextToFd(&statsProto, dump->fd());
+        dumpAsTextToFd(stat, stages, mFd);
+    }
+}
+
+static void findStatsFiles(const std::string& directory, std::vector<std::string>* paths) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(directory.c_str()), closedir);
+    if (!dir) {
+        int err = errno;
+        ALOGW("Failed to open '%s', errno=%d (%s)", directory.c_str(), err, strerror(err));
+        return;
+    }
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        std::string path = directory + "/" + entry->d_name;
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat sb;
+            if (lstat(path.c_str(), &sb)) {
+                continue;
+            }
+            type = S_ISDIR(sb.st_mode) ? DT_DIR : (S_ISREG(sb.st_mode) ? DT_REG : DT_UNKNOWN);
+        }
+        if (type == DT_DIR) {
+            findStatsFiles(path, paths);
+        } else if (type == DT_REG) {
+            const size_t suffixSize = strlen(sTempSuffix);
+            if (path.size() < suffixSize ||
+                path.compare(path.size() - suffixSize, suffixSize, sTempSuffix)) {
+                paths->push_back(std::move(path));
+            }
+        }
+    }
+}
+
+void GraphicsStatsService::addDirectoryToDump(Dump* dump, const std::string& directory) {
+    std::vector<std::string> paths;
+    findStatsFiles(directory, &paths);
+    // Sorted so that dumps list the files in the same order whichever threads loaded them
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<protos::GraphicsStatsProto> stats(paths.size());
+    std::vector<StageHistograms> stages(paths.size());
+    std::unique_ptr<bool[]> loaded(new bool[paths.size()]);
+    CommonPool::parallelFor(paths.size(), CommonPool::THREAD_COUNT + 1, [&](int i) {
+        loaded[i] = parseFromFile(paths[i], &stats[i], &stages[i]);
+    });
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (loaded[i]) {
+            dump->addStat(&stats[i], &stages[i]);
+        }
     }
 }
 
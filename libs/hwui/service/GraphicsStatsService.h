@@ -53,12 +53,16 @@ public:
                                       const std::string& package, int64_t versionCode,
                                       int64_t startTime, int64_t endTime, const ProfileData* data);
     ANDROID_API static void addToDump(Dump* dump, const std::string& path);
+    // Adds every stats file under directory, which are loaded in parallel. It is not registered
+    // over JNI, as the Java service does not declare nAddDirectoryToDump yet.
+    ANDROID_API static void addDirectoryToDump(Dump* dump, const std::string& directory);
     ANDROID_API static void finishDump(Dump* dump);
     ANDROID_API static void finishDumpInMemory(Dump* dump, AStatsEventList* data,
                                                bool lastFullDay);
 
-    // Visible for testing
-    static bool parseFromFile(const std::string& path, protos::GraphicsStatsProto* output);
+    // Visible for testing. outStages is set to the stage histograms of the file, if any
+    static bool parseFromFile(const std::string& path, protos::GraphicsStatsProto* output,
+                              StageHistograms* outStages = nullptr);
 };
 
 } /* namespace uirenderer */
@@ -21,6 +21,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -39,6 +40,11 @@ public:
         int reportFrametimeWeight = 0;
         bool renderOffscreen = true;
         int renderAhead = 0;
+        // Frames drawn before the measured ones, or -1 for the runner's default
+        int warmupFrameCount = -1;
+        // Draws the frames on the CPU into an offscreen raster surface, without any GPU or
+        // display, and reports the stage timings of each frame
+        bool renderRaster = false;
     };
 
     template <class T>
@@ -72,6 +78,10 @@ public:
     static void registerScene(const Info& info);
 
     sp<Surface> renderTarget;
+
+    // Nodes that the scene added animators to since the last frame. The runner attaches them to
+    // its AnimationContext on the next sync, which RootRenderNode does for apps
+    std::vector<RenderNode*> animatingNodes;
 };
 
 }  // namespace test
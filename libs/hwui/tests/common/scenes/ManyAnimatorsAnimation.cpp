@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TestSceneBase.h"
+#include "Animator.h"
+#include "Interpolator.h"
+
+#include <vector>
+
+class ManyAnimatorsAnimation;
+
+static TestScene::Registrar _ManyAnimators(TestScene::Info{
+        "manyanimators",
+        "A grid of cards entering with a stagger, each animating its alpha, translation, scale "
+        "and rotation with RenderProperty animators. Several hundred of them run at once.",
+        TestScene::simpleCreateScene<ManyAnimatorsAnimation>});
+
+class ManyAnimatorsAnimation : public TestScene {
+public:
+    static constexpr int kColumns = 10;
+    static constexpr int kRows = 16;
+    // Frames between each entrance of the cards
+    static constexpr int kRestartFrames = 120;
+
+    std::vector<sp<RenderNode>> cards;
+    std::vector<sp<BaseRenderNodeAnimator>> animators;
+
+    void createContent(int width, int height, Canvas& canvas) override {
+        canvas.drawColor(Color::White, SkBlendMode::kSrcOver);
+        const int cardWidth = width / kColumns;
+        const int cardHeight = height / kRows;
+        for (int i = 0; i < kColumns * kRows; i++) {
+            int left = (i % kColumns) * cardWidth;
+            int top = (i / kColumns) * cardHeight;
+            SkColor color = i % 2 ? Color::Blue_500 : Color::Teal_500;
+            sp<RenderNode> card = TestUtils::createNode(
+                    left, top, left + cardWidth, top + cardHeight,
+                    [color](RenderProperties& props, Canvas& canvas) {
+                        canvas.drawColor(color, SkBlendMode::kSrcOver);
+                    });
+            canvas.drawRenderNode(card.get());
+            cards.push_back(card);
+        }
+    }
+
+    void doFrame(int frameNr) override {
+        if (frameNr % kRestartFrames != 0) {
+            return;
+        }
+        // Cards that haven't finished entering yet start over
+        for (auto& animator : animators) {
+            animator->cancel();
+        }
+        animators.clear();
+        for (size_t i = 0; i < cards.size(); i++) {
+            RenderNode* card = cards[i].get();
+            nsecs_t delay = i * 3;
+            // One interpolator of each of the common kinds, as apps would use them
+            start(card, RenderPropertyAnimator::ALPHA, 0, 1, delay, nullptr);
+            start(card, RenderPropertyAnimator::TRANSLATION_Y, dp(96), 0, delay,
+                  new DecelerateInterpolator(1.5f));
+            start(card, RenderPropertyAnimator::SCALE_X, 0.5f, 1, delay,
+                  new OvershootInterpolator(2));
+            start(card, RenderPropertyAnimator::SCALE_Y, 0.5f, 1, delay,
+                  new OvershootInterpolator(2));
+            start(card, RenderPropertyAnimator::ROTATION, -15, 0, delay,
+                  new PathInterpolator({0, 0.4f, 1}, {0, 0.8f, 1}));
+            animatingNodes.push_back(card);
+        }
+    }
+
+private:
+    void start(RenderNode* card, RenderPropertyAnimator::RenderProperty property, float from,
+               float to, nsecs_t delay, Interpolator* interpolator) {
+        sp<RenderPropertyAnimator> animator = new RenderPropertyAnimator(property, to);
+        animator->setStartValue(from);
+        animator->setDuration(400);
+        animator->setStartDelay(delay);
+        if (interpolator) {
+            animator->setInterpolator(interpolator);
+        }
+        card->addAnimator(animator);
+        animator->start();
+        animators.push_back(animator);
+    }
+};
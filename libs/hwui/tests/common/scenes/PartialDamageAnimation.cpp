@@ -25,6 +25,16 @@ static TestScene::Registrar _PartialDamage(TestScene::Info{
         "EGL_KHR_partial_update is supported by the device & are enabled in hwui.",
         TestScene::simpleCreateScene<PartialDamageAnimation>});
 
+class PartialDamageCornersAnimation;
+
+static TestScene::Registrar _PartialDamageCorners(TestScene::Info{
+        "partialdamagecorners",
+        "Tests multi-rect damage tracking. Draws a grid of rects and animates the ones "
+        "in opposite corners. The pixels repainted each frame are reported through the "
+        "DamagedPixels trace counter and should stay close to the area of the two rects "
+        "rather than the whole window.",
+        TestScene::simpleCreateScene<PartialDamageCornersAnimation>});
+
 class PartialDamageAnimation : public TestScene {
 public:
     std::vector<sp<RenderNode> > cards;
@@ -50,13 +60,27 @@ public:
     }
     void doFrame(int frameNr) override {
         int curFrame = frameNr % 150;
-        cards[0]->mutateStagingProperties().setTranslationX(curFrame);
-        cards[0]->mutateStagingProperties().setTranslationY(curFrame);
-        cards[0]->setPropertyFieldsDirty(RenderNode::X | RenderNode::Y);
+        animateCard(cards[0], curFrame, curFrame);
+    }
 
-        TestUtils::recordNode(*cards[0], [curFrame](Canvas& canvas) {
+protected:
+    void animateCard(const sp<RenderNode>& card, int curFrame, float translation) {
+        card->mutateStagingProperties().setTranslationX(translation);
+        card->mutateStagingProperties().setTranslationY(translation);
+        card->setPropertyFieldsDirty(RenderNode::X | RenderNode::Y);
+
+        TestUtils::recordNode(*card, [curFrame](Canvas& canvas) {
             SkColor color = TestUtils::interpolateColor(curFrame / 150.0f, 0xFFF44336, 0xFFF8BBD0);
             canvas.drawColor(color, SkBlendMode::kSrcOver);
         });
     }
 };
+
+class PartialDamageCornersAnimation : public PartialDamageAnimation {
+public:
+    void doFrame(int frameNr) override {
+        int curFrame = frameNr % 150;
+        animateCard(cards.front(), curFrame, curFrame / 10.0f);
+        animateCard(cards.back(), curFrame, -curFrame / 10.0f);
+    }
+};
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SceneStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <inttypes.h>
+
+namespace android {
+namespace uirenderer {
+namespace test {
+
+namespace {
+
+struct StageSpan {
+    const char* name;
+    FrameInfoIndex start;
+    FrameInfoIndex end;
+};
+
+const StageSpan STAGE_SPANS[SceneStats::StageCount] = {
+        {"Traversal", FrameInfoIndex::PerformTraversalsStart, FrameInfoIndex::SyncStart},
+        {"Sync", FrameInfoIndex::SyncStart, FrameInfoIndex::IssueDrawCommandsStart},
+        {"Draw", FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::FrameCompleted},
+        {"Total", FrameInfoIndex::IntendedVsync, FrameInfoIndex::FrameCompleted},
+};
+
+double percentileOfSorted(const std::vector<int64_t>& sorted, double percentile) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    double position = percentile / 100.0 * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(position);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    double fraction = position - lower;
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+double toMs(double ns) {
+    return ns / 1000000.0;
+}
+
+}  // namespace
+
+void SceneStats::addFrame(const FrameInfo& frame) {
+    for (int i = 0; i < StageCount; i++) {
+        mSamples[i].push_back(frame.duration(STAGE_SPANS[i].start, STAGE_SPANS[i].end));
+    }
+}
+
+double SceneStats::percentile(Stage stage, double percentile) const {
+    std::vector<int64_t> sorted = mSamples[stage];
+    std::sort(sorted.begin(), sorted.end());
+    return percentileOfSorted(sorted, percentile);
+}
+
+void SceneStats::printSummary(FILE* file) const {
+    fprintf(file, "%s: %d runs of %d frames\n", mName.c_str(), runCount(),
+            runCount() ? frameCount() / runCount() : 0);
+    for (int i = 0; i < StageCount; i++) {
+        Stage stage = static_cast<Stage>(i);
+        fprintf(file, "  %-10s 50th %7.3fms  90th %7.3fms  95th %7.3fms  99th %7.3fms\n",
+                STAGE_SPANS[i].name, toMs(percentile(stage, 50)), toMs(percentile(stage, 90)),
+                toMs(percentile(stage, 95)), toMs(percentile(stage, 99)));
+    }
+}
+
+void SceneStats::writeStageJson(FILE* file, Stage stage) const {
+    const std::vector<int64_t>& samples = mSamples[stage];
+    std::vector<int64_t> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double mean = 0;
+    for (int64_t sample : samples) {
+        mean += sample;
+    }
+    mean = samples.empty() ? 0 : mean / samples.size();
+    double variance = 0;
+    for (int64_t sample : samples) {
+        variance += (sample - mean) * (sample - mean);
+    }
+    variance = samples.size() < 2 ? 0 : variance / (samples.size() - 1);
+
+    fprintf(file, "        \"%s\": {\n", STAGE_SPANS[stage].name);
+    fprintf(file, "          \"median_ms\": %.4f,\n", toMs(percentileOfSorted(sorted, 50)));
+    fprintf(file, "          \"p90_ms\": %.4f,\n", toMs(percentileOfSorted(sorted, 90)));
+    fprintf(file, "          \"p95_ms\": %.4f,\n", toMs(percentileOfSorted(sorted, 95)));
+    fprintf(file, "          \"p99_ms\": %.4f,\n", toMs(percentileOfSorted(sorted, 99)));
+    fprintf(file, "          \"mean_ms\": %.4f,\n", toMs(mean));
+    fprintf(file, "          \"stddev_ms\": %.4f,\n", toMs(std::sqrt(variance)));
+    fprintf(file, "          \"min_ms\": %.4f,\n", toMs(sorted.empty() ? 0 : sorted.front()));
+    fprintf(file, "          \"max_ms\": %.4f,\n", toMs(sorted.empty() ? 0 : sorted.back()));
+
+    // The median of each run, which are independent of each other unlike consecutive frames
+    fprintf(file, "          \"run_medians_ms\": [");
+    for (size_t run = 0; run < mRunStarts.size(); run++) {
+        size_t end = run + 1 < mRunStarts.size() ? mRunStarts[run + 1] : samples.size();
+        std::vector<int64_t> runSamples(samples.begin() + mRunStarts[run], samples.begin() + end);
+        std::sort(runSamples.begin(), runSamples.end());
+        fprintf(file, "%s%.4f", run ? ", " : "", toMs(percentileOfSorted(runSamples, 50)));
+    }
+    fprintf(file, "],\n");
+
+    fprintf(file, "          \"samples_us\": [");
+    for (size_t i = 0; i < samples.size(); i++) {
+        fprintf(file, "%s%" PRId64, i ? ", " : "", samples[i] / 1000);
+    }
+    fprintf(file, "]\n");
+    fprintf(file, "        }");
+}
+
+void SceneStats::writeJson(FILE* file, const Config& config,
+                           const std::vector<SceneStats>& scenes) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"format\": \"hwuimacro-raster-1\",\n");
+    fprintf(file, "  \"width\": %d,\n", config.width);
+    fprintf(file, "  \"height\": %d,\n", config.height);
+    fprintf(file, "  \"frames_per_run\": %d,\n", config.framesPerRun);
+    fprintf(file, "  \"warmup_frames\": %d,\n", config.warmupFrames);
+    fprintf(file, "  \"scenes\": [\n");
+    for (size_t i = 0; i < scenes.size(); i++) {
+        const SceneStats& scene = scenes[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", scene.mName.c_str());
+        fprintf(file, "      \"runs\": %d,\n", scene.runCount());
+        fprintf(file, "      \"frames\": %d,\n", scene.frameCount());
+        fprintf(file, "      \"stages\": {\n");
+        for (int stage = 0; stage < StageCount; stage++) {
+            scene.writeStageJson(file, static_cast<Stage>(stage));
+            fprintf(file, "%s\n", stage + 1 < StageCount ? "," : "");
+        }
+        fprintf(file, "      }\n");
+        fprintf(file, "    }%s\n", i + 1 < scenes.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+}  // namespace test
+}  // namespace uirenderer
+}  // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+namespace test {
+
+// The size of the frames of --raster runs, fixed so that runs are comparable across devices
+// whatever their display
+constexpr int kRasterWidth = 1080;
+constexpr int kRasterHeight = 1920;
+
+/**
+ * Per-frame CPU stage timings of the runs of a scene, read from the FrameInfo of each frame
+ * once it completes, and summarized as percentiles for the JSON report of --raster runs.
+ */
+class SceneStats {
+public:
+    enum Stage {
+        // PerformTraversalsStart to SyncStart, recording the frame on the UI thread
+        Traversal = 0,
+        // SyncStart to IssueDrawCommandsStart, syncing the tree and running animators
+        Sync,
+        // IssueDrawCommandsStart to FrameCompleted, rasterizing the frame
+        Draw,
+        // IntendedVsync to FrameCompleted
+        Total,
+        StageCount,
+    };
+
+    explicit SceneStats(const std::string& name) : mName(name) {}
+
+    const std::string& name() const { return mName; }
+    int runCount() const { return static_cast<int>(mRunStarts.size()); }
+    int frameCount() const { return static_cast<int>(mSamples[Total].size()); }
+
+    // Frames added after this belong to a new run
+    void beginRun() { mRunStarts.push_back(mSamples[Total].size()); }
+    void addFrame(const FrameInfo& frame);
+
+    // Linearly interpolated percentile of the durations of a stage in ns, or 0 without frames
+    double percentile(Stage stage, double percentile) const;
+
+    void printSummary(FILE* file) const;
+
+    struct Config {
+        int width;
+        int height;
+        int framesPerRun;
+        int warmupFrames;
+    };
+
+    static void writeJson(FILE* file, const Config& config, const std::vector<SceneStats>& scenes);
+
+private:
+    void writeStageJson(FILE* file, Stage stage) const;
+
+    std::string mName;
+    // Durations in ns, in the order the frames were drawn
+    std::vector<int64_t> mSamples[StageCount];
+    std::vector<size_t> mRunStarts;
+};
+
+}  // namespace test
+}  // namespace uirenderer
+}  // namespace android
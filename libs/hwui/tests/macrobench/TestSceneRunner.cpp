@@ -15,14 +15,21 @@
  */
 
 #include "AnimationContext.h"
+#include "LightingInfo.h"
 #include "RenderNode.h"
+#include "TreeInfo.h"
+#include "pipeline/skia/RenderNodeDrawable.h"
+#include "renderthread/CanvasContext.h"
 #include "renderthread/RenderProxy.h"
 #include "renderthread/RenderTask.h"
+#include "renderthread/RenderThread.h"
 #include "tests/common/TestContext.h"
 #include "tests/common/TestScene.h"
 #include "tests/common/scenes/TestSceneBase.h"
+#include "tests/macrobench/SceneStats.h"
 #include "utils/TraceUtils.h"
 
+#include <SkSurface.h>
 #include <benchmark/benchmark.h>
 #include <gui/Surface.h>
 #include <log/log.h>
@@ -33,11 +40,36 @@ using namespace android::uirenderer;
 using namespace android::uirenderer::renderthread;
 using namespace android::uirenderer::test;
 
+class SceneAnimationContext : public AnimationContext {
+public:
+    SceneAnimationContext(renderthread::TimeLord& clock, TestScene* scene)
+            : AnimationContext(clock), mScene(scene) {}
+
+    virtual void startFrame(TreeInfo::TraversalMode mode) override {
+        // Only full frames are synced with the UI thread, which may otherwise be adding nodes
+        if (mode == TreeInfo::MODE_FULL) {
+            for (RenderNode* node : mScene->animatingNodes) {
+                addAnimatingRenderNode(*node);
+            }
+            mScene->animatingNodes.clear();
+        }
+        AnimationContext::startFrame(mode);
+    }
+
+private:
+    TestScene* mScene;
+};
+
 class ContextFactory : public IContextFactory {
 public:
+    explicit ContextFactory(TestScene* scene) : mScene(scene) {}
+
     virtual AnimationContext* createAnimationContext(renderthread::TimeLord& clock) override {
-        return new AnimationContext(clock);
+        return new SceneAnimationContext(clock, mScene);
     }
+
+private:
+    TestScene* mScene;
 };
 
 template <class T>
@@ -128,7 +160,7 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
                 scene->createContent(width, height, canvas);
             });
 
-    ContextFactory factory;
+    ContextFactory factory(scene.get());
     std::unique_ptr<RenderProxy> proxy(new RenderProxy(false, rootNode.get(), &factory));
     proxy->loadSystemProperties();
     proxy->setSurface(surface.get());
@@ -138,7 +170,9 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
 
     // Do a few cold runs then reset the stats so that the caches are all hot
     int warmupFrameCount = 5;
-    if (opts.renderOffscreen) {
+    if (opts.warmupFrameCount >= 0) {
+        warmupFrameCount = opts.warmupFrameCount;
+    } else if (opts.renderOffscreen) {
         // Do a few more warmups to try and boost the clocks up
         warmupFrameCount = 10;
     }
@@ -187,3 +221,80 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
         proxy->dumpProfileInfo(STDOUT_FILENO, DumpFlags::JankStats);
     }
 }
+
+static constexpr float kRasterDensity = 2.625f;
+static constexpr nsecs_t kRasterFrameInterval = 16666667;
+
+void runRaster(const TestScene::Info& info, const TestScene::Options& opts, SceneStats* stats) {
+    std::unique_ptr<TestScene> scene(info.createScene(opts));
+
+    sp<RenderNode> rootNode = TestUtils::createNode(
+            0, 0, kRasterWidth, kRasterHeight, [&scene](RenderProperties& props, Canvas& canvas) {
+                props.setClipToBounds(false);
+                scene->createContent(kRasterWidth, kRasterHeight, canvas);
+            });
+
+    // The frames are synced by a CanvasContext without a surface, which runs the animators
+    // like it would for a window, and are then drawn into a raster surface instead of going
+    // through its pipeline. Hardware layers can't be allocated without a GPU context, so their
+    // nodes are drawn directly
+    ContextFactory factory(scene.get());
+    RenderThread& renderThread = RenderThread::getInstance();
+    std::unique_ptr<CanvasContext> context;
+    sk_sp<SkSurface> surface;
+    renderThread.queue().runSync([&]() {
+        context.reset(CanvasContext::create(renderThread, false, rootNode.get(), &factory));
+        surface = SkSurface::MakeRasterN32Premul(kRasterWidth, kRasterHeight);
+        LightGeometry lightGeometry{{kRasterWidth / 2.0f, -200.0f * kRasterDensity,
+                                     800.0f * kRasterDensity},
+                                    800.0f * kRasterDensity};
+        LightingInfo::updateLighting(lightGeometry, LightInfo(255 * 0.075, 255 * 0.15));
+    });
+
+    int64_t uiFrameInfo[UI_THREAD_FRAME_INFO_SIZE];
+    FrameInfo frameInfo;
+    // Frames are drawn back to back, but the animation clock advances by a vsync every frame,
+    // so that every run animates through the same frames as long as they take less than that
+    nsecs_t animationTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    stats->beginRun();
+    for (int i = -opts.warmupFrameCount; i < opts.count; i++) {
+        nsecs_t vsync = systemTime(SYSTEM_TIME_MONOTONIC);
+        UiFrameInfoBuilder(uiFrameInfo).setVsync(vsync, vsync);
+        // Like run(), warmup frames only redraw the initial content to get the caches hot
+        if (i >= 0) {
+            ATRACE_NAME("UI-Draw Frame");
+            scene->doFrame(i);
+        }
+        frameInfo.importUiThreadInfo(uiFrameInfo);
+        frameInfo.set(FrameInfoIndex::SyncQueued) = systemTime(SYSTEM_TIME_MONOTONIC);
+        animationTime += kRasterFrameInterval;
+
+        renderThread.queue().runSync([&]() {
+            frameInfo.markSyncStart();
+            renderThread.timeLord().vsyncReceived(animationTime);
+            TreeInfo treeInfo(TreeInfo::MODE_FULL, *context);
+            context->prepareTree(treeInfo, uiFrameInfo, frameInfo[FrameInfoIndex::SyncQueued],
+                                 rootNode.get());
+
+            frameInfo.markIssueDrawCommandsStart();
+            SkCanvas* canvas = surface->getCanvas();
+            canvas->clear(SK_ColorWHITE);
+            if (!rootNode->nothingToDraw()) {
+                skiapipeline::RenderNodeDrawable root(rootNode.get(), canvas);
+                root.draw(canvas);
+            }
+            canvas->flush();
+            frameInfo.markSwapBuffers();
+            frameInfo.markFrameCompleted();
+        });
+
+        if (i >= 0) {
+            stats->addFrame(frameInfo);
+        }
+    }
+
+    renderThread.queue().runSync([&]() {
+        context.reset();
+        surface.reset();
+    });
+}
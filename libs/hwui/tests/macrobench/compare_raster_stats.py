@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2020 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compares the JSON reports of two `hwuimacro --raster --json-out=FILE` runs.
+
+A stage of a test regressed when the medians of its runs are significantly
+larger in the candidate according to a two-sided Mann-Whitney U test, and the
+median of those medians grew by more than the threshold. Exits with 1 if
+anything regressed.
+
+The test needs independent samples, so it compares the run medians rather than
+the durations of consecutive frames, which are correlated. Record at least 8
+runs (-r) of each build for a change to reach the default significance level.
+
+Usage: compare_raster_stats.py [--alpha=0.01] [--threshold=0.05] BASE CANDIDATE
+"""
+
+import argparse
+import json
+import math
+import sys
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test, with the normal approximation."""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    values = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks_a = 0.0
+    tie_term = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j < len(values) and values[j][0] == values[i][0]:
+            j += 1
+        # Tied values all get the mean of their ranks
+        rank = (i + j + 1) / 2.0
+        ranks_a += rank * sum(1 for k in range(i, j) if values[k][1] == 0)
+        tie_term += (j - i) ** 3 - (j - i)
+        i = j
+    u = ranks_a - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+    return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def median(values):
+    ordered = sorted(values)
+    n = len(ordered)
+    if n == 0:
+        return 0.0
+    return (ordered[(n - 1) // 2] + ordered[n // 2]) / 2.0
+
+
+def load_scenes(path):
+    with open(path) as f:
+        report = json.load(f)
+    if report.get('format') != 'hwuimacro-raster-1':
+        sys.exit('%s is not a hwuimacro --raster report' % path)
+    return {scene['name']: scene for scene in report['scenes']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--alpha', type=float, default=0.01,
+                        help='significance level of the test (default 0.01)')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='relative change of the median to report (default 0.05)')
+    parser.add_argument('base')
+    parser.add_argument('candidate')
+    args = parser.parse_args()
+
+    base = load_scenes(args.base)
+    candidate = load_scenes(args.candidate)
+    regressed = False
+    print('%-24s %-10s %10s %10s %8s %10s' % ('test', 'stage', 'base', 'candidate', 'change',
+                                            'p-value'))
+    for name in sorted(base.keys() & candidate.keys()):
+        for stage, base_stats in base[name]['stages'].items():
+            candidate_stats = candidate[name]['stages'].get(stage)
+            if candidate_stats is None:
+                continue
+            base_runs = base_stats['run_medians_ms']
+            candidate_runs = candidate_stats['run_medians_ms']
+            base_median = median(base_runs)
+            candidate_median = median(candidate_runs)
+            change = (candidate_median - base_median) / base_median if base_median else 0.0
+            p = mann_whitney_p(base_runs, candidate_runs)
+            verdict = ''
+            if p < args.alpha and abs(change) > args.threshold:
+                verdict = 'REGRESSION' if change > 0 else 'improvement'
+                regressed = regressed or change > 0
+            print('%-24s %-10s %8.3fms %8.3fms %+7.1f%% %10.2g %s' % (
+                name, stage, base_median, candidate_median, change * 100, p, verdict))
+    for name in sorted(base.keys() ^ candidate.keys()):
+        print('%-24s only in %s' % (name, args.base if name in base else args.candidate))
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
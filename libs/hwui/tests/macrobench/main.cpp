@@ -16,6 +16,7 @@
 
 #include "tests/common/LeakChecker.h"
 #include "tests/common/TestScene.h"
+#include "tests/macrobench/SceneStats.h"
 
 #include "Properties.h"
 #include "hwui/Typeface.h"
@@ -43,10 +44,12 @@ using namespace android::uirenderer::test;
 static int gRepeatCount = 1;
 static std::vector<TestScene::Info> gRunTests;
 static TestScene::Options gOpts;
+static const char* gJsonOutPath = nullptr;
 std::unique_ptr<benchmark::BenchmarkReporter> gBenchmarkReporter;
 
 void run(const TestScene::Info& info, const TestScene::Options& opts,
          benchmark::BenchmarkReporter* reporter);
+void runRaster(const TestScene::Info& info, const TestScene::Options& opts, SceneStats* stats);
 
 static void printHelp() {
     printf(R"(
@@ -70,6 +73,12 @@ OPTIONS:
   --benchmark_format   Set output format. Possible values are tabular, json, csv
   --renderer=TYPE      Sets the render pipeline to use. May be skiagl or skiavk
   --render-ahead=NUM   Sets how far to render-ahead. Must be 0 (default), 1, or 2.
+  --raster             Draw frames on the CPU into an offscreen raster surface of
+                       1080x1920, without using the GPU or the display, and report
+                       the percentiles of each frame stage of every test
+  --warmup=NUM         NUM frames to draw before the measured ones of each run
+  --json-out=FILE      With --raster, write the stats of every test to FILE as JSON,
+                       to be compared with tests/macrobench/compare_raster_stats.py
 )");
 }
 
@@ -172,6 +181,9 @@ enum {
     Offscreen,
     Renderer,
     RenderAhead,
+    Raster,
+    Warmup,
+    JsonOut,
 };
 }
 
@@ -188,6 +200,9 @@ static const struct option LONG_OPTIONS[] = {
         {"offscreen", no_argument, nullptr, LongOpts::Offscreen},
         {"renderer", required_argument, nullptr, LongOpts::Renderer},
         {"render-ahead", required_argument, nullptr, LongOpts::RenderAhead},
+        {"raster", no_argument, nullptr, LongOpts::Raster},
+        {"warmup", required_argument, nullptr, LongOpts::Warmup},
+        {"json-out", required_argument, nullptr, LongOpts::JsonOut},
         {0, 0, 0, 0}};
 
 static const char* SHORT_OPTIONS = "c:r:h";
@@ -296,6 +311,30 @@ void parseOptions(int argc, char* argv[]) {
                 }
                 break;
 
+            case LongOpts::Raster:
+                gOpts.renderRaster = true;
+                break;
+
+            case LongOpts::Warmup:
+                if (!optarg) {
+                    error = true;
+                    break;
+                }
+                gOpts.warmupFrameCount = atoi(optarg);
+                if (gOpts.warmupFrameCount < 0) {
+                    fprintf(stderr, "Invalid warmup argument '%s'\n", optarg);
+                    error = true;
+                }
+                break;
+
+            case LongOpts::JsonOut:
+                if (!optarg) {
+                    error = true;
+                    break;
+                }
+                gJsonOutPath = optarg;
+                break;
+
             case 'h':
                 printHelp();
                 exit(EXIT_SUCCESS);
@@ -310,6 +349,11 @@ void parseOptions(int argc, char* argv[]) {
         }
     }
 
+    if (gJsonOutPath && !gOpts.renderRaster) {
+        fprintf(stderr, "--json-out requires --raster\n");
+        error = true;
+    }
+
     if (error) {
         fprintf(stderr, "Try 'hwuitest --help' for more information.\n");
         exit(EXIT_FAILURE);
@@ -334,6 +378,44 @@ void parseOptions(int argc, char* argv[]) {
     }
 }
 
+static int runRasterTests() {
+    if (gOpts.warmupFrameCount < 0) {
+        gOpts.warmupFrameCount = 10;
+    }
+    // Runs of each test are interleaved with the other tests, so that slow drifts of the
+    // machine's performance are spread over all of them
+    std::vector<SceneStats> stats;
+    for (auto&& test : gRunTests) {
+        stats.emplace_back(test.name);
+    }
+    for (int i = 0; i < gRepeatCount; i++) {
+        for (size_t j = 0; j < gRunTests.size(); j++) {
+            runRaster(gRunTests[j], gOpts, &stats[j]);
+        }
+    }
+    for (auto&& sceneStats : stats) {
+        sceneStats.printSummary(stdout);
+    }
+
+    int result = EXIT_SUCCESS;
+    if (gJsonOutPath) {
+        FILE* file = fopen(gJsonOutPath, "we");
+        if (file) {
+            SceneStats::Config config{kRasterWidth, kRasterHeight, gOpts.count,
+                                      gOpts.warmupFrameCount};
+            SceneStats::writeJson(file, config, stats);
+            fclose(file);
+        } else {
+            fprintf(stderr, "Failed to open '%s', errno=%d\n", gJsonOutPath, errno);
+            result = EXIT_FAILURE;
+        }
+    }
+
+    renderthread::RenderProxy::trimMemory(100);
+    LeakChecker::checkForLeaks();
+    return result;
+}
+
 int main(int argc, char* argv[]) {
     // set defaults
     gOpts.count = 150;
@@ -341,6 +423,9 @@ int main(int argc, char* argv[]) {
     Typeface::setRobotoTypefaceForTest();
 
     parseOptions(argc, argv);
+    if (gOpts.renderRaster) {
+        return runRasterTests();
+    }
     if (!gBenchmarkReporter && gOpts.renderOffscreen) {
         gBenchmarkReporter.reset(new benchmark::ConsoleReporter());
     }
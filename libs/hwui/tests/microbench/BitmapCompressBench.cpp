@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "hwui/ParallelEncoder.h"
+
+#include <SkBitmap.h>
+#include <SkColorSpace.h>
+#include <SkImageEncoder.h>
+#include <SkStream.h>
+
+using namespace android;
+
+// A 12MP camera picture
+static constexpr int kWidth = 4000;
+static constexpr int kHeight = 3000;
+
+static const SkBitmap& getPicture() {
+    static SkBitmap bitmap = [] {
+        SkBitmap bitmap;
+        bitmap.allocPixels(SkImageInfo::Make(kWidth, kHeight, kRGBA_8888_SkColorType,
+                                             kOpaque_SkAlphaType, SkColorSpace::MakeSRGB()));
+        uint32_t seed = 1234;
+        for (int y = 0; y < kHeight; y++) {
+            uint8_t* row = static_cast<uint8_t*>(bitmap.getAddr(0, y));
+            for (int x = 0; x < kWidth; x++, row += 4) {
+                seed = seed * 1664525u + 1013904223u;
+                const int noise = seed >> 29;
+                row[0] = (x * 255 / kWidth + noise) & 0xFF;
+                row[1] = (y * 255 / kHeight + noise) & 0xFF;
+                row[2] = ((x ^ y) >> 4) & 0xFF;
+                row[3] = 0xFF;
+            }
+        }
+        return bitmap;
+    }();
+    return bitmap;
+}
+
+// The "bytes" counter reports the size of the encoded picture, to compare the overhead of the
+// restart markers and of the per strip deflate streams to the Skia encoders
+static void runSkia(benchmark::State& state, SkEncodedImageFormat format) {
+    const SkBitmap& bitmap = getPicture();
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        SkDynamicMemoryWStream stream;
+        SkEncodeImage(&stream, bitmap, format, 90);
+        bytes = stream.bytesWritten();
+    }
+    state.counters["bytes"] = bytes;
+}
+
+static void runParallel(benchmark::State& state, SkEncodedImageFormat format) {
+    const SkBitmap& bitmap = getPicture();
+    const int threadBudget = state.range(0);
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        SkDynamicMemoryWStream stream;
+        if (format == SkEncodedImageFormat::kJPEG) {
+            ParallelEncoder::encodeJpeg(&stream, bitmap.pixmap(), 90, threadBudget);
+        } else {
+            ParallelEncoder::encodePng(&stream, bitmap.pixmap(), threadBudget);
+        }
+        bytes = stream.bytesWritten();
+    }
+    state.counters["bytes"] = bytes;
+}
+
+static void BM_BitmapCompress_jpegSkia(benchmark::State& state) {
+    runSkia(state, SkEncodedImageFormat::kJPEG);
+}
+BENCHMARK(BM_BitmapCompress_jpegSkia)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_BitmapCompress_jpegParallel(benchmark::State& state) {
+    runParallel(state, SkEncodedImageFormat::kJPEG);
+}
+BENCHMARK(BM_BitmapCompress_jpegParallel)
+        ->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_BitmapCompress_pngSkia(benchmark::State& state) {
+    runSkia(state, SkEncodedImageFormat::kPNG);
+}
+BENCHMARK(BM_BitmapCompress_pngSkia)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_BitmapCompress_pngParallel(benchmark::State& state) {
+    runParallel(state, SkEncodedImageFormat::kPNG);
+}
+BENCHMARK(BM_BitmapCompress_pngParallel)
+        ->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "utils/Blur.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// The size of a large shadow mask
+static constexpr int32_t kWidth = 512;
+static constexpr int32_t kHeight = 512;
+
+using BlurPass = void (*)(float*, int32_t, const uint8_t*, uint8_t*, int32_t, int32_t);
+
+static void runBlurPass(benchmark::State& state, BlurPass pass) {
+    int32_t radius = state.range(0);
+    std::vector<float> weights(2 * radius + 1);
+    Blur::generateGaussianWeights(weights.data(), radius);
+    std::vector<uint8_t> source(kWidth * kHeight, 0x80);
+    std::vector<uint8_t> dest(kWidth * kHeight);
+    while (state.KeepRunning()) {
+        pass(weights.data(), radius, source.data(), dest.data(), kWidth, kHeight);
+        benchmark::DoNotOptimize(dest.data());
+    }
+    state.SetBytesProcessed(state.iterations() * kWidth * kHeight);
+}
+
+static void BM_Blur_horizontalScalar(benchmark::State& state) {
+    runBlurPass(state, Blur::horizontalScalar);
+}
+BENCHMARK(BM_Blur_horizontalScalar)->Arg(2)->Arg(8)->Arg(24);
+
+static void BM_Blur_horizontal(benchmark::State& state) {
+    runBlurPass(state, Blur::horizontal);
+}
+BENCHMARK(BM_Blur_horizontal)->Arg(2)->Arg(8)->Arg(24);
+
+static void BM_Blur_verticalScalar(benchmark::State& state) {
+    runBlurPass(state, Blur::verticalScalar);
+}
+BENCHMARK(BM_Blur_verticalScalar)->Arg(2)->Arg(8)->Arg(24);
+
+static void BM_Blur_vertical(benchmark::State& state) {
+    runBlurPass(state, Blur::vertical);
+}
+BENCHMARK(BM_Blur_vertical)->Arg(2)->Arg(8)->Arg(24);
+
+// Both axes, switching to the box approximation from BOX_APPROXIMATION_MIN_RADIUS
+static void BM_Blur_blur(benchmark::State& state) {
+    float radius = state.range(0);
+    std::vector<uint8_t> source(kWidth * kHeight, 0x80);
+    std::vector<uint8_t> temp(kWidth * kHeight);
+    std::vector<uint8_t> dest(kWidth * kHeight);
+    while (state.KeepRunning()) {
+        Blur::blur(radius, source.data(), dest.data(), temp.data(), kWidth, kHeight);
+        benchmark::DoNotOptimize(dest.data());
+    }
+    state.SetBytesProcessed(state.iterations() * kWidth * kHeight);
+}
+BENCHMARK(BM_Blur_blur)->Arg(8)->Arg(11)->Arg(12)->Arg(24)->Arg(64);
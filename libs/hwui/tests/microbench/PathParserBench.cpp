@@ -51,3 +51,68 @@ void BM_PathParser_parseStringPathForPathData(benchmark::State& state) {
     }
 }
 BENCHMARK(BM_PathParser_parseStringPathForPathData);
+
+// Path data of commonly used material icons
+static const char* sIconPaths[] = {
+        "M19,13h-6v6h-2v-6H5v-2h6V5h2v6h6v2z",
+        "M19,6.41L17.59,5 12,10.59 6.41,5 5,6.41 10.59,12 5,17.59 6.41,19 12,13.41 17.59,19 "
+        "19,17.59 13.41,12z",
+        "M9,16.17L4.83,12l-1.42,1.41L9,19 21,7l-1.41,-1.41z",
+        "M3,18h18v-2H3v2zm0,-5h18v-2H3v2zm0,-7v2h18V6H3z",
+        "M20,11H7.83l5.59,-5.59L12,4l-8,8 8,8 1.41,-1.41L7.83,13H20v-2z",
+        "M10,20v-6h4v6h5v-8h3L12,3 2,12h3v8z",
+        "M15.5,14h-0.79l-0.28,-0.27C15.41,12.59 16,11.11 16,9.5 16,5.91 13.09,3 9.5,3S3,5.91 "
+        "3,9.5 5.91,16 9.5,16c1.61,0 3.09,-0.59 4.23,-1.57l0.27,0.28v0.79l5,4.99L20.49,19l-4.99,"
+        "-5zM9.5,14C7.01,14 5,11.99 5,9.5S7.01,5 9.5,5 14,7.01 14,9.5 11.99,14 9.5,14z",
+        "M12,8c1.1,0 2,-0.9 2,-2s-0.9,-2 -2,-2 -2,0.9 -2,2 0.9,2 2,2zM12,10c-1.1,0 -2,0.9 -2,2s0.9,"
+        "2 2,2 2,-0.9 2,-2 -0.9,-2 -2,-2zM12,16c-1.1,0 -2,0.9 -2,2s0.9,2 2,2 2,-0.9 2,-2 -0.9,-2 "
+        "-2,-2z",
+        "M12,21.35l-1.45,-1.32C5.4,15.36 2,12.28 2,8.5 2,5.42 4.42,3 7.5,3c1.74,0 3.41,0.81 4.5,"
+        "2.09C13.09,3.81 14.76,3 16.5,3 19.58,3 22,5.42 22,8.5c0,3.78 -3.4,6.86 -8.55,11.54L12,"
+        "21.35z",
+        "M6,19c0,1.1 0.9,2 2,2h8c1.1,0 2,-0.9 2,-2V7H6v12zM19,4h-3.5l-1,-1h-5l-1,1H5v2h14V4z",
+        "M18,16.08c-0.76,0 -1.44,0.3 -1.96,0.77L8.91,12.7c0.05,-0.23 0.09,-0.46 0.09,-0.7s-0.04,"
+        "-0.47 -0.09,-0.7l7.05,-4.11c0.54,0.5 1.25,0.81 2.04,0.81 1.66,0 3,-1.34 3,-3s-1.34,-3 -3,"
+        "-3 -3,1.34 -3,3c0,0.24 0.04,0.47 0.09,0.7L8.04,9.81C7.5,9.31 6.79,9 6,9c-1.66,0 -3,1.34 "
+        "-3,3s1.34,3 3,3c0.79,0 1.5,-0.31 2.04,-0.81l7.12,4.16c-0.05,0.21 -0.08,0.43 -0.08,0.65 "
+        "0,1.61 1.31,2.92 2.92,2.92 1.61,0 2.92,-1.31 2.92,-2.92s-1.31,-2.92 -2.92,-2.92z",
+        "M19.43,12.98c0.04,-0.32 0.07,-0.64 0.07,-0.98s-0.03,-0.66 -0.07,-0.98l2.11,-1.65c0.19,"
+        "-0.15 0.24,-0.42 0.12,-0.64l-2,-3.46c-0.12,-0.22 -0.39,-0.3 -0.61,-0.22l-2.49,1c-0.52,"
+        "-0.4 -1.08,-0.73 -1.69,-0.98l-0.38,-2.65C14.46,2.18 14.25,2 14,2h-4c-0.25,0 -0.46,0.18 "
+        "-0.49,0.42l-0.38,2.65c-0.61,0.25 -1.17,0.59 -1.69,0.98l-2.49,-1c-0.23,-0.09 -0.49,0 "
+        "-0.61,0.22l-2,3.46c-0.13,0.22 -0.07,0.49 0.12,0.64l2.11,1.65c-0.04,0.32 -0.07,0.65 "
+        "-0.07,0.98s0.03,0.66 0.07,0.98l-2.11,1.65c-0.19,0.15 -0.24,0.42 -0.12,0.64l2,3.46c0.12,"
+        "0.22 0.39,0.3 0.61,0.22l2.49,-1c0.52,0.4 1.08,0.73 1.69,0.98l0.38,2.65c0.03,0.24 0.24,"
+        "0.42 0.49,0.42h4c0.25,0 0.46,-0.18 0.49,-0.42l0.38,-2.65c0.61,-0.25 1.17,-0.59 1.69,"
+        "-0.98l2.49,1c0.23,0.09 0.49,0 0.61,-0.22l2,-3.46c0.12,-0.22 0.07,-0.49 -0.12,-0.64l-2.11,"
+        "-1.65zM12,15.5c-1.93,0 -3.5,-1.57 -3.5,-3.5s1.57,-3.5 3.5,-3.5 3.5,1.57 3.5,3.5 -1.57,"
+        "3.5 -3.5,3.5z",
+};
+
+static void parseIconPaths() {
+    for (const char* pathString : sIconPaths) {
+        PathData outData;
+        PathParser::ParseResult result;
+        PathParser::getPathDataFromAsciiString(&outData, &result, pathString, strlen(pathString));
+        benchmark::DoNotOptimize(&outData);
+    }
+}
+
+// Parses the corpus as if each icon was inflated for the first time
+void BM_PathParser_parseIconPaths_cold(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        PathParser::clearCache();
+        parseIconPaths();
+    }
+}
+BENCHMARK(BM_PathParser_parseIconPaths_cold);
+
+// Parses the corpus as if each icon had already been inflated
+void BM_PathParser_parseIconPaths_cached(benchmark::State& state) {
+    PathParser::clearCache();
+    parseIconPaths();
+    while (state.KeepRunning()) {
+        parseIconPaths();
+    }
+}
+BENCHMARK(BM_PathParser_parseIconPaths_cached);
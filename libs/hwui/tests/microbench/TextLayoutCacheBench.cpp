@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Properties.h"
+#include "hwui/Canvas.h"
+#include "hwui/MinikinUtils.h"
+#include "hwui/Paint.h"
+#include "hwui/TextLayoutCache.h"
+#include "tests/common/TestUtils.h"
+
+#include <string.h>
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// Messages of a chat list, where the same short strings come back as the list scrolls
+static const char* kChatCorpus[] = {
+        "Hey! Are you around?",
+        "Yes, what's up?",
+        "Lunch at noon?",
+        "Sure, the usual place",
+        "Running 5 minutes late, sorry",
+        "No worries",
+        "Did you see the game last night? That last minute goal was unbelievable",
+        "ok",
+        "Can you send me the slides from this morning's meeting when you get a chance?",
+        "Sent!",
+        "Thanks :)",
+        "See you tomorrow",
+        "Happy birthday!!! Hope you have a great day",
+        "lol",
+        "Where are we meeting?",
+        "In front of the station, by the bike racks",
+};
+static constexpr int kCorpusSize = sizeof(kChatCorpus) / sizeof(kChatCorpus[0]);
+// Rows of the list on screen in each frame
+static constexpr int kVisibleRows = 12;
+
+static std::vector<std::vector<uint16_t>> corpus() {
+    std::vector<std::vector<uint16_t>> messages;
+    for (const char* message : kChatCorpus) {
+        messages.emplace_back(message, message + strlen(message));
+    }
+    return messages;
+}
+
+// Each frame of a scrolling list measures and draws the visible rows, one row further down, with
+// the cache enabled or not depending on the argument
+void BM_TextLayoutCache_chatList(benchmark::State& benchState) {
+    ScopedProperty<int> cacheSize(Properties::textLayoutCacheSize,
+                                  benchState.range(0) ? 1024 : 0);
+    TextLayoutCache::getInstance().clear();
+    std::vector<std::vector<uint16_t>> messages = corpus();
+    std::unique_ptr<Canvas> canvas(Canvas::create_recording_canvas(1080, 1920));
+    Paint paint;
+    paint.getSkFont().setSize(42);
+    std::vector<float> advances;
+    int firstRow = 0;
+    TextLayoutCache::Stats before = TextLayoutCache::getInstance().stats();
+
+    while (benchState.KeepRunning()) {
+        canvas->resetRecording(1080, 1920);
+        for (int row = 0; row < kVisibleRows; row++) {
+            const std::vector<uint16_t>& text = messages[(firstRow + row) % kCorpusSize];
+            advances.resize(text.size());
+            float width = MinikinUtils::measureText(&paint, minikin::Bidi::LTR, nullptr,
+                                                    text.data(), 0, text.size(), text.size(),
+                                                    advances.data());
+            benchmark::DoNotOptimize(width);
+            canvas->drawText(text.data(), text.size(), 0, text.size(), 0, text.size(), 40,
+                             100 + row * 150, minikin::Bidi::LTR, paint, nullptr, nullptr);
+        }
+        delete canvas->finishRecording();
+        firstRow++;
+    }
+
+    TextLayoutCache::Stats after = TextLayoutCache::getInstance().stats();
+    const uint32_t hits = after.hits - before.hits;
+    const uint32_t lookups = hits + after.misses - before.misses;
+    if (lookups > 0) {
+        benchState.counters["hit_rate"] = static_cast<double>(hits) / lookups;
+    }
+}
+BENCHMARK(BM_TextLayoutCache_chatList)->Arg(0)->Arg(1);
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Properties.h"
+#include "jni/YuvToJpegEncoder.h"
+#include "tests/common/TestUtils.h"
+
+#include <hardware/hardware.h>
+
+#include <memory>
+#include <vector>
+
+using namespace android::uirenderer;
+
+// A 12MP camera frame
+static constexpr int kWidth = 4000;
+static constexpr int kHeight = 3000;
+
+struct YuvFrame {
+    std::vector<uint8_t> data;
+    int strides[2];
+    int offsets[2];
+};
+
+static YuvFrame createFrame(int format) {
+    YuvFrame frame;
+    uint32_t seed = 1234;
+    if (format == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+        frame.strides[0] = kWidth;
+        frame.strides[1] = kWidth;
+        frame.offsets[0] = 0;
+        frame.offsets[1] = kWidth * kHeight;
+        frame.data.resize(kWidth * kHeight * 3 / 2);
+    } else {
+        frame.strides[0] = kWidth * 2;
+        frame.offsets[0] = 0;
+        frame.data.resize(kWidth * kHeight * 2);
+    }
+    for (size_t i = 0; i < frame.data.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        frame.data[i] = (i / 64 + (seed >> 29)) & 0xFF;
+    }
+    return frame;
+}
+
+// Arguments are the HAL pixel format and the thread budget, 1 being the sequential encoder
+static void BM_YuvToJpegEncoder_encode(benchmark::State& state) {
+    const int format = state.range(0);
+    ScopedProperty<int> compressThreads(Properties::compressThreads, state.range(1));
+    YuvFrame frame = createFrame(format);
+    std::unique_ptr<YuvToJpegEncoder> encoder(YuvToJpegEncoder::create(format, frame.strides));
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        SkDynamicMemoryWStream stream;
+        encoder->encode(&stream, frame.data.data(), kWidth, kHeight, frame.offsets, 90);
+        bytes = stream.bytesWritten();
+    }
+    state.counters["bytes"] = bytes;
+}
+BENCHMARK(BM_YuvToJpegEncoder_encode)
+        ->Args({HAL_PIXEL_FORMAT_YCrCb_420_SP, 1})
+        ->Args({HAL_PIXEL_FORMAT_YCrCb_420_SP, 2})
+        ->Args({HAL_PIXEL_FORMAT_YCrCb_420_SP, 4})
+        ->Args({HAL_PIXEL_FORMAT_YCbCr_422_I, 1})
+        ->Args({HAL_PIXEL_FORMAT_YCbCr_422_I, 2})
+        ->Args({HAL_PIXEL_FORMAT_YCbCr_422_I, 4})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
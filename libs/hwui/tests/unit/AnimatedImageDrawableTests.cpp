@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Properties.h"
+#include "hwui/AnimatedImageDrawable.h"
+#include "tests/common/TestUtils.h"
+
+#include <SkAndroidCodec.h>
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkCodec.h>
+#include <SkData.h>
+
+#include <unistd.h>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static constexpr int kFrameCount = 8;
+
+/**
+ * Builds a looping GIF of kFrameCount 1x1 frames, each shown for delayCS hundredths of a
+ * second.
+ */
+static sk_sp<SkData> createGif(int delayCS) {
+    std::vector<uint8_t> gif = {
+            'G', 'I', 'F', '8', '9', 'a',
+            // Logical screen of 1x1, with a global color table of two colors
+            0x01, 0x00, 0x01, 0x00, 0x80, 0x00, 0x00,
+            0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00,
+            // Loop forever
+            0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+            0x03, 0x01, 0x00, 0x00, 0x00,
+    };
+    for (int i = 0; i < kFrameCount; i++) {
+        const uint8_t frame[] = {
+                // Graphic control extension with the delay
+                0x21, 0xF9, 0x04, 0x00, static_cast<uint8_t>(delayCS), 0x00, 0x00, 0x00,
+                // Image descriptor, and the LZW data of a single pixel of color i % 2
+                0x2C, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+                0x02, 0x02, static_cast<uint8_t>(0x44 | ((i % 2) << 3)), 0x01, 0x00,
+        };
+        gif.insert(gif.end(), frame, frame + sizeof(frame));
+    }
+    gif.push_back(0x3B);
+    return SkData::MakeWithCopy(gif.data(), gif.size());
+}
+
+static sk_sp<AnimatedImageDrawable> createDrawable(int delayCS) {
+    std::unique_ptr<SkAndroidCodec> codec =
+            SkAndroidCodec::MakeFromCodec(SkCodec::MakeFromData(createGif(delayCS)));
+    if (!codec) {
+        return nullptr;
+    }
+    sk_sp<SkAnimatedImage> image = SkAnimatedImage::Make(std::move(codec));
+    if (!image) {
+        return nullptr;
+    }
+    return sk_make_sp<AnimatedImageDrawable>(std::move(image), 0);
+}
+
+static int countDecodesAhead(AnimatedImageDrawable* drawable) {
+    int decodes = 1;
+    while (drawable->decodeAhead()) {
+        decodes++;
+        if (decodes > kFrameCount) {
+            break;
+        }
+    }
+    return decodes;
+}
+
+TEST(AnimatedImageDrawable, decodesAheadUpToLookahead) {
+    ScopedProperty<int> lookahead(Properties::animatedImageLookahead, 3);
+    const size_t pendingBytes = AnimatedImageDrawable::getFrameStats().pendingBytes;
+    {
+        // 20ms frames, so three of them are well within the time decoded ahead
+        sk_sp<AnimatedImageDrawable> drawable = createDrawable(2);
+        ASSERT_TRUE(drawable);
+        EXPECT_EQ(3, countDecodesAhead(drawable.get()));
+        EXPECT_EQ(pendingBytes + 3 * 4, AnimatedImageDrawable::getFrameStats().pendingBytes);
+    }
+    // Frames that were never shown are released with the drawable
+    EXPECT_EQ(pendingBytes, AnimatedImageDrawable::getFrameStats().pendingBytes);
+}
+
+TEST(AnimatedImageDrawable, lookaheadFollowsFrameDurations) {
+    ScopedProperty<int> lookahead(Properties::animatedImageLookahead, 3);
+    // One second frames, so the next one is enough
+    sk_sp<AnimatedImageDrawable> drawable = createDrawable(100);
+    ASSERT_TRUE(drawable);
+    EXPECT_EQ(1, countDecodesAhead(drawable.get()));
+}
+
+TEST(AnimatedImageDrawable, budgetLimitsLookahead) {
+    ScopedProperty<int> lookahead(Properties::animatedImageLookahead, 3);
+    ScopedProperty<int> cacheSize(Properties::animatedImageCacheSize, 0);
+    // Without any budget, only the next frame is decoded
+    sk_sp<AnimatedImageDrawable> drawable = createDrawable(2);
+    ASSERT_TRUE(drawable);
+    EXPECT_EQ(1, countDecodesAhead(drawable.get()));
+}
+
+TEST(AnimatedImageDrawable, drawsCurrentFrameWhileDecodingAhead) {
+    // One second frames, so the first frame stays on screen and only the next one is decoded
+    sk_sp<AnimatedImageDrawable> drawable = createDrawable(100);
+    ASSERT_TRUE(drawable);
+    const size_t pendingBytes = AnimatedImageDrawable::getFrameStats().pendingBytes;
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(1, 1);
+    SkCanvas canvas(bitmap);
+
+    // The first draw of a running image schedules decoding the next frame, which is black
+    drawable->start();
+    drawable->draw(&canvas);
+    EXPECT_EQ(SK_ColorWHITE, bitmap.getColor(0, 0));
+    for (int i = 0; AnimatedImageDrawable::getFrameStats().pendingBytes == pendingBytes &&
+                    i < 1000; i++) {
+        usleep(1000);
+    }
+    ASSERT_LT(pendingBytes, AnimatedImageDrawable::getFrameStats().pendingBytes);
+
+    bitmap.eraseColor(SK_ColorTRANSPARENT);
+    drawable->draw(&canvas);
+    EXPECT_EQ(SK_ColorWHITE, bitmap.getColor(0, 0));
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "AnimationContext.h"
+#include "Animator.h"
+#include "IContextFactory.h"
+#include "Interpolator.h"
+#include "renderthread/CanvasContext.h"
+#include "tests/common/TestUtils.h"
+
+#include <algorithm>
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+class ContextFactory : public IContextFactory {
+public:
+    virtual AnimationContext* createAnimationContext(renderthread::TimeLord& clock) override {
+        return new AnimationContext(clock);
+    }
+};
+
+static sp<RenderPropertyAnimator> createAnimator(RenderPropertyAnimator::RenderProperty property,
+                                                 float startValue, float finalValue,
+                                                 Interpolator* interpolator, nsecs_t durationMs,
+                                                 nsecs_t startDelayMs = 0) {
+    sp<RenderPropertyAnimator> animator = new RenderPropertyAnimator(property, finalValue);
+    animator->setStartValue(startValue);
+    animator->setInterpolator(interpolator);
+    animator->setDuration(durationMs);
+    animator->setStartDelay(startDelayMs);
+    return animator;
+}
+
+RENDERTHREAD_TEST(AnimatorManager, batchedAnimate) {
+    auto node = TestUtils::createNode(0, 0, 100, 100, nullptr);
+    ContextFactory contextFactory;
+    std::unique_ptr<CanvasContext> canvasContext(
+            CanvasContext::create(renderThread, false, node.get(), &contextFactory));
+    TreeInfo info(TreeInfo::MODE_RT_ONLY, *canvasContext.get());
+    AnimationContext context(renderThread.timeLord());
+
+    // Two animators of different kinds of interpolators on the same property, where the last
+    // one must win, one that is delayed, and one that finishes first
+    std::vector<sp<RenderPropertyAnimator>> animators = {
+            createAnimator(RenderPropertyAnimator::TRANSLATION_X, 0, 100,
+                           new LinearInterpolator(), 100),
+            createAnimator(RenderPropertyAnimator::TRANSLATION_X, 0, 400,
+                           new AccelerateInterpolator(1), 100),
+            createAnimator(RenderPropertyAnimator::TRANSLATION_Y, 0, 100,
+                           new LinearInterpolator(), 100, 50),
+            createAnimator(RenderPropertyAnimator::ALPHA, 1, 0, new LinearInterpolator(), 50),
+    };
+    for (auto& animator : animators) {
+        node->addAnimator(animator);
+        animator->start();
+    }
+    context.addAnimatingRenderNode(*node);
+
+    const nsecs_t startTime = std::max(renderThread.timeLord().latestVsync(),
+                                       systemTime(SYSTEM_TIME_MONOTONIC));
+    auto runFrame = [&](nsecs_t frameTimeMs) {
+        renderThread.timeLord().vsyncReceived(startTime + milliseconds_to_nanoseconds(frameTimeMs));
+        context.startFrame(TreeInfo::MODE_RT_ONLY);
+        node->animators().pushStaging();
+        node->animators().animateNoDamage(info);
+    };
+
+    runFrame(0);
+    runFrame(25);
+    EXPECT_FLOAT_EQ(400 * 0.25f * 0.25f, node->properties().getTranslationX());
+    EXPECT_FLOAT_EQ(0, node->properties().getTranslationY());
+    EXPECT_FLOAT_EQ(0.5f, node->properties().getAlpha());
+
+    runFrame(50);
+    EXPECT_FLOAT_EQ(400 * 0.5f * 0.5f, node->properties().getTranslationX());
+    EXPECT_FLOAT_EQ(0, node->properties().getTranslationY());
+    EXPECT_FLOAT_EQ(0, node->properties().getAlpha());
+    EXPECT_TRUE(animators[3]->isFinished());
+
+    runFrame(100);
+    EXPECT_FLOAT_EQ(400, node->properties().getTranslationX());
+    EXPECT_FLOAT_EQ(50, node->properties().getTranslationY());
+    EXPECT_TRUE(node->animators().hasAnimators());
+
+    runFrame(150);
+    EXPECT_FLOAT_EQ(100, node->properties().getTranslationY());
+    // The node leaves the animation context once every animator has finished
+    EXPECT_FALSE(node->animators().hasAnimators());
+    EXPECT_FALSE(node->animators().hasAnimationHandle());
+}
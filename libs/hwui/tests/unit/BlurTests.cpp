@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "utils/Blur.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static std::vector<uint8_t> createNoise(int32_t width, int32_t height) {
+    std::vector<uint8_t> pixels(width * height);
+    uint32_t seed = 1234;
+    for (uint8_t& pixel : pixels) {
+        seed = seed * 1664525u + 1013904223u;
+        pixel = seed >> 24;
+    }
+    return pixels;
+}
+
+static int maxDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    int difference = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        difference = std::max(difference, abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+TEST(Blur, vectorizedMatchesScalar) {
+    // Includes sizes smaller than the kernels, and widths that aren't multiples of the lanes
+    const int32_t sizes[][2] = {{1, 1}, {7, 5}, {33, 17}, {64, 64}, {100, 3}};
+    for (const auto& size : sizes) {
+        int32_t width = size[0];
+        int32_t height = size[1];
+        std::vector<uint8_t> source = createNoise(width, height);
+        for (int32_t radius : {1, 3, 8, 20}) {
+            std::vector<float> weights(2 * radius + 1);
+            Blur::generateGaussianWeights(weights.data(), radius);
+            std::vector<uint8_t> expected(width * height);
+            std::vector<uint8_t> actual(width * height);
+
+            Blur::horizontalScalar(weights.data(), radius, source.data(), expected.data(), width,
+                                   height);
+            Blur::horizontal(weights.data(), radius, source.data(), actual.data(), width, height);
+            EXPECT_LE(maxDifference(expected, actual), 1)
+                    << "horizontal " << width << "x" << height << " radius " << radius;
+
+            Blur::verticalScalar(weights.data(), radius, source.data(), expected.data(), width,
+                                 height);
+            Blur::vertical(weights.data(), radius, source.data(), actual.data(), width, height);
+            EXPECT_LE(maxDifference(expected, actual), 1)
+                    << "vertical " << width << "x" << height << " radius " << radius;
+        }
+    }
+}
+
+TEST(Blur, boxRadiiMatchGaussianVariance) {
+    for (float radius : {12.0f, 16.0f, 25.0f, 40.0f, 80.0f}) {
+        int32_t boxRadii[Blur::BOX_PASSES];
+        Blur::computeBoxRadii(radius, boxRadii);
+        // The variance of a box of width w is (w^2 - 1) / 12, and variances add up
+        float variance = 0;
+        for (int32_t boxRadius : boxRadii) {
+            float boxWidth = 2 * boxRadius + 1;
+            variance += (boxWidth * boxWidth - 1) / 12;
+        }
+        float sigma = 0.3f * radius + 0.6f;
+        EXPECT_NEAR(sigma, sqrtf(variance), 0.1f * sigma) << "radius " << radius;
+    }
+}
+
+TEST(Blur, boxApproximationOfShadowMask) {
+    // A rect mask, as used for shadows
+    const int32_t width = 200;
+    const int32_t height = 200;
+    std::vector<uint8_t> source(width * height, 0);
+    for (int32_t y = 60; y < 140; y++) {
+        for (int32_t x = 60; x < 140; x++) {
+            source[y * width + x] = 255;
+        }
+    }
+
+    for (float radius : {16.0f, 40.0f}) {
+        int32_t intRadius = Blur::convertRadiusToInt(radius);
+        ASSERT_GE(intRadius, Blur::BOX_APPROXIMATION_MIN_RADIUS);
+        std::vector<float> weights(2 * intRadius + 1);
+        Blur::generateGaussianWeights(weights.data(), radius);
+        std::vector<uint8_t> temp(width * height);
+        std::vector<uint8_t> gaussian(width * height);
+        Blur::horizontalScalar(weights.data(), intRadius, source.data(), temp.data(), width,
+                               height);
+        Blur::verticalScalar(weights.data(), intRadius, temp.data(), gaussian.data(), width,
+                             height);
+
+        std::vector<uint8_t> approximation(width * height);
+        Blur::blur(radius, source.data(), approximation.data(), temp.data(), width, height);
+
+        int totalDifference = 0;
+        for (size_t i = 0; i < gaussian.size(); i++) {
+            totalDifference += abs(gaussian[i] - approximation[i]);
+        }
+        EXPECT_LE(maxDifference(gaussian, approximation), 6) << "radius " << radius;
+        EXPECT_LT(totalDifference / float(width * height), 1.0f) << "radius " << radius;
+    }
+}
@@ -54,6 +54,21 @@ TEST(DISABLED_CommonPool, threadCount) {
     EXPECT_EQ(0, threads.count(gettid()));
 }
 
+TEST(CommonPool, parallelFor) {
+    std::array<std::atomic_int, 64> runs{};
+    CommonPool::parallelFor(runs.size(), CommonPool::THREAD_COUNT + 1,
+                            [&runs](int i) { runs[i]++; });
+    for (auto& run : runs) {
+        EXPECT_EQ(1, run.load());
+    }
+
+    // The calling thread runs every task when the pool is not allowed to help
+    std::set<pid_t> threads;
+    CommonPool::parallelFor(4, 1, [&threads](int) { threads.insert(gettid()); });
+    EXPECT_EQ(1, threads.size());
+    EXPECT_EQ(1, threads.count(gettid()));
+}
+
 TEST(CommonPool, singleThread) {
     std::mutex mutex;
     std::condition_variable fence;
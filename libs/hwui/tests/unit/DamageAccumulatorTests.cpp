@@ -127,3 +127,100 @@ TEST(DamageAccumulator, perspectiveTransform) {
     da.finish(&dirty);
     ASSERT_EQ(SkRect::MakeLTRB(50, 50, 500, 500), dirty);
 }
+
+// Test that damage in opposite corners is kept as separate rects, while
+// the bounding rect is unaffected
+TEST(DamageAccumulator, disjointRegion) {
+    DamageAccumulator da;
+    da.pushTransform(&Matrix4::identity());
+    {
+        da.pushTransform(&Matrix4::identity());
+        da.dirty(0, 0, 10, 10);
+        da.popTransform();
+        da.pushTransform(&Matrix4::identity());
+        da.dirty(990, 990, 1000, 1000);
+        da.popTransform();
+    }
+    da.popTransform();
+    SkRect dirty;
+    DamageRegion region;
+    da.finish(&dirty, &region);
+    ASSERT_EQ(SkRect::MakeLTRB(0, 0, 1000, 1000), dirty);
+    ASSERT_EQ(2, region.count());
+    EXPECT_EQ(200.0f, region.area());
+    EXPECT_EQ(dirty, region.getBounds());
+}
+
+// Test that overlapping and nearly adjacent rects are merged
+TEST(DamageAccumulator, mergeRegion) {
+    DamageRegion region;
+    region.add(SkRect::MakeLTRB(0, 0, 100, 100));
+    region.add(SkRect::MakeLTRB(50, 50, 150, 150));
+    ASSERT_EQ(1, region.count());
+    EXPECT_EQ(SkRect::MakeLTRB(0, 0, 150, 150), region[0]);
+
+    region.add(SkRect::MakeLTRB(150, 0, 200, 150));
+    ASSERT_EQ(1, region.count());
+    EXPECT_EQ(SkRect::MakeLTRB(0, 0, 200, 150), region[0]);
+
+    region.add(SkRect::MakeLTRB(10, 10, 20, 20));
+    ASSERT_EQ(1, region.count());
+}
+
+// Test that the region never grows beyond kMaxRects and still covers everything
+TEST(DamageAccumulator, boundedRegion) {
+    DamageRegion region;
+    SkRect bounds = SkRect::MakeEmpty();
+    for (int i = 0; i < 10; i++) {
+        SkRect rect = SkRect::MakeXYWH(i * 100, i * 100, 10, 10);
+        region.add(rect);
+        bounds.join(rect);
+        ASSERT_LE(region.count(), DamageRegion::kMaxRects);
+    }
+    EXPECT_EQ(bounds, region.getBounds());
+    for (int i = 0; i < 10; i++) {
+        SkRect rect = SkRect::MakeXYWH(i * 100, i * 100, 10, 10);
+        bool covered = false;
+        for (const SkRect& r : region) {
+            covered |= r.contains(rect);
+        }
+        EXPECT_TRUE(covered);
+    }
+    region.reduceTo(1);
+    ASSERT_EQ(1, region.count());
+    EXPECT_EQ(bounds, region[0]);
+}
+
+// Test that each rect of the region is mapped through RenderNode transforms
+TEST(DamageAccumulator, renderNodeRegion) {
+    DamageAccumulator da;
+    RenderNode node1;
+    node1.animatorProperties().setLeftTopRightBottom(50, 50, 1000, 1000);
+    node1.animatorProperties().updateMatrix();
+    da.pushTransform(&node1);
+    {
+        RenderNode node2;
+        node2.animatorProperties().setLeftTopRightBottom(0, 0, 100, 100);
+        node2.animatorProperties().updateMatrix();
+        da.pushTransform(&node2);
+        da.dirty(0, 0, 10, 10);
+        da.popTransform();
+        RenderNode node3;
+        node3.animatorProperties().setLeftTopRightBottom(500, 500, 600, 600);
+        node3.animatorProperties().updateMatrix();
+        da.pushTransform(&node3);
+        da.dirty(0, 0, 10, 10);
+        da.popTransform();
+    }
+    da.popTransform();
+    SkRect dirty;
+    DamageRegion region;
+    da.finish(&dirty, &region);
+    ASSERT_EQ(SkRect::MakeLTRB(50, 50, 560, 560), dirty);
+    ASSERT_EQ(2, region.count());
+    SkRect first = region[0];
+    SkRect second = region[1];
+    if (first.fLeft > second.fLeft) std::swap(first, second);
+    EXPECT_EQ(SkRect::MakeLTRB(50, 50, 60, 60), first);
+    EXPECT_EQ(SkRect::MakeLTRB(550, 550, 560, 560), second);
+}
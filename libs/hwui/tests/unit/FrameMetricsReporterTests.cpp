@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "FrameMetricsReporter.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static constexpr int kFrameSize = FrameMetricsRing::kFrameSize;
+
+class TestObserver : public FrameMetricsObserver {
+public:
+    void notify() override { notifyCount++; }
+
+    std::atomic<int> notifyCount{0};
+};
+
+static void reportFrame(FrameMetricsReporter* reporter, int64_t value) {
+    int64_t frame[kFrameSize];
+    for (int i = 0; i < kFrameSize; i++) {
+        frame[i] = value;
+    }
+    reporter->reportFrameMetrics(frame);
+}
+
+TEST(FrameMetricsReporter, notifiesOncePerBatch) {
+    FrameMetricsReporter reporter;
+    sp<TestObserver> observer = new TestObserver();
+    reporter.addObserver(observer.get());
+
+    for (int i = 1; i <= 3; i++) {
+        reportFrame(&reporter, i);
+    }
+    EXPECT_EQ(1, observer->notifyCount);
+
+    int64_t frame[kFrameSize];
+    uint32_t droppedCount;
+    for (int i = 1; i <= 3; i++) {
+        ASSERT_TRUE(observer->readNextFrame(frame, &droppedCount));
+        EXPECT_EQ(i, frame[0]);
+        EXPECT_EQ(i, frame[kFrameSize - 1]);
+        EXPECT_EQ(0u, droppedCount);
+    }
+    EXPECT_FALSE(observer->readNextFrame(frame, &droppedCount));
+
+    // Having read everything, the observer is woken up by the next frame
+    reportFrame(&reporter, 4);
+    EXPECT_EQ(2, observer->notifyCount);
+    reporter.removeObserver(observer.get());
+}
+
+TEST(FrameMetricsReporter, countsOverwrittenFrames) {
+    FrameMetricsReporter reporter;
+    sp<TestObserver> observer = new TestObserver();
+    reporter.addObserver(observer.get());
+
+    const int frameCount = FrameMetricsRing::kCapacity + 10;
+    for (int i = 0; i < frameCount; i++) {
+        reportFrame(&reporter, i);
+    }
+    int64_t frame[kFrameSize];
+    uint32_t droppedCount;
+    ASSERT_TRUE(observer->readNextFrame(frame, &droppedCount));
+    EXPECT_EQ(10, frame[0]);
+    EXPECT_EQ(10u, droppedCount);
+    EXPECT_EQ(10u, reporter.overflowCount());
+
+    int readCount = 1;
+    while (observer->readNextFrame(frame, &droppedCount)) {
+        EXPECT_EQ(0u, droppedCount);
+        readCount++;
+    }
+    EXPECT_EQ(static_cast<int>(FrameMetricsRing::kCapacity), readCount);
+    reporter.removeObserver(observer.get());
+}
+
+TEST(FrameMetricsReporter, concurrentReaders) {
+    constexpr int kFrameCount = 200000;
+    constexpr int kReaderCount = 3;
+    FrameMetricsReporter reporter;
+    std::vector<sp<TestObserver>> observers;
+    for (int i = 0; i < kReaderCount; i++) {
+        observers.push_back(new TestObserver());
+        reporter.addObserver(observers.back().get());
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::vector<int64_t> counts(kReaderCount);
+    std::vector<int> tornFrames(kReaderCount);
+    for (int r = 0; r < kReaderCount; r++) {
+        readers.emplace_back([&, r] {
+            int64_t frame[kFrameSize];
+            int64_t last = -1;
+            int torn = 0;
+            uint32_t droppedCount;
+            while (true) {
+                bool wasDone = done.load();
+                while (observers[r]->readNextFrame(frame, &droppedCount)) {
+                    // Every frame is whole, in order, and accounted for as read or dropped
+                    for (int i = 1; i < kFrameSize; i++) {
+                        torn += frame[i] != frame[0];
+                    }
+                    torn += frame[0] != last + 1 + droppedCount;
+                    last = frame[0];
+                }
+                if (wasDone) {
+                    break;
+                }
+            }
+            counts[r] = last + 1;
+            tornFrames[r] = torn;
+        });
+    }
+    for (int i = 0; i < kFrameCount; i++) {
+        reportFrame(&reporter, i);
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (int r = 0; r < kReaderCount; r++) {
+        EXPECT_EQ(0, tornFrames[r]) << "reader " << r;
+        EXPECT_EQ(kFrameCount, counts[r]) << "reader " << r;
+        reporter.removeObserver(observers[r].get());
+    }
+}
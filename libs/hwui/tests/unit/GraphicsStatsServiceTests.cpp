@@ -19,12 +19,16 @@
 #include "protos/graphicsstats.pb.h"
 #include "service/GraphicsStatsService.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <string>
+#include <vector>
+
 using namespace android;
 using namespace android::uirenderer;
 
@@ -160,3 +164,152 @@ TEST(GraphicsStats, merge) {
         EXPECT_EQ(expectedBucket, loadedProto.histogram().Get(i).render_millis());
     }
 }
+
+TEST(GraphicsStats, mergeStages) {
+    std::string path = findRootPath() + "/test_mergeStages";
+    std::string packageName = "com.test.mergeStages";
+    MockProfileData mockData;
+    mockData.editTotalFrameCount() = 10;
+    for (size_t stage = 0; stage < mockData.editStageCounts().size(); stage++) {
+        for (size_t i = 0; i < mockData.editStageCounts()[stage].size(); i++) {
+            mockData.editStageCounts()[stage][i] = (stage + i) % 3;
+        }
+    }
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 3000, 7000, &mockData);
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 7050, 10000, &mockData);
+
+    protos::GraphicsStatsProto loadedProto;
+    StageHistograms loadedStages;
+    EXPECT_TRUE(GraphicsStatsService::parseFromFile(path, &loadedProto, &loadedStages));
+    unlink(path.c_str());
+
+    EXPECT_EQ(20, loadedProto.summary().total_frames());
+    for (size_t stage = 0; stage < loadedStages.size(); stage++) {
+        for (size_t i = 0; i < loadedStages[stage].size(); i++) {
+            EXPECT_EQ(2 * ((stage + i) % 3), loadedStages[stage][i]);
+        }
+    }
+}
+
+TEST(GraphicsStats, upgradesProtoFile) {
+    std::string path = findRootPath() + "/test_upgradesProtoFile";
+    std::string packageName = "com.test.upgradesProtoFile";
+
+    // A file as saved before the stats were kept in the binary format
+    protos::GraphicsStatsProto oldProto;
+    oldProto.set_package_name(packageName);
+    oldProto.set_version_code(5);
+    oldProto.set_stats_start(3000);
+    oldProto.set_stats_end(7000);
+    oldProto.mutable_summary()->set_total_frames(100);
+    oldProto.mutable_summary()->set_janky_frames(20);
+    ProfileData empty;
+    empty.histogramForEach([&oldProto](ProfileData::HistogramEntry entry) {
+        auto bucket = oldProto.add_histogram();
+        bucket->set_render_millis(entry.renderTimeMs);
+        bucket->set_frame_count(1);
+    });
+    empty.histogramGPUForEach([&oldProto](ProfileData::HistogramEntry entry) {
+        auto bucket = oldProto.add_gpu_histogram();
+        bucket->set_render_millis(entry.renderTimeMs);
+        bucket->set_frame_count(2);
+    });
+    std::string serialized;
+    ASSERT_TRUE(oldProto.SerializeToString(&serialized));
+    const int32_t protoFileVersion = 1;
+    FILE* file = fopen(path.c_str(), "we");
+    ASSERT_NE(nullptr, file);
+    fwrite(&protoFileVersion, sizeof(protoFileVersion), 1, file);
+    fwrite(serialized.data(), 1, serialized.size(), file);
+    fclose(file);
+
+    MockProfileData mockData;
+    mockData.editJankFrameCount() = 50;
+    mockData.editTotalFrameCount() = 500;
+    for (size_t i = 0; i < mockData.editFrameCounts().size(); i++) {
+        mockData.editFrameCounts()[i] = (i % 5) + 1;
+    }
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 7050, 10000, &mockData);
+
+    int32_t fileVersion = 0;
+    file = fopen(path.c_str(), "re");
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ(1u, fread(&fileVersion, sizeof(fileVersion), 1, file));
+    fclose(file);
+    EXPECT_NE(protoFileVersion, fileVersion);
+
+    protos::GraphicsStatsProto loadedProto;
+    EXPECT_TRUE(GraphicsStatsService::parseFromFile(path, &loadedProto));
+    unlink(path.c_str());
+
+    EXPECT_EQ(packageName, loadedProto.package_name());
+    EXPECT_EQ(5, loadedProto.version_code());
+    EXPECT_EQ(3000, loadedProto.stats_start());
+    EXPECT_EQ(10000, loadedProto.stats_end());
+    ASSERT_TRUE(loadedProto.has_summary());
+    EXPECT_EQ(20 + 50, loadedProto.summary().janky_frames());
+    EXPECT_EQ(100 + 500, loadedProto.summary().total_frames());
+    ASSERT_EQ(oldProto.histogram_size(), loadedProto.histogram_size());
+    for (size_t i = 0; i < (size_t)loadedProto.histogram_size(); i++) {
+        int expectedCount = 1;
+        if (i < mockData.editFrameCounts().size()) {
+            expectedCount += (i % 5) + 1;
+        }
+        EXPECT_EQ(expectedCount, loadedProto.histogram().Get(i).frame_count());
+        EXPECT_EQ(oldProto.histogram().Get(i).render_millis(),
+                  loadedProto.histogram().Get(i).render_millis());
+    }
+    ASSERT_EQ(oldProto.gpu_histogram_size(), loadedProto.gpu_histogram_size());
+    for (int i = 0; i < loadedProto.gpu_histogram_size(); i++) {
+        EXPECT_EQ(2, loadedProto.gpu_histogram().Get(i).frame_count());
+    }
+}
+
+TEST(GraphicsStats, addDirectoryToDump) {
+    std::string root = findRootPath() + "/test_addDirectoryToDump";
+    std::string dumpPath = findRootPath() + "/test_addDirectoryToDump.dump";
+    const char* packageNames[] = {"com.test.c", "com.test.a", "com.test.b"};
+    mkdir(root.c_str(), 0770);
+    std::vector<std::string> paths;
+    for (const char* packageName : packageNames) {
+        std::string directory = root + "/" + packageName;
+        mkdir(directory.c_str(), 0770);
+        paths.push_back(directory + "/total");
+        MockProfileData mockData;
+        mockData.editTotalFrameCount() = 10;
+        GraphicsStatsService::saveBuffer(paths.back(), packageName, 1, 3000, 7000, &mockData);
+    }
+
+    int fd = open(dumpPath.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0660);
+    ASSERT_NE(-1, fd);
+    GraphicsStatsService::Dump* dump =
+            GraphicsStatsService::createDump(fd, GraphicsStatsService::DumpType::Protobuf);
+    GraphicsStatsService::addDirectoryToDump(dump, root);
+    GraphicsStatsService::finishDump(dump);
+
+    std::string serialized;
+    char buffer[4096];
+    ssize_t size;
+    lseek(fd, 0, SEEK_SET);
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        serialized.append(buffer, size);
+    }
+    close(fd);
+    protos::GraphicsStatsServiceDumpProto dumpProto;
+    EXPECT_TRUE(dumpProto.ParseFromString(serialized));
+    unlink(dumpPath.c_str());
+    for (const std::string& path : paths) {
+        unlink(path.c_str());
+        rmdir(path.substr(0, path.rfind('/')).c_str());
+    }
+    rmdir(root.c_str());
+
+    // The files are listed in the order of their paths, whichever thread loaded them
+    ASSERT_EQ(3, dumpProto.stats_size());
+    EXPECT_EQ("com.test.a", dumpProto.stats(0).package_name());
+    EXPECT_EQ("com.test.b", dumpProto.stats(1).package_name());
+    EXPECT_EQ("com.test.c", dumpProto.stats(2).package_name());
+    for (const auto& stat : dumpProto.stats()) {
+        EXPECT_EQ(10, stat.summary().total_frames());
+    }
+}
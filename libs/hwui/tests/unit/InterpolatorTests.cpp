@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Interpolator.h>
+
+#include <memory>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static std::vector<std::unique_ptr<Interpolator>> createInterpolators() {
+    std::vector<std::unique_ptr<Interpolator>> interpolators;
+    interpolators.emplace_back(new AccelerateDecelerateInterpolator());
+    interpolators.emplace_back(new AccelerateInterpolator(1.0f));
+    interpolators.emplace_back(new AccelerateInterpolator(1.5f));
+    interpolators.emplace_back(new AnticipateInterpolator(2.0f));
+    interpolators.emplace_back(new AnticipateOvershootInterpolator(3.0f));
+    interpolators.emplace_back(new BounceInterpolator());
+    interpolators.emplace_back(new CycleInterpolator(2.0f));
+    interpolators.emplace_back(new DecelerateInterpolator(1.0f));
+    interpolators.emplace_back(new DecelerateInterpolator(2.5f));
+    interpolators.emplace_back(new LinearInterpolator());
+    interpolators.emplace_back(new OvershootInterpolator(2.0f));
+    interpolators.emplace_back(new PathInterpolator({0.0f, 0.4f, 1.0f}, {0.0f, 0.8f, 1.0f}));
+    interpolators.emplace_back(new LUTInterpolator(new float[5]{0.0f, 0.1f, 0.5f, 0.9f, 1.0f}, 5));
+    return interpolators;
+}
+
+TEST(Interpolator, batchMatchesInterpolate) {
+    constexpr int kSteps = 100;
+    for (auto& interpolator : createInterpolators()) {
+        std::vector<float> inputs;
+        std::vector<float> parameters;
+        std::vector<Interpolator*> batch;
+        for (int i = 0; i <= kSteps; i++) {
+            inputs.push_back(i / (float)kSteps);
+            parameters.push_back(interpolator->parameter());
+            batch.push_back(interpolator.get());
+        }
+        Interpolator::interpolateBatch(interpolator->kind(), inputs.data(), parameters.data(),
+                                       batch.data(), inputs.size());
+        for (int i = 0; i <= kSteps; i++) {
+            // Exactly the same, so that batching doesn't change what is drawn
+            EXPECT_EQ(interpolator->interpolate(i / (float)kSteps), inputs[i])
+                    << "kind " << static_cast<int>(interpolator->kind()) << ", input " << i;
+        }
+    }
+}
+
+TEST(Interpolator, batchMixesParameters) {
+    AccelerateInterpolator square(1.0f);
+    AccelerateInterpolator cube(1.5f);
+    Interpolator* interpolators[] = {&square, &cube, &square, &cube};
+    float inputs[] = {0.5f, 0.5f, 0.25f, 0.25f};
+    const float parameters[] = {1.0f, 1.5f, 1.0f, 1.5f};
+    Interpolator::interpolateBatch(Interpolator::Kind::Accelerate, inputs, parameters,
+                                   interpolators, 4);
+    EXPECT_EQ(square.interpolate(0.5f), inputs[0]);
+    EXPECT_EQ(cube.interpolate(0.5f), inputs[1]);
+    EXPECT_EQ(square.interpolate(0.25f), inputs[2]);
+    EXPECT_EQ(cube.interpolate(0.25f), inputs[3]);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "hwui/ParallelEncoder.h"
+
+#include <SkBitmap.h>
+#include <SkCodec.h>
+#include <SkColorSpace.h>
+#include <SkData.h>
+#include <SkStream.h>
+#include <SkUnPreMultiply.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace android;
+
+// Not a multiple of the JPEG MCU size, so the last strip is partial
+static constexpr int kWidth = 1000;
+static constexpr int kHeight = 1100;
+
+static SkBitmap createBitmap(SkColorType colorType, SkAlphaType alphaType) {
+    SkBitmap bitmap;
+    bitmap.allocPixels(
+            SkImageInfo::Make(kWidth, kHeight, colorType, alphaType, SkColorSpace::MakeSRGB()));
+    uint32_t seed = 1234;
+    for (int y = 0; y < kHeight; y++) {
+        uint8_t* row = static_cast<uint8_t*>(bitmap.getAddr(0, y));
+        for (int x = 0; x < kWidth; x++, row += 4) {
+            seed = seed * 1664525u + 1013904223u;
+            const uint8_t alpha = alphaType == kOpaque_SkAlphaType ? 0xFF : x * 0xFF / kWidth;
+            // Gradients with a little noise, which is about what photos look like to JPEG
+            row[0] = ((x + y) & 0xFF) * alpha / 0xFF;
+            row[1] = (x / 4) * alpha / 0xFF;
+            row[2] = (y / 5 + (seed >> 29)) * alpha / 0xFF;
+            row[3] = alpha;
+        }
+    }
+    return bitmap;
+}
+
+static sk_sp<SkData> encode(const SkBitmap& bitmap, SkEncodedImageFormat format,
+                            int threadBudget) {
+    SkDynamicMemoryWStream stream;
+    bool encoded = format == SkEncodedImageFormat::kJPEG
+            ? ParallelEncoder::encodeJpeg(&stream, bitmap.pixmap(), 90, threadBudget)
+            : ParallelEncoder::encodePng(&stream, bitmap.pixmap(), threadBudget);
+    return encoded ? stream.detachAsData() : nullptr;
+}
+
+static SkBitmap decode(const sk_sp<SkData>& data) {
+    std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(data);
+    SkBitmap bitmap;
+    if (codec) {
+        bitmap.allocPixels(codec->getInfo().makeColorType(kRGBA_8888_SkColorType));
+        if (codec->getPixels(bitmap.pixmap()) != SkCodec::kSuccess) {
+            bitmap.reset();
+        }
+    }
+    return bitmap;
+}
+
+TEST(ParallelEncoder, canEncode) {
+    SkBitmap bitmap = createBitmap(kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+    EXPECT_TRUE(ParallelEncoder::canEncode(bitmap.pixmap(), SkEncodedImageFormat::kJPEG));
+    EXPECT_TRUE(ParallelEncoder::canEncode(bitmap.pixmap(), SkEncodedImageFormat::kPNG));
+    EXPECT_FALSE(ParallelEncoder::canEncode(bitmap.pixmap(), SkEncodedImageFormat::kWEBP));
+
+    SkBitmap small;
+    small.allocN32Pixels(100, 100);
+    EXPECT_FALSE(ParallelEncoder::canEncode(small.pixmap(), SkEncodedImageFormat::kJPEG));
+
+    SkBitmap wideGamut;
+    wideGamut.allocPixels(SkImageInfo::Make(
+            kWidth, kHeight, kRGBA_8888_SkColorType, kPremul_SkAlphaType,
+            SkColorSpace::MakeRGB(SkNamedTransferFn::kSRGB, SkNamedGamut::kDCIP3)));
+    EXPECT_FALSE(ParallelEncoder::canEncode(wideGamut.pixmap(), SkEncodedImageFormat::kPNG));
+}
+
+TEST(ParallelEncoder, jpegIndependentOfThreadBudget) {
+    SkBitmap bitmap = createBitmap(kRGBA_8888_SkColorType, kOpaque_SkAlphaType);
+    sk_sp<SkData> expected = encode(bitmap, SkEncodedImageFormat::kJPEG, 1);
+    ASSERT_TRUE(expected);
+    for (int threadBudget : {2, 3, 4, 8}) {
+        sk_sp<SkData> actual = encode(bitmap, SkEncodedImageFormat::kJPEG, threadBudget);
+        ASSERT_TRUE(actual);
+        EXPECT_TRUE(expected->equals(actual.get())) << "thread budget " << threadBudget;
+    }
+
+    SkBitmap decoded = decode(expected);
+    ASSERT_EQ(kWidth, decoded.width());
+    ASSERT_EQ(kHeight, decoded.height());
+    // Strips are stitched seamlessly, so the error is the same as a regular JPEG's everywhere
+    uint64_t totalError = 0;
+    for (int y = 0; y < kHeight; y++) {
+        const uint8_t* source = static_cast<const uint8_t*>(bitmap.getAddr(0, y));
+        const uint8_t* actual = static_cast<const uint8_t*>(decoded.getAddr(0, y));
+        for (int i = 0; i < kWidth * 4; i += 4) {
+            totalError += abs(source[i] - actual[i]);
+        }
+    }
+    EXPECT_LT(totalError / (kWidth * kHeight), 4u);
+}
+
+// Returns the unpremultiplied RGBA color of the pixel at x, y
+static void getUnpremulColor(const SkBitmap& bitmap, int x, int y, uint8_t* color) {
+    const uint8_t* pixel = static_cast<const uint8_t*>(bitmap.getAddr(x, y));
+    const bool bgra = bitmap.colorType() == kBGRA_8888_SkColorType;
+    const uint8_t alpha = pixel[3];
+    const SkUnPreMultiply::Scale scale = SkUnPreMultiply::GetScale(alpha);
+    color[0] = pixel[bgra ? 2 : 0];
+    color[1] = pixel[1];
+    color[2] = pixel[bgra ? 0 : 2];
+    color[3] = alpha;
+    if (bitmap.alphaType() == kPremul_SkAlphaType && alpha != 0xFF) {
+        for (int i = 0; i < 3; i++) {
+            color[i] = SkUnPreMultiply::ApplyScale(scale, color[i]);
+        }
+    }
+}
+
+TEST(ParallelEncoder, pngIsLossless) {
+    for (SkColorType colorType : {kRGBA_8888_SkColorType, kBGRA_8888_SkColorType}) {
+        for (SkAlphaType alphaType : {kOpaque_SkAlphaType, kPremul_SkAlphaType}) {
+            SkBitmap bitmap = createBitmap(colorType, alphaType);
+            for (int threadBudget : {1, 4}) {
+                sk_sp<SkData> data = encode(bitmap, SkEncodedImageFormat::kPNG, threadBudget);
+                SkBitmap decoded = decode(data);
+                ASSERT_EQ(kWidth, decoded.width());
+                ASSERT_EQ(kHeight, decoded.height());
+                ASSERT_EQ(alphaType == kOpaque_SkAlphaType, decoded.isOpaque());
+
+                for (int y = 0; y < kHeight; y++) {
+                    for (int x = 0; x < kWidth; x++) {
+                        uint8_t expected[4];
+                        getUnpremulColor(bitmap, x, y, expected);
+                        const uint8_t* actual = static_cast<const uint8_t*>(decoded.getAddr(x, y));
+                        ASSERT_EQ(0, memcmp(expected, actual, 4)) << "pixel " << x << ", " << y;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(ParallelEncoder, jpegEmbedsIccProfile) {
+    SkBitmap bitmap = createBitmap(kRGBA_8888_SkColorType, kOpaque_SkAlphaType);
+    sk_sp<SkData> data = encode(bitmap, SkEncodedImageFormat::kJPEG, 4);
+    ASSERT_TRUE(data);
+    // Like SkJpegEncoder, so that large and small bitmaps carry the same color metadata
+    std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(data);
+    ASSERT_TRUE(codec);
+    ASSERT_NE(nullptr, codec->getICCProfile());
+    ASSERT_TRUE(codec->getInfo().colorSpace()->isSRGB());
+
+    SkBitmap untagged;
+    untagged.installPixels(bitmap.pixmap().info().makeColorSpace(nullptr), bitmap.getPixels(),
+                           bitmap.rowBytes());
+    codec = SkCodec::MakeFromData(encode(untagged, SkEncodedImageFormat::kJPEG, 4));
+    ASSERT_TRUE(codec);
+    EXPECT_EQ(nullptr, codec->getICCProfile());
+}
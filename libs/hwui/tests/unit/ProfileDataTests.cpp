@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ProfileData.h"
+
+#include <utils/Timers.h>
+
+#include <cmath>
+
+using namespace android;
+using namespace android::uirenderer;
+
+TEST(ProfileData, stageBucketsAreWithinPrecision) {
+    uint32_t lastIndex = 0;
+    for (uint32_t us = 1; us < ProfileData::kStageMaxUs; us += us / 64 + 1) {
+        uint32_t index = ProfileData::stageCountIndexForDuration(us2ns(us));
+        ASSERT_GE(index, lastIndex);
+        lastIndex = index;
+        float durationUs = ProfileData::stageDurationUsForStageCountIndex(index);
+        float error = std::abs(durationUs - us) / us;
+        ASSERT_LE(error, 1.0f / ProfileData::kStageSubBuckets) << us << "us";
+    }
+    // Out of range durations are clamped to the first and last buckets
+    EXPECT_EQ(0u, ProfileData::stageCountIndexForDuration(-1));
+    EXPECT_EQ(lastIndex, ProfileData::stageCountIndexForDuration(s2ns(3600)));
+}
+
+TEST(ProfileData, stagePercentiles) {
+    ProfileData data;
+    // 1ms to 20ms of draw, and a constant 200us of sync
+    for (int ms = 1; ms <= 20; ms++) {
+        for (int i = 0; i < 5; i++) {
+            data.reportStage(FrameStage::Draw, ms2ns(ms));
+            data.reportStage(FrameStage::Sync, us2ns(200));
+        }
+    }
+    EXPECT_NEAR(11.0f, data.findStagePercentile(FrameStage::Draw, 50), 11.0f / 8);
+    EXPECT_NEAR(19.0f, data.findStagePercentile(FrameStage::Draw, 90), 19.0f / 8);
+    EXPECT_NEAR(20.0f, data.findStagePercentile(FrameStage::Draw, 99), 20.0f / 8);
+    EXPECT_NEAR(0.2f, data.findStagePercentile(FrameStage::Sync, 99), 0.2f / 8);
+    EXPECT_EQ(0.0f, data.findStagePercentile(FrameStage::Input, 50));
+}
+
+TEST(ProfileData, mergeWithAddsStages) {
+    ProfileData data;
+    ProfileData other;
+    data.reportStage(FrameStage::Gpu, ms2ns(4));
+    other.reportStage(FrameStage::Gpu, ms2ns(4));
+    other.reportStage(FrameStage::Gpu, ms2ns(12));
+    data.mergeWith(other);
+
+    uint32_t total = 0;
+    uint32_t fourMs = 0;
+    data.stageHistogramForEach(FrameStage::Gpu, [&](ProfileData::StageHistogramEntry entry) {
+        total += entry.frameCount;
+        if (entry.frameCount && entry.durationUs < 5000) {
+            fourMs = entry.frameCount;
+        }
+    });
+    EXPECT_EQ(3u, total);
+    EXPECT_EQ(2u, fourMs);
+
+    data.reset();
+    EXPECT_EQ(0.0f, data.findStagePercentile(FrameStage::Gpu, 50));
+}
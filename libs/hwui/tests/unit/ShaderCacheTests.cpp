@@ -20,11 +20,15 @@
 #include <gtest/gtest.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <utils/Log.h>
 #include <cstdint>
+#include <unistd.h>
+#include <map>
 #include "FileBlobCache.h"
 #include "pipeline/skia/ShaderCache.h"
+#include "pipeline/skia/ShaderCacheJournal.h"
 
 using namespace android::uirenderer::skiapipeline;
 
@@ -279,4 +283,127 @@ TEST(ShaderCacheTest, testCacheValidation) {
     remove(cacheFile1.c_str());
 }
 
+using JournalContents = std::map<std::string, std::string>;
+
+JournalContents replayJournal(const std::string& filename, size_t* outRecords = nullptr) {
+    JournalContents contents;
+    ShaderCacheJournal journal(filename, 1024 * 1024);
+    journal.replay([&](const void* key, size_t keySize, const void* value, size_t valueSize) {
+        contents[std::string((const char*)key, keySize)] = std::string((const char*)value,
+                                                                       valueSize);
+    });
+    if (outRecords) {
+        *outRecords = journal.stats().recordsReplayed;
+    }
+    return contents;
+}
+
+void appendString(ShaderCacheJournal& journal, const std::string& key, const std::string& value) {
+    journal.append(key.data(), key.size(), value.data(), value.size());
+}
+
+TEST(ShaderCacheTest, testJournalTornTail) {
+    if (!folderExist(getExternalStorageFolder())) {
+        // don't run the test if external storage folder is not available
+        return;
+    }
+    std::string journalFile = getExternalStorageFolder() + "/shaderCacheJournalTest";
+    remove(journalFile.c_str());
+
+    {
+        ShaderCacheJournal journal(journalFile, 1024 * 1024);
+        ASSERT_FALSE(journal.replay([](const void*, size_t, const void*, size_t) {}));
+        appendString(journal, "key1", "value1");
+        appendString(journal, "key2", "value2");
+        appendString(journal, "key3", "value3");
+    }
+    ASSERT_EQ((JournalContents{{"key1", "value1"}, {"key2", "value2"}, {"key3", "value3"}}),
+              replayJournal(journalFile));
+
+    // simulate a crash in the middle of writing the last record
+    struct stat statBuf;
+    ASSERT_EQ(0, stat(journalFile.c_str(), &statBuf));
+    ASSERT_EQ(0, truncate(journalFile.c_str(), statBuf.st_size - 3));
+
+    {
+        ShaderCacheJournal journal(journalFile, 1024 * 1024);
+        JournalContents contents;
+        ASSERT_TRUE(journal.replay(
+                [&](const void* key, size_t keySize, const void* value, size_t valueSize) {
+                    contents[std::string((const char*)key, keySize)] =
+                            std::string((const char*)value, valueSize);
+                }));
+        ASSERT_EQ((JournalContents{{"key1", "value1"}, {"key2", "value2"}}), contents);
+        ASSERT_EQ(1u, journal.stats().recordsDropped);
+
+        // new records go right after the last valid one
+        appendString(journal, "key1", "value4");
+    }
+    ASSERT_EQ((JournalContents{{"key1", "value4"}, {"key2", "value2"}}),
+              replayJournal(journalFile));
+
+    remove(journalFile.c_str());
+}
+
+TEST(ShaderCacheTest, testJournalCompaction) {
+    if (!folderExist(getExternalStorageFolder())) {
+        // don't run the test if external storage folder is not available
+        return;
+    }
+    std::string journalFile = getExternalStorageFolder() + "/shaderCacheJournalTest";
+    remove(journalFile.c_str());
+
+    std::string lastValue;
+    {
+        ShaderCacheJournal journal(journalFile, 1024 * 1024);
+        journal.replay([](const void*, size_t, const void*, size_t) {});
+        appendString(journal, "other", "value");
+        // overwrite the same key until the journal is mostly made of stale records
+        for (int i = 0; i < 20; i++) {
+            lastValue = std::string(32 * 1024, 'a' + i);
+            appendString(journal, "key", lastValue);
+        }
+        ASSERT_GE(journal.stats().compactions, 1u);
+        ASSERT_LT(journal.stats().fileSize, 20 * 32 * 1024u);
+        ASSERT_GT(journal.stats().bytesWritten, journal.stats().bytesStored);
+    }
+    size_t records;
+    ASSERT_EQ((JournalContents{{"other", "value"}, {"key", lastValue}}),
+              replayJournal(journalFile, &records));
+    ASSERT_LE(records, 9u);
+
+    remove(journalFile.c_str());
+}
+
+TEST(ShaderCacheTest, testJournalEviction) {
+    if (!folderExist(getExternalStorageFolder())) {
+        // don't run the test if external storage folder is not available
+        return;
+    }
+    std::string journalFile = getExternalStorageFolder() + "/shaderCacheJournalTest";
+    remove(journalFile.c_str());
+
+    const size_t maxTotalSize = 64 * 1024;
+    {
+        ShaderCacheJournal journal(journalFile, maxTotalSize);
+        journal.pinKey("id", 2);
+        journal.replay([](const void*, size_t, const void*, size_t) {});
+        appendString(journal, "id", "hash");
+        for (int i = 0; i < 40; i++) {
+            appendString(journal, "key" + std::to_string(i), std::string(4 * 1024, 'a'));
+            ASSERT_LE(journal.stats().liveSize, maxTotalSize);
+        }
+        // each eviction frees a quarter of the budget, not just the room for one record
+        ASSERT_GE(journal.stats().compactions, 1u);
+        ASSERT_LE(journal.stats().compactions, 8u);
+    }
+    JournalContents contents = replayJournal(journalFile);
+    // the pinned key survives although it is the oldest record
+    ASSERT_EQ("hash", contents["id"]);
+    ASSERT_EQ(1u, contents.count("key39"));
+    ASSERT_EQ(0u, contents.count("key0"));
+
+    remove(journalFile.c_str());
+}
+
 }  // namespace
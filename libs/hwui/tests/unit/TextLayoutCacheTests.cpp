@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Properties.h"
+#include "hwui/MinikinUtils.h"
+#include "hwui/Paint.h"
+#include "hwui/TextLayoutCache.h"
+#include "tests/common/TestUtils.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static std::vector<uint16_t> toUtf16(const char* text) {
+    return std::vector<uint16_t>(text, text + strlen(text));
+}
+
+static float measure(const Paint& paint, const std::vector<uint16_t>& text,
+                     std::vector<float>* advances) {
+    advances->resize(text.size());
+    return MinikinUtils::measureText(&paint, minikin::Bidi::LTR, nullptr, text.data(), 0,
+                                     text.size(), text.size(), advances->data());
+}
+
+static std::shared_ptr<const minikin::Layout> layout(const Paint& paint,
+                                                     const std::vector<uint16_t>& text) {
+    return MinikinUtils::getCachedLayout(&paint, minikin::Bidi::LTR, nullptr, text.data(),
+                                         text.size(), 0, text.size(), 0, text.size());
+}
+
+TEST(TextLayoutCache, drawAfterMeasureHits) {
+    TextLayoutCache::getInstance().clear();
+    Paint paint;
+    paint.getSkFont().setSize(20);
+    std::vector<uint16_t> text = toUtf16("See you at 8?");
+    std::vector<float> advances;
+
+    TextLayoutCache::Stats before = TextLayoutCache::getInstance().stats();
+    const float advance = measure(paint, text, &advances);
+    auto drawn = layout(paint, text);
+    TextLayoutCache::Stats after = TextLayoutCache::getInstance().stats();
+
+    EXPECT_EQ(before.misses + 1, after.misses);
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(1u, after.entries);
+    EXPECT_EQ(advance, drawn->getAdvance());
+    EXPECT_EQ(text.size(), drawn->nGlyphs());
+}
+
+TEST(TextLayoutCache, matchesUncachedMeasurement) {
+    TextLayoutCache::getInstance().clear();
+    Paint paint;
+    paint.getSkFont().setSize(16);
+    paint.setLetterSpacing(0.05f);
+    std::vector<uint16_t> text = toUtf16("The quick brown fox jumps over the lazy dog");
+
+    std::vector<float> cachedAdvances;
+    const float cached = measure(paint, text, &cachedAdvances);
+    // Measured a second time from the cache
+    std::vector<float> hitAdvances;
+    EXPECT_EQ(cached, measure(paint, text, &hitAdvances));
+    EXPECT_EQ(cachedAdvances, hitAdvances);
+
+    ScopedProperty<int> cacheSize(Properties::textLayoutCacheSize, 0);
+    std::vector<float> uncachedAdvances;
+    EXPECT_FLOAT_EQ(measure(paint, text, &uncachedAdvances), cached);
+    ASSERT_EQ(uncachedAdvances.size(), cachedAdvances.size());
+    for (size_t i = 0; i < cachedAdvances.size(); i++) {
+        EXPECT_FLOAT_EQ(uncachedAdvances[i], cachedAdvances[i]) << "at " << i;
+    }
+}
+
+TEST(TextLayoutCache, keyedByPaint) {
+    TextLayoutCache::getInstance().clear();
+    Paint paint;
+    paint.getSkFont().setSize(20);
+    std::vector<uint16_t> text = toUtf16("Hello");
+
+    auto small = layout(paint, text);
+    paint.getSkFont().setSize(40);
+    auto large = layout(paint, text);
+    paint.setFontFeatureSettings("smcp");
+    auto smallCaps = layout(paint, text);
+
+    EXPECT_NE(small.get(), large.get());
+    EXPECT_NE(large.get(), smallCaps.get());
+    EXPECT_GT(large->getAdvance(), small->getAdvance());
+    EXPECT_EQ(3u, TextLayoutCache::getInstance().stats().entries);
+
+    paint.setFontFeatureSettings("");
+    EXPECT_EQ(large.get(), layout(paint, text).get());
+}
+
+TEST(TextLayoutCache, staysWithinBudget) {
+    ScopedProperty<int> cacheSize(Properties::textLayoutCacheSize, 4);
+    TextLayoutCache::getInstance().clear();
+    TextLayoutCache::Stats before = TextLayoutCache::getInstance().stats();
+    Paint paint;
+    for (int i = 0; i < 200; i++) {
+        std::string message = "Message number " + std::to_string(i);
+        layout(paint, toUtf16(message.c_str()));
+    }
+    TextLayoutCache::Stats after = TextLayoutCache::getInstance().stats();
+
+    EXPECT_GT(after.evictions, before.evictions);
+    EXPECT_LE(after.cachedBytes, 4u * 1024);
+    EXPECT_LT(after.entries, 200u);
+}
+
+TEST(TextLayoutCache, skipsLongText) {
+    TextLayoutCache::getInstance().clear();
+    Paint paint;
+    std::vector<uint16_t> text(TextLayoutCache::kMaxContextLength + 1, 'a');
+    layout(paint, text);
+    layout(paint, text);
+    EXPECT_EQ(0u, TextLayoutCache::getInstance().stats().entries);
+}
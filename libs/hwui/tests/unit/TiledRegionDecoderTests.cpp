@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Properties.h"
+#include "hwui/TiledRegionDecoder.h"
+#include "tests/common/TestUtils.h"
+#include "thread/CommonPool.h"
+
+#include <SkBitmap.h>
+#include <SkColorSpace.h>
+#include <SkData.h>
+#include <SkImageEncoder.h>
+#include <SkStream.h>
+
+#include <string.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// Not a multiple of the tile size, so the last row and column of tiles are partial
+static constexpr int kWidth = 1000;
+static constexpr int kHeight = 700;
+
+class TestAllocator : public SkBRDAllocator {
+public:
+    bool allocPixelRef(SkBitmap* bitmap) override { return mAllocator.allocPixelRef(bitmap); }
+    SkCodec::ZeroInitialized zeroInit() const override { return SkCodec::kNo_ZeroInitialized; }
+
+private:
+    SkBitmap::HeapAllocator mAllocator;
+};
+
+static sk_sp<SkData> createPng() {
+    SkBitmap bitmap;
+    bitmap.allocPixels(SkImageInfo::Make(kWidth, kHeight, kRGBA_8888_SkColorType,
+                                         kPremul_SkAlphaType, SkColorSpace::MakeSRGB()));
+    for (int y = 0; y < kHeight; y++) {
+        uint8_t* row = static_cast<uint8_t*>(bitmap.getAddr(0, y));
+        for (int x = 0; x < kWidth; x++, row += 4) {
+            row[0] = x & 0xFF;
+            row[1] = y & 0xFF;
+            row[2] = (x ^ y) & 0xFF;
+            row[3] = 0xFF;
+        }
+    }
+    SkDynamicMemoryWStream stream;
+    if (!SkEncodeImage(&stream, bitmap, SkEncodedImageFormat::kPNG, 100)) {
+        return nullptr;
+    }
+    return stream.detachAsData();
+}
+
+static bool decodeDirectly(const sk_sp<SkData>& data, const SkIRect& subset, int sampleSize,
+                           SkBitmap* bitmap) {
+    std::unique_ptr<SkBitmapRegionDecoder> decoder(SkBitmapRegionDecoder::Create(
+            data, SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+    TestAllocator allocator;
+    return decoder && decoder->decodeRegion(bitmap, &allocator, subset, sampleSize,
+                                            kN32_SkColorType, false, SkColorSpace::MakeSRGB());
+}
+
+static bool decodeTiled(TiledRegionDecoder* decoder, const SkIRect& subset, int sampleSize,
+                        SkBitmap* bitmap) {
+    TestAllocator allocator;
+    return decoder->decodeRegion(bitmap, &allocator, subset, sampleSize, kN32_SkColorType, false,
+                                 SkColorSpace::MakeSRGB());
+}
+
+TEST(TiledRegionDecoder, matchesDirectDecode) {
+    sk_sp<SkData> data = createPng();
+    ASSERT_TRUE(data);
+    std::unique_ptr<TiledRegionDecoder> decoder =
+            TiledRegionDecoder::Make(std::make_unique<SkMemoryStream>(data));
+    ASSERT_TRUE(decoder);
+    ASSERT_EQ(kWidth, decoder->width());
+    ASSERT_EQ(kHeight, decoder->height());
+
+    struct Region {
+        SkIRect subset;
+        int sampleSize;
+    };
+    // Whole images, regions across tiles and within a single one, and regions that don't line
+    // up with the sampled pixels and are decoded directly
+    const Region regions[] = {
+            {SkIRect::MakeWH(kWidth, kHeight), 1}, {SkIRect::MakeXYWH(256, 128, 300, 300), 1},
+            {SkIRect::MakeXYWH(100, 200, 600, 400), 2}, {SkIRect::MakeWH(kWidth, kHeight), 4},
+            {SkIRect::MakeXYWH(12, 40, 64, 64), 4}, {SkIRect::MakeXYWH(3, 5, 101, 99), 2},
+            {SkIRect::MakeXYWH(900, 600, 200, 200), 1},
+    };
+    // Twice, to compare the regions composed of cached tiles too
+    for (int pass = 0; pass < 2; pass++) {
+        for (const Region& region : regions) {
+            SkBitmap expected;
+            SkBitmap actual;
+            ASSERT_TRUE(decodeDirectly(data, region.subset, region.sampleSize, &expected));
+            ASSERT_TRUE(decodeTiled(decoder.get(), region.subset, region.sampleSize, &actual));
+            ASSERT_EQ(expected.width(), actual.width());
+            ASSERT_EQ(expected.height(), actual.height());
+            ASSERT_EQ(expected.colorType(), actual.colorType());
+            ASSERT_EQ(expected.alphaType(), actual.alphaType());
+            for (int y = 0; y < expected.height(); y++) {
+                ASSERT_EQ(0, memcmp(expected.getAddr(0, y), actual.getAddr(0, y),
+                                    expected.width() * expected.bytesPerPixel()))
+                        << "pass " << pass << ", region " << region.subset.x() << ", "
+                        << region.subset.y() << ", sample size " << region.sampleSize
+                        << ", row " << y;
+            }
+        }
+    }
+}
+
+TEST(TiledRegionDecoder, cachesTiles) {
+    sk_sp<SkData> data = createPng();
+    ASSERT_TRUE(data);
+    const TiledRegionDecoder::Stats before = TiledRegionDecoder::stats();
+    std::unique_ptr<TiledRegionDecoder> decoder =
+            TiledRegionDecoder::Make(std::make_unique<SkMemoryStream>(data));
+    ASSERT_TRUE(decoder);
+
+    // Two tiles, both decoded by the first call and reused by the second one
+    const SkIRect subset = SkIRect::MakeXYWH(0, 0, 400, 200);
+    SkBitmap bitmap;
+    ASSERT_TRUE(decodeTiled(decoder.get(), subset, 1, &bitmap));
+    TiledRegionDecoder::Stats stats = TiledRegionDecoder::stats();
+    EXPECT_EQ(before.misses + 2, stats.misses);
+    EXPECT_LT(before.cachedBytes, stats.cachedBytes);
+
+    ASSERT_TRUE(decodeTiled(decoder.get(), subset, 1, &bitmap));
+    stats = TiledRegionDecoder::stats();
+    EXPECT_EQ(before.hits + 2, stats.hits);
+    EXPECT_EQ(before.misses + 2, stats.misses);
+
+    // Deleting the decoder drops its tiles, including the ones still being prefetched
+    decoder.reset();
+    EXPECT_EQ(before.cachedBytes, TiledRegionDecoder::stats().cachedBytes);
+}
+
+TEST(TiledRegionDecoder, sharesBudget) {
+    ScopedProperty<int> cacheSize(Properties::regionTileCacheSize, 1);
+    const size_t budget = 1024 * 1024;
+    sk_sp<SkData> data = createPng();
+    ASSERT_TRUE(data);
+    const TiledRegionDecoder::Stats before = TiledRegionDecoder::stats();
+    std::unique_ptr<TiledRegionDecoder> first =
+            TiledRegionDecoder::Make(std::make_unique<SkMemoryStream>(data));
+    ASSERT_TRUE(first);
+
+    // A single tile, and then the tiles prefetched around it, up to the whole budget
+    SkBitmap bitmap;
+    ASSERT_TRUE(decodeTiled(first.get(), SkIRect::MakeWH(256, 256), 1, &bitmap));
+    CommonPool::waitForIdle();
+    EXPECT_LT(budget / 2, TiledRegionDecoder::stats().cachedBytes - before.cachedBytes);
+
+    // The first cache shrinks to its half of the budget once a second decoder shares it
+    std::unique_ptr<TiledRegionDecoder> second =
+            TiledRegionDecoder::Make(std::make_unique<SkMemoryStream>(data));
+    ASSERT_TRUE(second);
+    EXPECT_GE(budget / 2, TiledRegionDecoder::stats().cachedBytes - before.cachedBytes);
+
+    first.reset();
+    second.reset();
+    EXPECT_EQ(before.cachedBytes, TiledRegionDecoder::stats().cachedBytes);
+}
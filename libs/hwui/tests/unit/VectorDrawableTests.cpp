@@ -18,10 +18,12 @@
 
 #include "PathParser.h"
 #include "VectorDrawable.h"
+#include "thread/CommonPool.h"
 #include "utils/MathUtils.h"
 #include "utils/VectorDrawableUtils.h"
 
 #include <functional>
+#include <future>
 
 namespace android {
 namespace uirenderer {
@@ -273,6 +275,61 @@ TEST(PathParser, parseStringForData) {
     }
 }
 
+TEST(PathParser, parseFloatsLikeStrtof) {
+    const char* numbers[] = {"0",          "-0",          "1",
+                             "-1",         ".5",          "-.5",
+                             "1.",         "0.1",         "3.14159265",
+                             "123456789",  "16777217",    "1e10",
+                             "1.5e-3",     "2E+2",        "0.000001",
+                             "1e",         "7.038531e-26", "1.00000005960464477539",
+                             "1e-40",      "99999999999999999999999", "0.30000001192092896"};
+    for (const char* number : numbers) {
+        std::string pathString = std::string("M") + number + ",0";
+        PathParser::ParseResult result;
+        PathData pathData;
+        PathParser::getPathDataFromAsciiString(&pathData, &result, pathString.c_str(),
+                                               pathString.size());
+        ASSERT_FALSE(result.failureOccurred) << number;
+        ASSERT_EQ(2u, pathData.points.size()) << number;
+        EXPECT_EQ(strtof(number, nullptr), pathData.points[0]) << number;
+    }
+}
+
+TEST(PathParser, cachedParse) {
+    PathParser::clearCache();
+    const char* pathString = "M12,21.35l-1.45,-1.32C5.4,15.36 2,12.28 2,8.5z";
+    size_t length = strlen(pathString);
+
+    PathParser::ParseResult result;
+    PathData parsedData;
+    PathParser::getPathDataFromAsciiString(&parsedData, &result, pathString, length);
+    ASSERT_FALSE(result.failureOccurred);
+    PathData cachedData;
+    PathParser::getPathDataFromAsciiString(&cachedData, &result, pathString, length);
+    ASSERT_FALSE(result.failureOccurred);
+    EXPECT_EQ(parsedData, cachedData);
+
+    SkPath parsedPath;
+    PathParser::parseAsciiStringForSkPath(&parsedPath, &result, pathString, length);
+    SkPath cachedPath;
+    PathParser::parseAsciiStringForSkPath(&cachedPath, &result, pathString, length);
+    ASSERT_FALSE(result.failureOccurred);
+    EXPECT_EQ(parsedPath, cachedPath);
+    SkPath expectedPath;
+    VectorDrawableUtils::verbsToPath(&expectedPath, parsedData);
+    EXPECT_EQ(expectedPath, cachedPath);
+
+    // Failures are reported every time
+    const char* invalidString = "L1,0 L1,1 L0,1 z M1000";
+    for (int i = 0; i < 2; i++) {
+        PathParser::ParseResult invalidResult;
+        PathData invalidData;
+        PathParser::getPathDataFromAsciiString(&invalidData, &invalidResult, invalidString,
+                                               strlen(invalidString));
+        EXPECT_TRUE(invalidResult.failureOccurred);
+    }
+}
+
 TEST(VectorDrawableUtils, createSkPathFromPathData) {
     for (const TestData& testData : sTestDataSet) {
         SkPath expectedPath;
@@ -409,5 +466,112 @@ TEST(VectorDrawable, drawPathWithoutIncrementingShaderRefCount) {
     EXPECT_TRUE(shader->unique());
 }
 
+static sp<VectorDrawableRoot> createSquareTree(SkColor color,
+                                              VectorDrawable::FullPath** outPath = nullptr) {
+    const char* pathString = "M0,0 L10,0 L10,10 L0,10 z";
+    VectorDrawable::FullPath* path = new VectorDrawable::FullPath(pathString, strlen(pathString));
+    path->mutateStagingProperties()->setFillColor(color);
+    VectorDrawable::Group* group = new VectorDrawable::Group();
+    group->addChild(path);
+    sp<VectorDrawableRoot> tree(new VectorDrawableRoot(group));
+    tree->mutateStagingProperties()->setViewportSize(10, 10);
+    tree->mutateStagingProperties()->setScaledSize(20, 20);
+    tree->mutateStagingProperties()->setBounds(SkRect::MakeWH(20, 20));
+    tree->syncProperties();
+    if (outPath) {
+        *outPath = path;
+    }
+    return tree;
+}
+
+static SkColor getCenterColor(Bitmap& bitmap) {
+    SkBitmap skBitmap;
+    bitmap.getSkBitmap(&skBitmap);
+    return skBitmap.getColor(skBitmap.width() / 2, skBitmap.height() / 2);
+}
+
+TEST(VectorDrawable, shareCacheOfIdenticalTrees) {
+    VectorDrawable::FullPath* path;
+    sp<VectorDrawableRoot> tree = createSquareTree(SK_ColorRED, &path);
+    sp<VectorDrawableRoot> identicalTree = createSquareTree(SK_ColorRED);
+
+    Bitmap& bitmap = tree->getBitmapUpdateIfDirty();
+    EXPECT_EQ(&bitmap, &identicalTree->getBitmapUpdateIfDirty());
+    EXPECT_EQ(SK_ColorRED, getCenterColor(bitmap));
+
+    // Once modified the tree must paint into its own bitmap, leaving the shared one intact
+    path->mutateProperties()->setFillColor(SK_ColorBLUE);
+    ASSERT_TRUE(tree->isDirty());
+    Bitmap& modifiedBitmap = tree->getBitmapUpdateIfDirty();
+    EXPECT_NE(&bitmap, &modifiedBitmap);
+    EXPECT_EQ(SK_ColorBLUE, getCenterColor(modifiedBitmap));
+    EXPECT_EQ(&bitmap, &identicalTree->getBitmapUpdateIfDirty());
+    EXPECT_EQ(SK_ColorRED, getCenterColor(bitmap));
+}
+
+TEST(VectorDrawable, prerasterizeAsync) {
+    VectorDrawable::FullPath* path;
+    sp<VectorDrawableRoot> tree = createSquareTree(SK_ColorGREEN, &path);
+    tree->prerasterizeAsync();
+    EXPECT_FALSE(tree->isDirty());
+    VectorDrawableRoot::waitForPrerasterization();
+    EXPECT_EQ(SK_ColorGREEN, getCenterColor(tree->getBitmapUpdateIfDirty()));
+
+    path->mutateProperties()->setFillColor(SK_ColorYELLOW);
+    ASSERT_TRUE(tree->isDirty());
+    tree->prerasterizeAsync();
+    // Drawing joins the pending repaint
+    EXPECT_EQ(SK_ColorYELLOW, getCenterColor(tree->getBitmapUpdateIfDirty()));
+}
+
+TEST(VectorDrawable, waitForPrerasterizationRunsQueuedRepaints) {
+    VectorDrawable::FullPath* path;
+    sp<VectorDrawableRoot> tree = createSquareTree(SK_ColorGREEN, &path);
+
+    // Keep every pool thread busy, so that the repaint stays queued
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::vector<std::future<void>> blockers;
+    for (int i = 0; i < CommonPool::THREAD_COUNT; i++) {
+        blockers.push_back(CommonPool::async([released] { released.wait(); }));
+    }
+
+    tree->prerasterizeAsync();
+    VectorDrawableRoot::waitForPrerasterization();
+    EXPECT_EQ(SK_ColorGREEN, getCenterColor(tree->getBitmapUpdateIfDirty()));
+
+    release.set_value();
+    for (auto& blocker : blockers) {
+        blocker.get();
+    }
+}
+
+TEST(SharedBitmapCache, evictAndRecycle) {
+    const size_t bitmapSize = 10 * 10 * 4;
+    VectorDrawable::SharedBitmapCache cache(2 * bitmapSize, bitmapSize);
+    const VectorDrawable::SharedBitmapCache::Key key1{1, 10, 10};
+    const VectorDrawable::SharedBitmapCache::Key key2{2, 10, 10};
+    const VectorDrawable::SharedBitmapCache::Key key3{3, 10, 10};
+
+    cache.put(key1, cache.obtain(10, 10));
+    sk_sp<Bitmap> bitmap2 = cache.obtain(10, 10);
+    Bitmap* bitmap2Ptr = bitmap2.get();
+    cache.put(key2, std::move(bitmap2));
+    EXPECT_NE(nullptr, cache.find(key1));
+    EXPECT_EQ(0u, cache.stats().recycled);
+
+    // key2 is now the least recently used entry
+    cache.put(key3, cache.obtain(10, 10));
+    EXPECT_EQ(nullptr, cache.find(key2));
+    EXPECT_NE(nullptr, cache.find(key1));
+    EXPECT_NE(nullptr, cache.find(key3));
+    EXPECT_EQ(1u, cache.stats().evictions);
+    EXPECT_EQ(2 * bitmapSize, cache.stats().cachedBytes);
+
+    // The evicted bitmap is no longer referenced, so it is handed out again
+    EXPECT_EQ(bitmap2Ptr, cache.obtain(10, 10).get());
+    EXPECT_EQ(1u, cache.stats().recycled);
+}
+
 }  // namespace uirenderer
 }  // namespace android
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Properties.h"
+#include "jni/YuvToJpegEncoder.h"
+#include "tests/common/TestUtils.h"
+
+#include <SkBitmap.h>
+#include <SkCodec.h>
+#include <SkData.h>
+#include <hardware/hardware.h>
+
+#include <memory>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// The last strip and the last row of MCUs are partial
+static constexpr int kWidth = 1024;
+static constexpr int kHeight = 1096;
+// The encoders read whole rows of MCUs, past the bottom of the image
+static constexpr int kPaddingRows = 16;
+
+struct YuvImage {
+    int format;
+    std::vector<uint8_t> data;
+    int strides[2];
+    int offsets[2];
+};
+
+// Luma gradients with a little noise, and chroma that varies slowly
+static YuvImage createImage(int format, int width, int height) {
+    YuvImage image;
+    image.format = format;
+    uint32_t seed = 1234;
+    auto noise = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 29;
+    };
+    if (format == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+        image.strides[0] = width;
+        image.strides[1] = width;
+        image.offsets[0] = 0;
+        image.offsets[1] = width * (height + kPaddingRows);
+        image.data.resize(image.offsets[1] + width * (height + kPaddingRows) / 2);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                image.data[y * width + x] = ((x + y) / 4 + noise()) & 0xFF;
+            }
+        }
+        for (int y = 0; y < height / 2; y++) {
+            uint8_t* vu = image.data.data() + image.offsets[1] + y * width;
+            for (int x = 0; x < width / 2; x++) {
+                vu[2 * x] = 128 + (x / 8) % 64;
+                vu[2 * x + 1] = 128 - (y / 8) % 64;
+            }
+        }
+    } else {
+        image.strides[0] = width * 2;
+        image.offsets[0] = 0;
+        image.data.resize(width * 2 * (height + kPaddingRows));
+        for (int y = 0; y < height; y++) {
+            uint8_t* yuyv = image.data.data() + y * width * 2;
+            for (int x = 0; x < width / 2; x++) {
+                yuyv[4 * x] = ((2 * x + y) / 4 + noise()) & 0xFF;
+                yuyv[4 * x + 1] = 128 + (x / 8) % 64;
+                yuyv[4 * x + 2] = ((2 * x + 1 + y) / 4 + noise()) & 0xFF;
+                yuyv[4 * x + 3] = 128 - (y / 8) % 64;
+            }
+        }
+    }
+    return image;
+}
+
+static sk_sp<SkData> encode(YuvImage& image, int width, int height, int threadBudget) {
+    std::unique_ptr<YuvToJpegEncoder> encoder(
+            YuvToJpegEncoder::create(image.format, image.strides));
+    SkDynamicMemoryWStream stream;
+    bool encoded;
+    if (threadBudget == 0) {
+        ScopedProperty<int> compressThreads(Properties::compressThreads, 1);
+        encoded = encoder->encode(&stream, image.data.data(), width, height, image.offsets, 90);
+    } else {
+        encoded = encoder->encodeStrips(&stream, image.data.data(), width, height,
+                                        image.offsets, 90, threadBudget);
+    }
+    return encoded ? stream.detachAsData() : nullptr;
+}
+
+static SkBitmap decode(const sk_sp<SkData>& data) {
+    std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(data);
+    SkBitmap bitmap;
+    if (codec) {
+        bitmap.allocPixels(codec->getInfo().makeColorType(kRGBA_8888_SkColorType));
+        if (codec->getPixels(bitmap.pixmap()) != SkCodec::kSuccess) {
+            bitmap.reset();
+        }
+    }
+    return bitmap;
+}
+
+/**
+ * Encodes planar YCbCr the way YuvToJpegEncoder did before its planes were deinterleaved with
+ * vector instructions, one row of MCUs at a time. chromaHeight is half of height for NV21, and
+ * height for YUY2.
+ */
+static sk_sp<SkData> encodePlanar(const std::vector<uint8_t>& luma,
+                                  const std::vector<uint8_t>& cb, const std::vector<uint8_t>& cr,
+                                  int width, int height, int chromaHeight) {
+    class ReferenceEncoder : public YuvToJpegEncoder {
+    public:
+        ReferenceEncoder(const std::vector<uint8_t>& luma, const std::vector<uint8_t>& cb,
+                         const std::vector<uint8_t>& cr, int chromaRowsPerMcu)
+                : YuvToJpegEncoder(nullptr)
+                , mLuma(luma)
+                , mCb(cb)
+                , mCr(cr)
+                , mChromaRowsPerMcu(chromaRowsPerMcu) {}
+
+    private:
+        void configSamplingFactors(jpeg_compress_struct* cinfo) override {
+            if (mChromaRowsPerMcu == 8) {
+                for (int i = 0; i < 3; i++) {
+                    cinfo->comp_info[i].h_samp_factor = i == 0 ? 2 : 1;
+                    cinfo->comp_info[i].v_samp_factor = i == 0 ? 2 : 1;
+                }
+            } else {
+                for (int i = 0; i < 3; i++) {
+                    cinfo->comp_info[i].h_samp_factor = i == 0 ? 2 : 1;
+                    cinfo->comp_info[i].v_samp_factor = 2;
+                }
+            }
+        }
+
+        void compress(jpeg_compress_struct* cinfo, uint8_t*, int*, int) override {
+            const int width = cinfo->image_width;
+            JSAMPROW y[16];
+            JSAMPROW cb[16];
+            JSAMPROW cr[16];
+            JSAMPARRAY planes[3] = {y, cb, cr};
+            while (cinfo->next_scanline < cinfo->image_height) {
+                const int row = cinfo->next_scanline;
+                const int chromaRow = row * mChromaRowsPerMcu / 16;
+                for (int i = 0; i < 16; i++) {
+                    y[i] = const_cast<uint8_t*>(mLuma.data()) + (row + i) * width;
+                }
+                for (int i = 0; i < mChromaRowsPerMcu; i++) {
+                    cb[i] = const_cast<uint8_t*>(mCb.data()) + (chromaRow + i) * (width / 2);
+                    cr[i] = const_cast<uint8_t*>(mCr.data()) + (chromaRow + i) * (width / 2);
+                }
+                jpeg_write_raw_data(cinfo, planes, 16);
+            }
+        }
+
+        const std::vector<uint8_t>& mLuma;
+        const std::vector<uint8_t>& mCb;
+        const std::vector<uint8_t>& mCr;
+        const int mChromaRowsPerMcu;
+    };
+
+    ReferenceEncoder reference(luma, cb, cr, chromaHeight == height ? 16 : 8);
+    SkDynamicMemoryWStream stream;
+    ScopedProperty<int> compressThreads(Properties::compressThreads, 1);
+    if (!reference.encode(&stream, nullptr, width, height, nullptr, 90)) {
+        return nullptr;
+    }
+    return stream.detachAsData();
+}
+
+TEST(YuvToJpegEncoder, nv21MatchesPlanarEncoding) {
+    // A whole number of MCUs, since the reference doesn't read past the planes
+    const int width = kWidth;
+    const int height = 1088;
+    YuvImage image = createImage(HAL_PIXEL_FORMAT_YCrCb_420_SP, width, height);
+    std::vector<uint8_t> luma(image.data.begin(), image.data.begin() + width * height);
+    std::vector<uint8_t> cb(width * height / 4);
+    std::vector<uint8_t> cr(width * height / 4);
+    const uint8_t* vu = image.data.data() + image.offsets[1];
+    for (size_t i = 0; i < cb.size(); i++) {
+        cr[i] = vu[2 * i];
+        cb[i] = vu[2 * i + 1];
+    }
+
+    sk_sp<SkData> expected = encodePlanar(luma, cb, cr, width, height, height / 2);
+    sk_sp<SkData> actual = encode(image, width, height, 0);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(actual);
+    EXPECT_TRUE(expected->equals(actual.get()));
+}
+
+TEST(YuvToJpegEncoder, yuy2MatchesPlanarEncoding) {
+    const int width = kWidth;
+    const int height = 1088;
+    YuvImage image = createImage(HAL_PIXEL_FORMAT_YCbCr_422_I, width, height);
+    std::vector<uint8_t> luma(width * height);
+    std::vector<uint8_t> cb(width * height / 2);
+    std::vector<uint8_t> cr(width * height / 2);
+    for (size_t i = 0; i < cb.size(); i++) {
+        luma[2 * i] = image.data[4 * i];
+        cb[i] = image.data[4 * i + 1];
+        luma[2 * i + 1] = image.data[4 * i + 2];
+        cr[i] = image.data[4 * i + 3];
+    }
+
+    sk_sp<SkData> expected = encodePlanar(luma, cb, cr, width, height, height);
+    sk_sp<SkData> actual = encode(image, width, height, 0);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(actual);
+    EXPECT_TRUE(expected->equals(actual.get()));
+}
+
+TEST(YuvToJpegEncoder, stripsDecodeLikeSequential) {
+    for (int format : {HAL_PIXEL_FORMAT_YCrCb_420_SP, HAL_PIXEL_FORMAT_YCbCr_422_I}) {
+        YuvImage image = createImage(format, kWidth, kHeight);
+        SkBitmap expected = decode(encode(image, kWidth, kHeight, 0));
+        ASSERT_EQ(kWidth, expected.width());
+        ASSERT_EQ(kHeight, expected.height());
+
+        for (int threadBudget : {1, 2, 4}) {
+            SkBitmap actual = decode(encode(image, kWidth, kHeight, threadBudget));
+            ASSERT_EQ(kWidth, actual.width());
+            ASSERT_EQ(kHeight, actual.height());
+            // Restart markers only reset the DC predictions, so the coefficients and therefore
+            // the decoded pixels are exactly the same
+            for (int y = 0; y < kHeight; y++) {
+                ASSERT_EQ(0, memcmp(expected.getAddr(0, y), actual.getAddr(0, y), kWidth * 4))
+                        << "format " << format << ", budget " << threadBudget << ", row " << y;
+            }
+        }
+    }
+}
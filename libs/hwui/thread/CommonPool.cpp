@@ -20,11 +20,39 @@
 #include <utils/Trace.h>
 #include "renderthread/RenderThread.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 
 namespace android {
 namespace uirenderer {
 
+namespace {
+
+struct ParallelForState {
+    std::atomic<int> next{0};
+    int count = 0;
+    // Only dereferenced while a task is claimed, so it outlives every use
+    const std::function<void(int)>* task = nullptr;
+
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining = 0;
+
+    void runTasks() {
+        int index;
+        while ((index = next.fetch_add(1)) < count) {
+            (*task)(index);
+            std::lock_guard<std::mutex> guard(lock);
+            if (--remaining == 0) {
+                done.notify_all();
+            }
+        }
+    }
+};
+
+}  // namespace
+
 CommonPool::CommonPool() {
     ATRACE_CALL();
 
@@ -58,6 +86,29 @@ void CommonPool::post(Task&& task) {
     instance().enqueue(std::move(task));
 }
 
+void CommonPool::parallelFor(int count, int threadBudget, const std::function<void(int)>& task) {
+    int helpers = std::min(std::min(threadBudget, count) - 1, static_cast<int>(THREAD_COUNT));
+    if (helpers <= 0) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->count = count;
+    state->task = &task;
+    state->remaining = count;
+    for (int i = 0; i < helpers; i++) {
+        post([state] { state->runTasks(); });
+    }
+    state->runTasks();
+
+    // Helpers that start after every task was claimed return without touching task
+    std::unique_lock<std::mutex> lock(state->lock);
+    state->done.wait(lock, [&state] { return state->remaining == 0; });
+}
+
 void CommonPool::enqueue(Task&& task) {
     std::unique_lock lock(mLock);
     while (!mWorkQueue.hasSpace()) {
@@ -97,6 +97,11 @@ public:
         return task.get_future().get();
     };
 
+    // Runs task(0) to task(count - 1) on the calling thread and up to threadBudget - 1 worker
+    // threads, and returns once all of them have completed. The calling thread claims tasks
+    // too, so it never waits on work queued behind other users of the pool.
+    static void parallelFor(int count, int threadBudget, const std::function<void(int)>& task);
+
     // For testing purposes only, blocks until all worker threads are parked.
     static void waitForIdle();
 
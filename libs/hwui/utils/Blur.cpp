@@ -19,6 +19,11 @@
 #include "Blur.h"
 #include "MathUtils.h"
 
+#include "include/private/SkVx.h"
+
+#include <algorithm>
+#include <vector>
+
 namespace android {
 namespace uirenderer {
 
@@ -91,8 +96,8 @@ void Blur::generateGaussianWeights(float* weights, float radius) {
     }
 }
 
-void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                      int32_t width, int32_t height) {
+void Blur::horizontalScalar(float* weights, int32_t radius, const uint8_t* source,
+                            uint8_t* dest, int32_t width, int32_t height) {
     float blurredPixel = 0.0f;
     float currentPixel = 0.0f;
 
@@ -134,8 +139,8 @@ void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uin
     }
 }
 
-void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                    int32_t width, int32_t height) {
+void Blur::verticalScalar(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                          int32_t width, int32_t height) {
     float blurredPixel = 0.0f;
     float currentPixel = 0.0f;
 
@@ -178,5 +183,183 @@ void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8
     }
 }
 
+// Pixels processed at once by the vectorized kernels
+static constexpr int32_t LANES = 8;
+using FloatLanes = skvx::Vec<LANES, float>;
+using ByteLanes = skvx::Vec<LANES, uint8_t>;
+
+// Blurs a single pixel of a row, clamping to its edges, as horizontalScalar does
+static inline uint8_t blurRowPixel(const float* weights, int32_t radius, const uint8_t* input,
+                                   int32_t x, int32_t width) {
+    float blurredPixel = 0.0f;
+    for (int32_t r = -radius; r <= radius; r++) {
+        int32_t validW = std::min(std::max(x + r, 0), width - 1);
+        blurredPixel += (float)input[validW] * weights[r + radius];
+    }
+    return (uint8_t)blurredPixel;
+}
+
+void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                      int32_t width, int32_t height) {
+    // Pixels whose kernel lies within the row are computed LANES at a time, in the same order as
+    // horizontalScalar so that rounding differences stay within a unit
+    const int32_t interiorStart = std::min(radius + 1, width);
+    const int32_t interiorEnd = std::max(width - radius, interiorStart);
+
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* input = source + y * width;
+        uint8_t* output = dest + y * width;
+
+        int32_t x = 0;
+        for (; x < interiorStart; x++) {
+            output[x] = blurRowPixel(weights, radius, input, x, width);
+        }
+        for (; x + LANES <= interiorEnd; x += LANES) {
+            const uint8_t* i = input + (x - radius);
+            FloatLanes blurredPixels(0.0f);
+            for (int32_t r = 0; r <= 2 * radius; r++) {
+                blurredPixels += skvx::cast<float>(ByteLanes::Load(i + r)) * weights[r];
+            }
+            skvx::cast<uint8_t>(blurredPixels).store(output + x);
+        }
+        for (; x < width; x++) {
+            output[x] = blurRowPixel(weights, radius, input, x, width);
+        }
+    }
+}
+
+void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                    int32_t width, int32_t height) {
+    // Rows contributing to the current output row, clamped to the top and bottom edges
+    std::vector<const uint8_t*> rows(2 * radius + 1);
+
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* output = dest + y * width;
+        for (int32_t r = -radius; r <= radius; r++) {
+            int32_t validH = std::min(std::max(y + r, 0), height - 1);
+            rows[r + radius] = source + validH * width;
+        }
+
+        int32_t x = 0;
+        for (; x + LANES <= width; x += LANES) {
+            FloatLanes blurredPixels(0.0f);
+            for (int32_t r = 0; r <= 2 * radius; r++) {
+                blurredPixels += skvx::cast<float>(ByteLanes::Load(rows[r] + x)) * weights[r];
+            }
+            skvx::cast<uint8_t>(blurredPixels).store(output + x);
+        }
+        for (; x < width; x++) {
+            float blurredPixel = 0.0f;
+            for (int32_t r = 0; r <= 2 * radius; r++) {
+                blurredPixel += (float)rows[r][x] * weights[r];
+            }
+            output[x] = (uint8_t)blurredPixel;
+        }
+    }
+}
+
+void Blur::computeBoxRadii(float radius, int32_t* outBoxRadii) {
+    // The widths of BOX_PASSES boxes whose successive application has the same variance as the
+    // gaussian. All boxes have an odd width of either lowerWidth or lowerWidth + 2.
+    float sigma = legacyConvertRadiusToSigma(radius);
+    float variance = 12.0f * sigma * sigma;
+    int32_t lowerWidth = floorf(sqrtf(variance / BOX_PASSES + 1.0f));
+    if (lowerWidth % 2 == 0) {
+        lowerWidth--;
+    }
+    lowerWidth = std::max(lowerWidth, 1);
+    int32_t lowerCount =
+            roundf((variance - BOX_PASSES * lowerWidth * lowerWidth - 4 * BOX_PASSES * lowerWidth -
+                    3 * BOX_PASSES) /
+                   (-4.0f * lowerWidth - 4.0f));
+    lowerCount = std::min(std::max(lowerCount, 0), BOX_PASSES);
+    for (int i = 0; i < BOX_PASSES; i++) {
+        int32_t boxWidth = i < lowerCount ? lowerWidth : lowerWidth + 2;
+        outBoxRadii[i] = (boxWidth - 1) / 2;
+    }
+}
+
+// Dividing the sum of a box by its size is done as a fixed point multiplication. The sum is at
+// most 255 * size, so sum * boxScale(size) + rounding stays below 2^32.
+static inline uint32_t boxScale(int32_t boxRadius) {
+    return roundf(float(1 << 24) / (2 * boxRadius + 1));
+}
+
+static inline uint8_t boxAverage(uint32_t sum, uint32_t scale) {
+    return (sum * scale + (1 << 23)) >> 24;
+}
+
+void Blur::boxHorizontal(int32_t boxRadius, const uint8_t* source, uint8_t* dest, int32_t width,
+                         int32_t height) {
+    const uint32_t scale = boxScale(boxRadius);
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* input = source + y * width;
+        uint8_t* output = dest + y * width;
+
+        // Running sum of the box centered on x, sliding one pixel at a time
+        uint32_t sum = 0;
+        for (int32_t r = -boxRadius; r <= boxRadius; r++) {
+            sum += input[std::min(std::max(r, 0), width - 1)];
+        }
+        for (int32_t x = 0; x < width; x++) {
+            output[x] = boxAverage(sum, scale);
+            sum += input[std::min(x + boxRadius + 1, width - 1)];
+            sum -= input[std::max(x - boxRadius, 0)];
+        }
+    }
+}
+
+void Blur::boxVertical(int32_t boxRadius, const uint8_t* source, uint8_t* dest, int32_t width,
+                       int32_t height) {
+    const uint32_t scale = boxScale(boxRadius);
+    // Running sums of the boxes of a whole row, so that the inner loops run along rows and are
+    // vectorized by the compiler
+    std::vector<uint32_t> sums(width, 0);
+    for (int32_t r = -boxRadius; r <= boxRadius; r++) {
+        const uint8_t* input = source + std::min(std::max(r, 0), height - 1) * width;
+        for (int32_t x = 0; x < width; x++) {
+            sums[x] += input[x];
+        }
+    }
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* output = dest + y * width;
+        for (int32_t x = 0; x < width; x++) {
+            output[x] = boxAverage(sums[x], scale);
+        }
+        const uint8_t* added = source + std::min(y + boxRadius + 1, height - 1) * width;
+        const uint8_t* removed = source + std::max(y - boxRadius, 0) * width;
+        for (int32_t x = 0; x < width; x++) {
+            sums[x] += added[x] - removed[x];
+        }
+    }
+}
+
+void Blur::blur(float radius, const uint8_t* source, uint8_t* dest, uint8_t* temp, int32_t width,
+                int32_t height) {
+    int32_t intRadius = convertRadiusToInt(radius);
+    if (intRadius < BOX_APPROXIMATION_MIN_RADIUS) {
+        std::vector<float> weights(2 * intRadius + 1);
+        generateGaussianWeights(weights.data(), radius);
+        horizontal(weights.data(), intRadius, source, temp, width, height);
+        vertical(weights.data(), intRadius, temp, dest, width, height);
+        return;
+    }
+
+    int32_t boxRadii[BOX_PASSES];
+    computeBoxRadii(radius, boxRadii);
+    // Ping-pong between temp and dest. There is an even number of passes, so the last one
+    // writes to dest.
+    const uint8_t* input = source;
+    for (int pass = 0; pass < 2 * BOX_PASSES; pass++) {
+        uint8_t* output = pass % 2 == 0 ? temp : dest;
+        if (pass < BOX_PASSES) {
+            boxHorizontal(boxRadii[pass], input, output, width, height);
+        } else {
+            boxVertical(boxRadii[pass - BOX_PASSES], input, output, width, height);
+        }
+        input = output;
+    }
+}
+
 }  // namespace uirenderer
 }  // namespace android
@@ -35,10 +35,38 @@ public:
     static uint32_t convertRadiusToInt(float radius);
 
     static void generateGaussianWeights(float* weights, float radius);
+    // Convolves each row, or each column, with the 2 * radius + 1 weights generated above.
+    // These are vectorized versions of horizontalScalar and verticalScalar, which they match to
+    // within one unit.
     static void horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
                            int32_t width, int32_t height);
     static void vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
                          int32_t width, int32_t height);
+    // Reference implementations, kept to validate the vectorized ones
+    static void horizontalScalar(float* weights, int32_t radius, const uint8_t* source,
+                                 uint8_t* dest, int32_t width, int32_t height);
+    static void verticalScalar(float* weights, int32_t radius, const uint8_t* source,
+                               uint8_t* dest, int32_t width, int32_t height);
+
+    // Number of box blurs used to approximate a gaussian blur
+    static constexpr int BOX_PASSES = 3;
+    // Radius from which "blur" approximates the gaussian with box blurs. The cost of the
+    // gaussian kernels grows with the radius while box blurs cost the same at any radius.
+    static constexpr int32_t BOX_APPROXIMATION_MIN_RADIUS = 12;
+
+    // Computes the radii of BOX_PASSES successive box blurs approximating the gaussian blur
+    // generated by generateGaussianWeights for the given radius.
+    static void computeBoxRadii(float radius, int32_t* outBoxRadii);
+    // Averages each pixel with the boxRadius pixels on each side of it, clamping at the edges
+    static void boxHorizontal(int32_t boxRadius, const uint8_t* source, uint8_t* dest,
+                              int32_t width, int32_t height);
+    static void boxVertical(int32_t boxRadius, const uint8_t* source, uint8_t* dest,
+                            int32_t width, int32_t height);
+
+    // Blurs source along both axes into dest, either with the gaussian kernels or, from
+    // BOX_APPROXIMATION_MIN_RADIUS, with box blurs. temp must hold width * height bytes.
+    static void blur(float radius, const uint8_t* source, uint8_t* dest, uint8_t* temp,
+                     int32_t width, int32_t height);
 };
 
 }  // namespace uirenderer